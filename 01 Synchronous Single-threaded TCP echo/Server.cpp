@@ -82,27 +82,41 @@ int main() {
     int iSendResult;
     int iRecvResult;
 
+    // 回显前缀是一个静态的缓冲区段，不随消息复制
+    // The echo prefix is a static buffer segment that is never copied per message
+    static char sendPrefix[] = "Server:";
+    const ULONG sendPrefixLen = sizeof(sendPrefix) - 1;
+
     do {
         // 阻塞等待接收数据
         // Blocking call to receive data
         iRecvResult = recv(ClientSocket, recvbuf, recvbuflen, 0);
         if (iRecvResult > 0) {
-            // 将接收到的数据转换为 std::string 便于显示
-            // Convert the received data to std::string for display
-            std::string receivedMsg(recvbuf, iRecvResult);
-            std::cout << "Server received: " << receivedMsg << std::endl;
-
-            // 准备回显消息，加上前缀 "Server:"
-            // Prepare the echo message by prefixing "Server:"
-            std::string sendMsg = "Server:" + receivedMsg;
-            iSendResult = send(ClientSocket, sendMsg.c_str(), (int)sendMsg.size(), 0);
+            // 直接输出接收缓冲区中的数据，不再复制为 std::string
+            // Print the data straight from the receive buffer instead of copying it into a std::string
+            std::cout << "Server received: ";
+            std::cout.write(recvbuf, iRecvResult) << std::endl;
+
+            // 准备回显消息，加上前缀 "Server:"：前缀与接收缓冲区作为两个 WSABUF，用一次 WSASend 发出（聚集发送），
+            // 不再为 "Server:" + 数据 分配并拼接新字符串
+            // Prepare the echo message prefixed with "Server:": the prefix and the receive buffer go out
+            // as two WSABUFs in one WSASend (a gather send) instead of allocating and concatenating a
+            // new "Server:" + data string
+            WSABUF sendBufs[2];
+            sendBufs[0].buf = sendPrefix;
+            sendBufs[0].len = sendPrefixLen;
+            sendBufs[1].buf = recvbuf;
+            sendBufs[1].len = (ULONG)iRecvResult;
+            DWORD bytesSent = 0;
+            iSendResult = WSASend(ClientSocket, sendBufs, 2, &bytesSent, 0, NULL, NULL);
             if (iSendResult == SOCKET_ERROR) {
                 std::cerr << "send failed: " << WSAGetLastError() << std::endl;
                 closesocket(ClientSocket);
                 WSACleanup();
                 return 1;
             }
-            std::cout << "Server sent: " << sendMsg << std::endl;
+            std::cout << "Server sent: " << sendPrefix;
+            std::cout.write(recvbuf, iRecvResult) << std::endl;
         }
         else if (iRecvResult == 0) {
             std::cout << "Connection closing..." << std::endl;
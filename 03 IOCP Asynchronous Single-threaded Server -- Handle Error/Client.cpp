@@ -17,6 +17,7 @@
 #include <cstring>
 #include <thread>
 #include <string>
+#include "../Common/ObjectPool.h"
 
 #pragma comment(lib, "Ws2_32.lib")
 
@@ -117,7 +118,7 @@ public:
             return false;
         }
 
-        auto* pConnIOData = new PerIOData(clientSocket);
+        auto* pConnIOData = ioPool.create(clientSocket);
         pConnIOData->operationType = IO_OPERATION::CONNECT; // 连接操作类型（仅用于检测完成） / Mark as CONNECT.
         pConnIOData->wsaBuf.buf = pConnIOData->buffer;
         pConnIOData->wsaBuf.len = 0;
@@ -127,7 +128,7 @@ public:
             int err = WSAGetLastError();
             if (err != ERROR_IO_PENDING) {
                 std::cerr << "ConnectEx failed. Error: " << err << std::endl;
-                delete pConnIOData;
+                ioPool.destroy(pConnIOData);
                 return false;
             }
         }
@@ -151,14 +152,14 @@ public:
             if (pIOData->operationType == IO_OPERATION::CONNECT) {
                 if (setsockopt(clientSocket, SOL_SOCKET, SO_UPDATE_CONNECT_CONTEXT, nullptr, 0) == SOCKET_ERROR) {
                     std::cerr << "setsockopt(SO_UPDATE_CONNECT_CONTEXT) failed. Error: " << WSAGetLastError() << std::endl;
-                    delete pIOData;
+                    ioPool.destroy(pIOData);
                     return false;
                 }
                 std::cout << "Connected to the server successfully." << std::endl;
-                delete pIOData;
+                ioPool.destroy(pIOData);
                 break;
             }
-            delete pIOData;
+            ioPool.destroy(pIOData);
         }
         return true;
     }
@@ -184,11 +185,16 @@ public:
         }
 
         worker.join();
+
+        PoolStats pool = ioPool.stats();
+        std::cout << "PerIOData pool: hits=" << pool.hits << " misses=" << pool.misses
+            << " high_water=" << pool.highWater << std::endl;
     }
 
 private:
     HANDLE hIocp;         // IOCP 句柄 / IOCP handle
     SOCKET clientSocket;  // 客户端套接字 / Client socket
+    ObjectPool<PerIOData> ioPool;  // PerIOData 对象池，发送在主线程分配、在工作线程释放 / Pool: sends are allocated on the main thread, freed on the worker
 
     // 后台线程：不断调用 GetQueuedCompletionStatus 处理接收和发送完成事件
     // Background thread: continuously process I/O events.
@@ -210,29 +216,29 @@ private:
             if (pIOData->operationType == IO_OPERATION::RECV) {
                 if (bytesTransferred == 0) {
                     std::cout << "Server closed connection." << std::endl;
-                    delete pIOData;
+                    ioPool.destroy(pIOData);
                     break;
                 }
                 else {
                     pIOData->buffer[bytesTransferred] = '\0';
                     std::cout << "Received echo from server: " << pIOData->buffer << std::endl;
                     postRecv();
-                    delete pIOData;
+                    ioPool.destroy(pIOData);
                 }
             }
             else if (pIOData->operationType == IO_OPERATION::SEND) {
                 std::cout << "Message sent to server." << std::endl;
-                delete pIOData;
+                ioPool.destroy(pIOData);
             }
             else {
-                delete pIOData;
+                ioPool.destroy(pIOData);
             }
         }
     }
 
     // 投递异步接收操作（WSARecv） / Post an asynchronous receive (WSARecv) operation.
     void postRecv() {
-        auto* pIOData = new PerIOData(clientSocket);
+        auto* pIOData = ioPool.create(clientSocket);
         pIOData->operationType = IO_OPERATION::RECV;
         DWORD flags = 0;
         DWORD bytesReceived = 0;
@@ -242,7 +248,7 @@ private:
             if (err != WSA_IO_PENDING) {
                 std::cerr << "WSARecv failed. Error: " << err << std::endl;
                 closesocket(clientSocket);
-                delete pIOData;
+                ioPool.destroy(pIOData);
                 return;
             }
         }
@@ -251,7 +257,7 @@ private:
 
     // 投递异步发送操作（WSASend） / Post an asynchronous send (WSASend) operation with the given message.
     void postSend(const std::string& msg) {
-        auto* pIOData = new PerIOData(clientSocket);
+        auto* pIOData = ioPool.create(clientSocket);
         size_t msgLen = msg.size();
         if (msgLen > IO_BUFFER_SIZE)
             msgLen = IO_BUFFER_SIZE; // 超长则截断 / Truncate if too long.
@@ -265,7 +271,7 @@ private:
             int err = WSAGetLastError();
             if (err != WSA_IO_PENDING) {
                 std::cerr << "WSASend failed. Error: " << err << std::endl;
-                delete pIOData;
+                ioPool.destroy(pIOData);
                 return;
             }
         }
@@ -0,0 +1,359 @@
+// CoServer.cpp
+// 用协程写成的回显服务器：与 Server.cpp 使用同一个完成引擎，连接逻辑是一个顺序的 co_await 循环
+// Echo server written with coroutines: the same completion engine as Server.cpp, with the
+// connection logic as one straight-line co_await loop
+//
+// Server.cpp 中一个连接的逻辑分散在 postRecv、handleRecv 与 handleSend 中，状态靠 operationType 传递；
+// 这里它是 serveConnection 中的一个循环：读、按帧切分、回显，直到对端关闭。接受连接的是 --accepts 个
+// 同样写成循环的协程。请求对象与协程帧都不经过堆分配（见 Coroutine.h）。
+// In Server.cpp a connection's logic is spread over postRecv, handleRecv and handleSend, with the
+// state passed along in operationType; here it is one loop in serveConnection: read, split into
+// frames, echo, until the peer closes. Connections are accepted by --accepts coroutines written
+// as loops too. Neither the requests nor the coroutine frames come from the heap (see Coroutine.h).
+//
+// 同一连接上读与写严格交替，与 Server.cpp 的 --high-water 0 相同；超时与指标端口只在 Server.cpp 中提供。
+// Reads and writes alternate strictly on a connection, as with Server.cpp's --high-water 0;
+// timeouts and the metrics port are only in Server.cpp.
+//
+// 需要 C++20 / Requires C++20:
+//   Windows: cl /std:c++20 /EHsc /O2 CoServer.cpp
+//   Linux:   g++ -std=c++20 -O2 -pthread CoServer.cpp -o CoServer
+
+#include "Coroutine.h"
+#include "../Common/Logger.h"
+#include "../Common/Framing.h"
+#include "../Common/Metrics.h"
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <csignal>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+
+// 定义监听端口 / Define listening port
+constexpr int PORT = 8888;
+// 默认等待接受连接的协程数 / Default number of coroutines waiting for connections
+constexpr int DEFAULT_ACCEPTORS = 8;
+// 取出完成事件的超时时间（毫秒） / Timeout for dequeuing completions (ms)
+constexpr DWORD WAIT_TIMEOUT_MS = 1000;
+// 接受失败（例如描述符用尽）后退避的最长时间（毫秒），从 1 ms 起每次加倍
+// Longest backoff after a failed accept such as running out of descriptors (ms); it starts at 1 ms and doubles.
+constexpr int MAX_ACCEPT_BACKOFF_MS = 100;
+// 停止时取走被取消操作的完成事件，这么久没有新的就认为取完了（毫秒）
+// When stopping, the completions of the cancelled operations are taken until none arrives for this long (ms).
+constexpr DWORD DRAIN_QUIET_MS = 100;
+
+// 计数的编号 / Counter ids
+enum class CoMetric : size_t {
+    Accepts,
+    Frames,
+    Echoes,
+    Errors
+};
+
+// 服务器配置 / Server configuration
+struct CoServerConfig {
+    int port{ PORT };                                            // 监听端口 / Listening port
+    int workerThreads{ static_cast<int>(std::thread::hardware_concurrency()) }; // 工作线程数 / Worker threads
+    std::string engine{ defaultEngineName() };                   // 完成引擎 / Completion engine
+    int acceptors{ DEFAULT_ACCEPTORS };                          // 等待接受连接的协程数 / Coroutines waiting for connections
+    LogLevel logLevel{ LogLevel::Debug };                        // 日志级别 / Log level
+    FrameMode framing{ FrameMode::Raw };                         // 分帧方式 / Message framing
+    int batch{ 64 };                                             // 每次最多取出的完成事件数 / Most completions dequeued at once
+};
+
+// 收到 Ctrl+C / SIGTERM 后置位，工作线程在下一次唤醒时退出
+// Set on Ctrl+C / SIGTERM; workers leave their loop on the next wakeup.
+static std::atomic<bool> g_stopRequested{ false };
+
+#ifdef _WIN32
+static BOOL WINAPI consoleCtrlHandler(DWORD) {
+    g_stopRequested = true;
+    return TRUE;
+}
+#else
+static void stopSignalHandler(int) {
+    g_stopRequested = true;
+}
+#endif
+
+// 一个连接的全部逻辑。完全位于本次读缓冲区中的帧是连续的一段，直接从读缓冲区写回；
+// 只有从 carry 补全的跨边界帧才需要复制到 split 中。协程结束时 socket 析构并关闭连接。
+// A connection's whole logic. Frames lying entirely within this read's buffer form one run and
+// are written straight back from it; only a split frame completed from the carry is copied into
+// split. When the coroutine ends, socket is destroyed and the connection closed.
+static Task serveConnection(AsyncSocket socket, FrameMode framing) {
+    FrameDecoder decoder(framing);
+    std::vector<char> split;
+    while (true) {
+        IoResult r = co_await socket.asyncRead();
+        if (!r.ok()) {
+            if (r.error != 0) {
+                LOG_WARN("Read failed on socket %llu. Error: %d", static_cast<unsigned long long>(socket.native()), r.error);
+                Metrics::add(CoMetric::Errors);
+            }
+            else {
+                LOG_INFO("Client disconnected. Socket: %llu", static_cast<unsigned long long>(socket.native()));
+            }
+            co_return;
+        }
+        const char* inPlaceBegin = nullptr;
+        const char* inPlaceEnd = nullptr;
+        int64_t frames = 0;
+        split.clear();
+        bool valid = decoder.feed(r.data, r.bytes, [&](std::string_view, std::string_view wire) {
+            ++frames;
+            if (std::less<const char*>()(wire.data(), r.data) || !std::less<const char*>()(wire.data(), r.data + r.bytes))
+                split.insert(split.end(), wire.begin(), wire.end());
+            else {
+                if (!inPlaceBegin)
+                    inPlaceBegin = wire.data();
+                inPlaceEnd = wire.data() + wire.size();
+            }
+        });
+        if (!valid) {
+            LOG_WARN("Oversized frame on socket %llu, closing.", static_cast<unsigned long long>(socket.native()));
+            Metrics::add(CoMetric::Errors);
+            co_return;
+        }
+        if (frames == 0)
+            continue; // 只收到半个帧 / Only part of a frame arrived
+        Metrics::add(CoMetric::Frames, frames);
+        if (split.empty()) {
+            r = co_await socket.asyncWrite(inPlaceBegin, static_cast<size_t>(inPlaceEnd - inPlaceBegin));
+        }
+        else {
+            if (inPlaceBegin)
+                split.insert(split.end(), inPlaceBegin, inPlaceEnd);
+            r = co_await socket.asyncWrite(split.data(), split.size());
+        }
+        if (r.error != 0) {
+            LOG_WARN("Write failed on socket %llu. Error: %d", static_cast<unsigned long long>(socket.native()), r.error);
+            Metrics::add(CoMetric::Errors);
+            co_return;
+        }
+        Metrics::add(CoMetric::Echoes);
+    }
+}
+
+// 接受连接的循环：每接受一个连接就启动一个 serveConnection，它运行到第一次读时返回这里。
+// 接受失败时（例如 EMFILE，监听套接字仍然就绪）先退避再重试，而不是原地空转；退避期间这个工作线程睡眠
+// Accept loop: every accepted connection starts a serveConnection, which returns here once it
+// reaches its first read. After a failed accept (EMFILE, say, with the listener still ready) it
+// backs off before retrying instead of spinning; this worker sleeps during the backoff.
+static Task acceptConnections(AsyncListener& listener, FrameMode framing) {
+    int backoffMs = 0;
+    while (!g_stopRequested) {
+        int error = 0;
+        AsyncSocket socket = co_await listener.asyncAccept(&error);
+        if (!socket) {
+            if (g_stopRequested)
+                co_return;
+            LOG_WARN_EVERY(100, "Accept failed. Error: %d", error);
+            Metrics::add(CoMetric::Errors);
+            backoffMs = std::min(MAX_ACCEPT_BACKOFF_MS, backoffMs ? backoffMs * 2 : 1);
+            std::this_thread::sleep_for(std::chrono::milliseconds(backoffMs));
+            continue;
+        }
+        backoffMs = 0;
+        LOG_INFO("Accepted a new connection. Client socket: %llu", static_cast<unsigned long long>(socket.native()));
+        Metrics::add(CoMetric::Accepts);
+        serveConnection(std::move(socket), framing);
+    }
+}
+
+class CoServer {
+public:
+    explicit CoServer(const CoServerConfig& cfg) : config(cfg) {
+        config.workerThreads = std::max(1, config.workerThreads);
+        config.acceptors = std::max(1, config.acceptors);
+        config.batch = std::max(1, std::min(config.batch, static_cast<int>(MAX_COMPLETION_BATCH)));
+    }
+
+    ~CoServer() {
+        listener.reset();
+        if (listenHandle)
+            engine->release(listenHandle);
+        else if (listenSocket != INVALID_SOCKET)
+            closesocket(listenSocket);
+        engine.reset();
+        WSACleanup();
+    }
+
+    // 初始化 Winsock、创建监听套接字与完成引擎 / Start Winsock, create the listening socket and the engine
+    bool initialize() {
+        WSADATA wsaData;
+        int iResult = WSAStartup(MAKEWORD(2, 2), &wsaData);
+        if (iResult != 0) {
+            std::cerr << "WSAStartup failed. Error: " << iResult << std::endl;
+            return false;
+        }
+        listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (listenSocket == INVALID_SOCKET) {
+            std::cerr << "Failed to create listening socket. Error: " << WSAGetLastError() << std::endl;
+            return false;
+        }
+#ifndef _WIN32
+        int reuse = 1;
+        setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+        sockaddr_in serverAddr{};
+        serverAddr.sin_family = AF_INET;
+        serverAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+        serverAddr.sin_port = htons(static_cast<unsigned short>(config.port));
+        if (bind(listenSocket, reinterpret_cast<sockaddr*>(&serverAddr), sizeof(serverAddr)) == SOCKET_ERROR) {
+            std::cerr << "Bind failed. Error: " << WSAGetLastError() << std::endl;
+            return false;
+        }
+        if (listen(listenSocket, SOMAXCONN) == SOCKET_ERROR) {
+            std::cerr << "Listen failed. Error: " << WSAGetLastError() << std::endl;
+            return false;
+        }
+        engine = createEngine(config.engine);
+        if (!engine) {
+            std::cerr << "Unknown engine: " << config.engine << std::endl;
+            return false;
+        }
+        if (!engine->open(config.workerThreads))
+            return false;
+        listenHandle = engine->attach(listenSocket, nullptr);
+        if (!listenHandle) {
+            std::cerr << "Failed to associate listening socket with the engine. Error: " << GetLastError() << std::endl;
+            return false;
+        }
+        listener = std::make_unique<AsyncListener>(engine.get(), listenHandle, listenSocket);
+        std::cout << "Coroutine server listening on port " << config.port
+            << " (engine: " << engine->name() << ", worker threads: " << config.workerThreads
+            << ", acceptors: " << config.acceptors << ")" << std::endl;
+        return true;
+    }
+
+    // 启动接受协程，再在工作线程上恢复完成的协程 / Start the accept coroutines, then resume completed coroutines on the workers
+    void run() {
+        for (int i = 0; i < config.acceptors; ++i)
+            acceptConnections(*listener, config.framing);
+        std::vector<std::thread> workers;
+        for (int i = 1; i < config.workerThreads; ++i)
+            workers.emplace_back(&CoServer::workerLoop, this);
+        workerLoop();
+        for (auto& t : workers)
+            t.join();
+        destroyFrames();
+    }
+
+    uint64_t syscalls() const { return engine ? engine->syscallCount() : 0; }
+
+private:
+    CoServerConfig config;
+    SOCKET listenSocket{ INVALID_SOCKET };
+    std::unique_ptr<CompletionEngine> engine;
+    IoHandle* listenHandle{ nullptr };
+    std::unique_ptr<AsyncListener> listener;
+
+    void workerLoop() {
+        std::vector<Completion> batch(static_cast<size_t>(config.batch));
+        while (!g_stopRequested) {
+            size_t n = engine->waitBatch(batch.data(), batch.size(), WAIT_TIMEOUT_MS);
+            for (size_t i = 0; i < n; ++i)
+                resumeCompletion(batch[i]);
+            // 整批恢复完后一起提交协程写出的数据 / Submit what the coroutines wrote once the whole batch has been resumed
+            engine->flush();
+        }
+    }
+
+    // 工作线程都已退出：取消接受与所有连接上在途的操作，取走它们的完成事件而不恢复协程，
+    // 内核不再写入帧中的请求之后销毁仍挂起的帧
+    // The workers have all left: cancel the accepts and the operations in flight on every
+    // connection, take their completions without resuming the coroutines, and once the kernel no
+    // longer writes into the requests in the frames, destroy the frames still suspended.
+    void destroyFrames() {
+        engine->detachListener(listenHandle);
+        AsyncSocket::abortAll();
+        std::vector<Completion> batch(static_cast<size_t>(config.batch));
+        while (engine->waitBatch(batch.data(), batch.size(), DRAIN_QUIET_MS) > 0) {}
+        size_t destroyed = Task::destroyAll();
+        if (destroyed > 0)
+            LOG_INFO("Destroyed %zu suspended coroutine frames.", destroyed);
+    }
+};
+
+// 打印统计行，Benchmark 按 key=value 解析 / Print the statistics line; Benchmark parses its key=value fields
+static void printStats(const CoServer& server) {
+    Logger::instance().flush();
+    const Metrics& m = Metrics::instance();
+    int64_t echoed = m.value(CoMetric::Echoes);
+    FramePoolStats frames = FramePool::stats();
+    std::cout << "Stats: echoed=" << echoed << " accepted=" << m.value(CoMetric::Accepts) << " syscalls=" << server.syscalls()
+        << " syscalls_per_echo=" << (echoed ? static_cast<double>(server.syscalls()) / echoed : 0.0)
+        << " frames=" << m.value(CoMetric::Frames) << " errors=" << m.value(CoMetric::Errors)
+        << " coroutine_frames=" << frames.allocations << " coroutine_frames_from_heap=" << frames.heap
+        << " log_dropped=" << Logger::instance().dropped() << std::endl;
+}
+
+// 解析命令行参数 / Parse command-line arguments
+static bool parseArgs(int argc, char* argv[], CoServerConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--port" && hasValue)
+            config.port = std::atoi(argv[++i]);
+        else if (arg == "--threads" && hasValue)
+            config.workerThreads = std::atoi(argv[++i]);
+        else if (arg == "--engine" && hasValue)
+            config.engine = argv[++i];
+        else if (arg == "--accepts" && hasValue)
+            config.acceptors = std::atoi(argv[++i]);
+        else if (arg == "--batch" && hasValue)
+            config.batch = std::atoi(argv[++i]);
+        else if (arg == "--framing" && hasValue) {
+            if (!parseFrameMode(argv[++i], config.framing)) {
+                std::cerr << "Unknown framing: " << argv[i] << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--quiet")
+            config.logLevel = LogLevel::Warn;
+        else if (arg == "--log-level" && hasValue) {
+            if (!parseLogLevel(argv[++i], config.logLevel)) {
+                std::cerr << "Unknown log level: " << argv[i] << std::endl;
+                return false;
+            }
+        }
+        else {
+            std::cerr << "Usage: " << argv[0]
+                << " [--port N] [--threads N] [--engine iocp|epoll|uring] [--accepts N] [--batch N]" << std::endl
+                << "       [--framing raw|length|line] [--log-level debug|info|warn|error|off] [--quiet]" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        CoServerConfig config;
+        if (!parseArgs(argc, argv, config))
+            return 1;
+        Logger::instance().setLevel(config.logLevel);
+#ifdef _WIN32
+        SetConsoleCtrlHandler(consoleCtrlHandler, TRUE);
+#else
+        std::signal(SIGINT, stopSignalHandler);
+        std::signal(SIGTERM, stopSignalHandler);
+#endif
+        CoServer server(config);
+        if (!server.initialize())
+            return 1;
+        server.run();
+        printStats(server);
+    }
+    catch (const std::exception& ex) {
+        std::cerr << "Exception occurred: " << ex.what() << std::endl;
+    }
+    return 0;
+}
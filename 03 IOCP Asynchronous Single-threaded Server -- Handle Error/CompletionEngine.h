@@ -0,0 +1,925 @@
+// CompletionEngine.h
+// 完成引擎：把 "投递操作 -> 取出完成事件" 的模型抽象出来，供 IocpServer 的状态机使用
+// Completion engine: abstracts the "post an operation -> dequeue its completion" model
+// used by the IocpServer state machine.
+//
+// Windows 上由 IOCP 直接实现；Linux 上由 epoll 模拟：就绪后在工作线程内执行非阻塞的
+// accept/recv/send，再把结果作为完成事件返回，因此上层的 ACCEPT/RECV/SEND 处理代码完全相同。
+// On Windows this is IOCP itself. On Linux it is emulated on top of epoll: when a socket
+// becomes ready the worker performs the non-blocking accept/recv/send and returns the result
+// as a completion, so the ACCEPT/RECV/SEND handlers above are identical on both platforms.
+// Linux 还提供原生完成模型的 io_uring 引擎（见 UringEngine.h）。
+// Linux also has a natively completion-based io_uring engine (see UringEngine.h).
+//
+// 投递 wsaBuf.buf 为空的接收时，由引擎在数据到达后才从共享的 BufferPool 中取缓冲区：
+// IOCP 先投递零字节 WSARecv 等待可读，epoll 在就绪后再取，io_uring 使用内核提供缓冲区。
+// A receive posted with an empty wsaBuf.buf lets the engine take a buffer from the shared
+// BufferPool only after data has arrived: IOCP first posts a zero-byte WSARecv to wait for
+// readability, epoll takes it once the socket is ready, io_uring uses kernel-provided buffers.
+//
+// waitBatch 一次取出一批完成事件（GetQueuedCompletionStatusEx / 一次 epoll_wait 的多个事件 /
+// 一轮 CQ 收割），调用者处理完整批后调用 flush，把处理期间投递的发送一起提交。
+// waitBatch dequeues a batch of completions at once (GetQueuedCompletionStatusEx, the events of
+// one epoll_wait, one pass over the CQ). The caller handles the whole batch and then calls
+// flush, which submits the sends posted meanwhile together.
+//
+// postSendFile 在 wsaBuf 之后直接从文件发送一段内容，数据不经过用户态：IOCP 用 TransmitFile，
+// epoll 用 sendfile。io_uring 没有对应的操作，canSendFile 返回 false，调用者改为从文件映射发送。
+// postSendFile sends wsaBuf followed by a range of a file straight from the file, without the
+// data passing through user space: TransmitFile on IOCP, sendfile on epoll. io_uring has no such
+// operation, so canSendFile returns false and the caller sends from a mapping of the file instead.
+//
+// timeoutMs 为 0 的 waitBatch 只检查不等待，SpinWait 用它在阻塞之前忙轮询一段时间（见文件末尾）。
+// waitBatch with timeoutMs 0 checks without waiting; SpinWait uses it to busy-poll for a while
+// before blocking (see the end of the file).
+
+#pragma once
+
+#include "../Common/Platform.h"
+#include "../Common/BufferPool.h"
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <deque>
+#include <chrono>
+
+#ifndef _WIN32
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#endif
+
+// 一次最多取出的完成事件数 / Most completions dequeued at once
+constexpr size_t MAX_COMPLETION_BATCH = 1024;
+
+// 引擎层面的操作类型 / Operation kinds as seen by the engine
+enum class EngineOp {
+    ACCEPT,
+    RECV,
+    SEND,
+    SENDFILE
+};
+
+struct IoHandle;
+
+// 每个异步请求的公共头部，PerIOData 从它派生
+// Common header of every asynchronous request; PerIOData derives from it.
+struct IoRequest {
+#ifdef _WIN32
+    OVERLAPPED overlapped{};                 // 必须是第一个成员 / Must be the first member
+#endif
+    WSABUF wsaBuf{};                         // 数据缓冲区描述 / Buffer description
+    SOCKET socket{ INVALID_SOCKET };         // 关联的套接字 / Associated socket
+    EngineOp engineOp{ EngineOp::RECV };     // 由引擎在投递时设置 / Set by the engine when posted
+    DWORD transferred{ 0 };                  // 已发送字节数（部分发送时使用） / Bytes already sent (partial sends)
+    IoHandle* handle{ nullptr };             // 投递到的句柄 (io_uring) / Handle it was posted on (io_uring)
+    int bufferId{ -1 };                      // 内核提供的接收缓冲区编号 (io_uring) / Kernel-provided buffer id (io_uring)
+    int bufferClass{ -1 };                   // 引擎从 BufferPool 取的缓冲区规格 / Class of a buffer the engine took from the BufferPool
+    IoRequest* nextPending{ nullptr };       // 同一监听套接字上排队的下一个接受操作 (Linux) / Next accept queued on the same listener (Linux)
+    FileHandle file{ INVALID_FILE_HANDLE };  // SENDFILE: 在 wsaBuf 之后发送的文件 / File sent after wsaBuf
+    uint64_t fileOffset{ 0 };                // SENDFILE: 文件中的起点 / Start within the file
+    uint64_t fileLength{ 0 };                // SENDFILE: 从文件发送的字节数 / Bytes sent from the file
+};
+
+// 每个套接字在引擎中的状态 / Per-socket state kept by the engine
+//
+// 句柄由 HandlePool 分配且在引擎存活期间从不释放内存（类型稳定），
+// 因此多个工作线程上迟到的 epoll 事件即使指向已回收的句柄也不会访问无效内存。
+// Handles come from a HandlePool and their memory is never freed while the engine lives
+// (type-stable), so a late epoll event seen by another worker never touches freed memory.
+struct IoHandle {
+    SOCKET socket{ INVALID_SOCKET };         // 套接字 / Socket
+    void* context{ nullptr };                // 所属的连接对象 / Owning connection object
+    IoHandle* nextFree{ nullptr };           // 空闲链表指针 / Free-list link
+    int recvClass{ DEFAULT_BUFFER_CLASS };   // 下一次接收使用的缓冲区规格 / Buffer class for the next receive
+    std::atomic<bool> detached{ false };     // 监听套接字已停止接受 (detachListener) / The listener stopped accepting (detachListener)
+#ifndef _WIN32
+    std::mutex lock;                         // 保护下面的字段 / Guards the fields below
+    IoRequest* readOp{ nullptr };            // 等待可读的操作（RECV，或经 nextPending 串起的多个 ACCEPT） / Operation waiting for readability (a RECV, or several ACCEPTs chained through nextPending)
+    IoRequest* writeOp{ nullptr };           // 等待可写的操作（SEND） / Operation waiting for writability
+    bool registered{ false };                // 是否已加入 epoll / Whether the fd was added to epoll
+    bool multishot{ false };                 // io_uring: 多次触发的 accept/recv 仍在内核中 / A multishot accept/recv is armed
+    bool releasing{ false };                 // io_uring: 已释放，等 multishot recv 的最后一个 CQE 后回收 / Released; recycled after the multishot recv's last CQE
+    std::vector<std::pair<int, unsigned>> backlog; // io_uring: 无等待请求时到达的结果 (res, flags) / Results that arrived with no request parked
+#endif
+};
+
+// 一个完成事件 / One completion
+struct Completion {
+    IoRequest* request{ nullptr };           // 完成的请求 / Completed request
+    IoHandle* handle{ nullptr };             // 请求所属的套接字句柄 / Handle the request was posted on
+    DWORD bytes{ 0 };                        // 传输字节数 / Bytes transferred
+    int error{ 0 };                          // 0 表示成功 / 0 on success
+};
+
+// 句柄池：按块分配，回收后进入空闲链表 / Handle pool: allocated in chunks, recycled through a free list
+class HandlePool {
+public:
+    IoHandle* acquire() {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!freeList) {
+            constexpr size_t CHUNK = 256;
+            chunks.emplace_back(new IoHandle[CHUNK]);
+            for (size_t i = 0; i < CHUNK; ++i) {
+                chunks.back()[i].nextFree = freeList;
+                freeList = &chunks.back()[i];
+            }
+        }
+        IoHandle* h = freeList;
+        freeList = h->nextFree;
+        h->nextFree = nullptr;
+        return h;
+    }
+
+    void put(IoHandle* h) {
+        std::lock_guard<std::mutex> guard(lock);
+        h->nextFree = freeList;
+        freeList = h;
+    }
+
+private:
+    std::mutex lock;
+    IoHandle* freeList{ nullptr };
+    std::vector<std::unique_ptr<IoHandle[]>> chunks;
+};
+
+// 引擎接口 / Engine interface
+//
+// post* 返回 false 表示操作立即失败（错误码见 WSAGetLastError）；返回 true 表示之后一定会
+// 通过 wait() 得到一个完成事件。wait() 可以被任意多个工作线程同时调用。
+// post* returns false if the operation failed immediately (see WSAGetLastError); true means
+// exactly one completion will later be returned by wait(). wait() may be called concurrently
+// from any number of worker threads.
+class CompletionEngine {
+public:
+    virtual ~CompletionEngine() = default;
+
+    virtual const char* name() const = 0;
+    // 创建完成队列，concurrency 为并发工作线程数 / Create the queue; concurrency = worker thread count
+    virtual bool open(int concurrency) = 0;
+    // 把套接字关联到引擎 / Associate a socket with the engine
+    virtual IoHandle* attach(SOCKET s, void* context) = 0;
+    // 关闭套接字并回收句柄（调用时不能再有未完成的操作） / Close the socket and recycle the handle (no operations may be pending)
+    virtual void release(IoHandle* h) = 0;
+    // 取消该套接字上所有未完成的操作，它们会以错误或 0 字节完成
+    // Cancel all pending operations on the socket; they complete with an error or 0 bytes.
+    virtual void abort(IoHandle* h) = 0;
+    // 停止在监听套接字上接受连接，但不触碰套接字本身：热重启时它仍被新进程使用，abort 的 shutdown 会让它失效。
+    // 挂起的接受操作以 ERROR_OPERATION_ABORTED / ECANCELED 完成，之后的 postAccept 立即失败；
+    // 引擎已接受但尚未交给请求的连接仍可由 postAccept 取走。须在工作线程上调用。
+    // Stop accepting on a listener without touching the socket itself: during a hot restart the
+    // new process keeps using it, and abort's shutdown would break it. Pending accepts complete
+    // with ERROR_OPERATION_ABORTED / ECANCELED and later postAccepts fail at once; connections the
+    // engine accepted but has not yet handed to a request can still be taken by postAccept. Must
+    // be called on a worker thread.
+    virtual void detachListener(IoHandle* listener) = 0;
+
+    virtual bool postAccept(IoHandle* listener, IoRequest* req) = 0;
+    virtual bool postRecv(IoHandle* h, IoRequest* req) = 0;
+    virtual bool postSend(IoHandle* h, IoRequest* req) = 0;
+
+    // 引擎能否直接从文件发送 / Whether the engine can send straight from a file
+    virtual bool canSendFile() const { return false; }
+    // 发送 wsaBuf，再发送 file 中从 fileOffset 起的 fileLength 字节；完成的字节数是两者之和，一次不超过 2 GiB - 1
+    // Send wsaBuf, then fileLength bytes of file from fileOffset; the completion counts both, at
+    // most 2 GiB - 1 per call.
+    virtual bool postSendFile(IoHandle*, IoRequest*) { return false; }
+
+    // 由内核线程轮询提交队列 (io_uring SQPOLL)，它空闲 idleMs 毫秒后睡眠；须在 open 之前调用。
+    // 不支持时返回 false
+    // Have a kernel thread poll the submission queue (io_uring SQPOLL), sleeping after idleMs of
+    // inactivity; must be called before open. Returns false where unsupported.
+    virtual bool enableKernelPolling(unsigned idleMs) {
+        (void)idleMs;
+        return false;
+    }
+
+    // 取出最多 max 个（不超过 MAX_COMPLETION_BATCH）完成事件，返回个数；超时返回 0
+    // Dequeue up to max completions (at most MAX_COMPLETION_BATCH) and return how many; 0 on timeout
+    virtual size_t waitBatch(Completion* out, size_t max, DWORD timeoutMs) = 0;
+
+    // 提交处理上一批时投递的发送。不调用时最迟由下一次 waitBatch 提交
+    // Submit the sends posted while the last batch was handled. Without a call the next waitBatch submits them at the latest.
+    virtual void flush() {}
+
+    // 取出一个完成事件；超时返回 false / Dequeue one completion; returns false on timeout
+    bool wait(Completion& c, DWORD timeoutMs) {
+        return waitBatch(&c, 1, timeoutMs) == 1;
+    }
+
+    // 缓冲区可能属于引擎（BufferPool 或 io_uring 的提供缓冲区），请求用完后交还
+    // The buffer may belong to the engine (BufferPool or io_uring provided buffers); hand it back when the request is done.
+    virtual void releaseBuffer(IoRequest* req) {
+        if (req->bufferClass >= 0) {
+            buffers.release(req->wsaBuf.buf, req->bufferClass);
+            req->bufferClass = -1;
+            req->wsaBuf = WSABUF{};
+        }
+    }
+
+    // 每次从内核取出一批完成事件时以批大小调用，用于统计；默认不设置
+    // Called with the batch size whenever a batch of completions comes out of the kernel, for
+    // statistics; unset by default.
+    using BatchObserver = void (*)(size_t);
+    void setBatchObserver(BatchObserver observer) { batchObserver = observer; }
+
+    // 引擎发出的系统调用次数 / Number of system calls issued by the engine
+    uint64_t syscallCount() const { return syscalls.load(std::memory_order_relaxed); }
+    // 从堆划出的接收缓冲区字节数 / Bytes of receive buffers carved from the heap
+    uint64_t bufferBytes() const { return buffers.highWaterBytes(); }
+
+protected:
+    std::atomic<uint64_t> syscalls{ 0 };
+    BufferPool buffers;
+    BatchObserver batchObserver{ nullptr };
+    void countSyscall(uint64_t n = 1) { syscalls.fetch_add(n, std::memory_order_relaxed); }
+    void noteBatch(size_t n) {
+        if (batchObserver && n > 0)
+            batchObserver(n);
+    }
+
+    // 数据到达后为接收取一个缓冲区 / Take a buffer for a receive once data has arrived
+    WSABUF takeRecvBuffer(IoHandle* h, IoRequest* req) {
+        req->bufferClass = h->recvClass;
+        return WSABUF{ static_cast<ULONG>(BufferPool::classSize(h->recvClass)), buffers.acquire(h->recvClass) };
+    }
+
+    // 接收结束：有数据则交给请求并调整下次的规格（读满则加大，读得很少则减小），否则归还
+    // Finish a receive: hand the data to the request and adapt the next class (grow after a
+    // full read, shrink after a small one), or give the buffer back.
+    void finishRecvBuffer(IoHandle* h, IoRequest* req, const WSABUF& buf, long bytes) {
+        if (bytes <= 0) {
+            buffers.release(buf.buf, req->bufferClass);
+            req->bufferClass = -1;
+            return;
+        }
+        req->wsaBuf = buf;
+        if (static_cast<ULONG>(bytes) == buf.len && h->recvClass + 1 < BUFFER_CLASS_COUNT)
+            ++h->recvClass;
+        else if (static_cast<ULONG>(bytes) <= buf.len / 8 && h->recvClass > 0)
+            --h->recvClass;
+    }
+};
+
+#ifdef _WIN32
+
+// ------------------- IOCP 实现 / IOCP implementation -------------------------
+
+class IocpEngine : public CompletionEngine {
+public:
+    ~IocpEngine() override {
+        if (hIocp)
+            CloseHandle(hIocp);
+    }
+
+    const char* name() const override { return "iocp"; }
+
+    bool open(int concurrency) override {
+        hIocp = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, static_cast<DWORD>(concurrency));
+        if (!hIocp) {
+            std::cerr << "CreateIoCompletionPort failed. Error: " << GetLastError() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    IoHandle* attach(SOCKET s, void* context) override {
+        IoHandle* h = pool.acquire();
+        h->socket = s;
+        h->context = context;
+        h->recvClass = DEFAULT_BUFFER_CLASS;
+        h->detached = false;
+        countSyscall(2);
+        // 完成键为句柄指针 / The completion key is the handle pointer
+        if (!CreateIoCompletionPort(reinterpret_cast<HANDLE>(s), hIocp, reinterpret_cast<ULONG_PTR>(h), 0)) {
+            pool.put(h);
+            return nullptr;
+        }
+        // 非阻塞模式只影响零字节读之后的同步 WSARecv，重叠操作不受影响
+        // Non-blocking mode only affects the synchronous WSARecv after a zero-byte read; overlapped I/O is unaffected.
+        setNonBlocking(s);
+        return h;
+    }
+
+    void release(IoHandle* h) override {
+        countSyscall();
+        closesocket(h->socket);
+        h->socket = INVALID_SOCKET;
+        h->context = nullptr;
+        pool.put(h);
+    }
+
+    void abort(IoHandle* h) override {
+        // 未完成的操作以 ERROR_OPERATION_ABORTED 完成 / Pending operations complete with ERROR_OPERATION_ABORTED
+        countSyscall();
+        CancelIoEx(reinterpret_cast<HANDLE>(h->socket), nullptr);
+    }
+
+    void detachListener(IoHandle* listener) override {
+        // CancelIoEx 只取消本进程投递的 AcceptEx / CancelIoEx cancels only the AcceptEx calls this process posted
+        listener->detached = true;
+        countSyscall();
+        CancelIoEx(reinterpret_cast<HANDLE>(listener->socket), nullptr);
+    }
+
+    bool postAccept(IoHandle* listener, IoRequest* req) override {
+        if (listener->detached) {
+            WSASetLastError(WSAESHUTDOWN);
+            return false;
+        }
+        // 一次性获取 AcceptEx 扩展函数指针 / Retrieve the AcceptEx pointer once
+        std::call_once(acceptExOnce, [&] {
+            GUID guidAcceptEx = WSAID_ACCEPTEX;
+            DWORD bytesReturned = 0;
+            if (WSAIoctl(listener->socket, SIO_GET_EXTENSION_FUNCTION_POINTER,
+                &guidAcceptEx, sizeof(guidAcceptEx),
+                &acceptExFunc, sizeof(acceptExFunc),
+                &bytesReturned, nullptr, nullptr) == SOCKET_ERROR) {
+                std::cerr << "WSAIoctl for AcceptEx failed. Error: " << WSAGetLastError() << std::endl;
+            }
+        });
+        if (!acceptExFunc)
+            return false;
+        // AcceptEx 需要预先创建好的套接字 / AcceptEx needs a pre-created socket
+        SOCKET acceptSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (acceptSocket == INVALID_SOCKET)
+            return false;
+        req->overlapped = OVERLAPPED{};
+        req->engineOp = EngineOp::ACCEPT;
+        req->socket = acceptSocket;
+        // AcceptEx 的地址输出区取自 BufferPool，随请求一起交还 / AcceptEx's address area comes from the BufferPool and goes back with the request
+        if (!req->wsaBuf.buf) {
+            req->bufferClass = 0;
+            req->wsaBuf = WSABUF{ static_cast<ULONG>(BufferPool::classSize(0)), buffers.acquire(0) };
+        }
+        countSyscall(2);
+        DWORD bytesReturned = 0;
+        if (!acceptExFunc(listener->socket, acceptSocket, req->wsaBuf.buf, 0,
+            sizeof(sockaddr_in) + 16, sizeof(sockaddr_in) + 16,
+            &bytesReturned, &req->overlapped)) {
+            int err = WSAGetLastError();
+            if (err != ERROR_IO_PENDING) {
+                closesocket(acceptSocket);
+                req->socket = INVALID_SOCKET;
+                WSASetLastError(err);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // wsaBuf.buf 为空时投递零字节读：完成只表示可读，等待期间不占用缓冲区
+    // With an empty wsaBuf.buf a zero-byte read is posted: it only signals readability and pins no buffer.
+    bool postRecv(IoHandle* h, IoRequest* req) override {
+        req->overlapped = OVERLAPPED{};
+        req->engineOp = EngineOp::RECV;
+        countSyscall();
+        DWORD flags = 0;
+        DWORD bytesReceived = 0;
+        int ret = WSARecv(h->socket, &req->wsaBuf, 1, &bytesReceived, &flags, &req->overlapped, nullptr);
+        return ret != SOCKET_ERROR || WSAGetLastError() == WSA_IO_PENDING;
+    }
+
+    bool postSend(IoHandle* h, IoRequest* req) override {
+        req->overlapped = OVERLAPPED{};
+        req->engineOp = EngineOp::SEND;
+        countSyscall();
+        DWORD bytesSent = 0;
+        int ret = WSASend(h->socket, &req->wsaBuf, 1, &bytesSent, 0, &req->overlapped, nullptr);
+        return ret != SOCKET_ERROR || WSAGetLastError() == WSA_IO_PENDING;
+    }
+
+    bool canSendFile() const override { return true; }
+
+    // TransmitFile 以 wsaBuf 为头部缓冲区，文件偏移放在 OVERLAPPED 中；单次最多 2 GiB - 1
+    // TransmitFile takes wsaBuf as its head buffer and the file offset in the OVERLAPPED; at most 2 GiB - 1 per call.
+    bool postSendFile(IoHandle* h, IoRequest* req) override {
+        std::call_once(transmitFileOnce, [&] {
+            GUID guidTransmitFile = WSAID_TRANSMITFILE;
+            DWORD bytesReturned = 0;
+            if (WSAIoctl(h->socket, SIO_GET_EXTENSION_FUNCTION_POINTER,
+                &guidTransmitFile, sizeof(guidTransmitFile),
+                &transmitFileFunc, sizeof(transmitFileFunc),
+                &bytesReturned, nullptr, nullptr) == SOCKET_ERROR) {
+                std::cerr << "WSAIoctl for TransmitFile failed. Error: " << WSAGetLastError() << std::endl;
+            }
+        });
+        if (!transmitFileFunc || req->fileLength > 0x7FFFFFFEull)
+            return false;
+        req->overlapped = OVERLAPPED{};
+        req->overlapped.Offset = static_cast<DWORD>(req->fileOffset);
+        req->overlapped.OffsetHigh = static_cast<DWORD>(req->fileOffset >> 32);
+        req->engineOp = EngineOp::SENDFILE;
+        TRANSMIT_FILE_BUFFERS head{ req->wsaBuf.buf, req->wsaBuf.len, nullptr, 0 };
+        countSyscall();
+        if (!transmitFileFunc(h->socket, req->file, static_cast<DWORD>(req->fileLength), 0, &req->overlapped,
+            req->wsaBuf.len > 0 ? &head : nullptr, 0))
+            return WSAGetLastError() == WSA_IO_PENDING;
+        return true;
+    }
+
+    // WSASend 在投递时立即发出（Windows 没有跨套接字的批量提交），flush 无事可做
+    // WSASend goes out when posted (Windows has no cross-socket batch submission), so flush has nothing to do.
+    size_t waitBatch(Completion* out, size_t max, DWORD timeoutMs) override {
+        static thread_local OVERLAPPED_ENTRY entries[MAX_COMPLETION_BATCH];
+        max = std::min(max, MAX_COMPLETION_BATCH);
+        while (true) {
+            ULONG removed = 0;
+            countSyscall();
+            if (!GetQueuedCompletionStatusEx(hIocp, entries, static_cast<ULONG>(max), &removed, timeoutMs, FALSE)) {
+                // 超时或完成端口本身出错 / Timeout, or the port itself failed
+                if (GetLastError() != WAIT_TIMEOUT)
+                    std::cerr << "GetQueuedCompletionStatusEx failed. Error: " << GetLastError() << std::endl;
+                return 0;
+            }
+            noteBatch(removed);
+            size_t n = 0;
+            for (ULONG i = 0; i < removed; ++i) {
+                Completion& c = out[n];
+                c.request = reinterpret_cast<IoRequest*>(entries[i].lpOverlapped);
+                c.handle = reinterpret_cast<IoHandle*>(entries[i].lpCompletionKey);
+                c.bytes = entries[i].dwNumberOfBytesTransferred;
+                c.error = overlappedError(c);
+                if (c.request->engineOp == EngineOp::RECV && !c.request->wsaBuf.buf && c.error == 0
+                    && !readAfterZeroByteRecv(c))
+                    continue;
+                ++n;
+            }
+            // 整批都是虚假就绪时继续等待 / Keep waiting if the whole batch was spurious readiness
+            if (n > 0)
+                return n;
+        }
+    }
+
+private:
+    // 失败的 I/O 也会出队（例如连接被重置）；OVERLAPPED 中只有 NTSTATUS，由 WSAGetOverlappedResult 换成 Winsock 错误码
+    // Failed I/O is dequeued too (e.g. connection reset). The OVERLAPPED only holds an NTSTATUS,
+    // which WSAGetOverlappedResult turns into a Winsock error code.
+    int overlappedError(const Completion& c) {
+        if (c.request->overlapped.Internal == 0)
+            return 0;
+        DWORD bytes = 0;
+        DWORD flags = 0;
+        countSyscall();
+        if (WSAGetOverlappedResult(c.handle->socket, &c.request->overlapped, &bytes, FALSE, &flags))
+            return 0;
+        return WSAGetLastError();
+    }
+
+    // 零字节读完成后取缓冲区并同步读取；没有数据（虚假就绪）时重新投递并返回 false
+    // After a zero-byte read completes, take a buffer and read synchronously; with no data
+    // (spurious readiness) post the zero-byte read again and return false.
+    bool readAfterZeroByteRecv(Completion& c) {
+        IoRequest* req = c.request;
+        WSABUF buf = takeRecvBuffer(c.handle, req);
+        DWORD flags = 0;
+        DWORD bytesReceived = 0;
+        countSyscall();
+        if (WSARecv(c.handle->socket, &buf, 1, &bytesReceived, &flags, nullptr, nullptr) == SOCKET_ERROR) {
+            int err = WSAGetLastError();
+            finishRecvBuffer(c.handle, req, buf, 0);
+            if (err == WSAEWOULDBLOCK) {
+                if (postRecv(c.handle, req))
+                    return false;
+                err = WSAGetLastError();
+            }
+            c.error = err;
+            c.bytes = 0;
+            return true;
+        }
+        finishRecvBuffer(c.handle, req, buf, static_cast<long>(bytesReceived));
+        c.bytes = bytesReceived;
+        return true;
+    }
+
+    HANDLE hIocp{ nullptr };                 // IOCP 句柄 / IOCP handle
+    LPFN_ACCEPTEX acceptExFunc{ nullptr };   // AcceptEx 函数指针 / Pointer to AcceptEx
+    std::once_flag acceptExOnce;
+    LPFN_TRANSMITFILE transmitFileFunc{ nullptr }; // TransmitFile 函数指针 / Pointer to TransmitFile
+    std::once_flag transmitFileOnce;
+    HandlePool pool;
+};
+
+#else
+
+// ------------------- epoll 实现 / epoll implementation -------------------------
+//
+// 每个套接字以 EPOLLONESHOT 注册：一次就绪只会唤醒一个工作线程，该线程在句柄锁内完成
+// 非阻塞调用后按剩余的操作重新布防。
+// Every socket is registered with EPOLLONESHOT: one readiness event wakes exactly one worker,
+// which performs the non-blocking call under the handle lock and re-arms for what is left.
+
+class EpollEngine : public CompletionEngine {
+public:
+    ~EpollEngine() override {
+        if (epfd != -1)
+            ::close(epfd);
+    }
+
+    const char* name() const override { return "epoll"; }
+
+    bool open(int) override {
+        epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epfd == -1) {
+            std::cerr << "epoll_create1 failed. Error: " << errno << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    IoHandle* attach(SOCKET s, void* context) override {
+        countSyscall(2);
+        if (!setNonBlocking(s))
+            return nullptr;
+        IoHandle* h = pool.acquire();
+        std::lock_guard<std::mutex> guard(h->lock);
+        h->socket = s;
+        h->context = context;
+        h->recvClass = DEFAULT_BUFFER_CLASS;
+        h->detached = false;
+        h->readOp = nullptr;
+        h->writeOp = nullptr;
+        // 延迟到第一次布防时再加入 epoll，避免没有操作时收到 EPOLLHUP
+        // Added to epoll on the first arm, so no EPOLLHUP arrives while nothing is posted.
+        h->registered = false;
+        return h;
+    }
+
+    void release(IoHandle* h) override {
+        {
+            std::lock_guard<std::mutex> guard(h->lock);
+            countSyscall();
+            closesocket(h->socket);  // 关闭时自动从 epoll 移除 / Closing removes it from epoll
+            h->socket = INVALID_SOCKET;
+            h->context = nullptr;
+            h->registered = false;
+        }
+        pool.put(h);
+    }
+
+    void abort(IoHandle* h) override {
+        // shutdown 使套接字立即可读/可写，已布防的操作随即以 0 字节或错误完成
+        // shutdown makes the socket readable/writable, so armed operations complete with 0 bytes or an error.
+        countSyscall();
+        ::shutdown(h->socket, SHUT_RDWR);
+    }
+
+    // 先从 epoll 中删除：epoll 的登记跟随打开的文件，另一个进程还持有该文件时，之后关闭描述符并不会移除它
+    // Remove it from epoll first: the registration belongs to the open file, and while another
+    // process still holds that file, closing the descriptor later would not remove it.
+    void detachListener(IoHandle* listener) override {
+        std::lock_guard<std::mutex> guard(listener->lock);
+        listener->detached = true;
+        if (listener->registered) {
+            countSyscall();
+            epoll_ctl(epfd, EPOLL_CTL_DEL, listener->socket, nullptr);
+            listener->registered = false;
+        }
+        while (IoRequest* req = listener->readOp) {
+            listener->readOp = req->nextPending;
+            req->nextPending = nullptr;
+            tlsReady.push_back(Completion{ req, listener, 0, ECANCELED });
+        }
+    }
+
+    // 可以同时挂起多个接受操作；监听套接字可读时一次 accept 多个连接，直到没有连接或没有挂起的操作
+    // Several accepts may be outstanding; once the listener is readable, connections are accepted
+    // in a batch until none is left or every posted accept is used.
+    bool postAccept(IoHandle* listener, IoRequest* req) override {
+        req->engineOp = EngineOp::ACCEPT;
+        req->socket = INVALID_SOCKET;
+        std::lock_guard<std::mutex> guard(listener->lock);
+        if (listener->detached) {
+            errno = ESHUTDOWN;
+            return false;
+        }
+        req->nextPending = listener->readOp;
+        listener->readOp = req;
+        // 已有挂起的接受操作时监听套接字已布防 / With accepts already pending the listener is armed
+        if (req->nextPending)
+            return true;
+        if (!arm(listener)) {
+            listener->readOp = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    bool postRecv(IoHandle* h, IoRequest* req) override {
+        req->engineOp = EngineOp::RECV;
+        std::lock_guard<std::mutex> guard(h->lock);
+        h->readOp = req;
+        if (!arm(h)) {
+            h->readOp = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    // 每个连接同一时刻最多一个发送操作 / At most one send may be pending per connection
+    bool postSend(IoHandle* h, IoRequest* req) override {
+        req->engineOp = EngineOp::SEND;
+        return queueSend(h, req);
+    }
+
+    bool canSendFile() const override { return true; }
+
+    bool postSendFile(IoHandle* h, IoRequest* req) override {
+        req->engineOp = EngineOp::SENDFILE;
+        return queueSend(h, req);
+    }
+
+    void flush() override {
+        for (const Completion& s : tlsSends)
+            startSend(s.handle, s.request);
+        tlsSends.clear();
+    }
+
+    size_t waitBatch(Completion* out, size_t max, DWORD timeoutMs) override {
+        static thread_local epoll_event events[MAX_COMPLETION_BATCH];
+        tlsOwner = this;
+        flush();
+        if (!tlsReady.empty())
+            return popReady(out, max);
+        countSyscall();
+        int n = epoll_wait(epfd, events, static_cast<int>(std::min(max, MAX_COMPLETION_BATCH)),
+            timeoutMs == INFINITE ? -1 : static_cast<int>(timeoutMs));
+        if (n <= 0) {
+            if (n < 0 && errno != EINTR)
+                std::cerr << "epoll_wait failed. Error: " << errno << std::endl;
+            return 0;
+        }
+        noteBatch(static_cast<size_t>(n));
+        for (int i = 0; i < n; ++i)
+            processEvent(static_cast<IoHandle*>(events[i].data.ptr), events[i].events);
+        return popReady(out, max);
+    }
+
+private:
+    int epfd{ -1 };
+    HandlePool pool;
+
+    // 本线程已产生但尚未返回的完成事件 / Completions produced on this thread but not yet returned
+    static inline thread_local std::deque<Completion> tlsReady;
+    // 本线程投递、等待 flush 的发送 / Sends posted on this thread, waiting for flush
+    static inline thread_local std::vector<Completion> tlsSends;
+    static inline thread_local EpollEngine* tlsOwner = nullptr;
+
+    size_t popReady(Completion* out, size_t max) {
+        size_t n = 0;
+        while (n < max && !tlsReady.empty()) {
+            out[n++] = tlsReady.front();
+            tlsReady.pop_front();
+        }
+        return n;
+    }
+
+    bool queueSend(IoHandle* h, IoRequest* req) {
+        req->transferred = 0;
+        // 工作线程上的发送留到 flush 时一起尝试直接发送，成功则无需等待 EPOLLOUT
+        // Sends posted on a worker wait for flush, which tries them right away; on success there is no EPOLLOUT round trip.
+        if (tlsOwner == this) {
+            tlsSends.push_back(Completion{ req, h, 0, 0 });
+            return true;
+        }
+        std::lock_guard<std::mutex> guard(h->lock);
+        h->writeOp = req;
+        if (!arm(h)) {
+            h->writeOp = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    // 直接发送，发不完时等待 EPOLLOUT；结果作为完成事件返回 / Send right away and wait for EPOLLOUT if it does not all go; the result comes back as a completion
+    void startSend(IoHandle* h, IoRequest* req) {
+        std::lock_guard<std::mutex> guard(h->lock);
+        int err = 0;
+        if (trySend(h, req, err)) {
+            tlsReady.push_back(Completion{ req, h, req->transferred, err });
+            return;
+        }
+        h->writeOp = req;
+        if (!arm(h)) {
+            h->writeOp = nullptr;
+            tlsReady.push_back(Completion{ req, h, req->transferred, errno });
+        }
+    }
+
+    // 按当前挂起的操作布防（调用者持有句柄锁） / Arm for the pending operations (handle lock held)
+    bool arm(IoHandle* h) {
+        uint32_t events = 0;
+        if (h->readOp)
+            events |= EPOLLIN | EPOLLRDHUP;
+        if (h->writeOp)
+            events |= EPOLLOUT;
+        if (events == 0)
+            return true;
+        epoll_event ev{};
+        ev.events = events | EPOLLONESHOT;
+        ev.data.ptr = h;
+        int op = h->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+        countSyscall();
+        if (epoll_ctl(epfd, op, h->socket, &ev) == -1)
+            return false;
+        h->registered = true;
+        return true;
+    }
+
+    // 发送剩余数据；返回 true 表示操作已结束（成功或 err 非 0） / Send what is left; true when finished (success or err != 0)
+    // SENDFILE 先发 wsaBuf（带 MSG_MORE，与文件的第一段合成一个报文段），再用 sendfile 发文件，
+    // transferred 对两者连续计数。sendfile 没有 MSG_NOSIGNAL，使用它的进程须忽略 SIGPIPE。
+    // SENDFILE sends wsaBuf first (with MSG_MORE, so it shares a segment with the start of the
+    // file) and then the file with sendfile; transferred counts across both. sendfile has no
+    // MSG_NOSIGNAL, so a process using it must ignore SIGPIPE.
+    bool trySend(IoHandle* h, IoRequest* req, int& err) {
+        bool file = req->engineOp == EngineOp::SENDFILE;
+        uint64_t total = req->wsaBuf.len + (file ? req->fileLength : 0);
+        while (req->transferred < total) {
+            countSyscall();
+            ssize_t n;
+            if (req->transferred < req->wsaBuf.len) {
+                n = ::send(h->socket, req->wsaBuf.buf + req->transferred,
+                    req->wsaBuf.len - req->transferred, MSG_NOSIGNAL | (file ? MSG_MORE : 0));
+            }
+            else {
+                off_t offset = static_cast<off_t>(req->fileOffset + (req->transferred - req->wsaBuf.len));
+                n = ::sendfile(h->socket, req->file, &offset, static_cast<size_t>(total - req->transferred));
+            }
+            if (n > 0) {
+                req->transferred += static_cast<DWORD>(n);
+            }
+            else if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return false;
+            }
+            else {
+                // 文件在发送期间被截短时 sendfile 返回 0 / sendfile returns 0 when the file was truncated meanwhile
+                err = n == 0 && req->transferred >= req->wsaBuf.len ? EIO : errno;
+                return true;
+            }
+        }
+        return true;
+    }
+
+    static bool wouldBlock(int err) {
+        return err == EAGAIN || err == EWOULDBLOCK || err == EINTR;
+    }
+
+    void processEvent(IoHandle* h, uint32_t events) {
+        std::lock_guard<std::mutex> guard(h->lock);
+        bool readable = events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR);
+        bool writable = events & (EPOLLOUT | EPOLLHUP | EPOLLERR);
+
+        if (readable && h->readOp) {
+            IoRequest* req = h->readOp;
+            if (req->engineOp == EngineOp::ACCEPT) {
+                while ((req = h->readOp) != nullptr) {
+                    countSyscall();
+                    SOCKET s = ::accept4(h->socket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                    int err = s == INVALID_SOCKET ? errno : 0;
+                    if (err == ECONNABORTED)
+                        continue;
+                    if (err != 0 && wouldBlock(err))
+                        break;
+                    h->readOp = req->nextPending;
+                    req->nextPending = nullptr;
+                    req->socket = s;
+                    tlsReady.push_back(Completion{ req, h, 0, err });
+                    if (err != 0)
+                        break;
+                }
+            }
+            else {
+                // 缓冲区为空时在就绪之后才从池中取 / With no buffer, take one from the pool only now that the socket is ready
+                bool pooled = req->wsaBuf.buf == nullptr;
+                WSABUF buf = pooled ? takeRecvBuffer(h, req) : req->wsaBuf;
+                countSyscall();
+                ssize_t n = ::recv(h->socket, buf.buf, buf.len, 0);
+                int err = n < 0 ? errno : 0;
+                if (pooled)
+                    finishRecvBuffer(h, req, buf, static_cast<long>(n));
+                if (n >= 0) {
+                    h->readOp = nullptr;
+                    tlsReady.push_back(Completion{ req, h, static_cast<DWORD>(n), 0 });
+                }
+                else if (!wouldBlock(err)) {
+                    h->readOp = nullptr;
+                    tlsReady.push_back(Completion{ req, h, 0, err });
+                }
+            }
+        }
+
+        if (writable && h->writeOp) {
+            IoRequest* req = h->writeOp;
+            int err = 0;
+            if (trySend(h, req, err)) {
+                h->writeOp = nullptr;
+                tlsReady.push_back(Completion{ req, h, req->transferred, err });
+            }
+        }
+
+        // 迟到的事件可能落在已回收的句柄上，此时没有挂起操作，arm 不做任何事
+        // A late event may hit a recycled handle; with nothing pending, arm() does nothing.
+        if (h->socket != INVALID_SOCKET && !arm(h)) {
+            int err = errno;
+            for (IoRequest* req = h->readOp; req; req = req->nextPending)
+                tlsReady.push_back(Completion{ req, h, 0, err });
+            if (h->writeOp)
+                tlsReady.push_back(Completion{ h->writeOp, h, 0, err });
+            h->readOp = nullptr;
+            h->writeOp = nullptr;
+        }
+    }
+};
+
+#include "UringEngine.h"
+
+#endif
+
+// 默认引擎名称 / Default engine name for this platform
+inline const char* defaultEngineName() {
+#ifdef _WIN32
+    return "iocp";
+#else
+    return "epoll";
+#endif
+}
+
+// 按名称创建引擎，名称无效时返回 nullptr / Create an engine by name; nullptr for an unknown name
+inline std::unique_ptr<CompletionEngine> createEngine(const std::string& name) {
+#ifdef _WIN32
+    if (name == "iocp")
+        return std::make_unique<IocpEngine>();
+#else
+    if (name == "epoll")
+        return std::make_unique<EpollEngine>();
+    if (name == "uring")
+        return std::make_unique<UringEngine>();
+#endif
+    return nullptr;
+}
+
+// 自适应忙轮询：阻塞等待之前，先用不等待的 waitBatch 反复检查最多 budget 微秒，完成事件在这期间到达
+// 就省去一次睡眠与唤醒。预算在 0 与 maxSpinUs 之间自行调整：转空之后若阻塞等待在 maxSpinUs 之内
+// 就等到了事件，说明多转一会儿本可以接住它，预算加倍；等了更久或超时说明连接空闲，预算减半，
+// 空闲的工作线程因此很快停止空转。每个工作线程一个实例。
+// Adaptive busy polling: before blocking, check with a non-waiting waitBatch for up to budget
+// microseconds, so a completion arriving meanwhile saves a sleep and a wakeup. The budget adjusts
+// itself between 0 and maxSpinUs. When a spin comes up empty and the blocking wait then returns
+// work within maxSpinUs, spinning longer would have caught it, so the budget doubles; a longer
+// wait or a timeout means the connections are idle and the budget halves, so an idle worker soon
+// stops burning CPU. One instance per worker thread.
+class SpinWait {
+public:
+    // 上一次等待的结果 / How the last wait went
+    enum class Outcome {
+        Blocked,    // 没有轮询，直接阻塞 / Blocked without polling
+        Hit,        // 轮询期间取到了完成事件 / Polling found completions
+        Miss        // 轮询落空，随后阻塞 / Polling came up empty, then blocked
+    };
+
+    explicit SpinWait(uint32_t maxSpinUs) : maxUs(maxSpinUs), budgetUs(maxSpinUs) {}
+
+    size_t waitBatch(CompletionEngine& engine, Completion* out, size_t max, DWORD timeoutMs) {
+        if (maxUs == 0) {
+            last = Outcome::Blocked;
+            return engine.waitBatch(out, max, timeoutMs);
+        }
+        auto start = std::chrono::steady_clock::now();
+        if (budgetUs > 0) {
+            auto deadline = start + std::chrono::microseconds(budgetUs);
+            do {
+                if (size_t n = engine.waitBatch(out, max, 0)) {
+                    last = Outcome::Hit;
+                    return n;
+                }
+            } while (std::chrono::steady_clock::now() < deadline);
+        }
+        last = budgetUs > 0 ? Outcome::Miss : Outcome::Blocked;
+        size_t n = engine.waitBatch(out, max, timeoutMs);
+        auto waited = std::chrono::steady_clock::now() - start;
+        if (n > 0 && waited <= std::chrono::microseconds(maxUs))
+            budgetUs = std::min(maxUs, std::max(budgetUs * 2, MIN_SPIN_US));
+        else
+            budgetUs /= 2;
+        return n;
+    }
+
+    Outcome lastOutcome() const { return last; }
+    uint32_t budget() const { return budgetUs; }
+
+private:
+    // 预算从 0 恢复时的起点 / Where the budget restarts from 0
+    static constexpr uint32_t MIN_SPIN_US = 4;
+
+    uint32_t maxUs;
+    uint32_t budgetUs;
+    Outcome last{ Outcome::Blocked };
+};
@@ -0,0 +1,335 @@
+// Coroutine.h
+// 完成引擎之上的 C++20 协程接口：可等待的 asyncAccept / asyncRead / asyncWrite
+// C++20 coroutine interface over the completion engine: awaitable asyncAccept / asyncRead / asyncWrite
+//
+// 每个可等待对象持有一个 AsyncOp（IoRequest 加上等待它的协程句柄）。await_suspend 把请求投递给引擎，
+// 工作线程取出完成事件后调用 resumeCompletion 恢复协程，协程一直运行到下一个 co_await 再把控制权
+// 交回工作线程。请求对象位于协程帧或 AsyncSocket 中，一次 I/O 不需要任何分配；协程帧本身来自
+// FramePool（见 Common/FramePool.h）的每线程链表，每个连接分配一次。
+// Each awaitable holds an AsyncOp (an IoRequest plus the coroutine waiting on it). await_suspend
+// posts the request to the engine; once a worker dequeues the completion, resumeCompletion
+// resumes the coroutine, which runs until its next co_await and then hands the worker back. The
+// requests live in the coroutine frame or in the AsyncSocket, so an I/O allocates nothing; the
+// frame itself comes from a per-thread FramePool list (see Common/FramePool.h), once per connection.
+//
+// 投递成功后完成事件可能在 await_suspend 返回之前就在另一个工作线程上恢复协程，
+// 因此 await_suspend 在投递之后不再访问等待对象。
+// Once posted, the completion may resume the coroutine on another worker before await_suspend
+// has returned, so await_suspend touches nothing of the awaiter after posting.
+//
+// 服务器停止时仍有协程挂起在 co_await 上。Task 与 AsyncSocket 各自登记在一个链表中：先用
+// AsyncSocket::abortAll 取消在途的 I/O，取走完成事件但不恢复协程，再用 Task::destroyAll 销毁剩下的帧。
+// When the server stops, coroutines are still suspended in co_await. Tasks and AsyncSockets are
+// each registered in a list: AsyncSocket::abortAll cancels the I/O in flight, the completions
+// are taken without resuming anyone, and Task::destroyAll then destroys the remaining frames.
+
+#pragma once
+
+#include "CompletionEngine.h"
+#include "../Common/FramePool.h"
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// 分离的协程：创建后立即运行到第一个 co_await，结束时自行销毁帧
+// Detached coroutine: runs up to its first co_await when created and destroys its own frame when done.
+struct Task {
+    struct promise_type {
+        promise_type() {
+            std::lock_guard<std::mutex> guard(lock());
+            next = head();
+            if (next)
+                next->prev = this;
+            head() = this;
+        }
+        ~promise_type() {
+            std::lock_guard<std::mutex> guard(lock());
+            (prev ? prev->next : head()) = next;
+            if (next)
+                next->prev = prev;
+        }
+        promise_type(const promise_type&) = delete;
+        promise_type& operator=(const promise_type&) = delete;
+
+        Task get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        // 没有人等待分离的协程，异常无处可去 / Nobody awaits a detached coroutine, so an exception has nowhere to go
+        void unhandled_exception() noexcept { std::terminate(); }
+
+        static void* operator new(size_t size) { return FramePool::allocate(size); }
+        static void operator delete(void* p, size_t size) noexcept { FramePool::deallocate(p, size); }
+
+        promise_type* prev{ nullptr };   // 未结束的帧的链表 / List of the frames not yet finished
+        promise_type* next{ nullptr };
+        static std::mutex& lock() {
+            static std::mutex m;
+            return m;
+        }
+        static promise_type*& head() {
+            static promise_type* h = nullptr;
+            return h;
+        }
+    };
+
+    // 销毁所有挂起的协程帧。只能在没有工作线程运行、且帧中的请求都已完成或被取走之后调用
+    // Destroy every suspended coroutine frame. Only call it once no worker runs and the requests in
+    // the frames have all completed or been taken.
+    static size_t destroyAll() {
+        std::vector<std::coroutine_handle<promise_type>> frames;
+        {
+            std::lock_guard<std::mutex> guard(promise_type::lock());
+            for (promise_type* p = promise_type::head(); p; p = p->next)
+                frames.push_back(std::coroutine_handle<promise_type>::from_promise(*p));
+        }
+        for (auto frame : frames)
+            frame.destroy();
+        return frames.size();
+    }
+};
+
+// 一次 I/O 的结果 / Result of one I/O
+struct IoResult {
+    DWORD bytes{ 0 };               // 传输的字节数；0 字节的读表示对端已关闭 / Bytes transferred; a 0-byte read means the peer closed
+    int error{ 0 };                 // 0 表示成功 / 0 on success
+    const char* data{ nullptr };    // 读到的数据 (asyncRead) / The data read (asyncRead)
+
+    bool ok() const { return error == 0 && bytes > 0; }
+};
+
+// 等待中的请求 / A request being awaited
+struct AsyncOp : IoRequest {
+    std::coroutine_handle<> waiter;     // 完成时恢复的协程 / Coroutine resumed on completion
+    CompletionEngine* engine{ nullptr };
+    DWORD bytes{ 0 };                   // 写操作为累计写出的字节 / For a write, the bytes written so far
+    DWORD length{ 0 };                  // 写操作的总长度 / Total length of a write
+    int error{ 0 };
+
+    // 投递失败时记下错误，由 await_suspend 返回 false 让协程立即继续
+    // A failed post records the error; await_suspend then returns false so the coroutine continues at once.
+    bool failed() {
+        bytes = 0;
+        error = WSAGetLastError();
+        if (error == 0)
+            error = -1;
+        return false;
+    }
+};
+
+// 工作线程对每个完成事件调用。写操作只写出一部分时接着投递剩余部分，写完或出错才恢复协程
+// Called by the workers for every completion. A write that sent only part of its data posts
+// the rest; the coroutine resumes once everything is written or an error occurs.
+inline void resumeCompletion(const Completion& c) {
+    auto* op = static_cast<AsyncOp*>(c.request);
+    op->error = c.error;
+    if (op->engineOp != EngineOp::SEND) {
+        op->bytes = c.bytes;
+        op->waiter.resume();
+        return;
+    }
+    op->bytes += c.bytes;
+    if (c.error == 0 && c.bytes > 0 && op->bytes < op->length) {
+        op->wsaBuf.buf += c.bytes;
+        op->wsaBuf.len -= c.bytes;
+        if (op->engine->postSend(c.handle, op))
+            return;
+        op->failed();
+    }
+    else if (c.error == 0 && op->bytes < op->length) {
+        op->error = -1; // 0 字节的发送不会再有进展 / A 0-byte send will make no further progress
+    }
+    op->waiter.resume();
+}
+
+// 已连接的套接字。同一时刻最多一个读和一个写在途；移动只能在没有操作在途时进行
+// A connected socket. At most one read and one write may be in flight at a time; it may only be
+// moved while no operation is in flight.
+class AsyncSocket {
+public:
+    AsyncSocket() = default;
+    AsyncSocket(CompletionEngine* e, IoHandle* h) : engine(e), handle(h) {
+        readOp.engine = writeOp.engine = e;
+        link();
+    }
+    AsyncSocket(AsyncSocket&& o) noexcept : engine(o.engine) {
+        readOp.engine = writeOp.engine = engine;
+        readOp.bufferClass = std::exchange(o.readOp.bufferClass, -1);
+        readOp.bufferId = std::exchange(o.readOp.bufferId, -1);
+        readOp.wsaBuf = std::exchange(o.readOp.wsaBuf, WSABUF{});
+        if (o.handle) {
+            o.unlink();
+            handle = std::exchange(o.handle, nullptr);
+            link();
+        }
+    }
+    AsyncSocket(const AsyncSocket&) = delete;
+    AsyncSocket& operator=(const AsyncSocket&) = delete;
+    AsyncSocket& operator=(AsyncSocket&&) = delete;
+    ~AsyncSocket() { close(); }
+
+    explicit operator bool() const { return handle != nullptr; }
+    SOCKET native() const { return handle ? handle->socket : INVALID_SOCKET; }
+
+    // 读取对端发来的数据；缓冲区由引擎在数据到达后提供，结果中的数据在下一次 asyncRead 或 close 之前有效
+    // Read whatever the peer sent. The engine supplies the buffer once data arrives; the data in
+    // the result stays valid until the next asyncRead or close.
+    auto asyncRead() {
+        struct Awaiter {
+            AsyncSocket& socket;
+            bool await_ready() const noexcept { return false; }
+            bool await_suspend(std::coroutine_handle<> h) {
+                AsyncOp& op = socket.readOp;
+                socket.engine->releaseBuffer(&op);
+                op.wsaBuf = WSABUF{};
+                op.waiter = h;
+                return socket.engine->postRecv(socket.handle, &op) || op.failed();
+            }
+            IoResult await_resume() const noexcept {
+                const AsyncOp& op = socket.readOp;
+                return IoResult{ op.bytes, op.error, op.wsaBuf.buf };
+            }
+        };
+        return Awaiter{ *this };
+    }
+
+    // 写出全部 length 字节，部分发送由 resumeCompletion 续写；data 须保持有效直到 co_await 返回
+    // Write all length bytes; resumeCompletion continues after partial sends. data must stay valid
+    // until the co_await returns.
+    auto asyncWrite(const char* data, size_t length) {
+        struct Awaiter {
+            AsyncSocket& socket;
+            const char* data;
+            DWORD length;
+            bool await_ready() const noexcept { return length == 0; }
+            bool await_suspend(std::coroutine_handle<> h) {
+                AsyncOp& op = socket.writeOp;
+                op.wsaBuf = WSABUF{ length, const_cast<char*>(data) };
+                op.bytes = 0;
+                op.length = length;
+                op.waiter = h;
+                return socket.engine->postSend(socket.handle, &op) || op.failed();
+            }
+            IoResult await_resume() const noexcept {
+                if (length == 0)
+                    return IoResult{};
+                return IoResult{ socket.writeOp.bytes, socket.writeOp.error, nullptr };
+            }
+        };
+        return Awaiter{ *this, data, static_cast<DWORD>(length) };
+    }
+
+    // 取消在途的操作，它们以错误或 0 字节完成 / Cancel the operations in flight; they complete with an error or 0 bytes
+    void abort() {
+        if (handle)
+            engine->abort(handle);
+    }
+
+    // 取消所有打开的套接字上在途的操作（服务器停止时） / Cancel the operations in flight on every open socket (when the server stops)
+    static void abortAll() {
+        std::lock_guard<std::mutex> guard(lock());
+        for (AsyncSocket* s = head(); s; s = s->next)
+            s->abort();
+    }
+
+    // 交还读缓冲区并关闭套接字；调用时不能有操作在途 / Hand back the read buffer and close the socket; no operation may be in flight
+    void close() {
+        if (!handle)
+            return;
+        unlink();
+        engine->releaseBuffer(&readOp);
+        engine->release(handle);
+        handle = nullptr;
+    }
+
+private:
+    CompletionEngine* engine{ nullptr };
+    IoHandle* handle{ nullptr };
+    AsyncOp readOp;
+    AsyncOp writeOp;
+    AsyncSocket* prev{ nullptr };   // 打开的套接字的链表 / List of the open sockets
+    AsyncSocket* next{ nullptr };
+
+    static std::mutex& lock() {
+        static std::mutex m;
+        return m;
+    }
+    static AsyncSocket*& head() {
+        static AsyncSocket* h = nullptr;
+        return h;
+    }
+    void link() {
+        std::lock_guard<std::mutex> guard(lock());
+        prev = nullptr;
+        next = head();
+        if (next)
+            next->prev = this;
+        head() = this;
+    }
+    void unlink() {
+        std::lock_guard<std::mutex> guard(lock());
+        (prev ? prev->next : head()) = next;
+        if (next)
+            next->prev = prev;
+        prev = next = nullptr;
+    }
+};
+
+// 监听套接字。每个 asyncAccept 的请求位于等待它的协程帧中，多个协程可以同时等待接受
+// Listening socket. Each asyncAccept's request lives in the frame of the coroutine awaiting it,
+// so several coroutines may wait for connections at once.
+class AsyncListener {
+public:
+    AsyncListener(CompletionEngine* e, IoHandle* listener, SOCKET listenSocket)
+        : engine(e), handle(listener), listenSocket(listenSocket) {}
+
+    // 接受一个连接并关联到引擎；失败时返回空的 AsyncSocket，error 中是错误码
+    // Accept a connection and attach it to the engine; on failure an empty AsyncSocket is returned
+    // and error holds the error code.
+    auto asyncAccept(int* error = nullptr) {
+        struct Awaiter {
+            AsyncListener& listener;
+            int* error;
+            AsyncOp op{};
+            bool await_ready() const noexcept { return false; }
+            bool await_suspend(std::coroutine_handle<> h) {
+                op.engine = listener.engine;
+                op.waiter = h;
+                return listener.engine->postAccept(listener.handle, &op) || op.failed();
+            }
+            AsyncSocket await_resume() {
+                // IOCP 的 AcceptEx 地址区来自 BufferPool / IOCP's AcceptEx address area comes from the BufferPool
+                listener.engine->releaseBuffer(&op);
+                if (error)
+                    *error = op.error;
+                if (op.error != 0) {
+                    if (op.socket != INVALID_SOCKET)
+                        closesocket(op.socket);
+                    return AsyncSocket{};
+                }
+                IoHandle* h = listener.engine->attach(op.socket, nullptr);
+                if (!h) {
+                    if (error)
+                        *error = static_cast<int>(GetLastError());
+                    closesocket(op.socket);
+                    return AsyncSocket{};
+                }
+#ifdef _WIN32
+                // AcceptEx 接受的套接字需要继承监听套接字的属性 / A socket accepted by AcceptEx must inherit the listener's properties
+                setsockopt(op.socket, SOL_SOCKET, SO_UPDATE_ACCEPT_CONTEXT,
+                    reinterpret_cast<char*>(&listener.listenSocket), sizeof(listener.listenSocket));
+#endif
+                setNoDelay(op.socket);
+                return AsyncSocket(listener.engine, h);
+            }
+        };
+        return Awaiter{ *this, error };
+    }
+
+private:
+    CompletionEngine* engine;
+    IoHandle* handle;
+    SOCKET listenSocket;
+};
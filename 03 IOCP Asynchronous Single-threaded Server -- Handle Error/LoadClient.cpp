@@ -0,0 +1,655 @@
+// LoadClient.cpp
+// 负载生成器：在完成引擎上异步驱动数千个连接，用 HDR 直方图报告往返延迟
+// Load generator: drives thousands of connections asynchronously on the completion engine and
+// reports round-trip latency from HDR histograms.
+//
+// 与 Client.cpp 的结构相同（请求对象 + 完成事件处理线程），但建立在 CompletionEngine 之上，
+// 因此在 Windows (IOCP) 与 Linux (epoll / io_uring) 上都能运行，可以对 03 与 04 的服务器施压。
+// Structured like Client.cpp (request objects plus threads that handle completions), but built
+// on CompletionEngine so it runs on Windows (IOCP) and Linux (epoll / io_uring) and can load
+// both the 03 and the 04 servers.
+//
+// 两种模式 / Two modes:
+//   closed  每个连接收到回复后立即发送下一个请求；吞吐量由服务器决定
+//           Every connection sends its next request as soon as the reply arrives; the server sets the pace.
+//   open    按固定速率 --rate 安排请求，第 i 个请求的预定时间为 start + i / rate，轮流分给各个连接。
+//           连接上仍有未完成的请求时，新请求在该连接上排队。延迟从预定时间开始计算，而不是实际
+//           发出的时间，因此服务器停顿期间本应发出的请求也会计入停顿（避免协同遗漏）。
+//           Requests are scheduled at a fixed --rate, request i due at start + i / rate and
+//           assigned to the connections in turn. A request whose connection still has one in
+//           flight queues on that connection. Latency is measured from the due time rather than
+//           from when it was actually sent, so requests that should have gone out during a server
+//           stall are charged for the stall too (no coordinated omission).
+//
+// --http PATH 时像 wrk 一样对 HTTP 服务器（如 Server --protocol http）施压：每个连接保持打开，
+// 一个请求是 --pipeline N 个流水线式发出的 "GET PATH"，收齐 N 个响应（按 Content-Length 计）才算完成，
+// 吞吐量按 HTTP 请求数计算。
+// With --http PATH it loads an HTTP server (such as Server --protocol http) the way wrk does:
+// every connection stays open, one request is --pipeline N pipelined "GET PATH" requests and it
+// completes once N responses (delimited by Content-Length) are in; throughput counts HTTP requests.
+//
+// 只统计预定时间落在预热之后、测量结束之前的请求；结束时仍未得到回复的请求按 "结束时刻 - 预定时间"
+// 记录（延迟的下界）并计入 unanswered。最后一行 "Result: key=value ..." 供脚本解析。
+// Only requests due after the warm-up and before the end of the measurement count. Requests
+// still unanswered at the end are recorded as "end - due time" (a lower bound on their latency)
+// and counted as unanswered. The final "Result: key=value ..." line is meant for scripts.
+//
+// 用法 / Usage:
+//   LoadClient [--host IP] [--port N] [--connections N] [--payload BYTES] [--reply-extra BYTES]
+//              [--framing raw|length|line] [--mode closed|open] [--rate REQ_PER_S]
+//              [--seconds S] [--warmup S] [--engine NAME] [--threads N] [--http PATH] [--pipeline N]
+//
+// 04 服务器在每个回复前加 "Server: "，对它施压时使用 --reply-extra 8。
+// The 04 server prefixes every reply with "Server: "; use --reply-extra 8 against it.
+
+#include "CompletionEngine.h"
+#include "../Common/Framing.h"
+#include "../Common/Histogram.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/resource.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+// 负载配置 / Load configuration
+struct LoadConfig {
+    std::string host{ "127.0.0.1" };
+    int port{ 8888 };
+    int connections{ 1000 };
+    int payload{ 64 };
+    int replyExtra{ 0 };                    // 回复比请求多出的字节数 / Bytes a reply carries beyond the request
+    FrameMode framing{ FrameMode::Raw };
+    bool openLoop{ false };
+    double rate{ 10000 };                   // open 模式每秒请求数 / Requests per second in open mode
+    int seconds{ 10 };
+    int warmup{ 2 };
+    std::string engine{ defaultEngineName() };
+    int threads{ static_cast<int>(std::max(1u, std::thread::hardware_concurrency())) };
+    std::string httpPath;                   // 非空时发送 HTTP GET / When set, send HTTP GETs
+    int pipeline{ 1 };                      // 每次一起发出的 HTTP 请求数 / HTTP requests sent together each time
+};
+
+// 统计完整的 HTTP 响应（只认 Content-Length 界定的正文） / Counts complete HTTP responses (bodies delimited by Content-Length only)
+class ResponseCounter {
+public:
+    // 返回这段数据中完成的响应数；响应无法解析时返回 -1 / Responses completed by this data; -1 if a response cannot be parsed
+    int feed(const char* p, size_t n) {
+        int complete = 0;
+        while (n > 0) {
+            if (bodyLeft > 0) {
+                size_t take = std::min(n, bodyLeft);
+                bodyLeft -= take;
+                p += take;
+                n -= take;
+                if (bodyLeft == 0)
+                    ++complete;
+                continue;
+            }
+            // 头部跨越接收边界时先拼进 head / A head spanning a receive boundary is gathered in head first
+            size_t before = head.size();
+            std::string_view view(p, n);
+            if (before > 0) {
+                head.append(p, n);
+                view = head;
+            }
+            size_t end = view.find("\r\n\r\n", before > 3 ? before - 3 : 0);
+            if (end == std::string_view::npos) {
+                if (before == 0)
+                    head.assign(p, n);
+                return head.size() > 64 * 1024 ? -1 : complete;
+            }
+            end += 4;
+            long long length = contentLength(view.substr(0, end));
+            if (length < 0)
+                return -1;
+            size_t used = end - before;
+            head.clear();
+            p += used;
+            n -= used;
+            bodyLeft = static_cast<size_t>(length);
+            if (bodyLeft == 0)
+                ++complete;
+        }
+        return complete;
+    }
+
+private:
+    std::string head;
+    size_t bodyLeft{ 0 };
+
+    static long long contentLength(std::string_view head) {
+        size_t pos = 0;
+        while ((pos = head.find('\n', pos)) != std::string_view::npos) {
+            ++pos;
+            std::string_view line = head.substr(pos, 15);
+            bool match = line.size() == 15;
+            for (size_t i = 0; match && i < 15; ++i)
+                match = std::tolower(static_cast<unsigned char>(line[i])) == "content-length:"[i];
+            if (match)
+                return std::atoll(head.data() + pos + 15);
+        }
+        return -1;
+    }
+};
+
+// 每个连接的状态；一个连接同时最多有一个请求在途，因此接收和发送各用一个请求对象
+// Per-connection state. A connection has at most one request in flight, so one request object
+// each for receiving and sending is enough.
+struct LoadConnection {
+    IoHandle* handle{ nullptr };
+    IoRequest recvReq;
+    IoRequest sendReq;
+    std::mutex lock;                        // 保护下面的字段 / Guards the fields below
+    bool alive{ true };
+    bool inFlight{ false };                 // 已发出请求、尚未收齐回复 / A request was sent and its reply is incomplete
+    bool sendBusy{ false };                 // sendReq 仍在引擎中 / sendReq is still with the engine
+    bool sendWanted{ false };               // sendReq 完成后立即再发一次 / Send again as soon as sendReq completes
+    size_t received{ 0 };                   // 当前回复已收到的字节数（HTTP 模式为响应数） / Bytes of the current reply received so far (responses in HTTP mode)
+    ResponseCounter responses;              // HTTP 模式的响应边界 / Response boundaries in HTTP mode
+    Clock::time_point due;                  // 当前请求的预定时间 / Due time of the current request
+    std::deque<Clock::time_point> backlog;  // open 模式中排队的请求 / Requests queued in open mode
+};
+
+// 工作线程记录延迟的直方图（纳秒） / Histogram the current thread records latencies into (ns)
+static thread_local Histogram* tlsHistogram = nullptr;
+
+class LoadClient {
+public:
+    explicit LoadClient(const LoadConfig& c) : cfg(c) {
+        if (!cfg.httpPath.empty()) {
+            for (int i = 0; i < cfg.pipeline; ++i)
+                request += "GET " + cfg.httpPath + " HTTP/1.1\r\nHost: " + cfg.host + "\r\n\r\n";
+            replySize = static_cast<size_t>(cfg.pipeline);
+            return;
+        }
+        appendFrame(request, cfg.framing, {}, std::string(static_cast<size_t>(cfg.payload), 'x'));
+        replySize = request.size() + static_cast<size_t>(cfg.replyExtra);
+    }
+
+    int run() {
+        engine = createEngine(cfg.engine);
+        if (!engine || !engine->open(cfg.threads)) {
+            std::cerr << "Failed to open engine " << cfg.engine << std::endl;
+            return 1;
+        }
+        std::vector<SOCKET> sockets = connectAll();
+        std::cout << "Connected " << sockets.size() << "/" << cfg.connections << " to " << cfg.host << ":" << cfg.port
+            << " (" << engine->name() << ", " << cfg.threads << " threads)" << std::endl;
+        if (sockets.empty())
+            return 1;
+
+        conns.reserve(sockets.size());
+        for (SOCKET s : sockets) {
+            auto conn = std::make_unique<LoadConnection>();
+            conn->recvReq.socket = s;
+            conn->sendReq.socket = s;
+            conn->handle = engine->attach(s, conn.get());
+            if (!conn->handle) {
+                std::cerr << "attach failed. Error: " << WSAGetLastError() << std::endl;
+                closesocket(s);
+                ++connectionErrors;
+                continue;
+            }
+            conns.push_back(std::move(conn));
+        }
+
+        histograms.resize(static_cast<size_t>(cfg.threads) + 1);
+        for (int i = 0; i < cfg.threads; ++i)
+            workers.emplace_back([this, i] { workerLoop(&histograms[static_cast<size_t>(i)]); });
+
+        for (auto& conn : conns) {
+            std::lock_guard<std::mutex> guard(conn->lock);
+            postRecv(*conn);
+        }
+
+        start = Clock::now();
+        measureBegin = start + std::chrono::seconds(cfg.warmup);
+        measureEnd = measureBegin + std::chrono::seconds(cfg.seconds);
+        if (cfg.openLoop)
+            scheduleOpenLoop();
+        else
+            runClosedLoop();
+
+        drainAndStop();
+        report();
+        return 0;
+    }
+
+private:
+    LoadConfig cfg;
+    std::string request;
+    size_t replySize{ 0 };                  // HTTP 模式为每个请求的响应数 / Responses per request in HTTP mode
+    std::unique_ptr<CompletionEngine> engine;
+    std::vector<std::unique_ptr<LoadConnection>> conns;
+    std::vector<Histogram> histograms;      // 每个工作线程一个，最后一个给主线程 / One per worker, the last one for the main thread
+    std::vector<std::thread> workers;
+    std::atomic<bool> running{ true };      // 闭环模式是否继续发出请求 / Whether closed loop keeps issuing requests
+    std::atomic<bool> stopWorkers{ false };
+    std::atomic<int64_t> outstanding{ 0 };  // 已安排、尚未得到回复或失败的请求 / Requests scheduled but neither answered nor failed
+    std::atomic<int64_t> pendingOps{ 0 };   // 引擎中尚未完成的操作 / Operations still inside the engine
+    std::atomic<uint64_t> connectionErrors{ 0 };
+    std::atomic<uint64_t> failedRequests{ 0 };
+    uint64_t scheduled{ 0 };                // 测量窗口内安排的请求 / Requests due inside the measurement window
+    uint64_t unanswered{ 0 };
+    Clock::time_point start;
+    Clock::time_point measureBegin;
+    Clock::time_point measureEnd;
+    Clock::time_point finish;
+
+    bool inWindow(Clock::time_point due) const { return due >= measureBegin && due < measureEnd; }
+
+    // ------------------------------ 建立连接 / Connecting ------------------------------
+
+    // 把打开文件数上限提到硬上限 / Raise the open-file limit to the hard limit
+    static void raiseSocketLimit() {
+#ifndef _WIN32
+        rlimit limit{};
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+            limit.rlim_cur = limit.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+#endif
+    }
+
+    // 每批发起 CONNECT_BATCH 个非阻塞连接并等待它们完成，避免一次压满服务器的监听队列；
+    // 目标是回环地址时轮流绑定 16 个本地回环地址，分散临时端口
+    // Start non-blocking connects CONNECT_BATCH at a time and wait for each batch, so the server's
+    // listen queue is not flooded all at once. Against a loopback target the sockets are bound
+    // to 16 local loopback addresses in turn to spread the ephemeral ports.
+    std::vector<SOCKET> connectAll() {
+        constexpr int CONNECT_BATCH = 256;
+        raiseSocketLimit();
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<unsigned short>(cfg.port));
+        if (InetPtonA(AF_INET, cfg.host.c_str(), &addr.sin_addr) != 1) {
+            std::cerr << "Invalid host address " << cfg.host << std::endl;
+            return {};
+        }
+        bool loopback = cfg.host.compare(0, 4, "127.") == 0;
+        std::vector<SOCKET> connected;
+        for (int first = 0; first < cfg.connections; first += CONNECT_BATCH) {
+            std::vector<SOCKET> pending;
+            for (int i = first; i < std::min(cfg.connections, first + CONNECT_BATCH); ++i) {
+                SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+                if (s == INVALID_SOCKET) {
+                    std::cerr << "socket failed. Error: " << WSAGetLastError() << std::endl;
+                    ++connectionErrors;
+                    break;
+                }
+                if (loopback) {
+                    sockaddr_in local{};
+                    local.sin_family = AF_INET;
+                    std::string localIp = "127.0.0." + std::to_string(1 + i % 16);
+                    InetPtonA(AF_INET, localIp.c_str(), &local.sin_addr);
+                    bind(s, reinterpret_cast<sockaddr*>(&local), sizeof(local));
+                }
+                setNonBlocking(s);
+                setNoDelay(s);
+                if (connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR) {
+                    int err = WSAGetLastError();
+#ifdef _WIN32
+                    bool inProgress = err == WSAEWOULDBLOCK;
+#else
+                    bool inProgress = err == EINPROGRESS;
+#endif
+                    if (!inProgress) {
+                        ++connectionErrors;
+                        closesocket(s);
+                        continue;
+                    }
+                }
+                pending.push_back(s);
+            }
+            waitConnected(pending, connected);
+        }
+        return connected;
+    }
+
+    // 等待一批连接完成，成功的移入 connected；5 秒后仍未完成的按失败计
+    // Wait for a batch of connects and move the successful ones to connected; anything still
+    // pending after 5 s counts as failed.
+    void waitConnected(std::vector<SOCKET>& pending, std::vector<SOCKET>& connected) {
+        auto deadline = Clock::now() + std::chrono::seconds(5);
+        while (!pending.empty() && Clock::now() < deadline) {
+            std::vector<WSAPOLLFD> polls(pending.size());
+            for (size_t i = 0; i < pending.size(); ++i) {
+                polls[i].fd = pending[i];
+                polls[i].events = POLLOUT;
+            }
+            if (WSAPoll(polls.data(), static_cast<ULONG>(polls.size()), 100) <= 0)
+                continue;
+            std::vector<SOCKET> still;
+            for (size_t i = 0; i < pending.size(); ++i) {
+                if (polls[i].revents == 0) {
+                    still.push_back(pending[i]);
+                    continue;
+                }
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(pending[i], SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&err), &len);
+                if (err == 0 && !(polls[i].revents & (POLLERR | POLLHUP))) {
+                    connected.push_back(pending[i]);
+                }
+                else {
+                    ++connectionErrors;
+                    closesocket(pending[i]);
+                }
+            }
+            pending.swap(still);
+        }
+        for (SOCKET s : pending) {
+            ++connectionErrors;
+            closesocket(s);
+        }
+        pending.clear();
+    }
+
+    // ------------------------------ 请求 / Requests ------------------------------
+
+    // 以下函数都在持有 conn.lock 时调用 / Everything below is called with conn.lock held
+
+    void postRecv(LoadConnection& conn) {
+        conn.recvReq.wsaBuf = WSABUF{};      // 由引擎在数据到达后提供缓冲区 / The engine supplies a buffer once data arrives
+        ++pendingOps;
+        if (!engine->postRecv(conn.handle, &conn.recvReq)) {
+            --pendingOps;
+            fail(conn);
+        }
+    }
+
+    void postSend(LoadConnection& conn) {
+        conn.sendReq.wsaBuf = WSABUF{ static_cast<ULONG>(request.size()), const_cast<char*>(request.data()) };
+        conn.sendBusy = true;
+        ++pendingOps;
+        if (!engine->postSend(conn.handle, &conn.sendReq)) {
+            --pendingOps;
+            conn.sendBusy = false;
+            fail(conn);
+        }
+    }
+
+    // 发出一个预定时间为 due 的请求；上一次发送尚未完成时（回复先于发送完成事件到达）推迟到它完成
+    // Issue a request due at due. If the previous send has not completed yet (its reply arrived
+    // before its send completion), the send waits for that completion.
+    void beginRequest(LoadConnection& conn, Clock::time_point due) {
+        conn.inFlight = true;
+        conn.due = due;
+        conn.received = 0;
+        if (conn.sendBusy)
+            conn.sendWanted = true;
+        else
+            postSend(conn);
+    }
+
+    // 连接出错或被关闭：它在途和排队的请求都算失败 / The connection failed or was closed: its in-flight and queued requests all fail
+    void fail(LoadConnection& conn) {
+        if (!conn.alive)
+            return;
+        conn.alive = false;
+        ++connectionErrors;
+        int64_t dropped = (conn.inFlight ? 1 : 0) + static_cast<int64_t>(conn.backlog.size());
+        conn.inFlight = false;
+        conn.backlog.clear();
+        failedRequests += static_cast<uint64_t>(dropped);
+        outstanding -= dropped;
+        engine->abort(conn.handle);
+    }
+
+    // ------------------------------ 完成事件 / Completions ------------------------------
+
+    void workerLoop(Histogram* histogram) {
+        tlsHistogram = histogram;
+        while (!stopWorkers.load(std::memory_order_acquire)) {
+            Completion c;
+            if (!engine->wait(c, 100))
+                continue;
+            auto* conn = static_cast<LoadConnection*>(c.handle->context);
+            {
+                std::lock_guard<std::mutex> guard(conn->lock);
+                if (c.request == &conn->recvReq)
+                    handleRecv(*conn, c);
+                else
+                    handleSend(*conn, c);
+            }
+            --pendingOps;
+        }
+    }
+
+    void handleRecv(LoadConnection& conn, const Completion& c) {
+        size_t units = c.bytes;
+        bool malformed = false;
+        if (!cfg.httpPath.empty() && c.error == 0 && c.bytes > 0) {
+            int complete = conn.responses.feed(conn.recvReq.wsaBuf.buf, c.bytes);
+            malformed = complete < 0;
+            units = malformed ? 0 : static_cast<size_t>(complete);
+        }
+        engine->releaseBuffer(&conn.recvReq);
+        if (c.error != 0 || c.bytes == 0 || malformed) {
+            fail(conn);
+            return;
+        }
+        if (!conn.alive)
+            return;
+        conn.received += units;
+        if (conn.inFlight && conn.received >= replySize) {
+            Clock::time_point now = Clock::now();
+            if (inWindow(conn.due))
+                tlsHistogram->record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - conn.due).count()));
+            conn.inFlight = false;
+            --outstanding;
+            if (!conn.backlog.empty()) {
+                Clock::time_point due = conn.backlog.front();
+                conn.backlog.pop_front();
+                beginRequest(conn, due);
+            }
+            else if (!cfg.openLoop && running.load(std::memory_order_relaxed)) {
+                ++outstanding;
+                beginRequest(conn, now);
+            }
+        }
+        if (conn.alive)
+            postRecv(conn);
+    }
+
+    void handleSend(LoadConnection& conn, const Completion& c) {
+        conn.sendBusy = false;
+        if (c.error != 0) {
+            fail(conn);
+            return;
+        }
+        if (conn.sendWanted && conn.alive) {
+            conn.sendWanted = false;
+            postSend(conn);
+        }
+    }
+
+    // ------------------------------ 负载 / Load ------------------------------
+
+    void runClosedLoop() {
+        for (auto& conn : conns) {
+            std::lock_guard<std::mutex> guard(conn->lock);
+            if (!conn->alive)
+                continue;
+            ++outstanding;
+            beginRequest(*conn, Clock::now());
+        }
+        std::this_thread::sleep_until(measureEnd);
+        running = false;
+    }
+
+    // 主线程按预定时间发出请求；落后时一次补发所有已到期的请求，不跳过
+    // The main thread issues requests at their due times; when it falls behind it issues every
+    // request that is already due at once, skipping none.
+    void scheduleOpenLoop() {
+        const double interval = 1e9 / cfg.rate;
+        auto dueAt = [&](uint64_t i) {
+            return start + std::chrono::nanoseconds(static_cast<int64_t>(static_cast<double>(i) * interval));
+        };
+        uint64_t next = 0;
+        while (true) {
+            Clock::time_point now = Clock::now();
+            if (now >= measureEnd)
+                break;
+            for (Clock::time_point due = dueAt(next); due <= now && due < measureEnd; due = dueAt(++next)) {
+                LoadConnection& conn = *conns[next % conns.size()];
+                if (inWindow(due))
+                    ++scheduled;
+                std::lock_guard<std::mutex> guard(conn.lock);
+                if (!conn.alive) {
+                    ++failedRequests;
+                    continue;
+                }
+                ++outstanding;
+                if (conn.inFlight)
+                    conn.backlog.push_back(due);
+                else
+                    beginRequest(conn, due);
+            }
+            std::this_thread::sleep_until(std::min(dueAt(next), measureEnd));
+        }
+    }
+
+    // 等待在途的请求最多 1 秒，剩下的按下界记录；然后取消所有操作、停止工作线程并关闭连接
+    // Wait up to 1 s for requests in flight and record the rest as lower bounds; then cancel all
+    // operations, stop the workers and close the connections.
+    void drainAndStop() {
+        auto drainDeadline = Clock::now() + std::chrono::seconds(1);
+        while (outstanding.load() > 0 && Clock::now() < drainDeadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        finish = Clock::now();
+        tlsHistogram = &histograms.back();
+        for (auto& conn : conns) {
+            std::lock_guard<std::mutex> guard(conn->lock);
+            auto recordUnanswered = [&](Clock::time_point due) {
+                if (!inWindow(due))
+                    return;
+                tlsHistogram->record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(finish - due).count()));
+                ++unanswered;
+            };
+            if (conn->inFlight)
+                recordUnanswered(conn->due);
+            for (Clock::time_point due : conn->backlog)
+                recordUnanswered(due);
+            conn->inFlight = false;
+            conn->backlog.clear();
+            if (conn->alive) {
+                conn->alive = false;
+                engine->abort(conn->handle);
+            }
+        }
+        auto abortDeadline = Clock::now() + std::chrono::seconds(2);
+        while (pendingOps.load() > 0 && Clock::now() < abortDeadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        stopWorkers = true;
+        for (std::thread& t : workers)
+            t.join();
+        if (pendingOps.load() > 0)
+            std::cerr << pendingOps.load() << " operations did not complete after cancellation" << std::endl;
+        else
+            for (auto& conn : conns)
+                engine->release(conn->handle);
+        engine.reset();
+    }
+
+    void report() {
+        Histogram all;
+        for (const Histogram& h : histograms)
+            all.add(h);
+        auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000; };
+        bool http = !cfg.httpPath.empty();
+        double perRequest = http ? cfg.pipeline : 1;
+        double throughput = static_cast<double>(all.count() - unanswered) * perRequest / cfg.seconds;
+        std::cout << (cfg.openLoop ? "Open" : "Closed") << " loop, " << conns.size() << " connections, ";
+        if (http)
+            std::cout << "GET " << cfg.httpPath << " pipelined " << cfg.pipeline << " deep";
+        else
+            std::cout << cfg.payload << "-byte payloads";
+        std::cout << ", " << cfg.seconds << " s after " << cfg.warmup << " s warm-up";
+        if (cfg.openLoop)
+            std::cout << ", target " << std::fixed << std::setprecision(0) << cfg.rate << " req/s (" << scheduled << " due)";
+        std::cout << std::endl;
+        std::cout << std::fixed << std::setprecision(0) << "  throughput " << throughput << " req/s, "
+            << all.count() << " latencies recorded, " << unanswered << " unanswered, "
+            << failedRequests.load() << " failed, " << connectionErrors.load() << " connection errors" << std::endl;
+        std::cout << std::setprecision(1)
+            << "  latency us: min " << us(all.min()) << "  mean " << all.mean() / 1000 << "  p50 " << us(all.percentile(50))
+            << "  p90 " << us(all.percentile(90)) << "  p99 " << us(all.percentile(99))
+            << "  p99.9 " << us(all.percentile(99.9)) << "  max " << us(all.max()) << std::endl;
+        std::cout << "Result: mode=" << (cfg.openLoop ? "open" : "closed");
+        if (http)
+            std::cout << " http=" << cfg.httpPath << " pipeline=" << cfg.pipeline;
+        std::cout << " connections=" << cfg.connections
+            << " connected=" << conns.size() << " payload=" << cfg.payload << " seconds=" << cfg.seconds
+            << std::setprecision(0) << " rate=" << (cfg.openLoop ? cfg.rate : 0.0) << " requests=" << all.count()
+            << " throughput=" << throughput << std::setprecision(1)
+            << " p50_us=" << us(all.percentile(50)) << " p90_us=" << us(all.percentile(90))
+            << " p99_us=" << us(all.percentile(99)) << " p999_us=" << us(all.percentile(99.9))
+            << " max_us=" << us(all.max()) << " errors=" << connectionErrors.load() + failedRequests.load()
+            << " unanswered=" << unanswered << std::endl;
+    }
+};
+
+static void usage() {
+    std::cerr << "Usage: LoadClient [--host IP] [--port N] [--connections N] [--payload BYTES] [--reply-extra BYTES]\n"
+        "                  [--framing raw|length|line] [--mode closed|open] [--rate REQ_PER_S]\n"
+        "                  [--seconds S] [--warmup S] [--engine NAME] [--threads N] [--http PATH] [--pipeline N]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    LoadConfig cfg;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--host") cfg.host = value;
+        else if (arg == "--port") cfg.port = std::atoi(value.c_str());
+        else if (arg == "--connections") cfg.connections = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--payload") cfg.payload = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--reply-extra") cfg.replyExtra = std::max(0, std::atoi(value.c_str()));
+        else if (arg == "--seconds") cfg.seconds = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--warmup") cfg.warmup = std::max(0, std::atoi(value.c_str()));
+        else if (arg == "--rate") cfg.rate = std::max(1.0, std::atof(value.c_str()));
+        else if (arg == "--engine") cfg.engine = value;
+        else if (arg == "--threads") cfg.threads = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--http") cfg.httpPath = value;
+        else if (arg == "--pipeline") cfg.pipeline = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--mode" && (value == "closed" || value == "open")) cfg.openLoop = value == "open";
+        else if (arg != "--framing" || !parseFrameMode(value, cfg.framing)) {
+            usage();
+            return 1;
+        }
+    }
+
+#ifndef _WIN32
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        std::cerr << "WSAStartup failed." << std::endl;
+        return 1;
+    }
+    int rc = LoadClient(cfg).run();
+    WSACleanup();
+    return rc;
+}
@@ -1,24 +1,175 @@
 // Server.cpp
-// Windows IOCP 첽̻߳Է (Modern C++ )
-// Windows IOCP asynchronous single-threaded echo server (Modern C++ style)
+// Windows IOCP 첽Է (Modern C++ )ֶ֧ɶ˿ڹ߳
+// Windows IOCP asynchronous echo server (Modern C++ style) with a pool of completion workers
 //
 //  RAII Դin-class ԱʼһԻȡ AcceptEx չָ롣
 // It uses RAII, in-class member initialization, and retrieves the AcceptEx pointer once.
+//
+// N ̹߳ͬһɶУÿüֻһɵĲŻͷ
+// ͬһ׽ϵ handleAccept/handleRecv/handleSend ڲͬ߳ϲִС
+// Linux ͬһ״̬ epoll ֮ϣ CompletionEngine.h
+// N worker threads share one completion queue. Every connection is reference counted and only
+// the last completing operation frees it, so handleAccept/handleRecv/handleSend may run
+// concurrently on different threads for the same socket. On Linux the same state machine runs
+// on the epoll engine (see CompletionEngine.h).
+//
+// --shards N ʱΪÿһƬÿƬԼļ׽ (SO_REUSEPORT)桢
+// ߳ӣƬ֮䲻κ״̬ںڸ׽֮ӡ
+// With --shards N the server runs one shard per core instead: each shard has its own listening
+// socket (SO_REUSEPORT), engine, single worker thread and connections. Shards share no state;
+// the kernel spreads new connections across their listeners.
+//
+// --framing length|line ʱ֡ԣ Common/Framing.hһνеĶ֡һηأ
+// Խձ߽֡ȲȫٷأĬ raw ԰ÿνյݵһϢ
+// With --framing length|line the server echoes whole frames (see Common/Framing.h): all complete
+// frames of one receive go back in one send, and a frame split across receives is echoed once it
+// is complete. The default, raw, still treats whatever one receive returns as one message.
+//
+// --admin-port N ʱ 127.0.0.1:N  Prometheus ıʽʱָ꣨ Common/Metrics.h
+// շֽڡ;¼С밴ͷֵĴָÿ̵߳ĲУץȡӰ칤̡߳
+// With --admin-port N the server serves runtime metrics on 127.0.0.1:N in the Prometheus text
+// format (see Common/Metrics.h): accepts, bytes in and out, operations in flight, completion
+// batch sizes and errors by type. They are kept in per-thread slots, so a scrape does not touch the workers.
+//
+// ߳ÿȡ --batch N ¼Ĭ 64һύвķ͡
+// Each worker dequeues up to --batch N completions at a time (64 by default) and submits the
+// sends they produced together once the whole batch is handled.
+//
+// ÿһУ;ʱգµĻԺϲУȵǰɺһη
+// ;Ŷӵֽڳ --high-water ʱͣգ --low-water ٻָռõڴޡ
+// Every connection has an output queue. Receiving goes on while a send is in flight; new echoes
+// are coalesced in the queue and go out in one send once the current one completes. When the
+// bytes in flight and queued exceed --high-water, receiving pauses until they drop to
+// --low-water, so a slow reader can only hold a bounded amount of memory.
+//
+// ʱɷֲʱ֣ Common/TimerWheel.hÿһʱֻڽʱ뵽ʱ
+// շ·ֻдʱʱޣ--idle-timeoutûյݣ--read-timeout
+// ֡δȫ --write-timeoutûнչκһ͹رӣ²
+// ʱÿ 100 ms ǰһ¼ѭƽÿĿ޹ء
+// Timeouts are driven by a hierarchical timing wheel (see Common/TimerWheel.h). Each connection
+// has one timer, armed only on accept and on expiry; the receive and send paths just write
+// timestamps. On expiry three deadlines are checked: --idle-timeout (nothing received),
+// --read-timeout (a partial frame not completed) and --write-timeout (a send making no progress).
+// Past any of them the connection is closed; otherwise the timer is re-armed for the nearest one.
+// The wheel moves in 100 ms ticks from the completion loop, at a per-tick cost independent of the
+// number of connections.
+//
+// --protocol http ʱٻԣΪ HTTP/1.1  Common/Http.hĬϱ֣
+// һνˮʽĶ˳ǵӦƴһͬһз
+// ·ɱɸӦԤȹͷ Date 볤ɣҲԷֿ鷢͡
+// ͻҪرջǷʱӦرӡ
+// With --protocol http the server stops echoing and speaks HTTP/1.1 instead (see
+// Common/Http.h). Connections stay open by default; pipelined requests arriving in one receive
+// are handled in order and their responses are concatenated and go out through the same output
+// queue. Requests are dispatched to handlers through a route table, and responses consist of a
+// pre-built header block plus Date and the length, or are sent in chunks. When the client asks
+// to close or a request is malformed, the connection closes once the last response is sent.
+//
+// --static DIR ʱ /static/ ṩ DIR еļ Common/FileCache.hļӳڰ --file-cache
+// ޶С LRU УӦͷڼʱɡļΪļƬУֱӴļ
+// (sendfile / TransmitFile)ÿ SEND_CHUNK ֽڣio_uring 治ܷļΪӳ䷢͡
+// With --static DIR the files in DIR are served under /static/ (see Common/FileCache.h): their
+// contents are mapped in an LRU cache bounded by --file-cache and their response headers are
+// rendered when they are loaded. The body of a large file waits in the output queue as a file
+// slice and the engine sends it straight from the file (sendfile / TransmitFile), at most
+// SEND_CHUNK bytes at a time; the io_uring engine cannot send files and sends from the
+// mapping instead.
+//
+// --handoff PATH ʱ֧ Common/Handoff.hͬĲ½̾ PATH ȡ߼׽֣
+// ɽֹͣܣdetachListenerHTTP ģʽÿӦ Connection: close
+// ӹرջ --drain-timeout ں˳׽ʼմ򿪣ڼûӱܾ
+// With --handoff PATH the server supports hot restarts (see Common/Handoff.h): a new process
+// started with the same arguments takes the listening sockets over PATH, and the old one then
+// stops accepting (detachListener), answers every HTTP request with Connection: close, and exits
+// once its connections have closed or --drain-timeout expires. The listening sockets stay open
+// throughout, so no connection is refused during a restart.
+//
+// --spin US ʱ߳ȴ֮ǰæѯ¼ US ΢룬Ԥ渺е CompletionEngine.h
+//  SpinWait CPU ȡʡĻӳ١Linux ϻ --busy-poll US ׽æѯ
+// (SO_BUSY_POLL) --sqpoll IDLE_MS ں߳ѯ io_uring ύСĬ϶رա
+// With --spin US the workers busy-poll for completions for up to US microseconds before they
+// block, with a budget that adapts to the load (see SpinWait in CompletionEngine.h), trading CPU
+// for the wakeup latency saved. On Linux --busy-poll US also has the sockets busy-poll the NIC
+// queue (SO_BUSY_POLL), and --sqpoll IDLE_MS has a kernel thread poll io_uring's submission
+// queue. All three are off by default.
+//
+// --cpus LIST ʱѹ߳ι̶ LIST е CPU ϣ Common/Topology.hջ slab
+// ֮ڸԽڵڴϡƬģʽÿƬһ CPU׽ SO_INCOMING_CPU
+// ں˰ڸ CPU յ SYN ӽӵݰ״̬뻺ͬһϡ
+// With --cpus LIST the workers are pinned to the CPUs of LIST in turn (see Common/Topology.h),
+// and the slabs of the object pools and receive buffers follow them onto their nodes' memory. In
+// shard mode each shard gets one CPU and its listener sets SO_INCOMING_CPU, so the kernel hands it
+// the connections whose SYN arrived on that CPU, and a connection's packet processing, state and
+// buffers all stay on one core.
+//
+// --limit-connects RATE[:BURST]  --limit-recv RATE[:BURST] ͻ IP ÿյֽ
+// --limit-unit messages ʱΪ֡ HTTP ͰȫƬõУ Common/RateLimiter.h
+// ĴС --limit-table ޶ʱ --limit-action delay Ƴһνգɶʱָ
+// ں˵Ľջ TCP ÿͻ˷Ƿ³һ BURST հ drop 
+// drop رӣbusy ظæµHTTP Ϊ 429رӡ
+// --limit-connects RATE[:BURST] and --limit-recv RATE[:BURST] limit each client IP's new
+// connections and received bytes per second (complete frames or HTTP requests with --limit-unit
+// messages). The token buckets live in a lock-free table shared by all shards (see
+// Common/RateLimiter.h) whose size is bounded by --limit-table. Above the limit --limit-action
+// decides: delay postpones the next receive until the timer resumes it, and once the kernel's
+// receive buffer fills, TCP flow control slows the client down, while connections and receives
+// that would run up more than one BURST of debt are dropped; drop closes the connection; busy
+// replies busy (429 in HTTP) and then closes it.
 
-#include <winsock2.h>
-#include <mswsock.h>
-#include <windows.h>
+#include "CompletionEngine.h"
+#include "../Common/ObjectPool.h"
+#include "../Common/Logger.h"
+#include "../Common/Framing.h"
+#include "../Common/Http.h"
+#include "../Common/FileCache.h"
+#include "../Common/Handoff.h"
+#include "../Common/RateLimiter.h"
+#include "../Common/Metrics.h"
+#include "../Common/TimerWheel.h"
+#include "../Common/Topology.h"
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <csignal>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory>
 
-#pragma comment(lib, "Ws2_32.lib")
-
-//  I/O С / Define I/O buffer size
-constexpr int IO_BUFFER_SIZE = 1024;
 // ˿ / Define listening port
 constexpr int PORT = 8888;
-//  GetQueuedCompletionStatus ĳʱʱ䣨룩 / Define timeout for GetQueuedCompletionStatus (ms)
+// Ĭͬʱ AcceptEx  / Default number of AcceptEx operations kept outstanding
+constexpr int DEFAULT_PENDING_ACCEPTS = 8;
+// еĬϸߵˮλֽڣ / Default output queue high and low watermarks (bytes)
+constexpr size_t DEFAULT_HIGH_WATER = 256 * 1024;
+constexpr size_t DEFAULT_LOW_WATER = 64 * 1024;
+//  GetQueuedCompletionStatusEx ĳʱʱ䣨룩 / Define timeout for GetQueuedCompletionStatusEx (ms)
 constexpr DWORD WAIT_TIMEOUT_MS = 1000;
+// ʱһĳȣ룩ʱľ / Length of one timing wheel tick (ms), the precision of the timeouts
+constexpr DWORD TIMER_TICK_MS = 100;
+// ĬϵĿСдʱ룩0 ʾر / Default idle, read and write timeouts (ms); 0 disables one
+constexpr int64_t DEFAULT_IDLE_TIMEOUT_MS = 60000;
+constexpr int64_t DEFAULT_READ_TIMEOUT_MS = 10000;
+constexpr int64_t DEFAULT_WRITE_TIMEOUT_MS = 30000;
+// һη͵ֽŶӵֽļԼƣɺűɣ˷ּη
+// ÿɶдʱĽչڶȡĿͻ˲Ϊһδûзر
+// Most bytes in one send (queued bytes and file each). An engine reports a send only once all of
+// it went out, so large output is split into several and each completion is progress to the write
+// timeout: a slow reader that keeps reading is not closed because one big send has not finished.
+constexpr uint64_t SEND_CHUNK = 256 * 1024;
+// ׽ֺȴӹرյĬޣ룩 / Default time allowed for the connections to close after a handoff (ms)
+constexpr int64_t DEFAULT_DRAIN_TIMEOUT_MS = 30000;
+// ֮߳ǰæѯʱ䣨΢룩0 ʾѯ / Longest a worker busy-polls before blocking (us); 0 disables polling
+constexpr uint32_t DEFAULT_SPIN_US = 0;
+// ٱĬϵĿÿ 16 ֽڣ / Default entries of the rate limit tables (16 bytes each)
+constexpr size_t DEFAULT_LIMIT_ENTRIES = 65536;
 
 // 첽ö / Enumeration for asynchronous I/O operations
 enum class IO_OPERATION {
@@ -28,33 +179,330 @@ enum class IO_OPERATION {
 };
 
 // 첽ݽṹ / Context for each asynchronous operation
-class PerIOData {
+// OVERLAPPEDWSABUF ׽λڻ IoRequest  / OVERLAPPED, WSABUF and the socket live in the IoRequest base
+// ݻǶʱݵ BufferPool ȡԷһ黹
+// The data buffer is no longer inline: the engine takes one from its BufferPool once data has
+// arrived, and it goes back together with the context after the echo is sent.
+class PerIOData : public IoRequest {
 public:
-    OVERLAPPED overlapped{};                // OVERLAPPED ṹ壬첽 I/O / OVERLAPPED for async I/O
-    char buffer[IO_BUFFER_SIZE]{};            // ݻ / Data buffer
-    WSABUF wsaBuf{  IO_BUFFER_SIZE, buffer };  // WSABUF ݻ / WSABUF describing the buffer
     IO_OPERATION operationType{ IO_OPERATION::RECV }; // ĬϲΪ RECV / Default operation is RECV
-    SOCKET socket{ INVALID_SOCKET };         // ׽ / Associated socket
-    PerIOData() {}
-    PerIOData(SOCKET s) :socket(s) {}
-    // ĬϹ캯ʹ in-class ʼгʼ
+    PerIOData() = default;
+    PerIOData(SOCKET s) { socket = s; }
+};
+
+// ÿͻӵ / Per-connection data
+// pendingOps ͳδɵĲʱͷ / pendingOps counts outstanding operations; the connection is freed at zero
+// ÿͬһʱһգdecoderhttp  split ֻ handleRecv зʣҪ
+// 뷢͵ɿڲͬ߳ͬʱе״̬ lock 
+// ʱΪĺɴʱ̶߳ȡԭӵġ
+// ļƬε at ڶӦֽڶеλãƬβռӵڴ棬ˮλ
+// At most one receive is outstanding per connection, so decoder, http and split are only touched
+// by handleRecv and need no lock. A receive and a send may complete on different threads at once,
+// so the output queue state is guarded by lock. The timestamps are in ms since the server
+// started and are read by whichever worker handles the timer, hence atomic. A file slice's at is
+// its position in the matching byte queue; slices hold none of the connection's memory and do
+// not count toward the watermarks.
+class Connection {
+public:
+    explicit Connection(FrameMode framing) : decoder(framing) {}
+
+    IoHandle* handle{ nullptr };               // е׽־ / Engine handle for the socket
+    std::atomic<int> pendingOps{ 0 };          // δɵĲ / Outstanding operations
+    std::atomic<bool> closing{ false };        // Ƿѿʼر / Whether close has started
+    FrameDecoder decoder;                      // ֡״̬Խձ߽İ֡ / Framing state holding a frame split across receives
+    std::vector<char> split;                   // νд carry ȫ֡ĻԣHTTP ģʽǱεȫӦ / Echo of frames this receive completed from the carry; in HTTP mode, all of this receive's responses
+    std::vector<HttpFileSlice> splitFiles;     // ӦеļƬ / File slices of this receive's responses
+    HttpRequestParser http;                    // HTTP ģʽĽ״̬ / Parsing state in HTTP mode
+    TimerNode timer;                           // ʱ鶨ʱ IocpServer::timerLock  / Timeout check timer, guarded by IocpServer::timerLock
+    std::atomic<int64_t> lastRecvAt{ 0 };      // һյݵʱ / When data last arrived
+    std::atomic<int64_t> partialSince{ -1 };   // ǰ֡ʼʱ䣬-1 ʾû / When the current partial frame began; -1 if there is none
+    std::atomic<int64_t> sendSince{ 0 };       // ;Ϳʼϴнչʱ / When the send in flight started or last made progress
+    std::atomic<int64_t> throttledUntil{ -1 }; // ƳٵĽպʱָ-1 ʾû / When a receive postponed by the rate limit resumes; -1 if none
+    uint64_t peerKey{ 0 };                     // ͻ˵ַٱеļʱ / Key of the client address in the rate limit tables, set on accept
+
+    std::mutex lock;                           // ֶ / Guards the fields below
+    bool sendBusy{ false };                    // Ƿз; / Whether a send is in flight
+    bool recvPaused{ false };                  // ˮλͶݽ / No receive is posted after the high watermark was passed
+    bool recvThrottled{ false };               // ٣ throttledUntil ֮ǰͶݽ / Over the rate limit; no receive is posted before throttledUntil
+    bool closeAfterSend{ false };              // ŶӵӦر / Close once the queued responses are sent
+    size_t inFlight{ 0 };                      // ;͵ֽ / Bytes of the send in flight
+    std::vector<char> sending;                 // ;õĻǽջʱ / Buffer of the send in flight, when it is not a receive buffer
+    std::vector<char> queued;                  // ;֮󡢺ϲһĻ / Echoes waiting behind the send in flight, coalesced
+    std::deque<HttpFileSlice> queuedFiles;     // queued еļƬΣλ / File slices within queued, in order of position
+    HttpFileSlice sendingSlice;                // ;ļĲ / The part of the send in flight that comes from a file
+
+    // ;Ŷӵֽ߳ lock / Bytes in flight and queued (lock held)
+    size_t backlog() const { return inFlight + queued.size(); }
+};
+
+// ʱָıţͬͬǩָУֱͼ
+// Runtime metric ids; metrics sharing a name with different labels are adjacent, the histogram comes last.
+enum class ServerMetric : size_t {
+    Accepts,
+    BytesReceived,
+    BytesSent,
+    Frames,
+    HttpRequests,
+    Echoes,          // ɵķͣŶӵĻԺϲһοܴϢϢ Frames / Completed sends: queued echoes are coalesced, so one may carry several messages (see Frames for those)
+    Completions,
+    Disconnects,
+    ErrorPostAccept,
+    ErrorAccept,
+    ErrorAttach,
+    ErrorPostRecv,
+    ErrorRecv,
+    ErrorPostSend,
+    ErrorSend,
+    ErrorOversizedFrame,
+    ErrorBadRequest,
+    ErrorUnknownOp,
+    FileHits,
+    FileMisses,
+    RecvPauses,
+    TimeoutIdle,
+    TimeoutRead,
+    TimeoutWrite,
+    SpinHits,
+    SpinMisses,
+    AcceptsSameCore,
+    AcceptsSameNode,
+    AcceptsOtherNode,
+    LimitedAccepts,
+    LimitedRecvs,
+    Connections,
+    OutstandingAccepts,
+    OutstandingRecvs,
+    OutstandingSends,
+    QueuedBytes,
+    CompletionBatch
+};
+
+// ȫָ꣬κι߳ǰһ / Describe every metric; called once before any worker starts
+static void defineServerMetrics() {
+    Metrics& m = Metrics::instance();
+    auto define = [&](ServerMetric id, const char* name, const char* labels, MetricType type, const char* help) {
+        m.define(static_cast<size_t>(id), MetricInfo{ name, labels, type, help, {} });
+    };
+    const char* errorsHelp = "Failed operations by kind.";
+    const char* outstandingHelp = "Operations posted to the engine and not yet completed.";
+    const char* timeoutsHelp = "Connections closed by a timeout, by kind.";
+    define(ServerMetric::Accepts, "echo_accepts_total", nullptr, MetricType::Counter, "Connections accepted.");
+    define(ServerMetric::BytesReceived, "echo_received_bytes_total", nullptr, MetricType::Counter, "Bytes received from clients.");
+    define(ServerMetric::BytesSent, "echo_sent_bytes_total", nullptr, MetricType::Counter, "Bytes sent to clients.");
+    define(ServerMetric::Frames, "echo_frames_total", nullptr, MetricType::Counter, "Complete frames parsed.");
+    define(ServerMetric::HttpRequests, "echo_http_requests_total", nullptr, MetricType::Counter, "HTTP requests handled.");
+    define(ServerMetric::Echoes, "echo_sends_completed_total", nullptr, MetricType::Counter, "Echo sends completed.");
+    define(ServerMetric::Completions, "echo_completions_total", nullptr, MetricType::Counter, "Completions dequeued by the workers.");
+    define(ServerMetric::Disconnects, "echo_disconnects_total", nullptr, MetricType::Counter, "Connections closed by the client.");
+    define(ServerMetric::ErrorPostAccept, "echo_errors_total", "op=\"post_accept\"", MetricType::Counter, errorsHelp);
+    define(ServerMetric::ErrorAccept, "echo_errors_total", "op=\"accept\"", MetricType::Counter, errorsHelp);
+    define(ServerMetric::ErrorAttach, "echo_errors_total", "op=\"attach\"", MetricType::Counter, errorsHelp);
+    define(ServerMetric::ErrorPostRecv, "echo_errors_total", "op=\"post_recv\"", MetricType::Counter, errorsHelp);
+    define(ServerMetric::ErrorRecv, "echo_errors_total", "op=\"recv\"", MetricType::Counter, errorsHelp);
+    define(ServerMetric::ErrorPostSend, "echo_errors_total", "op=\"post_send\"", MetricType::Counter, errorsHelp);
+    define(ServerMetric::ErrorSend, "echo_errors_total", "op=\"send\"", MetricType::Counter, errorsHelp);
+    define(ServerMetric::ErrorOversizedFrame, "echo_errors_total", "op=\"oversized_frame\"", MetricType::Counter, errorsHelp);
+    define(ServerMetric::ErrorBadRequest, "echo_errors_total", "op=\"bad_request\"", MetricType::Counter, errorsHelp);
+    define(ServerMetric::ErrorUnknownOp, "echo_errors_total", "op=\"unknown_operation\"", MetricType::Counter, errorsHelp);
+    define(ServerMetric::FileHits, "echo_file_cache_lookups_total", "result=\"hit\"", MetricType::Counter, "Static file lookups by result.");
+    define(ServerMetric::FileMisses, "echo_file_cache_lookups_total", "result=\"miss\"", MetricType::Counter, "Static file lookups by result.");
+    define(ServerMetric::RecvPauses, "echo_receive_pauses_total", nullptr, MetricType::Counter, "Times a connection stopped receiving at the output high watermark.");
+    define(ServerMetric::TimeoutIdle, "echo_timeouts_total", "kind=\"idle\"", MetricType::Counter, timeoutsHelp);
+    define(ServerMetric::TimeoutRead, "echo_timeouts_total", "kind=\"read\"", MetricType::Counter, timeoutsHelp);
+    define(ServerMetric::TimeoutWrite, "echo_timeouts_total", "kind=\"write\"", MetricType::Counter, timeoutsHelp);
+    define(ServerMetric::SpinHits, "echo_spin_polls_total", "result=\"hit\"", MetricType::Counter, "Busy-poll rounds by whether they found completions.");
+    define(ServerMetric::SpinMisses, "echo_spin_polls_total", "result=\"miss\"", MetricType::Counter, "Busy-poll rounds by whether they found completions.");
+    const char* localityHelp = "Accepted connections by where their packets arrived relative to the accepting worker.";
+    define(ServerMetric::AcceptsSameCore, "echo_accept_locality_total", "where=\"core\"", MetricType::Counter, localityHelp);
+    define(ServerMetric::AcceptsSameNode, "echo_accept_locality_total", "where=\"node\"", MetricType::Counter, localityHelp);
+    define(ServerMetric::AcceptsOtherNode, "echo_accept_locality_total", "where=\"remote\"", MetricType::Counter, localityHelp);
+    const char* limitedHelp = "Accepts and receives over a client's rate limit.";
+    define(ServerMetric::LimitedAccepts, "echo_rate_limited_total", "at=\"accept\"", MetricType::Counter, limitedHelp);
+    define(ServerMetric::LimitedRecvs, "echo_rate_limited_total", "at=\"recv\"", MetricType::Counter, limitedHelp);
+    define(ServerMetric::Connections, "echo_connections", nullptr, MetricType::Gauge, "Open client connections.");
+    define(ServerMetric::OutstandingAccepts, "echo_outstanding_operations", "op=\"accept\"", MetricType::Gauge, outstandingHelp);
+    define(ServerMetric::OutstandingRecvs, "echo_outstanding_operations", "op=\"recv\"", MetricType::Gauge, outstandingHelp);
+    define(ServerMetric::OutstandingSends, "echo_outstanding_operations", "op=\"send\"", MetricType::Gauge, outstandingHelp);
+    define(ServerMetric::QueuedBytes, "echo_output_queued_bytes", nullptr, MetricType::Gauge, "Echo bytes queued behind the sends in flight.");
+    m.define(static_cast<size_t>(ServerMetric::CompletionBatch), MetricInfo{ "echo_completion_batch_size", nullptr, MetricType::Histogram,
+        "Completions taken from the kernel per dequeue.", { 1, 2, 4, 8, 16, 32, 64, 128, 256 } });
+}
+
+// Сص / Batch size callback for the engine
+static void recordCompletionBatch(size_t n) {
+    Metrics::instance().observe(ServerMetric::CompletionBatch, static_cast<int64_t>(n));
+}
+
+// ˵Э / Protocol spoken on the connections
+enum class Protocol {
+    Echo,    //  / Echo
+    Http     // HTTP/1.1
+};
+
+//  / Server configuration
+struct ServerConfig {
+    int port{ PORT };                                            // ˿ / Listening port
+    int workerThreads{ static_cast<int>(std::thread::hardware_concurrency()) }; // ߳ / Worker threads
+    std::string engine{ defaultEngineName() };                   //  / Completion engine
+    int pendingAccepts{ DEFAULT_PENDING_ACCEPTS };               // ԤͶݵĽܲ / Accepts posted ahead of connections
+    int shards{ 1 };                                             // Ƭ 1 ʱÿƬ߳ / Shard count; above 1 each shard is single-threaded
+    LogLevel logLevel{ LogLevel::Debug };                        // ־Debug ʱӡÿ / Log level; Debug logs every operation
+    FrameMode framing{ FrameMode::Raw };                         // ֡ʽ / Message framing
+    Protocol protocol{ Protocol::Echo };                         // Ի HTTP / Echo or HTTP
+    int adminPort{ 0 };                                          // ָ˿ڣ0 ʾر / Metrics port; 0 disables it
+    int batch{ 64 };                                             // ÿȡ¼ / Most completions dequeued at once
+    size_t highWater{ DEFAULT_HIGH_WATER };                      // ʱͣ / Receiving pauses above this
+    size_t lowWater{ DEFAULT_LOW_WATER };                        // ֵʱָ / Receiving resumes at or below this
+    int64_t idleTimeoutMs{ DEFAULT_IDLE_TIMEOUT_MS };            // ûյݾ͹ر / Close after this long without data
+    int64_t readTimeoutMs{ DEFAULT_READ_TIMEOUT_MS };            // ֡ / Longest a partial frame may wait
+    int64_t writeTimeoutMs{ DEFAULT_WRITE_TIMEOUT_MS };          // ûнչ / Longest a send may make no progress
+    std::string staticRoot;                                      //  /static/ ṩĿ¼ձʾṩ / Directory served under /static/; empty for none
+    uint64_t fileCacheBytes{ DEFAULT_FILE_CACHE_BYTES };         // ļ0 ʾÿζȡ / File cache capacity; 0 reads every time
+    int64_t fileCheckMs{ DEFAULT_FILE_CHECK_MS };                // ļüһ޸ʱ / How often a cached file's modification time is checked
+    std::string handoffPath;                                     // õ Unix ׽·ձʾر / Unix socket path for hot restarts; empty disables them
+    int64_t drainTimeoutMs{ DEFAULT_DRAIN_TIMEOUT_MS };          // Ӻȴӹرն / Longest wait for the connections to close after a handoff
+    uint32_t spinUs{ DEFAULT_SPIN_US };                          // ֮ǰæѯã΢룩 / Longest busy-poll before blocking (us)
+    int busyPollUs{ 0 };                                         // ׽ֵ SO_BUSY_POLL΢룩0 ʾر / SO_BUSY_POLL of the sockets (us); 0 disables it
+    int64_t sqpollIdleMs{ -1 };                                  // io_uring SQPOLL ̵߳Ŀʱ䣬ʾر / Idle time of the io_uring SQPOLL thread; negative disables it
+    std::vector<int> cpus;                                       // ߳ι̶ CPUձʾ̶ / CPUs the workers are pinned to in turn; empty leaves them unpinned
+    RateLimit connectLimit;                                      // ÿͻ IP ÿ / New connections per second per client IP
+    RateLimit recvLimit;                                         // ÿͻ IP ÿյֽϢ / Bytes or messages received per second per client IP
+    bool limitMessages{ false };                                 // recvLimit ֽ֡ڼ / recvLimit counts complete frames or requests rather than bytes
+    LimitAction limitAction{ LimitAction::Delay };               // ʱĴ / What happens above a limit
+    size_t limitEntries{ DEFAULT_LIMIT_ENTRIES };                // ÿٱĿ / Entries per rate limit table
+};
+
+// ÿʵļƬļ˳ʱӣԡ֡ȫ̵ Metrics
+// Per-instance counters, summed over the shards on exit; echoes, frames and accepts come from the process-wide Metrics.
+struct ServerCounters {
+    uint64_t syscalls{ 0 };
+    uint64_t bufferBytes{ 0 };
+    PoolStats pool;
+
+    ServerCounters& operator+=(const ServerCounters& o) {
+        syscalls += o.syscalls;
+        bufferBytes += o.bufferBytes;
+        pool.hits += o.pool.hits;
+        pool.misses += o.pool.misses;
+        pool.highWater += o.pool.highWater;
+        pool.inUse += o.pool.inUse;
+        return *this;
+    }
 };
 
+// յ Ctrl+C / SIGTERM λ߳һλʱ˳
+// Set on Ctrl+C / SIGTERM; workers leave their loop on the next wakeup.
+static std::atomic<bool> g_stopRequested{ false };
+// ׽ѽ½̺λֹ߳ͣܣHTTP Ӧر
+// Set once the listening sockets belong to a new process: workers stop accepting and HTTP responses close their connections.
+static std::atomic<bool> g_handedOff{ false };
+
+#ifdef _WIN32
+static BOOL WINAPI consoleCtrlHandler(DWORD) {
+    g_stopRequested = true;
+    return TRUE;
+}
+#else
+static void stopSignalHandler(int) {
+    g_stopRequested = true;
+}
+#endif
+
+// HTTP ģʽ·ɱͷﹹһΣֻ׷ DateġļȫƬ
+// Route table of the HTTP mode. The header blocks are built here once; the handlers append only
+// Date, the length and the body. The file cache is shared by all shards.
+static HttpRouter buildRoutes(const ServerConfig& config) {
+    static const HttpHeaderBlock text(200, "text/plain");
+    static const HttpHeaderBlock binary(200, "application/octet-stream");
+    static const HttpHeaderBlock metrics(200, "text/plain; version=0.0.4");
+    HttpRouter router;
+    router.add("GET", "/", [](const HttpRequest&, HttpResponse& response) {
+        response.send(text, "Hello, World!");
+    });
+    router.add("GET", "/chunked", [](const HttpRequest&, HttpResponse& response) {
+        response.beginChunked(text);
+        response.chunk("Hello, ");
+        response.chunk("chunked ");
+        response.chunk("World!");
+        response.endChunked();
+    });
+    router.add("POST", "/echo", [](const HttpRequest& request, HttpResponse& response) {
+        response.send(binary, request.body);
+    });
+    router.add("GET", "/metrics", [](const HttpRequest&, HttpResponse& response) {
+        response.send(metrics, Metrics::instance().render());
+    });
+    if (!config.staticRoot.empty()) {
+        static FileCache files(config.staticRoot, config.fileCacheBytes, config.fileCheckMs);
+        router.mount("GET", "/static/", [](const HttpRequest& request, HttpResponse& response) {
+            FileLookup outcome = files.serve(request.path.substr(std::strlen("/static/")), response);
+            if (outcome != FileLookup::NotFound)
+                Metrics::add(outcome == FileLookup::Hit ? ServerMetric::FileHits : ServerMetric::FileMisses);
+        });
+    }
+    return router;
+}
+
+// ͻ IP ٱļһȫƬãûʱΪ nullptr
+// Per-client-IP rate limit tables, shared by all shards like the file cache; nullptr when no rate is set.
+static RateLimiter* connectLimiter(const ServerConfig& config) {
+    static const std::unique_ptr<RateLimiter> table = config.connectLimit.rate > 0
+        ? std::make_unique<RateLimiter>(config.limitEntries, config.connectLimit) : nullptr;
+    return table.get();
+}
+
+static RateLimiter* recvLimiter(const ServerConfig& config) {
+    static const std::unique_ptr<RateLimiter> table = config.recvLimit.rate > 0
+        ? std::make_unique<RateLimiter>(config.limitEntries, config.recvLimit) : nullptr;
+    return table.get();
+}
+
+// ʱæµظHTTP Ϊ 429԰ӵķ֡ʽ "BUSY"
+// The busy reply above a limit: 429 in HTTP; an echo connection gets "BUSY" in its framing.
+static std::string busyReplyFor(const ServerConfig& config) {
+    if (config.protocol == Protocol::Http)
+        return "HTTP/1.1 429 Too Many Requests\r\nRetry-After: 1\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    std::string reply;
+    appendFrame(reply, config.framing, "", "BUSY");
+    return reply;
+}
+
 // װ IOCP Ҫ / Server class encapsulating main IOCP server functionality
 class IocpServer {
 public:
-    IocpServer() : hIocp(nullptr), listenSocket(INVALID_SOCKET), acceptExFunc(nullptr) {}
+    // inherited Ǵһ̽ӹܵļ׽֣INVALID_SOCKET ʾԼ
+    // inherited is a listening socket taken over from the previous process; INVALID_SOCKET creates one.
+    explicit IocpServer(const ServerConfig& cfg, SOCKET inherited = INVALID_SOCKET) : config(cfg), listenSocket(inherited) {
+        if (config.workerThreads < 1)
+            config.workerThreads = 1;
+        if (config.pendingAccepts < 1)
+            config.pendingAccepts = 1;
+        config.batch = std::max(1, std::min(config.batch, static_cast<int>(MAX_COMPLETION_BATCH)));
+        config.lowWater = std::min(config.lowWater, config.highWater);
+        // ³̵ֵĳʱ֮ڣظ̣ȫΪ 0 ʱʹöʱ
+        // A deadline that starts now is due no sooner than the shortest timeout, so checks need be no
+        // more frequent. With all three at 0 no timer is used.
+        for (int64_t timeout : { config.idleTimeoutMs, config.readTimeoutMs, config.writeTimeoutMs }) {
+            if (timeout > 0 && (checkIntervalMs == 0 || timeout < checkIntervalMs))
+                checkIntervalMs = timeout;
+        }
+        // ƳٵĽɶʱָʹûгʱҲҪ / Postponed receives are resumed by the timer, which is needed even without timeouts
+        if (checkIntervalMs == 0 && config.limitAction == LimitAction::Delay
+            && (config.connectLimit.rate > 0 || config.recvLimit.rate > 0))
+            checkIntervalMs = WAIT_TIMEOUT_MS;
+    }
 
     ~IocpServer() {
-        if (listenSocket != INVALID_SOCKET)
+        if (listener)
+            engine->release(listener);
+        else if (listenSocket != INVALID_SOCKET)
             closesocket(listenSocket);
-        if (hIocp)
-            CloseHandle(hIocp);
+        engine.reset();
         WSACleanup(); //  Winsock Դ / Clean up Winsock
     }
 
-    // ʼʼ Winsock//׽֡ IOCPȡ AcceptEx չָ
-    // Initialize server: start Winsock, create/bind/listen socket, create IOCP, and retrieve AcceptEx pointer.
+    // ʼʼ Winsock//׽֡沢׽
+    // Initialize server: start Winsock, create/bind/listen socket, create the engine and attach the listener.
     bool initialize() {
         WSADATA wsaData;
         int iResult = WSAStartup(MAKEWORD(2, 2), &wsaData);
@@ -62,17 +510,134 @@ public:
             std::cerr << "WSAStartup failed. Error: " << iResult << std::endl;
             return false;
         }
+        if (listenSocket == INVALID_SOCKET && !createListener())
+            return false;
+        // Ƭֻһ CPUں˰ CPU յӽ / A shard has one CPU: have the kernel give it the connections arriving there
+        if (config.shards > 1 && config.cpus.size() == 1 && !setIncomingCpu(listenSocket, config.cpus[0]))
+            std::cerr << "setsockopt(SO_INCOMING_CPU) failed; connections are not steered. Error: " << WSAGetLastError() << std::endl;
+        //  (IOCP  epoll) / Create the completion engine (IOCP or epoll)
+        engine = createEngine(config.engine);
+        if (!engine) {
+            std::cerr << "Unknown engine: " << config.engine << std::endl;
+            return false;
+        }
+        if (config.sqpollIdleMs >= 0 && !engine->enableKernelPolling(static_cast<unsigned>(config.sqpollIdleMs))) {
+            std::cerr << "--sqpoll requires the uring engine." << std::endl;
+            return false;
+        }
+        if (!engine->open(config.workerThreads))
+            return false;
+        engine->setBatchObserver(recordCompletionBatch);
+        // ܵ׽ִӼ׽ּ̳ SO_BUSY_POLL / Accepted sockets inherit SO_BUSY_POLL from the listener
+        if (config.busyPollUs > 0 && !setBusyPoll(listenSocket, config.busyPollUs)) {
+            std::cerr << "setsockopt(SO_BUSY_POLL) failed. Error: " << WSAGetLastError() << std::endl;
+            return false;
+        }
+        // ׽ֹ / Associate listening socket with the engine
+        listener = engine->attach(listenSocket, nullptr);
+        if (!listener) {
+            std::cerr << "Failed to associate listening socket with IOCP. Error: " << GetLastError() << std::endl;
+            return false;
+        }
+        std::cout << "Server initialized successfully, listening on port " << config.port
+            << " (engine: " << engine->name() << ", worker threads: " << config.workerThreads
+            << ", batch: " << config.batch << ")" << std::endl;
+        if (config.spinUs > 0 || config.busyPollUs > 0 || config.sqpollIdleMs >= 0)
+            std::cout << "Polling (spin: " << config.spinUs << " us, SO_BUSY_POLL: " << config.busyPollUs << " us, SQPOLL: "
+                << (config.sqpollIdleMs >= 0 ? "idle " + std::to_string(config.sqpollIdleMs) + " ms" : std::string("off")) << ")" << std::endl;
+        if (!config.cpus.empty()) {
+            std::cout << "Workers pinned to CPU";
+            for (size_t i = 0; i < config.cpus.size(); ++i)
+                std::cout << (i == 0 ? " " : ",") << config.cpus[i] << " (node " << CpuTopology::instance().nodeOf(config.cpus[i]) << ")";
+            std::cout << std::endl;
+        }
+        if (connects || receives) {
+            static const char* const actions[] = { "delay", "drop", "busy" };
+            auto describe = [](const RateLimit& limit, const char* unit) {
+                return limit.rate == 0 ? std::string("off")
+                    : std::to_string(limit.rate) + " " + unit + "/s, burst " + std::to_string(limit.burst);
+            };
+            std::cout << "Rate limits per client IP (connects: " << describe(config.connectLimit, "connections")
+                << ", receives: " << describe(config.recvLimit, config.limitMessages ? "messages" : "bytes")
+                << ", action: " << actions[static_cast<int>(config.limitAction)] << ", table: "
+                << (connects ? connects : receives)->capacity() << " entries)" << std::endl;
+        }
+        if (config.protocol == Protocol::Http)
+            std::cout << "Speaking HTTP/1.1 (header scanning: " << httpScan().name << ")" << std::endl;
+        if (config.protocol == Protocol::Http && !config.staticRoot.empty())
+            std::cout << "Serving " << config.staticRoot << " under /static/ ("
+                << (config.fileCacheBytes == 0 ? std::string("no cache, read per request")
+                    : "cache: " + std::to_string(config.fileCacheBytes) + " bytes, file sends: "
+                        + (engine->canSendFile() ? "straight from the file" : "from the mapping")) << ")" << std::endl;
+        return true;
+    }
+
+    // ѭ̣߳ÿ߳ʹ޵ȴʱȡ¼
+    // Main loop: start the workers; each dequeues completions with a finite timeout and dispatches them.
+    void run() {
+        // ǰ߳ҲΪһ̣߳ȹ̶ԤͶݵĲŻڵĽڵ
+        // The calling thread is one of the workers; pin it first so the contexts posted up front come from its node.
+        pinWorker(0);
+        // ԤͶһ AcceptEx ͻʱȴɴ / Post a batch of AcceptEx operations up front so a burst of connections does not wait for completion handling
+        refillAccepts();
+
+        std::vector<std::thread> workers;
+        for (int i = 1; i < config.workerThreads; ++i) {
+            workers.emplace_back([this, i] {
+                pinWorker(i);
+                workerLoop();
+            });
+        }
+        workerLoop();
+        for (auto& t : workers)
+            t.join();
+    }
+
+    // 淢ϵͳؼջռ
+    // Engine system calls, pool counters and receive buffer footprint
+    ServerCounters counters() const {
+        ServerCounters c;
+        c.syscalls = engine ? engine->syscallCount() : 0;
+        c.bufferBytes = engine ? engine->bufferBytes() : 0;
+        c.pool = ioPool.stats();
+        return c;
+    }
+
+    // ׽֣ʱ½ / The listening socket, passed to the new process in a handoff
+    SOCKET listeningSocket() const { return listenSocket; }
+
+private:
+    // 󶨲׽ / Create, bind and listen on the socket
+    bool createListener() {
         // ׽ / Create listening socket
         listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
         if (listenSocket == INVALID_SOCKET) {
             std::cerr << "Failed to create listening socket. Error: " << WSAGetLastError() << std::endl;
             return false;
         }
+#ifndef _WIN32
+        // Linux Windows  SO_REUSEADDR 岻ͬʹã
+        // Allow an immediate restart on Linux (SO_REUSEADDR means something else on Windows).
+        int reuse = 1;
+        setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        // Ƭģʽ׽ְͬһ˿ڣں˰Ԫϣ
+        // Shard mode: several listeners bind the same port and the kernel hashes connections across them.
+        if (config.shards > 1 && setsockopt(listenSocket, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) == SOCKET_ERROR) {
+            std::cerr << "setsockopt(SO_REUSEPORT) failed. Error: " << WSAGetLastError() << std::endl;
+            return false;
+        }
+#else
+        // Windows ûаӷ SO_REUSEPORT / Windows has no load-balancing SO_REUSEPORT
+        if (config.shards > 1) {
+            std::cerr << "--shards requires SO_REUSEPORT, which Windows does not provide." << std::endl;
+            return false;
+        }
+#endif
         // ò󶨵ַ / Configure and bind address
         sockaddr_in serverAddr{};
         serverAddr.sin_family = AF_INET;
         serverAddr.sin_addr.s_addr = htonl(INADDR_ANY); //  / Listen on all interfaces
-        serverAddr.sin_port = htons(PORT);              // ö˿ / Set port
+        serverAddr.sin_port = htons(static_cast<unsigned short>(config.port)); // ö˿ / Set port
         if (bind(listenSocket, reinterpret_cast<sockaddr*>(&serverAddr), sizeof(serverAddr)) == SOCKET_ERROR) {
             std::cerr << "Bind failed. Error: " << WSAGetLastError() << std::endl;
             return false;
@@ -82,201 +647,1048 @@ public:
             std::cerr << "Listen failed. Error: " << WSAGetLastError() << std::endl;
             return false;
         }
-        //  IOCP  / Create IOCP handle
-        hIocp = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 0);
-        if (!hIocp) {
-            std::cerr << "CreateIoCompletionPort failed. Error: " << GetLastError() << std::endl;
-            return false;
+        return true;
+    }
+
+    ServerConfig config;                        //  / Server configuration
+    SOCKET listenSocket;                        // ׽ / Listening socket
+    ObjectPool<PerIOData> ioPool;               // PerIOData  / Pool of PerIOData contexts
+    std::unique_ptr<CompletionEngine> engine;   //  / Completion engine
+    IoHandle* listener{ nullptr };              // ׽ֵ / Engine handle of the listening socket
+    std::atomic<int> acceptsPosted{ 0 };        // ǰĽܲ / Accept operations currently outstanding
+    std::atomic<bool> accepting{ true };        // ֮Ϊ false / False after a handoff
+    const std::chrono::steady_clock::time_point started{ std::chrono::steady_clock::now() }; // ʱ / Origin of the timestamps
+    std::atomic<int64_t> loopMs{ 0 };           // һȡ¼ʱ䣬ʹ / Time of the latest dequeue, used by the handlers
+    int64_t checkIntervalMs{ 0 };               // γʱ0 ʾʹöʱ / Longest gap between timeout checks; 0 disables the timers
+    std::mutex timerLock;                       //  timers ӵ timer / Guards timers and every connection's timer
+    TimerWheel timers;                          //  TIMER_TICK_MS Ϊһ / Ticks of TIMER_TICK_MS
+    std::atomic<uint64_t> timerTick{ 0 };       // timers ƽĸ񣬲жǷҪƽ / Tick timers has reached, checked without the lock
+    const HttpRouter routes{ buildRoutes(config) };   // HTTP ģʽ·ɱֻ / Route table of the HTTP mode, read-only
+    RateLimiter* const connects{ connectLimiter(config) };   // ӵٱΪ / Rate limit table for new connections; may be null
+    RateLimiter* const receives{ recvLimiter(config) };      // յٱΪ / Rate limit table for receives; may be null
+    const std::string busyReply{ busyReplyFor(config) };     // --limit-action busy Ļظ / Reply of --limit-action busy
+
+    // ̣߳ȡ¼ͷ / Worker thread: dequeue completions and dispatch by operation type
+    void workerLoop() {
+        std::vector<Completion> batch(static_cast<size_t>(config.batch));
+        // ʹöʱʱÿһ / With timers in use, wake at least once per tick
+        DWORD waitMs = checkIntervalMs > 0 ? std::min(WAIT_TIMEOUT_MS, TIMER_TICK_MS) : WAIT_TIMEOUT_MS;
+        SpinWait spin(config.spinUs);
+        while (!g_stopRequested) {
+            // ֮ɵһ־Ĺֹ߳ͣ / After a handoff the first worker to see the flag stops accepting
+            if (g_handedOff.load(std::memory_order_relaxed) && accepting.exchange(false)) {
+                engine->detachListener(listener);
+                LOG_INFO("Stopped accepting; draining the open connections.");
+            }
+            size_t n = spin.waitBatch(*engine, batch.data(), batch.size(), waitMs);
+            if (spin.lastOutcome() != SpinWait::Outcome::Blocked)
+                Metrics::add(spin.lastOutcome() == SpinWait::Outcome::Hit ? ServerMetric::SpinHits : ServerMetric::SpinMisses);
+            int64_t now = elapsedMs();
+            loopMs.store(now, std::memory_order_relaxed);
+            if (n > 0) {
+                Metrics::add(ServerMetric::Completions, static_cast<int64_t>(n));
+                for (size_t i = 0; i < n; ++i)
+                    dispatch(batch[i]);
+            }
+            if (checkIntervalMs > 0)
+                expireTimers(now);
+            // һύķ / Submit the resulting sends together once the whole batch is handled
+            engine->flush();
         }
-        // ׽ֹ IOCP / Associate listening socket with IOCP
-        if (!CreateIoCompletionPort(reinterpret_cast<HANDLE>(listenSocket), hIocp,
-            static_cast<ULONG_PTR>(listenSocket), 0)) {
-            std::cerr << "Failed to associate listening socket with IOCP. Error: " << GetLastError() << std::endl;
-            return false;
+    }
+
+    // ѵ index ̶̹߳ --cpus е CPU  / Pin worker index to its CPU from --cpus
+    void pinWorker(int index) {
+        if (config.cpus.empty())
+            return;
+        int cpu = config.cpus[static_cast<size_t>(index) % config.cpus.size()];
+        if (!pinThread(cpu))
+            std::cerr << "Failed to pin a worker to CPU " << cpu << ". Error: " << GetLastError() << std::endl;
+    }
+
+    // ¼ӵݰﱻĹ߳ڵĺġͬһڵһģһڵ
+    // Record where a connection's packets are processed: on the accepting worker's core, on another
+    // core of its node, or on another node.
+    static void recordAcceptLocality(SOCKET s) {
+        int cpu = incomingCpu(s);
+        if (cpu < 0)
+            return;
+        int here = currentCpu();
+        const CpuTopology& topology = CpuTopology::instance();
+        if (cpu == here)
+            Metrics::add(ServerMetric::AcceptsSameCore);
+        else if (topology.nodeOf(cpu) == topology.nodeOf(here))
+            Metrics::add(ServerMetric::AcceptsSameNode);
+        else
+            Metrics::add(ServerMetric::AcceptsOtherNode);
+    }
+
+    int64_t elapsedMs() const {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+    }
+
+    //  ms ĵһ / The first tick not before ms
+    static uint64_t tickAt(int64_t ms) {
+        return static_cast<uint64_t>((ms + TIMER_TICK_MS - 1) / TIMER_TICK_MS);
+    }
+
+    // ʱƽǰֻõһ߳ƽֱ߳ӷأڵ
+    // Advance the wheel to the current tick. Only the thread that gets the lock advances it and the
+    // others return at once; the expired connections are checked outside the lock.
+    void expireTimers(int64_t now) {
+        uint64_t tick = static_cast<uint64_t>(now) / TIMER_TICK_MS;
+        if (tick <= timerTick.load(std::memory_order_relaxed))
+            return;
+        static thread_local std::vector<Connection*> expired;
+        {
+            std::unique_lock<std::mutex> guard(timerLock, std::try_to_lock);
+            if (!guard.owns_lock())
+                return;
+            timers.advance(tick, [](TimerNode* node) {
+                expired.push_back(static_cast<Connection*>(node->context));
+            });
+            timerTick.store(timers.now(), std::memory_order_relaxed);
         }
-        // һԻȡ AcceptEx չָ / Retrieve AcceptEx pointer once
-        GUID guidAcceptEx = WSAID_ACCEPTEX;
-        DWORD bytesReturned = 0;
-        if (WSAIoctl(listenSocket, SIO_GET_EXTENSION_FUNCTION_POINTER,
-            &guidAcceptEx, sizeof(guidAcceptEx),
-            &acceptExFunc, sizeof(acceptExFunc),
-            &bytesReturned, nullptr, nullptr) == SOCKET_ERROR) {
-            std::cerr << "WSAIoctl for AcceptEx failed. Error: " << WSAGetLastError() << std::endl;
-            return false;
+        for (Connection* conn : expired)
+            checkTimeouts(conn, now);
+        expired.clear();
+    }
+
+    // ʱڣκ޾͹رӣ²ʱһ
+    // A timer expired: past any deadline the connection is closed, otherwise the timer is re-armed
+    // for the nearest one. The timer holds a reference.
+    void checkTimeouts(Connection* conn, int64_t now) {
+        int64_t next = now + checkIntervalMs;
+        const char* kind = nullptr;
+        ServerMetric metric = ServerMetric::TimeoutIdle;
+        auto check = [&](int64_t since, int64_t timeout, const char* name, ServerMetric id) {
+            if (kind || timeout <= 0 || since < 0)
+                return;
+            if (now - since >= timeout) {
+                kind = name;
+                metric = id;
+            }
+            else {
+                next = std::min(next, since + timeout);
+            }
+        };
+        bool resume = false;
+        {
+            std::lock_guard<std::mutex> guard(conn->lock);
+            // ƳٵĽյڣûˮλͣҲڷӦرʱָ
+            // A receive postponed by the rate limit is due: it resumes unless receiving is paused at
+            // the high watermark or the connection closes after its last response.
+            if (conn->recvThrottled && now >= conn->throttledUntil.load(std::memory_order_relaxed)) {
+                conn->recvThrottled = false;
+                conn->throttledUntil.store(-1, std::memory_order_relaxed);
+                resume = !conn->recvPaused && !conn->closeAfterSend;
+            }
+            // ;ͣʱڵȶԶ˶ȡдʱ𣬲Уͣʱ֡Ҳƶʱ
+            // With a send in flight or receiving paused the server waits on the peer to read; that is
+            // the write timeout's business, not idleness. A partial frame is not held against the
+            // read timeout while receiving is paused either.
+            check(conn->sendBusy ? conn->sendSince.load(std::memory_order_relaxed) : -1,
+                config.writeTimeoutMs, "write", ServerMetric::TimeoutWrite);
+            // ƳٽʱͬƶʱճʱƳٵӲڵռ׽
+            // Nor while the rate limit postpones receiving; idleness still counts, so a postponed
+            // connection cannot hold its socket indefinitely.
+            check(conn->recvPaused || conn->recvThrottled ? -1 : conn->partialSince.load(std::memory_order_relaxed),
+                config.readTimeoutMs, "read", ServerMetric::TimeoutRead);
+            check(conn->sendBusy || conn->recvPaused ? -1 : conn->lastRecvAt.load(std::memory_order_relaxed),
+                config.idleTimeoutMs, "idle", ServerMetric::TimeoutIdle);
         }
-        std::cout << "Server initialized successfully, listening on port " << PORT << std::endl;
-        return true;
+        if (kind) {
+            LOG_INFO("Closing socket %llu: %s timeout.", static_cast<unsigned long long>(conn->handle->socket), kind);
+            Metrics::add(metric);
+            closeConnection(conn);
+            releaseConnection(conn);
+            return;
+        }
+        if (resume) {
+            if (conn->partialSince.load(std::memory_order_relaxed) >= 0)
+                conn->partialSince.store(now, std::memory_order_relaxed);
+            postRecv(conn);
+        }
+        {
+            std::lock_guard<std::mutex> guard(timerLock);
+            if (!conn->closing) {
+                // ڶȡthrottle õ޲ / Read under the lock so a deadline set by throttle is not missed
+                int64_t until = conn->throttledUntil.load(std::memory_order_relaxed);
+                if (until >= 0)
+                    next = std::min(next, until);
+                timers.schedule(&conn->timer, tickAt(next));
+                return;
+            }
+        }
+        releaseConnection(conn);
     }
 
-    // ѭʹ޵ȴʱ GetQueuedCompletionStatusɸ¼
-    // Main loop: use finite timeout for GetQueuedCompletionStatus and dispatch I/O events.
-    void run() {
-        // Ͷݳʼ AcceptEx  / Post initial AcceptEx operation
-        postAccept();
+    // ѽƳٵ until߳ conn->lockдñ־ͬһٽڣ
+    // ʱڿ recvThrottled ʱһҲޣǰָ
+    // Postpone receiving until until (the caller holds conn->lock). The deadline is stored before the
+    // flag is set, in the same critical section, so a timer that sees recvThrottled under the lock
+    // also sees the deadline and cannot resume the receive early.
+    static void holdRecv(Connection* conn, int64_t until) {
+        conn->throttledUntil.store(until, std::memory_order_relaxed);
+        conn->recvThrottled = true;
+    }
+
+    // holdRecv ֮ͷ conn->locköʱ until ڡʱڱ߳ϼʱûв
+    // ²ʱ throttledUntil
+    // After holdRecv (with conn->lock released): make the timer fire no later than until. A timer
+    // being checked on another thread is not armed; it reads throttledUntil when it re-arms.
+    void wakeBy(Connection* conn, int64_t until) {
+        std::lock_guard<std::mutex> guard(timerLock);
+        if (conn->timer.armed() && conn->timer.expires > tickAt(until))
+            timers.schedule(&conn->timer, tickAt(until));
+    }
+
+    // ΪӲʱʱռһ / Arm a new connection's timer; the timer takes a reference
+    void armTimer(Connection* conn) {
+        conn->timer.context = conn;
+        conn->pendingOps.fetch_add(1);
+        std::lock_guard<std::mutex> guard(timerLock);
+        timers.schedule(&conn->timer, tickAt(conn->lastRecvAt.load(std::memory_order_relaxed) + checkIntervalMs));
+    }
+
+    void dispatch(const Completion& c) {
+        // ȡɵ첽 / Retrieve completed operation context
+        auto* pIOData = static_cast<PerIOData*>(c.request);
+        auto* conn = static_cast<Connection*>(c.handle->context);
+        switch (pIOData->operationType) {
+        case IO_OPERATION::ACCEPT:
+            handleAccept(pIOData, c.error);
+            break;
+        case IO_OPERATION::RECV:
+            handleRecv(conn, pIOData, c.bytes, c.error);
+            break;
+        case IO_OPERATION::SEND:
+            handleSend(conn, pIOData, c.bytes, c.error);
+            break;
+        default:
+            LOG_ERROR("Unknown I/O operation type.");
+            Metrics::add(ServerMetric::ErrorUnknownOp);
+            freeIOData(pIOData);
+            break;
+        }
+    }
 
-        DWORD bytesTransferred = 0;
-        ULONG_PTR completionKey = 0;
-        LPOVERLAPPED lpOverlapped = nullptr;
+    // ջ棩Ļ / Hand back the receive buffer (if engine-owned) and return the context to the pool
+    void freeIOData(PerIOData* pIOData) {
+        engine->releaseBuffer(pIOData);
+        ioPool.destroy(pIOData);
+    }
+
+    // ʼرӣȡδɵĲִֻһ / Start closing a connection: cancel pending operations, once
+    // ѲĶʱ֮ȡãԼãﲻͷ
+    // An armed timer is cancelled and its reference returned; the caller holds a reference of its
+    // own, so the connection is not freed here.
+    void closeConnection(Connection* conn) {
+        if (conn->closing.exchange(true))
+            return;
+        engine->abort(conn->handle);
+        bool armed = false;
+        {
+            std::lock_guard<std::mutex> guard(timerLock);
+            armed = conn->timer.armed();
+            timers.cancel(&conn->timer);
+        }
+        if (armed)
+            releaseConnection(conn);
+    }
 
+    // һһʱر׽ֲͷ
+    // One operation finished; the last one closes the socket and frees the connection.
+    void releaseConnection(Connection* conn) {
+        if (conn->pendingOps.fetch_sub(1) == 1) {
+            // ʱŶӵĻԲٷǱмȥ / Echoes still queued at teardown will never go out; take them off the gauge
+            if (!conn->queued.empty())
+                Metrics::add(ServerMetric::QueuedBytes, -static_cast<int64_t>(conn->queued.size()));
+            engine->release(conn->handle);
+            delete conn;
+            Metrics::add(ServerMetric::Connections, -1);
+        }
+    }
+
+    // ѹĽܲ㵽 pendingAccepts ͶʧܵĿȱһνʱ
+    // Top the outstanding accepts back up to pendingAccepts; a slot whose post failed is refilled
+    // by the next accept completion.
+    void refillAccepts() {
         while (true) {
-            BOOL result = GetQueuedCompletionStatus(hIocp, &bytesTransferred, &completionKey, &lpOverlapped, WAIT_TIMEOUT_MS);
-            if (!result) {
-                // ʱʱ / Timeout or transient error; continue looping
-                if (lpOverlapped == nullptr && GetLastError() == WAIT_TIMEOUT) {
-                    continue; //  I/O ¼ȴ / No I/O event, continue waiting
-                }
-                else {
-                    std::cerr << "GetQueuedCompletionStatus failed. Error: " << GetLastError() << std::endl;
-                    continue;
-                }
+            if (acceptsPosted.fetch_add(1) >= config.pendingAccepts) {
+                acceptsPosted.fetch_sub(1);
+                return;
             }
-            // ȡɵ첽 / Retrieve completed operation context
-            auto* pIOData = reinterpret_cast<PerIOData*>(lpOverlapped);
-            switch (pIOData->operationType) {
-            case IO_OPERATION::ACCEPT:
-                handleAccept(pIOData);
-                break;
-            case IO_OPERATION::RECV:
-                handleRecv(pIOData, bytesTransferred);
-                break;
-            case IO_OPERATION::SEND:
-                handleSend(pIOData);
-                break;
-            default:
-                std::cerr << "Unknown I/O operation type." << std::endl;
-                delete pIOData;
-                break;
+            if (!postAccept()) {
+                acceptsPosted.fetch_sub(1);
+                return;
             }
         }
     }
 
-private:
-    HANDLE hIocp;              // IOCP  / IOCP handle
-    SOCKET listenSocket;       // ׽ / Listening socket
-    LPFN_ACCEPTEX acceptExFunc; // AcceptEx ָ / Pointer to AcceptEx
-
     // Ͷһ첽 AcceptEx ڽ
     // Post an asynchronous AcceptEx operation to accept a new connection.
-    void postAccept() {
-        // ΪӴһ׽ / Create a new socket for the incoming connection.
-        SOCKET acceptSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-        if (acceptSocket == INVALID_SOCKET) {
-            std::cerr << "Failed to create accept socket. Error: " << WSAGetLastError() << std::endl;
-            return;
-        }
+    bool postAccept() {
         // 䲢ʼĶ / Allocate and initialize the context object.
-        auto* pIOData = new PerIOData();
+        auto* pIOData = ioPool.create();
         pIOData->operationType = IO_OPERATION::ACCEPT;
-        pIOData->socket = acceptSocket;
-        //  AcceptEx 첽 / Call AcceptEx to initiate asynchronous accept.
-        DWORD bytesReturned = 0;
-        if (!acceptExFunc(listenSocket, acceptSocket, pIOData->buffer, 0,
-            sizeof(sockaddr_in) + 16, sizeof(sockaddr_in) + 16,
-            &bytesReturned, &pIOData->overlapped))
-        {
-            int err = WSAGetLastError();
-            if (err != ERROR_IO_PENDING) {
-                std::cerr << "AcceptEx failed. Error: " << err << std::endl;
-                closesocket(acceptSocket);
-                delete pIOData;
-                return;
+        Metrics::add(ServerMetric::OutstandingAccepts);
+        // 洴׽ֲ첽 / The engine creates the accept socket and starts the asynchronous accept.
+        if (!engine->postAccept(listener, pIOData)) {
+            // ֹ֮ͣʧԤڵ / Once accepting has stopped, failing is expected
+            if (accepting.load(std::memory_order_relaxed)) {
+                LOG_ERROR("AcceptEx failed. Error: %d", WSAGetLastError());
+                Metrics::add(ServerMetric::ErrorPostAccept);
             }
+            Metrics::add(ServerMetric::OutstandingAccepts, -1);
+            freeIOData(pIOData);
+            return false;
         }
-        std::cout << "Posted an asynchronous AcceptEx operation." << std::endl;
+        LOG_DEBUG("Posted an asynchronous AcceptEx operation.");
+        return true;
     }
 
     //  AcceptEx ¼ / Handle completion of an AcceptEx operation.
-    void handleAccept(PerIOData* pIOData) {
+    void handleAccept(PerIOData* pIOData, int error) {
         SOCKET clientSocket = pIOData->socket;
-        // ¿ͻ׽ֹ IOCP / Associate the accepted socket with IOCP.
-        if (!CreateIoCompletionPort(reinterpret_cast<HANDLE>(clientSocket), hIocp,
-            static_cast<ULONG_PTR>(clientSocket), 0)) {
-            std::cerr << "Failed to associate client socket with IOCP. Error: " << GetLastError() << std::endl;
+        Metrics::add(ServerMetric::OutstandingAccepts, -1);
+        // ܲùֲ
+        // Replace this accept right away so the number outstanding stays constant.
+        acceptsPosted.fetch_sub(1);
+        refillAccepts();
+        if (error != 0) {
+            // ֹͣʱȡĽܲ / Accepts cancelled when accepting stopped are not errors
+            if (accepting.load(std::memory_order_relaxed)) {
+                LOG_WARN("AcceptEx completed with error: %d", error);
+                Metrics::add(ServerMetric::ErrorAccept);
+            }
+            if (clientSocket != INVALID_SOCKET)
+                closesocket(clientSocket);
+            freeIOData(pIOData);
+            return;
+        }
+        // ͷŵǰĶ / Free the current context object.
+        freeIOData(pIOData);
+        Metrics::add(ServerMetric::Accepts);
+        // ¿ͻ׽ֹ / Associate the accepted socket with the engine.
+        auto* conn = new Connection(config.framing);
+        conn->handle = engine->attach(clientSocket, conn);
+        if (!conn->handle) {
+            LOG_ERROR("Failed to associate client socket with IOCP. Error: %u", static_cast<unsigned>(GetLastError()));
+            Metrics::add(ServerMetric::ErrorAttach);
             closesocket(clientSocket);
-            delete pIOData;
+            delete conn;
             return;
         }
+#ifdef _WIN32
         // ׽ ( setsockopt(SO_UPDATE_ACCEPT_CONTEXT) )
         // Update socket context by calling setsockopt(SO_UPDATE_ACCEPT_CONTEXT)
         if (setsockopt(clientSocket, SOL_SOCKET, SO_UPDATE_ACCEPT_CONTEXT,
             reinterpret_cast<char*>(&listenSocket), sizeof(listenSocket)) == SOCKET_ERROR) {
-            std::cerr << "setsockopt(SO_UPDATE_ACCEPT_CONTEXT) failed. Error: " << WSAGetLastError() << std::endl;
-            closesocket(clientSocket);
-            delete pIOData;
+            LOG_ERROR("setsockopt(SO_UPDATE_ACCEPT_CONTEXT) failed. Error: %d", WSAGetLastError());
+            Metrics::add(ServerMetric::ErrorAttach);
+            engine->release(conn->handle);
+            delete conn;
+            return;
+        }
+#endif
+        // ر Nagleһˮ֡ԽνʱԷηڶβӦȴԵһεӳȷ
+        // Disable Nagle: when a batch of pipelined frames spans two receives its echo goes out in two
+        // sends, and the second must not wait for the delayed ACK of the first.
+        setNoDelay(clientSocket);
+        // ͻ IP ӵʣdelay ʱճܣֻƳٵһνգǷ³һ burst ʱܾ
+        // Check the client IP's connection rate; with delay the connection is accepted as usual and only
+        // its first receive is postponed, unless that would run up more than one burst of debt.
+        int64_t now = loopMs.load(std::memory_order_relaxed);
+        uint32_t delayMs = 0;
+        if (connects || receives)
+            conn->peerKey = peerKey(clientSocket);
+        if (connects && (delayMs = connects->take(conn->peerKey, 1, now, config.limitAction == LimitAction::Delay)) > 0) {
+            Metrics::add(ServerMetric::LimitedAccepts);
+            if (config.limitAction != LimitAction::Delay || delayMs == RateLimiter::REFUSED) {
+                LOG_INFO_EVERY(100, "Connection rate limit exceeded, closing socket %llu.", static_cast<unsigned long long>(clientSocket));
+                // ׽ֵķͻǿյģ⼸ֽ / The new socket's send buffer is empty, so these few bytes go out at once
+                if (config.limitAction == LimitAction::Busy)
+                    send(clientSocket, busyReply.data(), static_cast<int>(busyReply.size()), 0);
+                engine->release(conn->handle);
+                delete conn;
+                return;
+            }
+        }
+        LOG_INFO("Accepted a new connection. Client socket: %llu", static_cast<unsigned long long>(clientSocket));
+        if (!config.cpus.empty())
+            recordAcceptLocality(clientSocket);
+        Metrics::add(ServerMetric::Connections);
+        conn->lastRecvAt.store(now, std::memory_order_relaxed);
+        if (checkIntervalMs > 0)
+            armTimer(conn);
+        if (delayMs > 0) {
+            {
+                std::lock_guard<std::mutex> guard(conn->lock);
+                holdRecv(conn, now + delayMs);
+            }
+            wakeBy(conn, now + delayMs);
             return;
         }
-        std::cout << "Accepted a new connection. Client socket: " << clientSocket << std::endl;
         // ΪͶݽղ / Post a receive operation on the new connection.
-        postRecv(clientSocket);
-        // ٴͶ AcceptEx Աܸ / Post another AcceptEx for subsequent connections.
-        postAccept();
-        // ͷŵǰĶ / Free the current context object.
-        delete pIOData;
+        postRecv(conn);
     }
 
     // 첽¼WSARecv ɣ / Handle completion of a receive operation.
-    void handleRecv(PerIOData* pIOData, DWORD bytesTransferred) {
-        if (bytesTransferred == 0) {
-            std::cout << "Client disconnected. Socket: " << pIOData->socket << std::endl;
-            closesocket(pIOData->socket);
-            delete pIOData;
+    void handleRecv(Connection* conn, PerIOData* pIOData, DWORD bytesTransferred, int error) {
+        SOCKET s = conn->handle->socket;
+        Metrics::add(ServerMetric::OutstandingRecvs, -1);
+        if (error != 0 || bytesTransferred == 0) {
+            if (error != 0) {
+                LOG_WARN("WSARecv completed with error on socket %llu. Error: %d", static_cast<unsigned long long>(s), error);
+                Metrics::add(ServerMetric::ErrorRecv);
+            }
+            else {
+                LOG_INFO("Client disconnected. Socket: %llu", static_cast<unsigned long long>(s));
+                Metrics::add(ServerMetric::Disconnects);
+            }
+            closeConnection(conn);
+            freeIOData(pIOData);
+            releaseConnection(conn);
             return;
         }
-        // ַֹ / Null-terminate the received data.
-        pIOData->buffer[bytesTransferred] = '\0';
-        std::cout << "Received data from socket " << pIOData->socket << ": " << pIOData->buffer << std::endl;
-        // յݺ޸ĲΪ SEND׼ݻԸͻ
-        // After receiving data, change operation type to SEND to echo data back.
-        pIOData->operationType = IO_OPERATION::SEND;
-        pIOData->wsaBuf.len = bytesTransferred; // ͵ݳյһ / Set send length equal to received bytes.
-        DWORD bytesSent = 0;
-        int ret = WSASend(pIOData->socket, &pIOData->wsaBuf, 1, &bytesSent, 0, &pIOData->overlapped, nullptr);
-        if (ret == SOCKET_ERROR) {
-            int err = WSAGetLastError();
-            if (err != WSA_IO_PENDING) {
-                std::cerr << "WSASend failed in handleRecv. Error: " << err << std::endl;
-                closesocket(pIOData->socket);
-                delete pIOData;
+        LOG_DEBUG("Received data from socket %llu: %.*s", static_cast<unsigned long long>(s),
+            static_cast<int>(bytesTransferred), pIOData->wsaBuf.buf);
+        Metrics::add(ServerMetric::BytesReceived, bytesTransferred);
+        int64_t now = loopMs.load(std::memory_order_relaxed);
+        conn->lastRecvAt.store(now, std::memory_order_relaxed);
+        // ͻ IP յʡֽڼʱڽ֮ǰ飬drop  busy յݣ
+        // Ϣʱ֡Ҫ֪֮
+        // Check the client IP's receive rate. Counted in bytes it is checked before parsing, and drop
+        // and busy discard the data received; counted in messages the frames are known only after
+        // parsing, see below.
+        uint32_t throttleMs = 0;
+        bool busy = false;
+        if (receives && !config.limitMessages && !chargeRecv(conn, static_cast<uint32_t>(bytesTransferred), now, throttleMs, busy)) {
+            closeConnection(conn);
+            freeIOData(pIOData);
+            releaseConnection(conn);
+            return;
+        }
+        // Լ֡ԭءȫλڱνջе֡һΣûп߽֡ʱӻͷʼ
+        // ûз;ʱֱӴӽջֻͣд carry ȫĿ߽֡ҪѻԸƵ split С
+        // Echoing means sending complete frames back unchanged. Frames lying entirely within this
+        // receive buffer form one run (starting at the buffer's start when no frame was split) and,
+        // with no send in flight, are sent straight from it; only when a split frame was completed
+        // from the carry is the echo copied into split.
+        const char* data = pIOData->wsaBuf.buf;
+        const char* inPlaceBegin = nullptr;
+        const char* inPlaceEnd = nullptr;
+        uint64_t frameCount = 0;
+        bool keepOpen = true;
+        bool valid = true;
+        conn->split.clear();
+        conn->splitFiles.clear();
+        if (busy) {
+            // æµظνյӦر / The busy reply replaces this receive's responses; the connection closes once it is sent
+            conn->split.assign(busyReply.begin(), busyReply.end());
+            keepOpen = false;
+        }
+        else if (config.protocol == Protocol::Http) {
+            serveHttp(conn, data, bytesTransferred, frameCount, keepOpen);
+        }
+        else {
+            valid = conn->decoder.feed(data, bytesTransferred, [&](std::string_view, std::string_view wire) {
+                ++frameCount;
+                if (std::less<const char*>()(wire.data(), data) || !std::less<const char*>()(wire.data(), data + bytesTransferred))
+                    conn->split.insert(conn->split.end(), wire.begin(), wire.end());
+                else {
+                    if (!inPlaceBegin)
+                        inPlaceBegin = wire.data();
+                    inPlaceEnd = wire.data() + wire.size();
+                }
+            });
+        }
+        if (!valid) {
+            LOG_WARN("Oversized frame on socket %llu, closing.", static_cast<unsigned long long>(s));
+            Metrics::add(ServerMetric::ErrorOversizedFrame);
+            closeConnection(conn);
+            freeIOData(pIOData);
+            releaseConnection(conn);
+            return;
+        }
+        // Ϣʱÿ֡һƣbusy ĻظѾɵĻԻӦ
+        // Counted in messages, every complete frame or request costs one token; the busy reply
+        // replaces the echoes or responses already produced.
+        if (receives && config.limitMessages && frameCount > 0) {
+            if (!chargeRecv(conn, static_cast<uint32_t>(std::min<uint64_t>(frameCount, UINT32_MAX)), now, throttleMs, busy)) {
+                closeConnection(conn);
+                freeIOData(pIOData);
+                releaseConnection(conn);
                 return;
             }
+            if (busy) {
+                inPlaceBegin = inPlaceEnd = nullptr;
+                conn->split.assign(busyReply.begin(), busyReply.end());
+                conn->splitFiles.clear();
+                keepOpen = false;
+            }
+        }
+        bool http = config.protocol == Protocol::Http;
+        Metrics::add(http ? ServerMetric::HttpRequests : ServerMetric::Frames, static_cast<int64_t>(frameCount));
+        // ʱӵǰ֡ʼʱȫһ֡¿ʼ / The read timeout runs from the start of the current partial frame and restarts once a frame completes
+        if ((http ? conn->http.buffered() : conn->decoder.buffered()) == 0)
+            conn->partialSince.store(-1, std::memory_order_relaxed);
+        else if (frameCount > 0 || conn->partialSince.load(std::memory_order_relaxed) < 0)
+            conn->partialSince.store(now, std::memory_order_relaxed);
+        if (frameCount == 0 && conn->split.empty()) {
+            // ֻյ֡Ѵ carry / Only part of a frame arrived; it is in the carry, keep receiving
+            if (throttleMs > 0) {
+                {
+                    std::lock_guard<std::mutex> guard(conn->lock);
+                    holdRecv(conn, now + throttleMs);
+                }
+                wakeBy(conn, now + throttleMs);
+            }
+            else {
+                postRecv(conn);
+            }
+            freeIOData(pIOData);
+            releaseConnection(conn);
+            return;
+        }
+        bool sendNow = false;
+        bool keepReceiving = true;
+        {
+            std::lock_guard<std::mutex> guard(conn->lock);
+            if (!conn->sendBusy) {
+                // ûз;ջΪͣòռõתͲ
+                // No send in flight: the receive becomes the send and its reference moves to it.
+                sendNow = true;
+                conn->sendBusy = true;
+                conn->sendSince.store(now, std::memory_order_relaxed);
+                if (conn->split.empty()) {
+                    pIOData->wsaBuf.len = static_cast<ULONG>(inPlaceEnd - inPlaceBegin); // ֻ֡ / Send back only the complete frames
+                    conn->inFlight = pIOData->wsaBuf.len;
+                }
+                else {
+                    // ߽֡ǰǱλе֡ջ漴
+                    // ȫյĶУһηʹȡļƬ֮Ӧڶ
+                    // The split frame comes first, followed by this buffer's complete frames; the
+                    // receive buffer goes back right away. It all goes into the empty queue and the
+                    // first send is taken from there; responses behind a file slice stay queued.
+                    if (inPlaceBegin)
+                        conn->split.insert(conn->split.end(), inPlaceBegin, inPlaceEnd);
+                    engine->releaseBuffer(pIOData);
+                    conn->queued.swap(conn->split);
+                    conn->queuedFiles.assign(conn->splitFiles.begin(), conn->splitFiles.end());
+                    takeSend(conn);
+                    prepareSend(conn, pIOData);
+                    Metrics::add(ServerMetric::QueuedBytes, static_cast<int64_t>(conn->queued.size()));
+                }
+            }
+            else {
+                // ;ŵУ֮ǰŶӵĺϲΪһη
+                // A send is in flight: the echo joins the queue and goes out with what is already queued.
+                size_t before = conn->queued.size();
+                conn->queued.insert(conn->queued.end(), conn->split.begin(), conn->split.end());
+                if (inPlaceBegin)
+                    conn->queued.insert(conn->queued.end(), inPlaceBegin, inPlaceEnd);
+                for (HttpFileSlice& slice : conn->splitFiles) {
+                    slice.at += before;
+                    conn->queuedFiles.push_back(std::move(slice));
+                }
+                Metrics::add(ServerMetric::QueuedBytes, static_cast<int64_t>(conn->queued.size() - before));
+            }
+            if (!keepOpen) {
+                // Ӧٽգر / The last response: stop receiving and close once it is sent
+                conn->closeAfterSend = true;
+                keepReceiving = false;
+            }
+            else {
+                if (conn->backlog() > config.highWater) {
+                    conn->recvPaused = true;
+                    keepReceiving = false;
+                    Metrics::add(ServerMetric::RecvPauses);
+                }
+                if (throttleMs > 0) {
+                    holdRecv(conn, now + throttleMs);
+                    keepReceiving = false;
+                }
+            }
+        }
+        // ͶݽգԼãͶݷ֮ conn ʱͷ
+        // Post the receive first (it holds its own reference); once the send is posted conn may be freed at any time.
+        if (throttleMs > 0 && keepOpen)
+            wakeBy(conn, now + throttleMs);
+        if (keepReceiving)
+            postRecv(conn);
+        if (sendNow) {
+            postSend(conn, pIOData);
+            return;
+        }
+        freeIOData(pIOData);
+        releaseConnection(conn);
+    }
+
+    // ɣδĲַŻضͷٴӶȡһηͣѹˮλʱָ
+    // A send completed: what it did not send goes back to the front of the queue and the next
+    // send is taken from there; receiving resumes once the backlog drops to the low watermark.
+    void handleSend(Connection* conn, PerIOData* pIOData, DWORD bytesTransferred, int error) {
+        Metrics::add(ServerMetric::OutstandingSends, -1);
+        if (error != 0) {
+            LOG_WARN("WSASend completed with error on socket %llu. Error: %d",
+                static_cast<unsigned long long>(conn->handle->socket), error);
+            Metrics::add(ServerMetric::ErrorSend);
+            closeConnection(conn);
+            freeIOData(pIOData);
+            releaseConnection(conn);
+            return;
+        }
+        Metrics::add(ServerMetric::Echoes);
+        Metrics::add(ServerMetric::BytesSent, bytesTransferred);
+        bool sendMore = false;
+        bool resume = false;
+        bool finished = false;
+        {
+            std::lock_guard<std::mutex> guard(conn->lock);
+            size_t before = conn->queued.size();
+            requeueUnsent(conn, pIOData, bytesTransferred);
+            sendMore = takeSend(conn);
+            Metrics::add(ServerMetric::QueuedBytes, static_cast<int64_t>(conn->queued.size()) - static_cast<int64_t>(before));
+            conn->sendBusy = sendMore;
+            finished = !sendMore && conn->closeAfterSend;
+            conn->sendSince.store(loopMs.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            if (conn->recvPaused && conn->backlog() <= config.lowWater) {
+                conn->recvPaused = false;
+                // ƳеĽɶʱָ / A receive postponed by the rate limit is resumed by the timer
+                resume = !conn->recvThrottled;
+                // ͣڼ䲻ƶʱָ¼ʱ / The read timeout did not run while paused; restart it
+                if (conn->partialSince.load(std::memory_order_relaxed) >= 0)
+                    conn->partialSince.store(loopMs.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+        }
+        // ջһη / Hand back the receive buffer; the context and its reference go to the next send
+        engine->releaseBuffer(pIOData);
+        if (resume)
+            postRecv(conn);
+        if (sendMore) {
+            prepareSend(conn, pIOData);
+            postSend(conn, pIOData);
+            return;
         }
-        std::cout << "Posted asynchronous WSASend operation (echo) for socket " << pIOData->socket << std::endl;
-        // ע⣺ﲻɾ pIODataΪڷɺĴ
+        if (finished) {
+            LOG_INFO("Closing socket %llu after its last response.", static_cast<unsigned long long>(conn->handle->socket));
+            closeConnection(conn);
+        }
+        freeIOData(pIOData);
+        releaseConnection(conn);
+    }
+
+    // ;ûзĲַŻضͷ߳ lockӳ䷢ʱ wsaBuf ļ
+    // Put what the send in flight did not send back at the front of the queue (lock held). When it
+    // was sent from the mapping, wsaBuf is itself the file content.
+    void requeueUnsent(Connection* conn, const PerIOData* pIOData, DWORD sent) {
+        HttpFileSlice slice = std::move(conn->sendingSlice);
+        conn->sendingSlice = HttpFileSlice{};
+        bool mapped = slice.length > 0 && pIOData->fileLength == 0;
+        size_t bytes = mapped ? 0 : pIOData->wsaBuf.len;
+        size_t unsent = sent < bytes ? bytes - sent : 0;
+        uint64_t fileSent = sent > bytes ? sent - bytes : 0;
+        if (unsent > 0) {
+            conn->queued.insert(conn->queued.begin(), pIOData->wsaBuf.buf + sent, pIOData->wsaBuf.buf + bytes);
+            for (HttpFileSlice& queued : conn->queuedFiles)
+                queued.at += unsent;
+        }
+        if (slice.length > fileSent) {
+            slice.at = unsent;
+            slice.offset += fileSent;
+            slice.length -= fileSent;
+            conn->queuedFiles.push_front(std::move(slice));
+        }
+    }
+
+    // Ӷͷȡһηͣ߳ lockһļƬ֮ǰֽڣ SEND_CHUNKŽ sendingܷļʱ
+    // ͬƬһͣƬЩֽ֮󵥶ӳ䷢͡ûпɷ͵ʱ false
+    // Take the next send off the front of the queue (lock held). The bytes before the first file
+    // slice (SEND_CHUNK at most) go into sending; an engine that can send files sends the slice right behind them in
+    // the same operation, otherwise the slice goes out from the mapping on its own afterwards.
+    // Returns false when there is nothing to send.
+    bool takeSend(Connection* conn) {
+        conn->sending.clear();
+        conn->sendingSlice = HttpFileSlice{};
+        size_t bytes = conn->queuedFiles.empty() ? conn->queued.size() : conn->queuedFiles.front().at;
+        bytes = std::min<size_t>(bytes, SEND_CHUNK);
+        if (bytes == conn->queued.size()) {
+            conn->sending.swap(conn->queued);
+        }
+        else {
+            conn->sending.assign(conn->queued.begin(), conn->queued.begin() + static_cast<ptrdiff_t>(bytes));
+            conn->queued.erase(conn->queued.begin(), conn->queued.begin() + static_cast<ptrdiff_t>(bytes));
+        }
+        for (HttpFileSlice& queued : conn->queuedFiles)
+            queued.at -= bytes;
+        conn->inFlight = conn->sending.size();
+        if (!conn->queuedFiles.empty() && conn->queuedFiles.front().at == 0 && (bytes == 0 || engine->canSendFile())) {
+            HttpFileSlice& front = conn->queuedFiles.front();
+            uint64_t length = std::min(front.length, SEND_CHUNK);
+            conn->sendingSlice = HttpFileSlice{ 0, front.file, front.offset, length };
+            front.offset += length;
+            front.length -= length;
+            if (front.length == 0)
+                conn->queuedFiles.pop_front();
+        }
+        return !conn->sending.empty() || conn->sendingSlice.length > 0;
+    }
+
+    //  takeSend ȡд / Fill in the send request from what takeSend took
+    void prepareSend(Connection* conn, PerIOData* pIOData) {
+        const HttpFileSlice& slice = conn->sendingSlice;
+        pIOData->file = INVALID_FILE_HANDLE;
+        pIOData->fileOffset = slice.offset;
+        pIOData->fileLength = 0;
+        if (slice.length > 0 && !engine->canSendFile()) {
+            pIOData->wsaBuf = WSABUF{ static_cast<ULONG>(slice.length), const_cast<char*>(slice.file->data().data() + slice.offset) };
+            return;
+        }
+        pIOData->wsaBuf = WSABUF{ static_cast<ULONG>(conn->sending.size()), conn->sending.data() };
+        if (slice.length > 0) {
+            pIOData->file = slice.file->handle();
+            pIOData->fileLength = slice.length;
+        }
+    }
+
+    // HTTP ģʽνеȫ󣬰Ӧ˳׷ӵ splitkeepOpen Ϊ false ʱӦ
+    // ǷʱĴӦ
+    // HTTP mode: parse every request in this receive and append the responses to split in order.
+    // keepOpen comes back false when this is the last response, including the error response to a
+    // malformed request.
+    // ӿͻ IP ĽͰȡ cost ơdelay ʱճνգthrottleMs ΪƳһνյĺ
+    // Ƿ³һ burst ʱ drop busy ʱλ busy false ʾӦر
+    // Take cost tokens from the client IP's receive bucket. With delay this receive is handled as
+    // usual and throttleMs is how long the next one is postponed, or it is dropped if it would run
+    // up more than one burst of debt; with busy, busy is set. Returns false when the connection
+    // should close.
+    bool chargeRecv(Connection* conn, uint32_t cost, int64_t now, uint32_t& throttleMs, bool& busy) {
+        throttleMs = receives->take(conn->peerKey, cost, now, config.limitAction == LimitAction::Delay);
+        if (throttleMs == 0)
+            return true;
+        Metrics::add(ServerMetric::LimitedRecvs);
+        if (config.limitAction == LimitAction::Drop || throttleMs == RateLimiter::REFUSED) {
+            LOG_INFO_EVERY(100, "Receive rate limit exceeded, closing socket %llu.", static_cast<unsigned long long>(conn->handle->socket));
+            return false;
+        }
+        busy = config.limitAction == LimitAction::Busy;
+        return true;
     }
 
-    // 첽¼ / Handle completion of a send operation.
-    void handleSend(PerIOData* pIOData) {
-        // ɺΪǰͶݽղ / After sending, post a new receive to continue communication.
-        postRecv(pIOData->socket);
-        delete pIOData;
+    void serveHttp(Connection* conn, const char* data, DWORD bytes, uint64_t& requests, bool& keepOpen) {
+        bool valid = conn->http.feed(data, bytes, [&](const HttpRequest& request) {
+            ++requests;
+            HttpResponse response(conn->split, request, &conn->splitFiles);
+            // ֮ÿͻ½ / After a handoff, make the client reconnect to the new process
+            if (g_handedOff.load(std::memory_order_relaxed))
+                response.close();
+            routes.dispatch(request, response);
+            keepOpen = response.keepsAlive();
+            return keepOpen;
+        });
+        if (!valid) {
+            LOG_WARN("Malformed HTTP request on socket %llu (status %d), closing after the response.",
+                static_cast<unsigned long long>(conn->handle->socket), conn->http.error());
+            Metrics::add(ServerMetric::ErrorBadRequest);
+            HttpRequest request;
+            HttpResponse response(conn->split, request);
+            response.close();
+            response.sendStatus(conn->http.error());
+            keepOpen = false;
+        }
+    }
+
+    // Ͷ첽ͲWSASendpIOData ռõתͣʧʱر
+    // Post an asynchronous send (WSASend); pIOData's reference moves to the send. On failure the connection closes.
+    void postSend(Connection* conn, PerIOData* pIOData) {
+        SOCKET s = conn->handle->socket;
+        pIOData->operationType = IO_OPERATION::SEND;
+        Metrics::add(ServerMetric::OutstandingSends);
+        bool posted = !conn->closing && (pIOData->fileLength > 0
+            ? engine->postSendFile(conn->handle, pIOData) : engine->postSend(conn->handle, pIOData));
+        if (!posted) {
+            LOG_WARN("WSASend failed. Error: %d", WSAGetLastError());
+            Metrics::add(ServerMetric::OutstandingSends, -1);
+            Metrics::add(ServerMetric::ErrorPostSend);
+            closeConnection(conn);
+            freeIOData(pIOData);
+            releaseConnection(conn);
+            return;
+        }
+        // ע⣺Ͷݳɹ pIOData  conn ߳ɲͷţٷ
+        // Note: once posted, pIOData and conn may already be completed and freed on another thread.
+        LOG_DEBUG("Posted asynchronous WSASend operation (echo) for socket %llu", static_cast<unsigned long long>(s));
     }
 
-    // Ͷ첽ղWSARecv / Post an asynchronous receive (WSARecv) operation on socket s.
-    void postRecv(SOCKET s) {
-        auto* pIOData = new PerIOData(s);
+    // Ͷ첽ղWSARecv / Post an asynchronous receive (WSARecv) operation on the connection.
+    void postRecv(Connection* conn) {
+        SOCKET s = conn->handle->socket;
+        auto* pIOData = ioPool.create(s);
         pIOData->operationType = IO_OPERATION::RECV; // Ϊ RECV  / Mark as RECV.
-        DWORD flags = 0;
-        DWORD bytesReceived = 0;
-        int ret = WSARecv(s, &pIOData->wsaBuf, 1, &bytesReceived, &flags, &pIOData->overlapped, nullptr);
-        if (ret == SOCKET_ERROR) {
-            int err = WSAGetLastError();
-            if (err != WSA_IO_PENDING) {
-                std::cerr << "WSARecv failed. Error: " << err << std::endl;
-                closesocket(s);
-                delete pIOData;
-                return;
-            }
+        conn->pendingOps.fetch_add(1);
+        Metrics::add(ServerMetric::OutstandingRecvs);
+        if (conn->closing || !engine->postRecv(conn->handle, pIOData)) {
+            LOG_WARN("WSARecv failed. Error: %d", WSAGetLastError());
+            Metrics::add(ServerMetric::OutstandingRecvs, -1);
+            Metrics::add(ServerMetric::ErrorPostRecv);
+            closeConnection(conn);
+            freeIOData(pIOData);
+            releaseConnection(conn);
+            return;
         }
-        std::cout << "Posted an asynchronous WSARecv operation on socket " << s << std::endl;
+        LOG_DEBUG("Posted an asynchronous WSARecv operation on socket %llu", static_cast<unsigned long long>(s));
     }
 };
 
-int main() {
+// ӡͳУBenchmark  key=value  / Print the statistics line; Benchmark parses its key=value fields
+static void printStats(const ServerCounters& c) {
+    Logger::instance().flush();
+    const Metrics& m = Metrics::instance();
+    int64_t echoed = m.value(ServerMetric::Echoes);
+    std::cout << "Stats: echoed=" << echoed << " accepted=" << m.value(ServerMetric::Accepts) << " syscalls=" << c.syscalls
+        << " syscalls_per_echo=" << (echoed ? static_cast<double>(c.syscalls) / echoed : 0.0)
+        << " pool_hits=" << c.pool.hits << " pool_misses=" << c.pool.misses
+        << " pool_high_water=" << c.pool.highWater
+        << " buffer_high_water_bytes=" << c.bufferBytes
+        << " frames=" << m.value(ServerMetric::Frames)
+        << " requests=" << m.value(ServerMetric::HttpRequests)
+        << " file_hits=" << m.value(ServerMetric::FileHits) << " file_misses=" << m.value(ServerMetric::FileMisses)
+        << " timeouts=" << m.value(ServerMetric::TimeoutIdle) + m.value(ServerMetric::TimeoutRead) + m.value(ServerMetric::TimeoutWrite)
+        << " spin_hits=" << m.value(ServerMetric::SpinHits) << " spin_misses=" << m.value(ServerMetric::SpinMisses)
+        << " limited_accepts=" << m.value(ServerMetric::LimitedAccepts) << " limited_recvs=" << m.value(ServerMetric::LimitedRecvs)
+        << " accepts_same_core=" << m.value(ServerMetric::AcceptsSameCore)
+        << " accepts_same_node=" << m.value(ServerMetric::AcceptsSameNode)
+        << " accepts_other_node=" << m.value(ServerMetric::AcceptsOtherNode)
+        << " log_dropped=" << Logger::instance().dropped() << std::endl;
+}
+
+// ȴһ̽ӹܡ׽ֺֹ߳ͣܣʣµĽܲӹرգ
+//  drainMs 룬Ȼ÷˳
+// Wait for the next process to take over. Once the listening sockets are handed off the workers
+// stop accepting; wait for the remaining accepts to finish and the open connections to close,
+// for at most drainMs, then stop the server.
+static void serveHandoff(HandoffChannel& handoff, const std::vector<SOCKET>& listeners, int64_t drainMs) {
+    while (!g_stopRequested) {
+        if (!handoff.handOff(listeners, 200))
+            continue;
+        g_handedOff = true;
+        std::cout << "Handed the listening sockets to a new process; draining." << std::endl;
+        const Metrics& m = Metrics::instance();
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(drainMs);
+        while (!g_stopRequested && std::chrono::steady_clock::now() < deadline
+            && (m.value(ServerMetric::OutstandingAccepts) > 0 || m.value(ServerMetric::Connections) > 0))
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        int64_t open = m.value(ServerMetric::Connections);
+        if (open > 0)
+            std::cout << "Drain timeout: closing " << open << " connections." << std::endl;
+        g_stopRequested = true;
+    }
+}
+
+// һƬģʽÿƬһ̷߳Լ߳ϡ
+// inherited ǿʱǴһ̽ӹܵļ׽֣ÿһ
+// Run one server, or in shard mode one single-threaded server per shard, each on its own thread.
+// A non-empty inherited holds the listening sockets taken over from the previous process, one per server.
+static int runServers(const ServerConfig& config, const std::vector<SOCKET>& inherited, HandoffChannel& handoff) {
+    ServerConfig serverConfig = config;
+    int count = std::max(1, config.shards);
+    if (count > 1)
+        serverConfig.workerThreads = 1;
+    if (!inherited.empty() && inherited.size() != static_cast<size_t>(count)) {
+        std::cerr << "The previous process passed " << inherited.size() << " listening sockets for "
+            << count << " shards; restart with the same --shards." << std::endl;
+        return 1;
+    }
+    std::vector<std::unique_ptr<IocpServer>> servers;
+    for (int i = 0; i < count; ++i) {
+        // ƬģʽÿƬηֵһ CPU / In shard mode each shard gets the next CPU
+        if (count > 1 && !config.cpus.empty())
+            serverConfig.cpus = { config.cpus[static_cast<size_t>(i) % config.cpus.size()] };
+        servers.push_back(std::make_unique<IocpServer>(serverConfig, inherited.empty() ? INVALID_SOCKET : inherited[i]));
+        if (!servers.back()->initialize())
+            return 1;
+    }
+    std::thread handoffThread;
+    if (!config.handoffPath.empty()) {
+        // ȷ֮ɽֹͣܣںŶӣֱ run ʼ
+        // After the confirmation the old process stops accepting; connections queue in the kernel until run below starts accepting.
+        handoff.confirm();
+        if (!inherited.empty())
+            std::cout << "Took over " << inherited.size() << " listening socket(s) from the previous process." << std::endl;
+        if (handoff.listen()) {
+            std::vector<SOCKET> listeners;
+            for (const auto& server : servers)
+                listeners.push_back(server->listeningSocket());
+            handoffThread = std::thread(serveHandoff, std::ref(handoff), listeners, config.drainTimeoutMs);
+        }
+    }
+    if (count == 1) {
+        servers[0]->run();
+    }
+    else {
+        std::vector<std::thread> threads;
+        for (auto& server : servers)
+            threads.emplace_back(&IocpServer::run, server.get());
+        for (auto& t : threads)
+            t.join();
+    }
+    if (handoffThread.joinable())
+        handoffThread.join();
+    ServerCounters total;
+    for (const auto& server : servers)
+        total += server->counters();
+    printStats(total);
+    return 0;
+}
+
+// в / Parse command-line arguments
+static bool parseArgs(int argc, char* argv[], ServerConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--port" && hasValue)
+            config.port = std::atoi(argv[++i]);
+        else if (arg == "--threads" && hasValue)
+            config.workerThreads = std::atoi(argv[++i]);
+        else if (arg == "--engine" && hasValue)
+            config.engine = argv[++i];
+        else if (arg == "--accepts" && hasValue)
+            config.pendingAccepts = std::atoi(argv[++i]);
+        else if (arg == "--shards" && hasValue)
+            config.shards = std::atoi(argv[++i]);
+        else if (arg == "--framing" && hasValue) {
+            if (!parseFrameMode(argv[++i], config.framing)) {
+                std::cerr << "Unknown framing: " << argv[i] << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--protocol" && hasValue) {
+            std::string name = argv[++i];
+            if (name == "echo")
+                config.protocol = Protocol::Echo;
+            else if (name == "http")
+                config.protocol = Protocol::Http;
+            else {
+                std::cerr << "Unknown protocol: " << name << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--admin-port" && hasValue)
+            config.adminPort = std::atoi(argv[++i]);
+        else if (arg == "--batch" && hasValue)
+            config.batch = std::atoi(argv[++i]);
+        else if (arg == "--high-water" && hasValue)
+            config.highWater = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--low-water" && hasValue)
+            config.lowWater = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--idle-timeout" && hasValue)
+            config.idleTimeoutMs = std::strtoll(argv[++i], nullptr, 10);
+        else if (arg == "--read-timeout" && hasValue)
+            config.readTimeoutMs = std::strtoll(argv[++i], nullptr, 10);
+        else if (arg == "--write-timeout" && hasValue)
+            config.writeTimeoutMs = std::strtoll(argv[++i], nullptr, 10);
+        else if (arg == "--static" && hasValue)
+            config.staticRoot = argv[++i];
+        else if (arg == "--file-cache" && hasValue)
+            config.fileCacheBytes = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--file-check" && hasValue)
+            config.fileCheckMs = std::strtoll(argv[++i], nullptr, 10);
+        else if (arg == "--handoff" && hasValue)
+            config.handoffPath = argv[++i];
+        else if (arg == "--drain-timeout" && hasValue)
+            config.drainTimeoutMs = std::strtoll(argv[++i], nullptr, 10);
+        else if (arg == "--spin" && hasValue)
+            config.spinUs = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--busy-poll" && hasValue)
+            config.busyPollUs = std::atoi(argv[++i]);
+        else if (arg == "--sqpoll" && hasValue)
+            config.sqpollIdleMs = std::strtoll(argv[++i], nullptr, 10);
+        else if (arg == "--cpus" && hasValue) {
+            if (!parseCpuList(argv[++i], config.cpus)) {
+                std::cerr << "Invalid CPU list: " << argv[i] << std::endl;
+                return false;
+            }
+            for (int cpu : config.cpus) {
+                if (cpu >= CpuTopology::instance().cpuCount()) {
+                    std::cerr << "CPU " << cpu << " does not exist." << std::endl;
+                    return false;
+                }
+            }
+        }
+        else if ((arg == "--limit-connects" || arg == "--limit-recv") && hasValue) {
+            if (!parseRateLimit(argv[++i], arg == "--limit-connects" ? config.connectLimit : config.recvLimit)) {
+                std::cerr << "Invalid rate limit (RATE[:BURST]): " << argv[i] << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--limit-unit" && hasValue) {
+            std::string unit = argv[++i];
+            if (unit != "bytes" && unit != "messages") {
+                std::cerr << "Unknown limit unit: " << unit << std::endl;
+                return false;
+            }
+            config.limitMessages = unit == "messages";
+        }
+        else if (arg == "--limit-action" && hasValue) {
+            if (!parseLimitAction(argv[++i], config.limitAction)) {
+                std::cerr << "Unknown limit action: " << argv[i] << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--limit-table" && hasValue)
+            config.limitEntries = std::max<size_t>(RateLimiter::WAYS, std::strtoull(argv[++i], nullptr, 10));
+        else if (arg == "--quiet")
+            config.logLevel = LogLevel::Warn;
+        else if (arg == "--log-level" && hasValue) {
+            if (!parseLogLevel(argv[++i], config.logLevel)) {
+                std::cerr << "Unknown log level: " << argv[i] << std::endl;
+                return false;
+            }
+        }
+        else {
+            std::cerr << "Usage: " << argv[0]
+                << " [--port N] [--threads N] [--engine iocp|epoll|uring] [--accepts N] [--shards N]" << std::endl
+                << "       [--batch N] [--high-water BYTES] [--low-water BYTES] [--framing raw|length|line] [--admin-port N]" << std::endl
+                << "       [--idle-timeout MS] [--read-timeout MS] [--write-timeout MS] [--protocol echo|http]" << std::endl
+                << "       [--static DIR] [--file-cache BYTES] [--file-check MS] [--handoff PATH] [--drain-timeout MS]" << std::endl
+                << "       [--spin US] [--busy-poll US] [--sqpoll IDLE_MS] [--cpus LIST] [--limit-connects RATE[:BURST]]" << std::endl
+                << "       [--limit-recv RATE[:BURST]] [--limit-unit bytes|messages] [--limit-action delay|drop|busy] [--limit-table N]" << std::endl
+                << "       [--log-level debug|info|warn|error|off] [--quiet]" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
     try {
-        IocpServer server;
-        if (!server.initialize())
+        ServerConfig config;
+        if (!parseArgs(argc, argv, config))
+            return 1;
+        Logger::instance().setLevel(config.logLevel);
+#ifdef _WIN32
+        SetConsoleCtrlHandler(consoleCtrlHandler, TRUE);
+#else
+        std::signal(SIGINT, stopSignalHandler);
+        std::signal(SIGTERM, stopSignalHandler);
+        // sendfile û MSG_NOSIGNALԶѹرʱֹ / sendfile has no MSG_NOSIGNAL; a closed peer must not kill the process
+        std::signal(SIGPIPE, SIG_IGN);
+#endif
+        defineServerMetrics();
+        MetricsEndpoint admin;
+        if (config.adminPort > 0) {
+            if (!admin.start(config.adminPort))
+                return 1;
+            std::cout << "Metrics on http://127.0.0.1:" << config.adminPort << "/metrics" << std::endl;
+        }
+        // оɽʱӹļ׽ / Take over the old process's listening sockets if there is one
+        HandoffChannel handoff(config.handoffPath);
+        std::vector<SOCKET> inherited;
+        if (!config.handoffPath.empty() && !handoff.takeOver(inherited))
             return 1;
-        server.run();
+        return runServers(config, inherited, handoff);
     }
     catch (const std::exception& ex) {
         std::cerr << "Exception occurred: " << ex.what() << std::endl;
@@ -0,0 +1,647 @@
+// UringEngine.h
+// io_uring 完成引擎（仅 Linux），由 CompletionEngine.h 包含
+// io_uring completion engine (Linux only), included from CompletionEngine.h
+//
+// io_uring 和 IOCP 一样是完成模型，ACCEPT/RECV/SEND 状态机可以直接映射过来：
+//   - 监听套接字上只挂一个多次触发 (multishot) 的 accept，每个新连接产生一个 CQE；
+//   - 每个连接只挂一个 multishot recv，数据写入内核从提供缓冲区环中挑选的缓冲区；
+//   - send 与关闭套接字的 close 只写入 SQ，由下一次 io_uring_enter 一并提交；
+//     连接仍挂着 multishot recv 时，close 硬链接在取消它的 ASYNC_CANCEL 之后。
+// 因此一次 io_uring_enter 既提交本轮所有的发送，又收回一批完成事件，而不是每次 WSARecv/WSASend
+// 各自一次系统调用。没有使用 liburing，直接调用系统调用并映射环形队列。
+// io_uring is completion based like IOCP, so the ACCEPT/RECV/SEND state machine maps directly:
+//   - the listener carries one multishot accept that yields a CQE per new connection;
+//   - each connection carries one multishot recv whose data lands in buffers the kernel picks
+//     from a provided-buffer ring;
+//   - sends and the close of a released socket are only written to the SQ and go
+//     out with the next io_uring_enter; while the connection's multishot recv is armed, the
+//     close is hard-linked behind the ASYNC_CANCEL that cancels it.
+// One io_uring_enter therefore submits all sends of a round and reaps a batch of completions,
+// instead of one system call per WSARecv/WSASend. liburing is not used; the rings are mapped
+// directly through the raw system calls.
+//
+// enableKernelPolling 打开 SQPOLL：内核线程轮询 SQ，提交不再需要系统调用，只在它空闲睡眠后唤醒一次。
+// 不等待的 waitBatch（SpinWait 的轮询）只读映射的 CQ，没有待提交的 SQE 时不进入内核。
+// enableKernelPolling turns on SQPOLL: a kernel thread polls the SQ, so submitting needs no
+// system call, except one wakeup after the thread has gone to sleep when idle. A non-waiting
+// waitBatch (SpinWait's polling) only reads the mapped CQ and does not enter the kernel unless
+// SQEs are pending.
+
+#pragma once
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include <ctime>
+#include <thread>
+
+// 队列深度与提供缓冲区的规格 / Queue depth and provided-buffer geometry
+constexpr unsigned URING_ENTRIES = 4096;
+constexpr unsigned URING_BUFFER_COUNT = 4096;    // 必须是 2 的幂 / Must be a power of two
+constexpr unsigned URING_BUFFER_SIZE = 2048;
+constexpr unsigned short URING_BUFFER_GROUP = 0;
+
+class UringEngine : public CompletionEngine {
+public:
+    ~UringEngine() override {
+        if (ringFd != -1 && sqes)
+            cancelAll();
+        if (bufferRing)
+            munmap(bufferRing, bufferRingBytes);
+        if (sqes)
+            munmap(sqes, sqesBytes);
+        if (cqRing && cqRing != sqRing)
+            munmap(cqRing, cqRingBytes);
+        if (sqRing)
+            munmap(sqRing, sqRingBytes);
+        if (ringFd != -1)
+            ::close(ringFd);
+    }
+
+    const char* name() const override { return "uring"; }
+
+    bool enableKernelPolling(unsigned idleMs) override {
+        sqpoll = true;
+        sqpollIdleMs = idleMs;
+        return true;
+    }
+
+    bool open(int) override {
+        io_uring_params params{};
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = URING_ENTRIES * 4;
+        if (sqpoll) {
+            params.flags |= IORING_SETUP_SQPOLL;
+            params.sq_thread_idle = sqpollIdleMs;
+        }
+        ringFd = static_cast<int>(syscall(__NR_io_uring_setup, URING_ENTRIES, &params));
+        if (ringFd < 0) {
+            std::cerr << "io_uring_setup failed. Error: " << errno << std::endl;
+            return false;
+        }
+        if (!(params.features & IORING_FEAT_EXT_ARG)) {
+            std::cerr << "io_uring: kernel lacks IORING_FEAT_EXT_ARG (needs Linux 5.11+)" << std::endl;
+            return false;
+        }
+        // 映射 SQ/CQ 环与 SQE 数组 / Map the SQ/CQ rings and the SQE array
+        sqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single)
+            sqRingBytes = cqRingBytes = std::max(sqRingBytes, cqRingBytes);
+        sqRing = mapRing(sqRingBytes, IORING_OFF_SQ_RING);
+        cqRing = single ? sqRing : mapRing(cqRingBytes, IORING_OFF_CQ_RING);
+        sqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(mapRing(sqesBytes, IORING_OFF_SQES));
+        if (!sqRing || !cqRing || !sqes) {
+            std::cerr << "io_uring mmap failed. Error: " << errno << std::endl;
+            return false;
+        }
+        auto* sq = static_cast<char*>(sqRing);
+        sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sqFlags = reinterpret_cast<unsigned*>(sq + params.sq_off.flags);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqEntries = params.sq_entries;
+        auto* sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        for (unsigned i = 0; i < sqEntries; ++i)
+            sqArray[i] = i;
+        auto* cq = static_cast<char*>(cqRing);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        localTail = *sqTail;
+        return setupBufferRing();
+    }
+
+    IoHandle* attach(SOCKET s, void* context) override {
+        IoHandle* h = pool.acquire();
+        std::lock_guard<std::mutex> guard(h->lock);
+        h->socket = s;
+        h->context = context;
+        h->readOp = nullptr;
+        h->writeOp = nullptr;
+        h->multishot = false;
+        h->releasing = false;
+        h->detached = false;
+        h->backlog.clear();
+        return h;
+    }
+
+    void release(IoHandle* h) override {
+        bool recycleNow = true;
+        {
+            std::lock_guard<std::mutex> guard(h->lock);
+            // 交还尚未取走的接收缓冲区 / Give back receive buffers nobody picked up
+            for (const auto& r : h->backlog)
+                if (r.first > 0 && (r.second & IORING_CQE_F_BUFFER))
+                    recycleBuffer(r.second >> IORING_CQE_BUFFER_SHIFT);
+            h->backlog.clear();
+            std::lock_guard<std::mutex> sq(sqLock);
+            // 关闭也经 SQ 提交，省去一次系统调用；此时该套接字上除了 multishot recv 已没有未完成的请求。
+            // multishot recv 持有文件引用，先取消它，close 硬链接在取消之后（取消失败也照样关闭），
+            // 两个 SQE 一起发布，内核不会只看到前一个；等它的最后一个 CQE 后才能复用句柄
+            // The close goes through the SQ too, saving a system call; apart from the multishot recv no
+            // request on the socket is outstanding by now. The recv holds a file reference, so it is
+            // cancelled first and the close is hard-linked behind the cancel (it runs even if the cancel
+            // fails). Both SQEs are published together so the kernel never sees the first alone. The
+            // handle is recycled only after the recv's last CQE.
+            unsigned count = h->multishot ? 2 : 1;
+            io_uring_sqe* sqe = getSqe(count);
+            if (h->multishot) {
+                h->releasing = true;
+                recycleNow = false;
+                prep(sqe, IORING_OP_ASYNC_CANCEL, -1, TAG_INTERNAL);
+                sqe->addr = tag(h, TAG_RECV);
+                sqe->flags = IOSQE_IO_HARDLINK | IOSQE_CQE_SKIP_SUCCESS;
+                sqe = &sqes[(localTail + 1) & sqMask];
+            }
+            prep(sqe, IORING_OP_CLOSE, h->socket, TAG_INTERNAL);
+            sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+            publish(count);
+            h->socket = INVALID_SOCKET;
+        }
+        if (recycleNow)
+            pool.put(h);
+    }
+
+    // 同步 shutdown：挂起的 recv 随即以 0 字节结束，发送以错误结束。
+    // 不经 SQ 提交，因为 SHUTDOWN 请求在 io-wq 中执行时才按编号解析描述符，
+    // 那时编号可能已被关闭并分给另一个连接。
+    // Synchronous shutdown: the armed recv ends with 0 bytes and sends fail. It does not go
+    // through the SQ, because a SHUTDOWN request resolves the descriptor number only when it runs
+    // from io-wq, when the number may already be closed and handed to another connection.
+    void abort(IoHandle* h) override {
+        std::lock_guard<std::mutex> guard(h->lock);
+        countSyscall();
+        ::shutdown(h->socket, SHUT_RDWR);
+    }
+
+    // 取消 multishot accept；它的最后一个 CQE 让其余等待的请求以 ECANCELED 完成
+    // Cancel the multishot accept; its last CQE completes the remaining parked requests with ECANCELED.
+    void detachListener(IoHandle* listener) override {
+        std::lock_guard<std::mutex> guard(listener->lock);
+        listener->detached = true;
+        if (!listener->multishot) {
+            failPendingAccepts(listener);
+            return;
+        }
+        std::lock_guard<std::mutex> sq(sqLock);
+        io_uring_sqe* sqe = getSqe();
+        prep(sqe, IORING_OP_ASYNC_CANCEL, -1, TAG_INTERNAL);
+        sqe->addr = tag(listener, TAG_ACCEPT);
+        sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+        publish();
+    }
+
+    bool postAccept(IoHandle* listener, IoRequest* req) override {
+        req->engineOp = EngineOp::ACCEPT;
+        req->handle = listener;
+        req->socket = INVALID_SOCKET;
+        std::lock_guard<std::mutex> guard(listener->lock);
+        // 已经有连接在等待，直接完成 / A connection is already waiting: complete right away
+        if (!listener->backlog.empty()) {
+            req->socket = listener->backlog.front().first;
+            listener->backlog.erase(listener->backlog.begin());
+            pushReady(Completion{ req, listener, 0, 0 });
+            return true;
+        }
+        if (listener->detached) {
+            errno = ESHUTDOWN;
+            return false;
+        }
+        // 多个接受操作经 nextPending 排队，共用同一个多次触发的 accept / Several accepts queue through nextPending and share the one multishot accept
+        req->nextPending = listener->readOp;
+        listener->readOp = req;
+        if (!listener->multishot)
+            armAccept(listener);
+        return true;
+    }
+
+    bool postRecv(IoHandle* h, IoRequest* req) override {
+        req->engineOp = EngineOp::RECV;
+        req->handle = h;
+        std::lock_guard<std::mutex> guard(h->lock);
+        if (!h->backlog.empty()) {
+            auto r = h->backlog.front();
+            h->backlog.erase(h->backlog.begin());
+            deliverRecv(h, req, r.first, r.second);
+            return true;
+        }
+        h->readOp = req;
+        if (!h->multishot)
+            armRecv(h);
+        return true;
+    }
+
+    bool postSend(IoHandle* h, IoRequest* req) override {
+        req->engineOp = EngineOp::SEND;
+        req->handle = h;
+        req->transferred = 0;
+        std::lock_guard<std::mutex> sq(sqLock);
+        submitSend(req);
+        return true;
+    }
+
+    void releaseBuffer(IoRequest* req) override {
+        if (req->bufferId >= 0) {
+            recycleBuffer(static_cast<unsigned>(req->bufferId));
+            req->bufferId = -1;
+        }
+        CompletionEngine::releaseBuffer(req);
+    }
+
+    // 发送只写入 SQ。下一次 waitBatch 要进入内核等待时会顺带提交；只有它不必进入内核
+    // （已有就绪事件或 CQE）时才在这里单独提交，以免发送被后面的整批处理耽搁。
+    // Sends are only written to the SQ. When the next waitBatch has to enter the kernel to wait, it
+    // submits them on the way; only when it will not (ready completions or CQEs are already there)
+    // are they submitted here, so they are not held back by the whole next batch.
+    void flush() override {
+        bool waiting;
+        {
+            std::lock_guard<std::mutex> guard(readyLock);
+            waiting = !ready.empty();
+        }
+        if (waiting || *cqHead != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE))
+            submitPending();
+    }
+
+    size_t waitBatch(Completion* out, size_t max, DWORD timeoutMs) override {
+        max = std::min(max, MAX_COMPLETION_BATCH);
+        if (size_t n = popReady(out, max))
+            return n;
+        // 如果另一个线程正在内核中等待，先把本线程写入的 SQE 提交出去，再排队等待
+        // If another thread is blocked in the kernel, submit this thread's SQEs first, then queue up.
+        std::unique_lock<std::mutex> cq(cqLock, std::try_to_lock);
+        if (!cq.owns_lock()) {
+            submitPending();
+            cq.lock();
+            // 持锁的线程可能留下了多余的就绪事件 / The previous holder may have left extra ready completions
+            if (size_t n = popReady(out, max))
+                return n;
+        }
+        bool waited = false;
+        while (true) {
+            // 一轮最多收割 max 个 CQE；多余的留在 CQ 中给下一轮或其他线程
+            // Reap at most max CQEs per pass; the rest stay in the CQ for the next pass or another thread.
+            size_t reaped = 0;
+            io_uring_cqe cqe;
+            while (reaped < max && reapOne(cqe)) {
+                ++reaped;
+                processCqe(cqe);
+            }
+            noteBatch(reaped);
+            size_t n = popReady(out, max);
+            if (n > 0 || waited)
+                return n;
+            if (reaped == 0) {
+                // 不等待时只提交：CQE 由内核直接写入映射的 CQ，检查它不需要系统调用
+                // Without a wait only submit: the kernel writes CQEs straight into the mapped CQ, and checking it needs no system call.
+                if (timeoutMs == 0)
+                    submitPending();
+                else
+                    enterAndWait(timeoutMs);
+                waited = true;
+            }
+        }
+    }
+
+private:
+    // user_data 的低 3 位标记请求种类 / The low 3 bits of user_data tag the request kind
+    static constexpr uint64_t TAG_ACCEPT = 1;    // 指针为 IoHandle / pointer is an IoHandle
+    static constexpr uint64_t TAG_RECV = 2;      // 指针为 IoHandle / pointer is an IoHandle
+    static constexpr uint64_t TAG_SEND = 3;      // 指针为 IoRequest / pointer is an IoRequest
+    static constexpr uint64_t TAG_INTERNAL = 4;  // 结果被忽略 / result ignored
+    static constexpr uint64_t TAG_MASK = 7;
+
+    int ringFd{ -1 };
+    void* sqRing{ nullptr };
+    void* cqRing{ nullptr };
+    io_uring_sqe* sqes{ nullptr };
+    size_t sqRingBytes{ 0 }, cqRingBytes{ 0 }, sqesBytes{ 0 };
+    unsigned* sqHead{ nullptr };
+    unsigned* sqFlags{ nullptr };
+    unsigned* sqTail{ nullptr };
+    unsigned sqMask{ 0 }, sqEntries{ 0 };
+    unsigned localTail{ 0 };                 // 已写入但可能尚未提交的 SQ 尾 / SQ tail written so far
+    unsigned* cqHead{ nullptr };
+    unsigned* cqTail{ nullptr };
+    unsigned cqMask{ 0 };
+    io_uring_cqe* cqes{ nullptr };
+    bool sqpoll{ false };                    // 由内核线程轮询 SQ / A kernel thread polls the SQ
+    unsigned sqpollIdleMs{ 0 };
+
+    // 提供缓冲区环 / Provided-buffer ring
+    io_uring_buf_ring* bufferRing{ nullptr };
+    size_t bufferRingBytes{ 0 };
+    std::unique_ptr<char[]> bufferMemory;
+    unsigned short bufferTail{ 0 };
+    std::mutex bufferLock;
+
+    // 锁顺序 / Lock order: cqLock -> IoHandle::lock -> sqLock -> bufferLock / readyLock
+    std::mutex sqLock;
+    std::mutex cqLock;
+    std::mutex readyLock;
+    std::deque<Completion> ready;            // 不经过内核即可完成的事件 / Completions produced without the kernel
+    HandlePool pool;
+
+    void* mapRing(size_t bytes, unsigned long long offset) {
+        void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, offset);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    bool setupBufferRing() {
+        bufferRingBytes = URING_BUFFER_COUNT * sizeof(io_uring_buf);
+        void* mem = mmap(nullptr, bufferRingBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) {
+            std::cerr << "mmap for the buffer ring failed. Error: " << errno << std::endl;
+            return false;
+        }
+        bufferRing = static_cast<io_uring_buf_ring*>(mem);
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<uint64_t>(bufferRing);
+        reg.ring_entries = URING_BUFFER_COUNT;
+        reg.bgid = URING_BUFFER_GROUP;
+        if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+            std::cerr << "IORING_REGISTER_PBUF_RING failed (needs Linux 5.19+). Error: " << errno << std::endl;
+            return false;
+        }
+        bufferMemory.reset(new char[static_cast<size_t>(URING_BUFFER_COUNT) * URING_BUFFER_SIZE]);
+        for (unsigned i = 0; i < URING_BUFFER_COUNT; ++i)
+            recycleBuffer(i);
+        return true;
+    }
+
+    char* bufferAddress(unsigned bid) {
+        return bufferMemory.get() + static_cast<size_t>(bid) * URING_BUFFER_SIZE;
+    }
+
+    // 把缓冲区放回提供缓冲区环 / Put a buffer back on the provided-buffer ring
+    void recycleBuffer(unsigned bid) {
+        std::lock_guard<std::mutex> guard(bufferLock);
+        // 不用 bufferRing->bufs：C++ 中内核头文件的柔性数组宏会让 bufs 偏移 8 字节
+        // Not bufferRing->bufs: in C++ the kernel header's flex-array macro shifts bufs by 8 bytes.
+        io_uring_buf& b = reinterpret_cast<io_uring_buf*>(bufferRing)[bufferTail & (URING_BUFFER_COUNT - 1)];
+        b.addr = reinterpret_cast<uint64_t>(bufferAddress(bid));
+        b.len = URING_BUFFER_SIZE;
+        b.bid = static_cast<unsigned short>(bid);
+        ++bufferTail;
+        __atomic_store_n(&bufferRing->tail, bufferTail, __ATOMIC_RELEASE);
+    }
+
+    static uint64_t tag(const void* p, uint64_t kind) { return reinterpret_cast<uint64_t>(p) | kind; }
+
+    static void prep(io_uring_sqe* sqe, int opcode, int fd, uint64_t userData) {
+        *sqe = io_uring_sqe{};
+        sqe->opcode = static_cast<uint8_t>(opcode);
+        sqe->fd = fd;
+        sqe->user_data = userData;
+    }
+
+    // 取 count 个连续的空闲 SQE 中的第一个（调用者持有 sqLock），空位不够时先提交；链接的 SQE 之间不会插入提交
+    // Get the first of count consecutive free SQEs (sqLock held), submitting first if there is no
+    // room; no submission falls between linked SQEs.
+    io_uring_sqe* getSqe(unsigned count = 1) {
+        while (localTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) > sqEntries - count)
+            enter(localTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE), 0, pollerFlags(IORING_ENTER_SQ_WAIT), nullptr);
+        return &sqes[localTail & sqMask];
+    }
+
+    // 让内核看到新写入的 count 个 SQE（调用者持有 sqLock） / Make the count new SQEs visible to the kernel (sqLock held)
+    void publish(unsigned count = 1) {
+        localTail += count;
+        __atomic_store_n(sqTail, localTail, __ATOMIC_RELEASE);
+    }
+
+    unsigned pendingSubmissions() {
+        return localTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    }
+
+    // SQPOLL 下附加到 io_uring_enter 的标志：轮询线程睡眠时须唤醒它。未使用 SQPOLL 时为 0
+    // Flags added to io_uring_enter under SQPOLL: the polling thread must be woken when it sleeps. 0 without SQPOLL.
+    unsigned pollerFlags(unsigned extra = 0) {
+        if (!sqpoll)
+            return 0;
+        // 新的 SQ 尾必须在读取标志之前对内核可见 / The new SQ tail must be visible to the kernel before the flags are read
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return extra | (__atomic_load_n(sqFlags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP ? IORING_ENTER_SQ_WAKEUP : 0);
+    }
+
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags, io_uring_getevents_arg* arg) {
+        countSyscall();
+        return static_cast<int>(syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete,
+            flags, arg, arg ? sizeof(*arg) : 0));
+    }
+
+    // 关闭环之前取消全部请求：多次触发的 accept/recv 持有套接字的引用，环在进程退出后才由内核
+    // 异步回收，否则监听端口会在进程退出后短暂保持监听。取消在提交时同步执行。
+    // Cancel every request before the ring is closed: the multishot accept/recv hold socket
+    // references and the kernel tears the ring down asynchronously after the process exits, so the
+    // listening port would otherwise stay open for a moment. The cancel runs inline on submission.
+    void cancelAll() {
+        std::lock_guard<std::mutex> sq(sqLock);
+        io_uring_sqe* sqe = getSqe();
+        prep(sqe, IORING_OP_ASYNC_CANCEL, -1, TAG_INTERNAL);
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY | IORING_ASYNC_CANCEL_ALL;
+        publish();
+        if (!sqpoll) {
+            enter(pendingSubmissions(), 0, 0, nullptr);
+            return;
+        }
+        // 轮询线程异步取走取消请求，等它取走后再关闭环 / The polling thread picks the cancel up asynchronously; wait until it has before the ring closes
+        while (pendingSubmissions() > 0) {
+            if (unsigned flags = pollerFlags())
+                enter(0, 0, flags, nullptr);
+            std::this_thread::yield();
+        }
+    }
+
+    void submitPending() {
+        std::lock_guard<std::mutex> sq(sqLock);
+        unsigned n = pendingSubmissions();
+        if (n == 0)
+            return;
+        // SQPOLL 下轮询线程自己取走 SQE，只在它睡眠时需要系统调用 / Under SQPOLL the polling thread takes the SQEs itself; a system call is needed only while it sleeps
+        if (!sqpoll)
+            enter(n, 0, 0, nullptr);
+        else if (unsigned flags = pollerFlags())
+            enter(0, 0, flags, nullptr);
+    }
+
+    // 一次系统调用完成 "提交全部待提交的 SQE + 等待至少一个 CQE" / One call submits every pending SQE and waits for a CQE
+    void enterAndWait(DWORD timeoutMs) {
+        __kernel_timespec ts{};
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000000;
+        io_uring_getevents_arg arg{};
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+        unsigned n;
+        {
+            std::lock_guard<std::mutex> sq(sqLock);
+            n = pendingSubmissions();
+        }
+        int ret = enter(n, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG | pollerFlags(),
+            timeoutMs == INFINITE ? nullptr : &arg);
+        if (ret < 0 && errno != ETIME && errno != EINTR && errno != EBUSY)
+            std::cerr << "io_uring_enter failed. Error: " << errno << std::endl;
+    }
+
+    // 从 CQ 取一个 CQE（调用者持有 cqLock） / Take one CQE from the CQ (cqLock held)
+    bool reapOne(io_uring_cqe& out) {
+        unsigned head = *cqHead;
+        if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE))
+            return false;
+        out = cqes[head & cqMask];
+        __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    void pushReady(const Completion& c) {
+        std::lock_guard<std::mutex> guard(readyLock);
+        ready.push_back(c);
+    }
+
+    size_t popReady(Completion* out, size_t max) {
+        std::lock_guard<std::mutex> guard(readyLock);
+        size_t n = 0;
+        while (n < max && !ready.empty()) {
+            out[n++] = ready.front();
+            ready.pop_front();
+        }
+        return n;
+    }
+
+    // 以 ECANCELED 完成监听套接字上所有等待的接受操作（调用者持有其锁）
+    // Complete every accept parked on the listener with ECANCELED (its lock held by the caller)
+    void failPendingAccepts(IoHandle* listener) {
+        while (IoRequest* req = listener->readOp) {
+            listener->readOp = req->nextPending;
+            req->nextPending = nullptr;
+            pushReady(Completion{ req, listener, 0, ECANCELED });
+        }
+    }
+
+    // 以下 arm*/submit* 需要持有相应的锁 / The arm*/submit* helpers below need the matching locks held
+    void armAccept(IoHandle* listener) {
+        std::lock_guard<std::mutex> sq(sqLock);
+        io_uring_sqe* sqe = getSqe();
+        prep(sqe, IORING_OP_ACCEPT, listener->socket, tag(listener, TAG_ACCEPT));
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_CLOEXEC;
+        publish();
+        listener->multishot = true;
+    }
+
+    void armRecv(IoHandle* h) {
+        std::lock_guard<std::mutex> sq(sqLock);
+        io_uring_sqe* sqe = getSqe();
+        prep(sqe, IORING_OP_RECV, h->socket, tag(h, TAG_RECV));
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = URING_BUFFER_GROUP;
+        publish();
+        h->multishot = true;
+    }
+
+    void submitSend(IoRequest* req) {
+        io_uring_sqe* sqe = getSqe();
+        prep(sqe, IORING_OP_SEND, req->handle->socket, tag(req, TAG_SEND));
+        sqe->addr = reinterpret_cast<uint64_t>(req->wsaBuf.buf + req->transferred);
+        sqe->len = req->wsaBuf.len - req->transferred;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        publish();
+    }
+
+    // 把一个 recv 结果交给等待中的请求 / Hand one recv result to a parked request
+    void deliverRecv(IoHandle* h, IoRequest* req, int res, unsigned flags) {
+        if (res > 0) {
+            unsigned bid = flags >> IORING_CQE_BUFFER_SHIFT;
+            req->bufferId = static_cast<int>(bid);
+            req->wsaBuf.buf = bufferAddress(bid);
+            req->wsaBuf.len = static_cast<ULONG>(res);
+            pushReady(Completion{ req, h, static_cast<DWORD>(res), 0 });
+        }
+        else {
+            pushReady(Completion{ req, h, 0, res < 0 ? -res : 0 });
+        }
+    }
+
+    // 处理一个 CQE（调用者持有 cqLock） / Process one CQE (cqLock held)
+    void processCqe(const io_uring_cqe& cqe) {
+        uint64_t kind = cqe.user_data & TAG_MASK;
+        void* ptr = reinterpret_cast<void*>(cqe.user_data & ~TAG_MASK);
+        bool more = cqe.flags & IORING_CQE_F_MORE;
+
+        if (kind == TAG_ACCEPT) {
+            auto* listener = static_cast<IoHandle*>(ptr);
+            std::lock_guard<std::mutex> guard(listener->lock);
+            if (!more)
+                listener->multishot = false;
+            if (IoRequest* req = listener->readOp) {
+                listener->readOp = req->nextPending;
+                req->nextPending = nullptr;
+                if (cqe.res >= 0)
+                    req->socket = cqe.res;
+                pushReady(Completion{ req, listener, 0, cqe.res < 0 ? -cqe.res : 0 });
+            }
+            else if (cqe.res >= 0) {
+                listener->backlog.emplace_back(cqe.res, 0u);
+            }
+            if (!listener->multishot && listener->readOp) {
+                if (listener->detached)
+                    failPendingAccepts(listener);
+                else
+                    armAccept(listener);
+            }
+        }
+        else if (kind == TAG_RECV) {
+            auto* h = static_cast<IoHandle*>(ptr);
+            bool recycle = false;
+            {
+                std::lock_guard<std::mutex> guard(h->lock);
+                if (!more)
+                    h->multishot = false;
+                if (h->releasing) {
+                    // 连接已释放：丢弃数据，等最后一个 CQE 后回收句柄 / Released: drop data, recycle after the last CQE
+                    if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER))
+                        recycleBuffer(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                    recycle = !more;
+                }
+                else if (cqe.res == -ENOBUFS) {
+                    // 缓冲区暂时耗尽，multishot 已终止；有请求等待时立即重新布防
+                    // Buffers ran out and the multishot ended; re-arm right away if a request is waiting.
+                    if (h->readOp)
+                        armRecv(h);
+                }
+                else if (IoRequest* req = h->readOp) {
+                    h->readOp = nullptr;
+                    deliverRecv(h, req, cqe.res, cqe.flags);
+                }
+                else {
+                    h->backlog.emplace_back(cqe.res, cqe.flags);
+                }
+                if (recycle)
+                    h->releasing = false;
+            }
+            if (recycle)
+                pool.put(h);
+        }
+        else if (kind == TAG_SEND) {
+            auto* req = static_cast<IoRequest*>(ptr);
+            if (cqe.res < 0) {
+                pushReady(Completion{ req, req->handle, req->transferred, -cqe.res });
+                return;
+            }
+            req->transferred += static_cast<DWORD>(cqe.res);
+            if (req->transferred < req->wsaBuf.len && cqe.res > 0) {
+                // 部分发送：提交剩余部分 / Partial send: submit the rest
+                std::lock_guard<std::mutex> sq(sqLock);
+                submitSend(req);
+                return;
+            }
+            pushReady(Completion{ req, req->handle, req->transferred, 0 });
+        }
+    }
+};
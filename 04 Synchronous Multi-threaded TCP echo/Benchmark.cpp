@@ -0,0 +1,646 @@
+// Benchmark.cpp
+// 04 服务器的延迟基准测试：以子进程方式启动 Server，比较每连接一个线程与有界线程池的各种饱和策略
+// Latency benchmark for the 04 server: start Server as a child process and compare
+// thread-per-connection with the bounded pool under each saturation policy.
+//
+// 每个连接每隔 --interval 毫秒发送一条消息，延迟从计划发送时刻算起，
+// 因此服务器变慢时推迟的发送也计入延迟，不会被漏掉（避免协同遗漏）。
+// Every connection sends one message per --interval milliseconds. Latency is measured from the
+// scheduled send time, so sends pushed back by a slow server still count against it instead of
+// being silently skipped (no coordinated omission).
+//
+// accept 模式在保持 --connections 个空闲会话的同时测量短会话的建立延迟。
+// The accept mode times short sessions while --connections idle sessions are held open.
+//
+// reply 模式是进程内的微基准：在一条回环连接上比较拼接字符串与聚集发送两种回复方式的吞吐量与每条消息的内存分配次数。
+// The reply mode is an in-process microbenchmark: over one loopback connection it compares
+// building replies by string concatenation with gather sends, in throughput and heap
+// allocations per message.
+//
+// 用法 / Usage:
+//   Benchmark latency|accept|reply [--server PATH] [--port N] [--connections N1,N2,...] [--workers N]
+//                                  [--payload BYTES] [--interval MS] [--seconds S] [--client-threads N]
+//                                  [--sizes N1,N2,...]
+
+#include "../Common/Process.h"
+#include "../Common/Gather.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+// 全局 operator new 的调用次数，reply 模式用它统计每条消息的分配次数
+// Calls to the global operator new; the reply mode uses it to count allocations per message.
+static std::atomic<uint64_t> g_allocations{ 0 };
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+// 不内联，否则 GCC 会把内联后的 free 误报为与 new 不匹配 / Not inlined, or GCC misreports the inlined free as mismatched with new
+#ifdef _MSC_VER
+#define BENCH_NOINLINE __declspec(noinline)
+#else
+#define BENCH_NOINLINE __attribute__((noinline))
+#endif
+
+BENCH_NOINLINE void operator delete(void* p) noexcept { std::free(p); }
+BENCH_NOINLINE void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+// 服务器在回显前加上的前缀长度（"Server: "）/ Length of the prefix the server adds to every echo ("Server: ")
+constexpr int REPLY_PREFIX = 8;
+
+// 基准测试配置 / Benchmark configuration
+struct BenchConfig {
+#ifdef _WIN32
+    std::string server{ "Server.exe" };
+#else
+    std::string server{ "./Server" };
+#endif
+    int port{ 9888 };
+    std::vector<int> connectionCounts{ 100, 1000, 10000 };
+    int workers{ 64 };
+    int payload{ 64 };
+    int intervalMs{ 100 };
+    int seconds{ 5 };
+    int clientThreads{ static_cast<int>(std::max(1u, std::thread::hardware_concurrency())) };
+    std::vector<int> replySizes{ 64, 1024, 65536 }; // reply 模式的载荷大小 / Payload sizes for the reply mode
+};
+
+// 被测的服务器模型 / A server model under test
+struct ServerModel {
+    std::string name;
+    std::vector<std::string> args;
+};
+
+// 一次运行的结果 / Result of one run
+struct LatencyResult {
+    std::vector<double> latenciesUs;  // 每条已回显消息的延迟（微秒）/ Latency of every answered message (µs)
+    size_t connected{ 0 };            // 建立成功的连接 / Connections that were established
+    size_t failed{ 0 };               // 未能建立的连接 / Connections that could not be established
+    size_t closed{ 0 };               // 被服务器关闭的连接 / Connections closed by the server
+    size_t stalled{ 0 };              // 结束时仍在等待回显的连接 / Connections still waiting for an echo at the end
+    size_t serverThreads{ 0 };
+    size_t serverRss{ 0 };
+};
+
+// 客户端一侧的连接状态 / Client-side state of one connection
+struct ClientConn {
+    SOCKET socket{ INVALID_SOCKET };
+    Clock::time_point due;        // 下一条消息的计划发送时刻 / Scheduled time of the next message
+    Clock::time_point scheduled;  // 正在等待的消息的计划发送时刻 / Scheduled time of the message in flight
+    int received{ 0 };            // 已收到的回显字节 / Echo bytes received so far
+    bool waiting{ false };
+    bool closed{ false };
+};
+
+// 把打开文件数上限提到硬上限（子进程继承），返回可用的套接字数
+// Raise the open-file limit to the hard limit (inherited by the child) and return the usable socket count.
+static int raiseSocketLimit() {
+#ifdef _WIN32
+    return 1 << 30;
+#else
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0)
+        return 1024;
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    getrlimit(RLIMIT_NOFILE, &limit);
+    return static_cast<int>(std::min<rlim_t>(limit.rlim_cur, 1 << 30));
+#endif
+}
+
+// 非阻塞地发起 count 个连接并等待它们完成；超过 5 秒仍未完成的按失败计
+// Start count non-blocking connects and wait for them; anything still pending after 5 s counts as failed.
+static std::vector<SOCKET> connectMany(int port, int count, size_t& failed) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<unsigned short>(port));
+    InetPtonA(AF_INET, "127.0.0.1", &addr.sin_addr);
+    std::vector<SOCKET> pending;
+    for (int i = 0; i < count; ++i) {
+        SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (s == INVALID_SOCKET) {
+            ++failed;
+            continue;
+        }
+        // 轮流使用 16 个回环地址，分散临时端口 / Rotate over 16 loopback addresses to spread ephemeral ports
+        sockaddr_in local{};
+        local.sin_family = AF_INET;
+        std::string localIp = "127.0.0." + std::to_string(1 + i % 16);
+        InetPtonA(AF_INET, localIp.c_str(), &local.sin_addr);
+        bind(s, reinterpret_cast<sockaddr*>(&local), sizeof(local));
+        setNonBlocking(s);
+        setNoDelay(s);
+        if (connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR) {
+            int err = WSAGetLastError();
+#ifdef _WIN32
+            bool inProgress = err == WSAEWOULDBLOCK;
+#else
+            bool inProgress = err == EINPROGRESS;
+#endif
+            if (!inProgress) {
+                ++failed;
+                closesocket(s);
+                continue;
+            }
+        }
+        pending.push_back(s);
+    }
+
+    std::vector<SOCKET> connected;
+    auto deadline = Clock::now() + std::chrono::seconds(5);
+    while (!pending.empty() && Clock::now() < deadline) {
+        std::vector<WSAPOLLFD> polls(pending.size());
+        for (size_t i = 0; i < pending.size(); ++i) {
+            polls[i].fd = pending[i];
+            polls[i].events = POLLOUT;
+        }
+        if (WSAPoll(polls.data(), static_cast<ULONG>(polls.size()), 100) <= 0)
+            continue;
+        std::vector<SOCKET> still;
+        for (size_t i = 0; i < pending.size(); ++i) {
+            if (polls[i].revents == 0) {
+                still.push_back(pending[i]);
+                continue;
+            }
+            int err = 0;
+            socklen_t len = sizeof(err);
+            getsockopt(pending[i], SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&err), &len);
+            if (err == 0) {
+                connected.push_back(pending[i]);
+            }
+            else {
+                ++failed;
+                closesocket(pending[i]);
+            }
+        }
+        pending.swap(still);
+    }
+    failed += pending.size();
+    for (SOCKET s : pending)
+        closesocket(s);
+    return connected;
+}
+
+// 一个客户端线程：按计划在自己的连接上发送消息，用 WSAPoll 等待回显并记录延迟
+// One client thread: send on its connections as scheduled, wait for echoes with WSAPoll and record latencies.
+static void clientLoop(std::vector<ClientConn>& conns, const BenchConfig& cfg, Clock::time_point end,
+    std::vector<double>& latenciesUs) {
+    const auto interval = std::chrono::milliseconds(cfg.intervalMs);
+    const int replySize = cfg.payload + REPLY_PREFIX;
+    std::vector<char> out(cfg.payload, 'x');
+    std::vector<char> in(replySize);
+    std::vector<WSAPOLLFD> polls;
+    std::vector<ClientConn*> polled;
+    while (Clock::now() < end) {
+        auto now = Clock::now();
+        auto nextDue = end;
+        polls.clear();
+        polled.clear();
+        for (auto& c : conns) {
+            if (c.closed)
+                continue;
+            if (!c.waiting && c.due <= now) {
+                if (send(c.socket, out.data(), cfg.payload, 0) != cfg.payload) {
+                    c.closed = true;
+                    continue;
+                }
+                c.scheduled = c.due;
+                c.due += interval;
+                c.waiting = true;
+            }
+            if (c.waiting) {
+                WSAPOLLFD p{};
+                p.fd = c.socket;
+                p.events = POLLIN;
+                polls.push_back(p);
+                polled.push_back(&c);
+            }
+            else {
+                nextDue = std::min(nextDue, c.due);
+            }
+        }
+        auto waitMs = std::chrono::duration_cast<std::chrono::milliseconds>(nextDue - Clock::now()).count();
+        int timeout = static_cast<int>(std::max<long long>(0, std::min<long long>(waitMs, 10)));
+        if (polls.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+            continue;
+        }
+        if (WSAPoll(polls.data(), static_cast<ULONG>(polls.size()), timeout) <= 0)
+            continue;
+        for (size_t i = 0; i < polls.size(); ++i) {
+            if (polls[i].revents == 0)
+                continue;
+            ClientConn& c = *polled[i];
+            int n = recv(c.socket, in.data(), replySize - c.received, 0);
+            if (n <= 0) {
+                if (n == 0 || WSAGetLastError() != WSAEWOULDBLOCK)
+                    c.closed = true;
+                continue;
+            }
+            c.received += n;
+            if (c.received < replySize)
+                continue;
+            latenciesUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - c.scheduled).count());
+            c.received = 0;
+            c.waiting = false;
+        }
+    }
+}
+
+// 启动服务器子进程 / Start the server child process
+static bool startServer(ChildProcess& proc, const BenchConfig& cfg, const std::vector<std::string>& extra) {
+    std::vector<std::string> args{ cfg.server, "--port", std::to_string(cfg.port), "--quiet" };
+    args.insert(args.end(), extra.begin(), extra.end());
+    if (!proc.start(args, "bench_server.out")) {
+        std::cerr << "Failed to start " << cfg.server << std::endl;
+        return false;
+    }
+    if (!waitForPort("127.0.0.1", cfg.port, 5000)) {
+        std::cerr << "Server did not start listening on port " << cfg.port << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// 启动一种服务器模型，建立连接并施加负载 / Start one server model, open the connections and apply the load
+static bool runModel(const BenchConfig& cfg, const ServerModel& model, int count, LatencyResult& result) {
+    ChildProcess server;
+    if (!startServer(server, cfg, model.args))
+        return false;
+
+    std::vector<SOCKET> sockets = connectMany(cfg.port, count, result.failed);
+    result.connected = sockets.size();
+    int threads = std::max(1, std::min<int>(cfg.clientThreads, static_cast<int>(sockets.size())));
+    std::vector<std::vector<ClientConn>> slices(threads);
+    // 各连接的首次发送均匀分布在一个间隔内 / First sends are spread evenly over one interval
+    auto start = Clock::now() + std::chrono::milliseconds(100);
+    for (size_t i = 0; i < sockets.size(); ++i) {
+        ClientConn c;
+        c.socket = sockets[i];
+        c.due = start + std::chrono::microseconds(static_cast<long long>(cfg.intervalMs) * 1000 * i / sockets.size());
+        slices[i % threads].push_back(c);
+    }
+
+    auto end = start + std::chrono::seconds(cfg.seconds);
+    std::vector<std::vector<double>> latencies(threads);
+    std::vector<std::thread> clients;
+    for (int t = 0; t < threads; ++t)
+        clients.emplace_back(clientLoop, std::ref(slices[t]), std::cref(cfg), end, std::ref(latencies[t]));
+    // 负载进行到一半时记录服务器的线程数与常驻内存 / Sample the server's threads and resident memory halfway through
+    std::this_thread::sleep_until(start + std::chrono::milliseconds(cfg.seconds * 500));
+    result.serverThreads = server.threadCount();
+    result.serverRss = server.residentBytes();
+    for (auto& c : clients)
+        c.join();
+    server.terminate();
+    std::remove("bench_server.out");
+
+    for (const auto& slice : slices) {
+        for (const auto& c : slice) {
+            if (c.closed)
+                ++result.closed;
+            else if (c.waiting)
+                ++result.stalled;
+            closesocket(c.socket);
+        }
+    }
+    for (auto& l : latencies)
+        result.latenciesUs.insert(result.latenciesUs.end(), l.begin(), l.end());
+    return true;
+}
+
+// 已排序样本的百分位数 / Percentile of sorted samples
+static double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty())
+        return 0;
+    size_t index = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// 每连接一个线程与有界线程池在不同连接数下的延迟分布
+// Latency distribution of thread-per-connection versus the bounded pool at each connection count.
+static int benchLatency(const BenchConfig& cfg) {
+    int socketLimit = raiseSocketLimit();
+    std::string workers = std::to_string(cfg.workers);
+    std::vector<ServerModel> models{
+        { "thread", {} },
+        { "queue", { "--pool", "--workers", workers, "--saturation", "queue" } },
+        { "reject", { "--pool", "--workers", workers, "--saturation", "reject" } },
+        { "handoff", { "--pool", "--workers", workers, "--saturation", "handoff" } },
+    };
+    std::cout << "Echo latency vs. connections (" << cfg.payload << "-byte message every " << cfg.intervalMs
+        << " ms per connection, " << cfg.seconds << " s per point, pool of " << cfg.workers << " workers, "
+        << cfg.clientThreads << " client threads)" << std::endl;
+    std::cout << std::setw(7) << "conns" << std::setw(9) << "model" << std::setw(10) << "p50 us" << std::setw(10) << "p90 us"
+        << std::setw(10) << "p99 us" << std::setw(11) << "p99.9 us" << std::setw(10) << "max us" << std::setw(10) << "answered"
+        << std::setw(8) << "failed" << std::setw(8) << "closed" << std::setw(9) << "stalled" << std::setw(9) << "threads"
+        << std::setw(9) << "rss MB" << std::endl;
+    for (int requested : cfg.connectionCounts) {
+        // 两端各占一个描述符，另留一些余量 / Both ends take a descriptor each, plus some headroom
+        int count = std::min(requested, socketLimit - 64);
+        for (const auto& model : models) {
+            LatencyResult r;
+            if (!runModel(cfg, model, count, r))
+                return 1;
+            std::sort(r.latenciesUs.begin(), r.latenciesUs.end());
+            std::cout << std::setw(7) << count << std::setw(9) << model.name << std::fixed << std::setprecision(0)
+                << std::setw(10) << percentile(r.latenciesUs, 50) << std::setw(10) << percentile(r.latenciesUs, 90)
+                << std::setw(10) << percentile(r.latenciesUs, 99) << std::setw(11) << percentile(r.latenciesUs, 99.9)
+                << std::setw(10) << (r.latenciesUs.empty() ? 0 : r.latenciesUs.back())
+                << std::setw(10) << r.latenciesUs.size() << std::setw(8) << r.failed << std::setw(8) << r.closed
+                << std::setw(9) << r.stalled << std::setw(9) << r.serverThreads
+                << std::setw(9) << std::setprecision(1) << r.serverRss / 1048576.0 << std::endl;
+        }
+    }
+    return 0;
+}
+
+// 一个短会话：连接、回显一条消息、关闭；返回耗时（微秒），失败时返回负数
+// One short session: connect, echo one message and close; returns the time taken in µs, or a negative value on failure.
+static double shortSession(int port, const char* localIp, const std::vector<char>& out, std::vector<char>& in) {
+    auto begin = Clock::now();
+    SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == INVALID_SOCKET)
+        return -1;
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    InetPtonA(AF_INET, localIp, &local.sin_addr);
+    bind(s, reinterpret_cast<sockaddr*>(&local), sizeof(local));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<unsigned short>(port));
+    InetPtonA(AF_INET, "127.0.0.1", &addr.sin_addr);
+    bool ok = connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != SOCKET_ERROR;
+    if (ok) {
+        setNoDelay(s);
+        ok = send(s, out.data(), static_cast<int>(out.size()), 0) == static_cast<int>(out.size());
+    }
+    for (int got = 0; ok && got < static_cast<int>(in.size());) {
+        int n = recv(s, in.data() + got, static_cast<int>(in.size()) - got, 0);
+        ok = n > 0;
+        got += std::max(n, 0);
+    }
+    closesocket(s);
+    return ok ? std::chrono::duration<double, std::micro>(Clock::now() - begin).count() : -1;
+}
+
+// 会话建立延迟随活跃会话数的变化：先保持 N 个空闲的长连接，再测量短会话（连接 + 一次回显）的耗时。
+// 每个短会话结束时服务器都要回收一个会话，因此会话表的插入、删除与清理都在被测路径上。
+// Session setup latency versus live sessions: hold N idle long-lived connections, then time short
+// sessions (connect plus one echo). Every short session that ends makes the server reclaim a
+// session, so inserting, removing and reaping sessions are all on the measured path.
+static int benchAccept(const BenchConfig& cfg) {
+    int socketLimit = raiseSocketLimit();
+    std::cout << "Short-session latency vs. live sessions (thread per connection, " << cfg.payload
+        << "-byte message, " << cfg.seconds << " s per point)" << std::endl;
+    std::cout << std::setw(8) << "live" << std::setw(12) << "sessions/s" << std::setw(10) << "p50 us" << std::setw(10) << "p99 us"
+        << std::setw(11) << "p99.9 us" << std::setw(10) << "max us" << std::setw(8) << "failed" << std::endl;
+    ChildProcess server;
+    if (!startServer(server, cfg, {}))
+        return 1;
+    std::vector<char> out(cfg.payload, 'x');
+    std::vector<char> in(cfg.payload + REPLY_PREFIX);
+    std::vector<SOCKET> idle;
+    int nextLocal = 0;
+    for (int requested : cfg.connectionCounts) {
+        // 两端各占一个描述符，另留一些余量 / Both ends take a descriptor each, plus some headroom
+        int live = std::min(requested, socketLimit - 256);
+        size_t failed = 0;
+        if (live > static_cast<int>(idle.size())) {
+            std::vector<SOCKET> more = connectMany(cfg.port, live - static_cast<int>(idle.size()), failed);
+            idle.insert(idle.end(), more.begin(), more.end());
+        }
+        // 等服务器为每个连接启动线程 / Wait until the server has started a thread for every connection
+        auto settle = Clock::now() + std::chrono::seconds(10);
+        while (server.threadCount() < idle.size() && Clock::now() < settle)
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        std::vector<double> latenciesUs;
+        auto start = Clock::now();
+        auto end = start + std::chrono::seconds(cfg.seconds);
+        while (Clock::now() < end) {
+            // 轮流使用 16 个回环地址，分散 TIME_WAIT / Rotate over 16 loopback addresses to spread TIME_WAIT
+            std::string localIp = "127.0.0." + std::to_string(1 + nextLocal++ % 16);
+            double us = shortSession(cfg.port, localIp.c_str(), out, in);
+            if (us < 0)
+                ++failed;
+            else
+                latenciesUs.push_back(us);
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::sort(latenciesUs.begin(), latenciesUs.end());
+        std::cout << std::setw(8) << idle.size() << std::fixed << std::setprecision(0)
+            << std::setw(12) << latenciesUs.size() / seconds << std::setw(10) << percentile(latenciesUs, 50)
+            << std::setw(10) << percentile(latenciesUs, 99) << std::setw(11) << percentile(latenciesUs, 99.9)
+            << std::setw(10) << (latenciesUs.empty() ? 0 : latenciesUs.back()) << std::setw(8) << failed << std::endl;
+    }
+    server.terminate();
+    std::remove("bench_server.out");
+    for (SOCKET s : idle)
+        closesocket(s);
+    return 0;
+}
+
+// 一种回复方式的测量结果 / Measurement of one way of building replies
+struct ReplyResult {
+    double bytesPerSecond{ 0 };
+    double messagesPerSecond{ 0 };
+    double allocationsPerMessage{ 0 };
+};
+
+// 在已连接的 sender 上持续发送 "Server: " + payload 形式的回复 seconds 秒；另一端由线程读空。
+// gather 为 false 时按原来的写法拼接 std::string 再 send，为 true 时用 GatherList 聚集发送。
+// Send "Server: " + payload replies on the connected sender for seconds while a thread drains
+// the other end. With gather false each reply is built the old way, as a concatenated
+// std::string, then sent; with gather true it goes out as a GatherList gather send.
+static ReplyResult measureReplies(SOCKET sender, SOCKET receiver, const std::vector<char>& payload, bool gather, int seconds) {
+    std::atomic<bool> stop{ false };
+    std::thread drain([&] {
+        std::vector<char> sink(1 << 16);
+        while (recv(receiver, sink.data(), static_cast<int>(sink.size()), 0) > 0 && !stop.load(std::memory_order_relaxed)) {
+        }
+    });
+    // 服务器中载荷就在接收缓冲区里，这里同样用一块固定的缓冲区代替
+    // In the server the payload sits in the receive buffer; a fixed buffer stands in for it here.
+    const char* buffer = payload.data();
+    size_t length = payload.size();
+    GatherList reply;
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+    uint64_t allocationsBefore = g_allocations.load();
+    auto start = Clock::now();
+    auto end = start + std::chrono::seconds(seconds);
+    while (Clock::now() < end) {
+        for (int i = 0; i < 64; ++i) {
+            bool ok;
+            if (gather) {
+                reply.clear();
+                reply.add("Server: ");
+                reply.add(std::string_view(buffer, length));
+                bytes += reply.size();
+                ok = reply.sendAll(sender);
+            }
+            else {
+                std::string response = "Server: " + std::string(buffer, length);
+                bytes += response.size();
+                const char* p = response.data();
+                size_t left = response.size();
+                ok = true;
+                while (ok && left > 0) {
+                    int n = send(sender, p, static_cast<int>(left), 0);
+                    ok = n > 0;
+                    p += n;
+                    left -= ok ? n : 0;
+                }
+            }
+            if (!ok)
+                break;
+            ++messages;
+        }
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    uint64_t allocations = g_allocations.load() - allocationsBefore;
+    stop = true;
+    // 再发一个字节唤醒读取线程 / One more byte wakes the draining thread
+    send(sender, "x", 1, 0);
+    drain.join();
+    ReplyResult result;
+    result.bytesPerSecond = bytes / elapsed;
+    result.messagesPerSecond = messages / elapsed;
+    result.allocationsPerMessage = messages ? static_cast<double>(allocations) / messages : 0;
+    return result;
+}
+
+// 回复方式的微基准：不启动服务器，只测量构造并发送回复的代价
+// Reply microbenchmark: no server is started; it measures only the cost of building and sending replies.
+static int benchReply(const BenchConfig& cfg) {
+    SOCKET listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<unsigned short>(cfg.port));
+    InetPtonA(AF_INET, "127.0.0.1", &addr.sin_addr);
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+    if (bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR || listen(listener, 1) == SOCKET_ERROR) {
+        std::cerr << "Failed to listen on port " << cfg.port << ". Error: " << WSAGetLastError() << std::endl;
+        closesocket(listener);
+        return 1;
+    }
+    SOCKET sender = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (connect(sender, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR) {
+        std::cerr << "connect failed. Error: " << WSAGetLastError() << std::endl;
+        closesocket(sender);
+        closesocket(listener);
+        return 1;
+    }
+    SOCKET receiver = accept(listener, nullptr, nullptr);
+    closesocket(listener);
+    setNoDelay(sender);
+
+    std::cout << "Reply construction: concatenated string vs. gather send (" << cfg.seconds << " s per point)" << std::endl;
+    std::cout << std::setw(8) << "payload" << std::setw(10) << "method" << std::setw(12) << "MB/s"
+        << std::setw(12) << "msgs/s" << std::setw(14) << "allocs/msg" << std::endl;
+    for (int size : cfg.replySizes) {
+        std::vector<char> payload(static_cast<size_t>(std::max(1, size)), 'x');
+        for (bool gather : { false, true }) {
+            ReplyResult r = measureReplies(sender, receiver, payload, gather, cfg.seconds);
+            std::cout << std::setw(8) << payload.size() << std::setw(10) << (gather ? "gather" : "concat")
+                << std::fixed << std::setprecision(0) << std::setw(12) << r.bytesPerSecond / 1e6
+                << std::setw(12) << r.messagesPerSecond << std::setw(14) << std::setprecision(2)
+                << r.allocationsPerMessage << std::endl;
+        }
+    }
+    closesocket(sender);
+    closesocket(receiver);
+    return 0;
+}
+
+// 解析逗号分隔的整数列表 / Parse a comma-separated list of integers
+static std::vector<int> parseList(const std::string& value) {
+    std::vector<int> list;
+    for (size_t pos = 0; pos < value.size();) {
+        size_t comma = value.find(',', pos);
+        if (comma == std::string::npos)
+            comma = value.size();
+        list.push_back(std::atoi(value.substr(pos, comma - pos).c_str()));
+        pos = comma + 1;
+    }
+    return list;
+}
+
+static void usage() {
+    std::cerr << "Usage: Benchmark latency|accept|reply [--server PATH] [--port N] [--connections N1,N2,...] [--workers N]" << std::endl
+        << "                                      [--payload BYTES] [--interval MS] [--seconds S] [--client-threads N]" << std::endl
+        << "                                      [--sizes N1,N2,...]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    std::string mode = argc >= 2 ? argv[1] : "";
+    if (mode != "latency" && mode != "accept" && mode != "reply") {
+        usage();
+        return 1;
+    }
+    BenchConfig cfg;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--server" && hasValue)
+            cfg.server = argv[++i];
+        else if (arg == "--port" && hasValue)
+            cfg.port = std::atoi(argv[++i]);
+        else if (arg == "--connections" && hasValue)
+            cfg.connectionCounts = parseList(argv[++i]);
+        else if (arg == "--workers" && hasValue)
+            cfg.workers = std::atoi(argv[++i]);
+        else if (arg == "--payload" && hasValue)
+            cfg.payload = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--interval" && hasValue)
+            cfg.intervalMs = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--seconds" && hasValue)
+            cfg.seconds = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--client-threads" && hasValue)
+            cfg.clientThreads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--sizes" && hasValue)
+            cfg.replySizes = parseList(argv[++i]);
+        else {
+            usage();
+            return 1;
+        }
+    }
+    // 服务器默认把每次读取当作一条消息，负载须一次装进它的 1024 字节缓冲区
+    // By default the server treats each read as one message, so the payload must fit its 1024-byte buffer.
+    cfg.payload = std::min(cfg.payload, 1024);
+
+#ifndef _WIN32
+    // 被服务器关闭的连接上 send 不应终止进程 / A send on a connection the server closed must not kill the process
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        std::cerr << "WSAStartup failed" << std::endl;
+        return 1;
+    }
+    int rc = mode == "accept" ? benchAccept(cfg) : mode == "reply" ? benchReply(cfg) : benchLatency(cfg);
+    WSACleanup();
+    return rc;
+}
@@ -4,21 +4,55 @@
 //      Ϊÿһ̣߳߳ڽݺظ Server: ǰ׺Ϣ
 //      Ựʱ߳ϱɻỰ߳̽Դգjoin Ƴ
 //
-// ʱȷ ws2_32.lib
+// --pool ģʽ¸ù̶СĹ̳߳أ̰߳ӷ빤УɿеĹ߳ȡ
+// ͬʱ --workersй̶߳æʱ --saturation ĲԴӣ
+//      queue   нУ--queueȴʱͣ accept
+//      reject  رӣ
+//      handoff һھ֪ͨ (WSAPoll) ĵ߳¼ѭԷʽ
+//
+// --framing ѡϢķ֡ʽ ../Common/Framing.h
+//      raw     ÿ recv յݼһϢĬϣ
+//      length  4 ֽڴ򳤶ǰ׺Ķ֡
+//      line    Իзָı֡
+// ֡ʱظҲͬĸʽ֡һ recv еĶ֡ظϲΪһ sendԽ recv ֡ڲȫ
+//
+// --cpus LIST Ѵ̶̹߳бе CPU ϣ ../Common/Topology.hÿһ̵߳ģʽ£
+// ̶̹߳ڽոݰ CPU ϣSO_INCOMING_CPU CPU бʱת䣻
+// ̳߳صĵ i ̶̹߳беĵ i  CPU ϡ
+//
+// --limit-connects RATE[:BURST]  --limit-recv RATE[:BURST] ͻ IP ÿյֽ
+// --limit-unit messages ʱΪϢͰٱУ ../Common/RateLimiter.h
+// ĴС --limit-table ޶߳ accept ʣ߳ÿ recv ʣ
+// ʱ --limit-action delayֻÿһ̵߳ģʽô߳˯Ʋٶȡں˵Ľջ TCP ÿͻ˷
+// Ƿ³һ BURST հ drop 
+// drop رӣbusy ظ "BUSY" --framing ֡رӡhandoff ¼ѭֻ̳߳ģʽ´ڣ
+// ֻ drop  busyͬʡ
+//
+// ͨ ../Common/Platform.h  Linux ͬԱ룻Windows ϱʱȷ ws2_32.lib
 
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#include <windows.h>
+#include "../Common/Platform.h"
+#include "../Common/Logger.h"
+#include "../Common/Framing.h"
+#include "../Common/Gather.h"
+#include "../Common/Topology.h"
+#include "../Common/RateLimiter.h"
+#include <algorithm>
 #include <iostream>
 #include <thread>
 #include <vector>
+#include <deque>
+#include <memory>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
+#include <array>
+#include <cstdint>
+#include <csignal>
 #include <stdexcept>
 #include <string>
-
-#pragma comment(lib, "ws2_32.lib")
+#include <string_view>
+#include <cstdlib>
 
 // ------------------- RAII  -------------------------
 
@@ -74,105 +108,588 @@ private:
     SOCKET sock;
 };
 
+// -------------------  -------------------------
+
+// Ͳԣ̳߳й̶߳æʱδ
+enum class SaturationPolicy {
+    Queue,   // нУȴ߳̿Уʱͣ acceptں˵ļ
+    Reject,  // ر
+    Handoff  // ھ֪ͨ¼ѭ
+};
+
+// ServerConfigв
+struct ServerConfig {
+    int port{ 8888 };                                 // ˿
+    bool pool{ false };                               // falseÿһ̣߳true̶С̳߳
+    int workers{ 64 };                                // ̳߳شСʽͬʱ
+    size_t queueLimit{ 1024 };                        // Queue µȴе
+    SaturationPolicy policy{ SaturationPolicy::Queue };
+    LogLevel logLevel{ LogLevel::Debug };             // ־Debug ʱӡÿϢ
+    FrameMode framing{ FrameMode::Raw };              // Ϣķ֡ʽ
+    std::vector<int> cpus;                            // ̶̹߳ CPUΪʱ̶
+    RateLimit connectLimit;                           // ÿͻ IP ÿrate Ϊ 0 ʱ
+    RateLimit recvLimit;                              // ÿͻ IP ÿյֽrate Ϊ 0 ʱ
+    bool limitMessages{ false };                      // recvLimit մֽڼ
+    LimitAction limitAction{ LimitAction::Delay };    // ʱĴ
+    size_t limitEntries{ 65536 };                     // ÿٱĿÿ 16 ֽڣ
+};
+
+// ֡ʽ main ڽ֮ǰã˺ֻ
+static FrameMode g_framing = FrameMode::Raw;
+// ̶̹߳ CPUͬ main ڽ֮ǰ
+static std::vector<int> g_cpus;
+
+// Admissionͻ IP ١ main ڽ֮ǰã˺Աֻٱ
+struct Admission {
+    std::unique_ptr<RateLimiter> connects;        // ӵٱδʱΪ
+    std::unique_ptr<RateLimiter> receives;        // յٱδʱΪ
+    bool messages{ false };                       // receives Ϣֽڼ
+    LimitAction action{ LimitAction::Delay };
+    std::string busyReply;                        // busy ʱĻظ
+};
+static Admission g_admission;
+
+// ظǰ׺Ϊ̬Ļֱӷ
+constexpr std::string_view REPLY_PREFIX = "Server: ";
+
 // ------------------- ͻ˻Ự -------------------------
 
-// ClientSession ṹ壺ڱÿͻ˻ỰĴ̺߳һ finished ־
-// finished ־ڱʾûỰǷʹ std::shared_ptr<std::atomic<bool>> ڶ߳й״̬
-struct ClientSession {
-    std::thread thread; // ÿͻ˵߳
-    std::shared_ptr<std::atomic<bool>> finished; // Ựɱ־
-    ClientSession(std::thread&& t, std::shared_ptr<std::atomic<bool>> f)
-        : thread(std::move(t)), finished(f) {
-    }
+// SessionIdλ±Ӵλÿһδͼһ˹ڵ SessionId ָĻỰ
+struct SessionId {
+    uint32_t index;
+    uint32_t generation;
 };
 
-// ȫڱлԾĿͻ˻Ự
-std::vector<ClientSession> g_clientSessions;
-// ȫֻȫֻỰķ
-std::mutex g_sessionsMutex;
-// ڵлỰʱ֪ͨ߳
-std::condition_variable g_sessionCV;
+// SessionRegistry ࣺлԾỰĴ̣߳һִλ (generational slot map)
+// - ɾ O(1)вλȡͷɾŻرͷԾỰ޹ء
+// - λ̶СĿҴӲƶʱҪᶯе std::thread
+//   ĻỰ߳ҲԲطԼĲλ
+// - ỰʱԼ±ѹһջpublish_finished߳һȡ
+//   ֻɿձΪǿʱҪ̲߳ɨȫỰҲڳʱ join
+// slotsMutex ֻλе threadÿγеʱǳ
+class SessionRegistry {
+public:
+    // Ϊ»Ựλڵ makeThread(id) ̺߳λ
+    // ߳һʼ֪Լ SessionId߳̿ʱ̶߳ҲѾλ
+    // λþʱ false
+    template <typename MakeThread>
+    bool add(MakeThread&& makeThread) {
+        std::lock_guard<std::mutex> lock(slotsMutex);
+        if (freeHead == NO_SLOT && !grow())
+            return false;
+        uint32_t index = freeHead;
+        Slot& s = slot(index);
+        s.thread = makeThread(SessionId{ index, s.generation }); // ׳쳣ʱλڿ
+        freeHead = s.nextFree;
+        return true;
+    }
 
-// ------------------- Ự߳ -------------------------
+    // ɽĻỰ̵߳ãѲλѹѽԭΪʱ߳
+    void publish_finished(SessionId id) {
+        Slot& s = slot(id.index);
+        if (s.generation != id.generation)
+            return; // ڵ SessionId
+        uint32_t head = finishedHead.load(std::memory_order_relaxed);
+        do {
+            s.nextFinished = head;
+        } while (!finishedHead.compare_exchange_weak(head, id.index, std::memory_order_release, std::memory_order_relaxed));
+        if (head == NO_SLOT) {
+            // Ȼȡ wakeMutex ֪̲ͨ߳ڼ뿪ʼȴ֪֮ͨ
+            { std::lock_guard<std::mutex> lock(wakeMutex); }
+            finishedCV.notify_one();
+        }
+    }
 
-// session_cleaner ȴ֪ͨ󣬶ȫѽĻỰ join Ƴ
-// ˵߳ѯȴỰ֪ͨϱ
-void session_cleaner() {
-    while (true) {
-        std::unique_lock<std::mutex> lock(g_sessionsMutex);
-        // ȴֱһỰ
-        g_sessionCV.wait(lock, [] {
-            for (const auto& session : g_clientSessions) {
-                if (session.finished->load()) return true;
+    // ̣߳ȴỰ֪ͨȡѽղλ join ߳
+    void reap_forever() {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(wakeMutex);
+                finishedCV.wait(lock, [this] { return finishedHead.load(std::memory_order_relaxed) != NO_SLOT; });
             }
-            return false;
-            });
-        // ȫѽĻỰ
-        for (auto it = g_clientSessions.begin(); it != g_clientSessions.end(); ) {
-            if (it->finished->load()) {
-                if (it->thread.joinable()) {
-                    it->thread.join();
+            uint32_t index = finishedHead.exchange(NO_SLOT, std::memory_order_acquire);
+            while (index != NO_SLOT) {
+                Slot& s = slot(index);
+                uint32_t next = s.nextFinished;
+                std::thread finished;
+                {
+                    std::lock_guard<std::mutex> lock(slotsMutex);
+                    finished = std::move(s.thread);
+                    ++s.generation;
+                    s.nextFree = freeHead;
+                    freeHead = index;
                 }
-                it = g_clientSessions.erase(it);
-            }
-            else {
-                ++it;
+                // ߳Ѿϱjoin ֻȴأκ
+                if (finished.joinable())
+                    finished.join();
+                index = next;
             }
         }
     }
-}
 
+private:
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+    static constexpr uint32_t CHUNK_SIZE = 1024;   // ÿĲλ
+    static constexpr uint32_t MAX_CHUNKS = 1024;   // Լ 100 Ự
+
+    struct Slot {
+        std::thread thread;                        // ûỰ̣߳вλΪ
+        uint32_t generation{ 0 };                  // λõĴ
+        uint32_t nextFree{ NO_SLOT };              // еһλ
+        uint32_t nextFinished{ NO_SLOT };          // ѽеһλ
+    };
+
+    // ָڷκβλ֮ǰд룬֮ٸı䣬˿Բضȡ
+    std::array<std::unique_ptr<Slot[]>, MAX_CHUNKS> chunks;
+    uint32_t chunkCount{ 0 };
+    uint32_t freeHead{ NO_SLOT };
+    std::mutex slotsMutex;                  // ϳԱλе thread
+    std::atomic<uint32_t> finishedHead{ NO_SLOT };  // ѽջıͷ
+    std::mutex wakeMutex;
+    std::condition_variable finishedCV;            // ѽɿձΪǿ
+
+    Slot& slot(uint32_t index) {
+        return chunks[index / CHUNK_SIZE][index % CHUNK_SIZE];
+    }
+
+    // һ¿飬еĲλ±˳߳ slotsMutex
+    bool grow() {
+        if (chunkCount == MAX_CHUNKS)
+            return false;
+        chunks[chunkCount].reset(new Slot[CHUNK_SIZE]);
+        uint32_t base = chunkCount * CHUNK_SIZE;
+        for (uint32_t i = CHUNK_SIZE; i-- > 0;) {
+            chunks[chunkCount][i].nextFree = freeHead;
+            freeHead = base + i;
+        }
+        ++chunkCount;
+        return true;
+    }
+};
+
+// ȫֻỰע
+SessionRegistry g_sessions;
 // ------------------- ͻ˴߳ -------------------------
 
-// handle_client 뵥ͻ˵ͨš
+// admit_recv ӿͻ IP ĽͰп۳ costdelay ʱ waitMs Ϊظ֮ȴĺ
+// Ƿ³һ burst ʱ drop drop  busyȻظ "BUSY"ʱ false߹رӡ
+static bool admit_recv(uint64_t key, uint32_t cost, Socket& clientSocket, const char* clientIP, uint32_t& waitMs) {
+    waitMs = g_admission.receives->take(key, cost, RateLimiter::clockMs(), g_admission.action == LimitAction::Delay);
+    if (waitMs == 0 || (g_admission.action == LimitAction::Delay && waitMs != RateLimiter::REFUSED))
+        return true;
+    LOG_INFO_EVERY(100, "Receive rate limit exceeded by %s, closing.", clientIP);
+    if (g_admission.action == LimitAction::Busy)
+        send(clientSocket.get(), g_admission.busyReply.data(), static_cast<int>(g_admission.busyReply.size()), 0);
+    return false;
+}
+
+// serve_client ʽ뵥ͻ˵ͨţֱԷϿ
 // 1. տͻݣӡͻ IP/˿Ϣ
-// 2. ظʱǰ "Server:" ǰ׺
-// 3. Ựʱ finished ־ͨϱ
-// 
-//   clientSocket - ÿͻ˵ Socket 󣨷װ
-//   finished - Ựɱ־Ĺָ
-//   clientAddr - ͻ˵ַϢsockaddr_in
-void handle_client(Socket clientSocket, std::shared_ptr<std::atomic<bool>> finished, sockaddr_in clientAddr) {
+// 2.  g_framing ӽջԭؽϢÿϢظ "Server:" ǰ׺ͬʽϢ
+//    ظƴַɾ̬ǰ׺ָջϢɵĻΣһξۼͷ
+// 3. ˽ʱÿ recv ӿͻ IP Ͱп۳ϢʱΪϢ
+//    delayMs Ҫġһζȡǰĵȴ
+// ÿһ̵߳ģʽ̳߳صĹ̶߳ô˺
+void serve_client(Socket& clientSocket, const sockaddr_in& clientAddr, uint32_t delayMs) {
     // ͻ˵ַתΪַ־
     char clientIP[INET_ADDRSTRLEN];
     inet_ntop(AF_INET, &(clientAddr.sin_addr), clientIP, INET_ADDRSTRLEN);
-    std::cout << "Handling client " << clientIP << ":" << ntohs(clientAddr.sin_port) << std::endl;
+    LOG_INFO("Handling client %s:%d", clientIP, ntohs(clientAddr.sin_port));
+    uint64_t key = addressKey(clientAddr);
+    if (delayMs > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
 
     const int bufSize = 1024;
     char buffer[bufSize] = { 0 };
+    FrameDecoder decoder(g_framing);
+    GatherList reply;  // ϢãȶÿϢٷڴ
 
     // ͨѭݲظ
     while (true) {
-        int bytesReceived = recv(clientSocket.get(), buffer, bufSize - 1, 0);
+        int bytesReceived = recv(clientSocket.get(), buffer, bufSize, 0);
         if (bytesReceived > 0) {
-            buffer[bytesReceived] = '\0'; // ȷַ '\0' β
-            std::cout << "Received from " << clientIP << ": " << buffer << std::endl;
-            // ڻظǰ "Server:" ǰ׺
-            std::string response = "Server: " + std::string(buffer);
-            int bytesSent = send(clientSocket.get(), response.c_str(), (int)response.size(), 0);
-            if (bytesSent == SOCKET_ERROR) {
-                std::cerr << "send() failed with error: " << WSAGetLastError() << std::endl;
+            // delay ʱճνգظ֮ٵȴdrop  busy յݲرӡֽڼʱڽ֮ǰ۳
+            uint32_t waitMs = 0;
+            if (g_admission.receives && !g_admission.messages
+                && !admit_recv(key, static_cast<uint32_t>(bytesReceived), clientSocket, clientIP, waitMs))
+                break;
+            // Ϣֱָջ '\0' βյϢĻظϲΪһξۼ
+            reply.clear();
+            uint32_t messages = 0;
+            bool valid = decoder.feed(buffer, bytesReceived, [&](std::string_view message, std::string_view) {
+                ++messages;
+                LOG_DEBUG("Received from %s: %.*s", clientIP, static_cast<int>(message.size()), message.data());
+                // ڻظǰ "Server:" ǰ׺
+                appendFrame(reply, g_framing, REPLY_PREFIX, message);
+            });
+            if (!valid) {
+                LOG_WARN("Oversized frame from %s, closing.", clientIP);
+                break;
+            }
+            // Ϣʱ֪֮мʱɵĻظٷ
+            if (g_admission.receives && g_admission.messages && messages > 0
+                && !admit_recv(key, messages, clientSocket, clientIP, waitMs))
+                break;
+            if (!reply.empty() && !reply.sendAll(clientSocket.get())) {
+                LOG_WARN("send() failed with error: %d", WSAGetLastError());
                 break;
             }
+            // ֻյϢʱ reply Ϊգȴಿ֣ʱ˯Ʋ
+            if (waitMs > 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(waitMs));
         }
         else if (bytesReceived == 0) {
-            std::cout << "Client " << clientIP << " disconnected gracefully." << std::endl;
+            LOG_INFO("Client %s disconnected gracefully.", clientIP);
             break;
         }
         else {
-            std::cerr << "recv() failed with error: " << WSAGetLastError() << std::endl;
+            LOG_WARN("recv() failed with error: %d", WSAGetLastError());
             break;
         }
     }
-    // Ự finished ־֪ͨ߳
-    finished->store(true);
-    g_sessionCV.notify_one();
 }
 
+// pin_to_incoming_cpu ѵǰ̶̹߳ڽոݰ CPU ϣ CPU δ֪ g_cpus ʱ
+// ת̶ g_cpus еһ CPU ϡg_cpus ΪʱʲôҲ
+static void pin_to_incoming_cpu(SOCKET s) {
+    if (g_cpus.empty())
+        return;
+    static std::atomic<size_t> next{ 0 };
+    int cpu = incomingCpu(s);
+    if (std::find(g_cpus.begin(), g_cpus.end(), cpu) == g_cpus.end())
+        cpu = g_cpus[next.fetch_add(1, std::memory_order_relaxed) % g_cpus.size()];
+    if (!pinThread(cpu))
+        LOG_WARN("Failed to pin the thread to CPU %d.", cpu);
+}
+
+// handle_client ÿһ߳ģʽµ̺߳
+// ỰʱͨỰעϱ
+// 
+//   clientSocket - ÿͻ˵ Socket 󣨷װ
+//   id - ûỰ g_sessions е SessionId
+//   clientAddr - ͻ˵ַϢsockaddr_in
+//   delayMs - Ҫġһζȡǰĵȴ룩
+void handle_client(Socket clientSocket, SessionId id, sockaddr_in clientAddr, uint32_t delayMs) {
+    pin_to_incoming_cpu(clientSocket.get());
+    serve_client(clientSocket, clientAddr, delayMs);
+    // Ựȹر׽֣ϱԱ߳ join ̲߳ղλ
+    clientSocket = Socket();
+    g_sessions.publish_finished(id);
+}
+
+// ------------------- ֪ͨ¼ѭhandoff ԣ -------------------------
+
+// ReadinessLoop ࣺһ߳ WSAPoll ȴез׽ֻ֣׽ֿɶдʱŵ recv/send
+// һ̼߳ɷӣÿֶҪȫ׽ֽں˼һ顣
+// ظֱӴӽջۼͣûһηʱʣಿֲŸƵ output У֮ǰٶȡӡ
+class ReadinessLoop {
+public:
+    ReadinessLoop() {
+        std::thread(&ReadinessLoop::run, this).detach(); // ͬ
+    }
+
+    // ̵߳ãӽ¼ѭһֵȴʱЧ
+    void add(Socket clientSocket, const sockaddr_in& clientAddr) {
+        if (!setNonBlocking(clientSocket.get())) {
+            LOG_WARN("setNonBlocking() failed with error: %d", WSAGetLastError());
+            return;
+        }
+        std::lock_guard<std::mutex> lock(incomingMutex);
+        incoming.emplace_back(std::move(clientSocket), clientAddr);
+    }
+
+private:
+    // ȴôòűһ WSAPoll
+    static constexpr int POLL_INTERVAL_MS = 10;
+
+    struct Conn {
+        Conn(Socket s, const sockaddr_in& addr) : socket(std::move(s)), decoder(g_framing), key(addressKey(addr)) {
+            inet_ntop(AF_INET, &addr.sin_addr, ip, INET_ADDRSTRLEN);
+        }
+        Socket socket;
+        FrameDecoder decoder; // Խ recv İϢ
+        uint64_t key;        // ͻ˵ַٱеļ
+        char ip[INET_ADDRSTRLEN]; // ־
+        std::string output;  // δĻظ
+        size_t sent{ 0 };    // output ѷֽ
+    };
+
+    std::mutex incomingMutex;
+    std::vector<std::pair<Socket, sockaddr_in>> incoming;
+
+    void run() {
+        std::vector<Conn> conns;
+        std::vector<WSAPOLLFD> fds;
+        char buffer[1024];
+        GatherList reply;
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(incomingMutex);
+                for (auto& [s, addr] : incoming)
+                    conns.emplace_back(std::move(s), addr);
+                incoming.clear();
+            }
+            if (conns.empty()) {
+                // WSAPoll ܿ
+                std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+                continue;
+            }
+            fds.resize(conns.size());
+            for (size_t i = 0; i < conns.size(); ++i) {
+                fds[i].fd = conns[i].socket.get();
+                fds[i].events = conns[i].output.empty() ? POLLIN : POLLOUT;
+                fds[i].revents = 0;
+            }
+            int ready = WSAPoll(fds.data(), static_cast<ULONG>(fds.size()), POLL_INTERVAL_MS);
+            if (ready == SOCKET_ERROR) {
+                LOG_ERROR("WSAPoll() failed with error: %d", WSAGetLastError());
+                continue;
+            }
+            // ӺǰرյĩβԪؽƳ
+            for (size_t i = conns.size(); ready > 0 && i-- > 0;) {
+                if (fds[i].revents == 0)
+                    continue;
+                --ready;
+                if (!service(conns[i], buffer, sizeof(buffer), reply)) {
+                    std::swap(conns[i], conns.back());
+                    conns.pop_back();
+                }
+            }
+        }
+    }
+
+    // һӣ false ʾѽ
+    //  serve_client ֽͬڼʱڽ֮ǰ۳Ϣʱڽ֮۳
+    // ¼ѭֻ̳߳ģʽֻ drop  busyʱرӣ˯ߡ
+    static bool service(Conn& c, char* buffer, int bufSize, GatherList& reply) {
+        if (c.output.empty()) {
+            int bytesReceived = recv(c.socket.get(), buffer, bufSize, 0);
+            if (bytesReceived == 0)
+                return false;
+            if (bytesReceived < 0)
+                return WSAGetLastError() == WSAEWOULDBLOCK;
+            uint32_t waitMs = 0;
+            if (g_admission.receives && !g_admission.messages
+                && !admit_recv(c.key, static_cast<uint32_t>(bytesReceived), c.socket, c.ip, waitMs))
+                return false;
+            reply.clear();
+            uint32_t messages = 0;
+            bool valid = c.decoder.feed(buffer, bytesReceived, [&](std::string_view message, std::string_view) {
+                ++messages;
+                appendFrame(reply, g_framing, REPLY_PREFIX, message);
+            });
+            if (!valid)
+                return false;
+            if (g_admission.receives && g_admission.messages && messages > 0
+                && !admit_recv(c.key, messages, c.socket, c.ip, waitMs))
+                return false;
+            while (reply.remaining() > 0) {
+                int bytesSent = reply.sendSome(c.socket.get());
+                if (bytesSent == SOCKET_ERROR) {
+                    LOG_WARN("send() failed with error: %d", WSAGetLastError());
+                    return false;
+                }
+                if (bytesSent == 0)
+                    break; // ʱд
+            }
+            // ջҪãûĲָƳȴд
+            reply.appendRemaining(c.output);
+            c.sent = 0;
+            return true;
+        }
+        while (c.sent < c.output.size()) {
+            int bytesSent = send(c.socket.get(), c.output.data() + c.sent, (int)(c.output.size() - c.sent), 0);
+            if (bytesSent == SOCKET_ERROR) {
+                if (WSAGetLastError() == WSAEWOULDBLOCK)
+                    return true; // ȴд
+                LOG_WARN("send() failed with error: %d", WSAGetLastError());
+                return false;
+            }
+            c.sent += bytesSent;
+        }
+        c.output.clear();
+        return true;
+    }
+};
+
+// ------------------- н̳߳ -------------------------
+
+// WorkerPool ̶ࣺĹ̴߳ӹȡӣʽӽȡһ
+// idle ¼ڵȴ߳гȲС idle ʱ˵̳߳ѱͣӰͲԴ
+class WorkerPool {
+public:
+    WorkerPool(const ServerConfig& config, ReadinessLoop* handoffLoop)
+        : queueLimit(config.queueLimit), policy(config.policy), handoff(handoffLoop) {
+        for (int i = 0; i < config.workers; ++i) {
+            //  i ̶̹߳ --cpus еĵ i  CPU ϣбת
+            int cpu = config.cpus.empty() ? -1 : config.cpus[static_cast<size_t>(i) % config.cpus.size()];
+            std::thread(&WorkerPool::worker, this, cpu).detach(); // ͬ
+        }
+    }
+
+    // ̵߳ãӽ̳߳ءQueue ڶʱֱпλ
+    void submit(Socket clientSocket, const sockaddr_in& clientAddr) {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        if (queue.size() < idle) {
+            queue.push_back(PendingClient{ std::move(clientSocket), clientAddr });
+            workAvailable.notify_one();
+            return;
+        }
+        switch (policy) {
+        case SaturationPolicy::Queue:
+            spaceAvailable.wait(lock, [this] { return queue.size() < queueLimit || queue.size() < idle; });
+            queue.push_back(PendingClient{ std::move(clientSocket), clientAddr });
+            workAvailable.notify_one();
+            break;
+        case SaturationPolicy::Reject:
+            lock.unlock();
+            // ʱÿܾӶߵ¼־ˢ
+            LOG_INFO_EVERY(100, "All workers busy, rejecting connection.");
+            break; // clientSocket ʱر
+        case SaturationPolicy::Handoff:
+            lock.unlock();
+            handoff->add(std::move(clientSocket), clientAddr);
+            break;
+        }
+    }
+
+private:
+    // ȴ̵߳
+    struct PendingClient {
+        Socket socket;
+        sockaddr_in addr;
+    };
+
+    std::mutex queueMutex;                       // ³Ա
+    std::condition_variable workAvailable;       // 
+    std::condition_variable spaceAvailable;      // пλ
+    std::deque<PendingClient> queue;
+    size_t idle{ 0 };
+    size_t queueLimit;
+    SaturationPolicy policy;
+    ReadinessLoop* handoff;
+
+    void worker(int cpu) {
+        if (cpu >= 0 && !pinThread(cpu))
+            LOG_WARN("Failed to pin worker to CPU %d.", cpu);
+        while (true) {
+            PendingClient client;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                ++idle;
+                workAvailable.wait(lock, [this] { return !queue.empty(); });
+                --idle;
+                client = std::move(queue.front());
+                queue.pop_front();
+                spaceAvailable.notify_one();
+            }
+            // ̳߳ģʽ delay main̲߳Ϊ˯
+            serve_client(client.socket, client.addr, 0);
+        }
+    }
+};
+
 // -------------------  -------------------------
 
-int main() {
+// в
+static bool parse_args(int argc, char* argv[], ServerConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--port" && hasValue)
+            config.port = std::atoi(argv[++i]);
+        else if (arg == "--pool")
+            config.pool = true;
+        else if (arg == "--workers" && hasValue)
+            config.workers = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--queue" && hasValue)
+            config.queueLimit = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        else if (arg == "--saturation" && hasValue) {
+            std::string policy = argv[++i];
+            if (policy == "queue")
+                config.policy = SaturationPolicy::Queue;
+            else if (policy == "reject")
+                config.policy = SaturationPolicy::Reject;
+            else if (policy == "handoff")
+                config.policy = SaturationPolicy::Handoff;
+            else
+                return false;
+        }
+        else if (arg == "--framing" && hasValue) {
+            if (!parseFrameMode(argv[++i], config.framing))
+                return false;
+        }
+        else if (arg == "--cpus" && hasValue) {
+            if (!parseCpuList(argv[++i], config.cpus))
+                return false;
+            for (int cpu : config.cpus) {
+                if (cpu >= CpuTopology::instance().cpuCount()) {
+                    std::cerr << "CPU " << cpu << " does not exist." << std::endl;
+                    return false;
+                }
+            }
+        }
+        else if ((arg == "--limit-connects" || arg == "--limit-recv") && hasValue) {
+            if (!parseRateLimit(argv[++i], arg == "--limit-connects" ? config.connectLimit : config.recvLimit))
+                return false;
+        }
+        else if (arg == "--limit-unit" && hasValue) {
+            std::string unit = argv[++i];
+            if (unit != "bytes" && unit != "messages")
+                return false;
+            config.limitMessages = unit == "messages";
+        }
+        else if (arg == "--limit-action" && hasValue) {
+            if (!parseLimitAction(argv[++i], config.limitAction))
+                return false;
+        }
+        else if (arg == "--limit-table" && hasValue)
+            config.limitEntries = std::max<size_t>(RateLimiter::WAYS, std::strtoull(argv[++i], nullptr, 10));
+        else if (arg == "--quiet")
+            config.logLevel = LogLevel::Warn;
+        else if (arg == "--log-level" && hasValue) {
+            if (!parseLogLevel(argv[++i], config.logLevel))
+                return false;
+        }
+        else
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
     try {
+        ServerConfig config;
+        if (!parse_args(argc, argv, config)) {
+            std::cerr << "Usage: " << argv[0]
+                << " [--port N] [--pool] [--workers N] [--queue N] [--saturation queue|reject|handoff]" << std::endl
+                << "       [--framing raw|length|line] [--cpus LIST] [--log-level debug|info|warn|error|off] [--quiet]" << std::endl
+                << "       [--limit-connects RATE[:BURST]] [--limit-recv RATE[:BURST]] [--limit-unit bytes|messages]" << std::endl
+                << "       [--limit-action delay|drop|busy] [--limit-table N]" << std::endl;
+            return 1;
+        }
+        // delay ô߳˯ߣ̳߳ģʽһõ IP й߳˯ţͻ
+        if (config.pool && config.limitAction == LimitAction::Delay
+            && (config.connectLimit.rate > 0 || config.recvLimit.rate > 0)) {
+            std::cerr << "--limit-action delay sleeps the handler thread, so in --pool mode one client could park every worker;"
+                " use --limit-action drop or busy." << std::endl;
+            return 1;
+        }
+        Logger::instance().setLevel(config.logLevel);
+        g_framing = config.framing;
+        g_cpus = config.cpus;
+        if (config.connectLimit.rate > 0)
+            g_admission.connects = std::make_unique<RateLimiter>(config.limitEntries, config.connectLimit);
+        if (config.recvLimit.rate > 0)
+            g_admission.receives = std::make_unique<RateLimiter>(config.limitEntries, config.recvLimit);
+        g_admission.messages = config.limitMessages;
+        g_admission.action = config.limitAction;
+        appendFrame(g_admission.busyReply, config.framing, "", "BUSY");
+#ifndef _WIN32
+        // ѶϿĿͻ send ʱشֹ
+        std::signal(SIGPIPE, SIG_IGN);
+#endif
+
         WSAInitializer wsa; // ʼ WinSock
 
         //  socket
@@ -181,11 +698,17 @@ int main() {
             throw std::runtime_error("socket() failed with error: " + std::to_string(WSAGetLastError()));
         }
 
-        // ÷ַַ˿ 8888
+#ifndef _WIN32
+        // Linux Windows  SO_REUSEADDR 岻ͬʹã
+        int reuse = 1;
+        setsockopt(listenSocket.get(), SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+
+        // ÷ַַĬ϶˿ 8888
         sockaddr_in serverAddr{};
         serverAddr.sin_family = AF_INET;
         serverAddr.sin_addr.s_addr = INADDR_ANY;
-        serverAddr.sin_port = htons(8888);
+        serverAddr.sin_port = htons(static_cast<unsigned short>(config.port));
 
         // 󶨼 socket
         if (bind(listenSocket.get(), reinterpret_cast<sockaddr*>(&serverAddr), sizeof(serverAddr)) == SOCKET_ERROR) {
@@ -197,38 +720,66 @@ int main() {
             throw std::runtime_error("listen() failed with error: " + std::to_string(WSAGetLastError()));
         }
 
-        std::cout << "Server is listening on port 8888..." << std::endl;
+        std::cout << "Server is listening on port " << config.port << "..." << std::endl;
 
-        // Ự̣߳ϱỰ
-        std::thread cleanerThread(session_cleaner);
-        cleanerThread.detach(); // ̣߳ʱ޳
+        // ̳߳ģʽhandoff ԶҪһ¼ѭ
+        std::unique_ptr<ReadinessLoop> handoffLoop;
+        std::unique_ptr<WorkerPool> pool;
+        if (config.pool) {
+            if (config.policy == SaturationPolicy::Handoff)
+                handoffLoop = std::make_unique<ReadinessLoop>();
+            pool = std::make_unique<WorkerPool>(config, handoffLoop.get());
+        }
+        else {
+            // Ự̣߳ϱỰ
+            std::thread cleanerThread(&SessionRegistry::reap_forever, &g_sessions);
+            cleanerThread.detach(); // ̣߳ʱ޳
+        }
 
         // ѭȴ
         while (true) {
             sockaddr_in clientAddr{};
-            int clientAddrLen = sizeof(clientAddr);
+            socklen_t clientAddrLen = sizeof(clientAddr);
             // ӣȡͻ˵ַϢ
             SOCKET clientSock = accept(listenSocket.get(), reinterpret_cast<sockaddr*>(&clientAddr), &clientAddrLen);
             if (clientSock == INVALID_SOCKET) {
-                std::cerr << "accept() failed with error: " << WSAGetLastError() << std::endl;
+                LOG_ERROR("accept() failed with error: %d", WSAGetLastError());
                 std::this_thread::sleep_for(std::chrono::milliseconds(100));
                 continue;
             }
-            // ͻ˵ַתΪַڴӡ
-            char clientIP[INET_ADDRSTRLEN];
-            inet_ntop(AF_INET, &(clientAddr.sin_addr), clientIP, INET_ADDRSTRLEN);
-            std::cout << "Accepted new connection from " << clientIP << ":" << ntohs(clientAddr.sin_port) << std::endl;
+            if (Logger::instance().enabled(LogLevel::Info)) {
+                // ͻ˵ַתΪַڴӡ
+                char clientIP[INET_ADDRSTRLEN];
+                inet_ntop(AF_INET, &(clientAddr.sin_addr), clientIP, INET_ADDRSTRLEN);
+                LOG_INFO("Accepted new connection from %s:%d", clientIP, ntohs(clientAddr.sin_port));
+            }
 
-            // ΪӴ finished ־ʼΪ false
-            auto finishedFlag = std::make_shared<std::atomic<bool>>(false);
-            // ÿͻ˵̣߳ Socketfinished ־Ϳͻ˵ַϢ
-            std::thread t(handle_client, Socket(clientSock), finishedFlag, clientAddr);
+            // ͻ IP ʡdelay ʱճܣɴ߳ڵһζȡǰȴǷ³һ burst ʱܾ
+            uint32_t delayMs = 0;
+            if (g_admission.connects) {
+                delayMs = g_admission.connects->take(addressKey(clientAddr), 1,
+                    RateLimiter::clockMs(), g_admission.action == LimitAction::Delay);
+                if (delayMs > 0 && (g_admission.action != LimitAction::Delay || delayMs == RateLimiter::REFUSED)) {
+                    LOG_INFO_EVERY(100, "Connection rate limit exceeded, closing connection.");
+                    if (g_admission.action == LimitAction::Busy)
+                        send(clientSock, g_admission.busyReply.data(), static_cast<int>(g_admission.busyReply.size()), 0);
+                    closesocket(clientSock);
+                    continue;
+                }
+            }
 
-            // µĿͻ˻Ựȫں
-            {
-                std::lock_guard<std::mutex> lock(g_sessionsMutex);
-                g_clientSessions.emplace_back(std::move(t), finishedFlag);
+            if (pool) {
+                pool->submit(Socket(clientSock), clientAddr);
+                continue;
             }
+
+            // ÿͻ˵̲߳ǼǵỰע SocketSessionId Ϳͻ˵ַϢ
+            Socket clientSocket(clientSock);
+            bool added = g_sessions.add([&](SessionId id) {
+                return std::thread(handle_client, std::move(clientSocket), id, clientAddr, delayMs);
+                });
+            if (!added)
+                LOG_ERROR("Too many sessions, closing connection.");
         }
     }
     catch (const std::exception& ex) {
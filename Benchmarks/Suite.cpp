@@ -0,0 +1,809 @@
+// Suite.cpp
+// 跨代基准测试套件：以子进程方式依次启动各代服务器模型，在回环上施加相同的负载，输出可解析的结果并与基线比较
+// Cross-generation benchmark suite: start every server model in turn as a child process, apply
+// the same workloads over loopback, print machine-readable results and compare them with a baseline.
+//
+// 负载 / Workloads:
+//   churn     短连接：连接、回显一条消息、关闭，延迟为整个会话 / Short sessions: connect, echo one message, close; latency covers the whole session
+//   idle      保持 --idle 个空闲连接，另有 --active 个连接做 ping-pong / Hold --idle idle connections while --active connections ping-pong
+//   pingpong  --connections 个连接，每个连接一问一答的小消息 / --connections connections, one small message in flight on each
+//   bulk      --bulk-connections 个连接持续发送 --bulk-payload 字节的帧，每个连接最多 --bulk-window 个在途
+//             --bulk-connections connections stream --bulk-payload-byte frames, at most --bulk-window in flight on each
+//
+// 所有服务器以 --framing length 运行，因此大消息也按帧回显，回复长度可以预知。
+// Every server runs with --framing length, so large messages are echoed frame by frame and the
+// reply length is known in advance.
+//
+// 用法 / Usage:
+//   Suite [--server03 PATH] [--server03co PATH] [--server04 PATH] [--models A,B,...] [--workloads A,B,...] [--seconds S] [--warmup S]
+//         [--threads N] [--port N] [--payload BYTES] [--connections N] [--idle N] [--active N] [--churn-threads N]
+//         [--bulk-payload BYTES] [--bulk-connections N] [--bulk-window N] [--save FILE] [--baseline FILE] [--tolerance F]
+
+#include "../Common/Process.h"
+#include "../Common/Framing.h"
+#include "../Common/Histogram.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+// 套件配置 / Suite configuration
+struct SuiteConfig {
+#ifdef _WIN32
+    std::string server03{ "../03 IOCP Asynchronous Single-threaded Server -- Handle Error/Server.exe" };
+    std::string server03co{ "../03 IOCP Asynchronous Single-threaded Server -- Handle Error/CoServer.exe" };
+    std::string server04{ "../04 Synchronous Multi-threaded TCP echo/Server.exe" };
+    std::vector<std::string> models{ "03-iocp", "04-thread", "04-pool" };
+#else
+    std::string server03{ "../03 IOCP Asynchronous Single-threaded Server -- Handle Error/Server" };
+    std::string server03co{ "../03 IOCP Asynchronous Single-threaded Server -- Handle Error/CoServer" };
+    std::string server04{ "../04 Synchronous Multi-threaded TCP echo/Server" };
+    std::vector<std::string> models{ "03-epoll", "03-uring", "04-thread", "04-pool" };
+#endif
+    std::vector<std::string> workloads{ "churn", "idle", "pingpong", "bulk" };
+    int port{ 9890 };
+    int seconds{ 5 };
+    int warmup{ 1 };
+    int threads{ static_cast<int>(std::max(1u, std::thread::hardware_concurrency())) };  // 服务器工作线程 / Server worker threads
+    int payload{ 64 };
+    int connections{ 64 };
+    int idle{ 2000 };
+    int active{ 8 };
+    int churnThreads{ 4 };
+    int bulkPayload{ 65536 };
+    int bulkConnections{ 4 };
+    int bulkWindow{ 4 };
+    std::string save;                       // 把结果写为新基线 / Write the results as a new baseline
+    std::string baseline;                   // 与之比较的基线 / Baseline to compare against
+    double tolerance{ 0.25 };               // 超过该相对变化视为退化 / Relative change beyond which a metric counts as regressed
+};
+
+// 被测的服务器模型 / A server model under test
+struct ServerModel {
+    std::string name;
+    std::vector<std::string> args;          // args[0] 为可执行文件 / args[0] is the executable
+    int replyExtra{ 0 };                    // 回复帧比请求帧多出的字节（04 的 "Server: "）/ Extra bytes per reply frame (04's "Server: ")
+};
+
+// 一次 (模型, 负载) 运行的结果 / Result of one (model, workload) run
+struct SuiteResult {
+    std::string model;
+    std::string workload;
+    uint64_t ops{ 0 };                      // 测量窗口内完成的消息或会话 / Messages or sessions completed in the window
+    uint64_t bytes{ 0 };                    // 其中回显的载荷字节 / Payload bytes echoed in them
+    double seconds{ 0 };
+    double cpuSeconds{ 0 };                 // 服务器在窗口内消耗的 CPU 时间 / Server CPU time used in the window
+    size_t rssBytes{ 0 };                   // 窗口结束时服务器的常驻内存 / Server resident memory at the end of the window
+    uint64_t errors{ 0 };
+    uint64_t stalls{ 0 };                   // 超时未到的回复，非零即判本次运行失败 / Replies that timed out; any fails the run
+    Histogram latency;                      // 纳秒 / Nanoseconds
+
+    double opsPerSecond() const { return seconds > 0 ? ops / seconds : 0; }
+    double mbPerSecond() const { return seconds > 0 ? bytes / seconds / 1e6 : 0; }
+    double cpuUsPerOp() const { return ops ? cpuSeconds * 1e6 / ops : 0; }
+};
+
+static std::vector<std::string> splitList(const std::string& value) {
+    std::vector<std::string> items;
+    std::istringstream list(value);
+    std::string item;
+    while (std::getline(list, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+static bool makeModel(const SuiteConfig& cfg, const std::string& name, ServerModel& model) {
+    std::string port = std::to_string(cfg.port);
+    std::string threads = std::to_string(cfg.threads);
+    model.name = name;
+    if (name == "03-iocp" || name == "03-epoll" || name == "03-uring") {
+        model.args = { cfg.server03, "--port", port, "--engine", name.substr(3), "--threads", threads, "--framing", "length", "--quiet" };
+        model.replyExtra = 0;
+    }
+    else if (name == "03co-iocp" || name == "03co-epoll" || name == "03co-uring") {
+        model.args = { cfg.server03co, "--port", port, "--engine", name.substr(5), "--threads", threads, "--framing", "length", "--quiet" };
+        model.replyExtra = 0;
+    }
+    else if (name == "04-thread") {
+        model.args = { cfg.server04, "--port", port, "--framing", "length", "--quiet" };
+        model.replyExtra = 8;
+    }
+    else if (name == "04-pool") {
+        // 空闲连接交给就绪循环，否则 idle 负载会占满整个线程池 / Idle connections go to the readiness loop, or the idle workload would pin the whole pool
+        model.args = { cfg.server04, "--port", port, "--pool", "--workers", "64", "--saturation", "handoff", "--framing", "length", "--quiet" };
+        model.replyExtra = 8;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+// ------------------------------ 套接字辅助 / Socket helpers ------------------------------
+
+// 把打开文件数上限提到硬上限并返回可用的套接字数 / Raise the open-file limit to the hard limit and return the usable socket count
+static int raiseSocketLimit() {
+#ifdef _WIN32
+    return 1 << 30;
+#else
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0)
+        return 1024;
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    getrlimit(RLIMIT_NOFILE, &limit);
+    return static_cast<int>(std::min<rlim_t>(limit.rlim_cur, 1 << 30));
+#endif
+}
+
+static sockaddr_in serverAddress(int port) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<unsigned short>(port));
+    InetPtonA(AF_INET, "127.0.0.1", &addr.sin_addr);
+    return addr;
+}
+
+// 阻塞连接；先绑定 127.0.0.(1 + index % 16)，分散临时端口与 TIME_WAIT
+// Blocking connect, bound to 127.0.0.(1 + index % 16) first to spread ephemeral ports and TIME_WAIT.
+static SOCKET connectTo(int port, uint64_t index) {
+    SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == INVALID_SOCKET)
+        return INVALID_SOCKET;
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    std::string localIp = "127.0.0." + std::to_string(1 + index % 16);
+    InetPtonA(AF_INET, localIp.c_str(), &local.sin_addr);
+    bind(s, reinterpret_cast<sockaddr*>(&local), sizeof(local));
+    sockaddr_in addr = serverAddress(port);
+    if (connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR) {
+        closesocket(s);
+        return INVALID_SOCKET;
+    }
+    setNoDelay(s);
+    return s;
+}
+
+// 非阻塞地每批发起 256 个连接并等待完成，用于大量空闲连接；失败的计入 failed
+// Open many connections with non-blocking connects, 256 per batch; failures are added to failed.
+static std::vector<SOCKET> connectMany(int port, int count, uint64_t& failed) {
+    constexpr int CONNECT_BATCH = 256;
+    sockaddr_in addr = serverAddress(port);
+    std::vector<SOCKET> connected;
+    for (int first = 0; first < count; first += CONNECT_BATCH) {
+        std::vector<SOCKET> pending;
+        for (int i = first; i < std::min(count, first + CONNECT_BATCH); ++i) {
+            SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            if (s == INVALID_SOCKET) {
+                ++failed;
+                continue;
+            }
+            sockaddr_in local{};
+            local.sin_family = AF_INET;
+            std::string localIp = "127.0.0." + std::to_string(1 + i % 16);
+            InetPtonA(AF_INET, localIp.c_str(), &local.sin_addr);
+            bind(s, reinterpret_cast<sockaddr*>(&local), sizeof(local));
+            setNonBlocking(s);
+            if (connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR) {
+                int err = WSAGetLastError();
+#ifdef _WIN32
+                bool inProgress = err == WSAEWOULDBLOCK;
+#else
+                bool inProgress = err == EINPROGRESS;
+#endif
+                if (!inProgress) {
+                    ++failed;
+                    closesocket(s);
+                    continue;
+                }
+            }
+            pending.push_back(s);
+        }
+        auto deadline = Clock::now() + std::chrono::seconds(5);
+        while (!pending.empty() && Clock::now() < deadline) {
+            std::vector<WSAPOLLFD> polls(pending.size());
+            for (size_t i = 0; i < pending.size(); ++i) {
+                polls[i].fd = pending[i];
+                polls[i].events = POLLOUT;
+            }
+            if (WSAPoll(polls.data(), static_cast<ULONG>(polls.size()), 100) <= 0)
+                continue;
+            std::vector<SOCKET> still;
+            for (size_t i = 0; i < pending.size(); ++i) {
+                if (polls[i].revents == 0) {
+                    still.push_back(pending[i]);
+                    continue;
+                }
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(pending[i], SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&err), &len);
+                if (err == 0 && !(polls[i].revents & (POLLERR | POLLHUP))) {
+                    connected.push_back(pending[i]);
+                }
+                else {
+                    ++failed;
+                    closesocket(pending[i]);
+                }
+            }
+            pending.swap(still);
+        }
+        failed += pending.size();
+        for (SOCKET s : pending)
+            closesocket(s);
+    }
+    return connected;
+}
+
+static bool sendAll(SOCKET s, const char* data, size_t len) {
+    while (len > 0) {
+        int n = send(s, data, static_cast<int>(std::min<size_t>(len, 1 << 30)), 0);
+        if (n <= 0)
+            return false;
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// 回复的每一段都须在该时间内到达，否则视为服务器停滞，避免一个卡住的服务器挂起整个套件
+// Every piece of a reply must arrive within this time, or the server counts as stalled; a stuck
+// server must not hang the whole suite.
+static constexpr int REPLY_TIMEOUT_MS = 10000;
+
+enum class Reply { Complete, Failed, Stalled };
+
+// 停滞时关闭套接字的两个方向，使阻塞在 send 上的线程也能返回
+// On a stall, shut down both directions of the socket so a thread blocked in send returns too.
+static Reply recvAll(SOCKET s, char* data, size_t len) {
+    while (len > 0) {
+        WSAPOLLFD poll{};
+        poll.fd = s;
+        poll.events = POLLIN;
+        if (WSAPoll(&poll, 1, REPLY_TIMEOUT_MS) == 0) {
+            shutdown(s, SD_BOTH);
+            return Reply::Stalled;
+        }
+        int n = recv(s, data, static_cast<int>(std::min<size_t>(len, 1 << 30)), 0);
+        if (n <= 0)
+            return Reply::Failed;
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return Reply::Complete;
+}
+
+static uint64_t elapsedNs(Clock::time_point since) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - since).count());
+}
+
+// ------------------------------ 测量窗口 / Measurement window ------------------------------
+
+// 客户端线程在预热期间就开始施压，只有 recording 为 true 时才计数；窗口两端记录服务器的 CPU 时间，结束时记录常驻内存
+// Client threads apply load from the start of the warm-up but only count while recording is set.
+// The server's CPU time is sampled at both ends of the window and its resident memory at the end.
+class Window {
+public:
+    Window(const SuiteConfig& c, ChildProcess& s, int clientThreads) : cfg(c), server(s), histograms(static_cast<size_t>(clientThreads)) {}
+
+    std::atomic<bool> recording{ false };
+    std::atomic<bool> stop{ false };
+
+    // 线程 i 完成了一次操作 / Thread i completed one operation
+    void complete(size_t i, uint64_t latencyNs, uint64_t bytes) {
+        if (!recording.load(std::memory_order_relaxed))
+            return;
+        histograms[i].record(latencyNs);
+        counters[i % COUNTER_SLOTS].bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void error() { errors.fetch_add(1, std::memory_order_relaxed); }
+
+    // 一次回复未能收齐 / A reply did not arrive in full
+    void error(Reply reply) {
+        error();
+        if (reply == Reply::Stalled)
+            stalls.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 在主线程上运行预热和测量，然后通知客户端线程停止 / Run the warm-up and the measurement on the main thread, then tell the client threads to stop
+    void run(SuiteResult& result) {
+        std::this_thread::sleep_for(std::chrono::seconds(cfg.warmup));
+        double cpuBefore = server.cpuSeconds();
+        auto begin = Clock::now();
+        recording = true;
+        std::this_thread::sleep_for(std::chrono::seconds(cfg.seconds));
+        recording = false;
+        result.seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+        result.cpuSeconds = server.cpuSeconds() - cpuBefore;
+        result.rssBytes = server.residentBytes();
+        stop = true;
+    }
+
+    // 客户端线程结束后汇总 / Collect once the client threads have finished
+    void collect(SuiteResult& result) {
+        for (const Histogram& h : histograms)
+            result.latency.add(h);
+        result.ops = result.latency.count();
+        for (const Counter& c : counters)
+            result.bytes += c.bytes.load();
+        result.errors += errors.load();
+        result.stalls += stalls.load();
+    }
+
+private:
+    static constexpr size_t COUNTER_SLOTS = 16;
+    struct alignas(64) Counter {
+        std::atomic<uint64_t> bytes{ 0 };
+    };
+
+    const SuiteConfig& cfg;
+    ChildProcess& server;
+    std::vector<Histogram> histograms;      // 每个客户端线程一个 / One per client thread
+    Counter counters[COUNTER_SLOTS];
+    std::atomic<uint64_t> errors{ 0 };
+    std::atomic<uint64_t> stalls{ 0 };
+};
+
+// ------------------------------ 负载 / Workloads ------------------------------
+
+// 每个套接字一个线程，一问一答直到窗口结束 / One thread per socket, one request and reply at a time until the window ends
+static void pingPong(Window& window, const std::vector<SOCKET>& sockets, const std::string& request, size_t replySize, size_t payload) {
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < sockets.size(); ++i) {
+        threads.emplace_back([&, i] {
+            std::vector<char> reply(replySize);
+            while (!window.stop.load(std::memory_order_relaxed)) {
+                auto begin = Clock::now();
+                if (!sendAll(sockets[i], request.data(), request.size())) {
+                    window.error();
+                    return;
+                }
+                Reply r = recvAll(sockets[i], reply.data(), reply.size());
+                if (r != Reply::Complete) {
+                    window.error(r);
+                    return;
+                }
+                window.complete(i, elapsedNs(begin), payload);
+            }
+        });
+    }
+    for (std::thread& t : threads)
+        t.join();
+}
+
+static void runPingPong(const SuiteConfig& cfg, const ServerModel& model, ChildProcess& server, SuiteResult& result) {
+    std::string request;
+    appendFrame(request, FrameMode::Length, {}, std::string(static_cast<size_t>(cfg.payload), 'x'));
+    std::vector<SOCKET> sockets;
+    for (int i = 0; i < cfg.connections; ++i) {
+        SOCKET s = connectTo(cfg.port, static_cast<uint64_t>(i));
+        if (s == INVALID_SOCKET)
+            ++result.errors;
+        else
+            sockets.push_back(s);
+    }
+    Window window(cfg, server, static_cast<int>(sockets.size()));
+    std::thread load([&] { pingPong(window, sockets, request, request.size() + model.replyExtra, cfg.payload); });
+    window.run(result);
+    load.join();
+    window.collect(result);
+    for (SOCKET s : sockets)
+        closesocket(s);
+}
+
+static void runIdle(const SuiteConfig& cfg, const ServerModel& model, ChildProcess& server, SuiteResult& result) {
+    // 两端各占一个描述符，另留一些余量 / Both ends take a descriptor each, plus some headroom
+    int idleCount = std::min(cfg.idle, raiseSocketLimit() - 256);
+    std::vector<SOCKET> idle = connectMany(cfg.port, idleCount, result.errors);
+    // 先给空闲连接各回显一条消息，确保服务器已经接受并开始服务它们
+    // Echo one message on every idle connection first, so the server has accepted and is serving each of them.
+    std::string request;
+    appendFrame(request, FrameMode::Length, {}, std::string(static_cast<size_t>(cfg.payload), 'x'));
+    std::vector<char> reply(request.size() + model.replyExtra);
+    for (SOCKET s : idle) {
+        Reply r = sendAll(s, request.data(), request.size()) ? recvAll(s, reply.data(), reply.size()) : Reply::Failed;
+        if (r != Reply::Complete)
+            ++result.errors;
+        if (r == Reply::Stalled)
+            ++result.stalls;
+    }
+    std::vector<SOCKET> active;
+    for (int i = 0; i < cfg.active; ++i) {
+        SOCKET s = connectTo(cfg.port, static_cast<uint64_t>(i));
+        if (s == INVALID_SOCKET)
+            ++result.errors;
+        else
+            active.push_back(s);
+    }
+    Window window(cfg, server, static_cast<int>(active.size()));
+    std::thread load([&] { pingPong(window, active, request, reply.size(), cfg.payload); });
+    window.run(result);
+    load.join();
+    window.collect(result);
+    for (SOCKET s : active)
+        closesocket(s);
+    for (SOCKET s : idle)
+        closesocket(s);
+}
+
+static void runChurn(const SuiteConfig& cfg, const ServerModel& model, ChildProcess& server, SuiteResult& result) {
+    std::string request;
+    appendFrame(request, FrameMode::Length, {}, std::string(static_cast<size_t>(cfg.payload), 'x'));
+    size_t replySize = request.size() + model.replyExtra;
+    Window window(cfg, server, cfg.churnThreads);
+    std::atomic<uint64_t> next{ 0 };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < cfg.churnThreads; ++t) {
+        threads.emplace_back([&, t] {
+            std::vector<char> reply(replySize);
+            while (!window.stop.load(std::memory_order_relaxed)) {
+                auto begin = Clock::now();
+                SOCKET s = connectTo(cfg.port, next.fetch_add(1, std::memory_order_relaxed));
+                Reply r = s != INVALID_SOCKET && sendAll(s, request.data(), request.size())
+                    ? recvAll(s, reply.data(), reply.size()) : Reply::Failed;
+                if (s != INVALID_SOCKET)
+                    closesocket(s);
+                if (r == Reply::Complete)
+                    window.complete(static_cast<size_t>(t), elapsedNs(begin), static_cast<uint64_t>(cfg.payload));
+                else
+                    window.error(r);
+            }
+        });
+    }
+    window.run(result);
+    for (std::thread& t : threads)
+        t.join();
+    window.collect(result);
+}
+
+// 每个连接一个发送线程和一个接收线程；发送线程在途帧达到 --bulk-window 时等待，延迟从帧发出到回复收齐
+// Each connection has a sending and a receiving thread. The sender waits while --bulk-window
+// frames are in flight; latency runs from sending a frame to receiving all of its reply.
+static void runBulk(const SuiteConfig& cfg, const ServerModel& model, ChildProcess& server, SuiteResult& result) {
+    struct Stream {
+        SOCKET socket{ INVALID_SOCKET };
+        std::mutex lock;
+        std::condition_variable changed;
+        std::deque<Clock::time_point> inFlight;
+        bool failed{ false };
+    };
+    std::string request;
+    appendFrame(request, FrameMode::Length, {}, std::string(static_cast<size_t>(cfg.bulkPayload), 'x'));
+    size_t replySize = request.size() + model.replyExtra;
+    std::vector<std::unique_ptr<Stream>> streams;
+    for (int i = 0; i < cfg.bulkConnections; ++i) {
+        SOCKET s = connectTo(cfg.port, static_cast<uint64_t>(i));
+        if (s == INVALID_SOCKET) {
+            ++result.errors;
+            continue;
+        }
+        streams.push_back(std::make_unique<Stream>());
+        streams.back()->socket = s;
+    }
+    Window window(cfg, server, static_cast<int>(streams.size()));
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < streams.size(); ++i) {
+        Stream& st = *streams[i];
+        threads.emplace_back([&] {
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> guard(st.lock);
+                    st.changed.wait(guard, [&] {
+                        return window.stop.load() || st.failed || st.inFlight.size() < static_cast<size_t>(cfg.bulkWindow);
+                    });
+                    if (window.stop.load() || st.failed)
+                        break;
+                    st.inFlight.push_back(Clock::now());
+                }
+                st.changed.notify_all();
+                if (!sendAll(st.socket, request.data(), request.size()))
+                    break;
+            }
+            std::lock_guard<std::mutex> guard(st.lock);
+            st.failed = st.failed || !window.stop.load();
+            st.changed.notify_all();
+        });
+        threads.emplace_back([&, i] {
+            std::vector<char> reply(replySize);
+            while (true) {
+                Clock::time_point sent;
+                {
+                    std::unique_lock<std::mutex> guard(st.lock);
+                    st.changed.wait(guard, [&] { return !st.inFlight.empty() || st.failed || window.stop.load(); });
+                    if (st.inFlight.empty())
+                        break;  // 已停止且全部回复已收齐 / Stopped and every reply is in
+                    sent = st.inFlight.front();
+                }
+                Reply r = recvAll(st.socket, reply.data(), reply.size());
+                if (r != Reply::Complete) {
+                    window.error(r);
+                    std::lock_guard<std::mutex> guard(st.lock);
+                    st.failed = true;
+                    st.changed.notify_all();
+                    break;
+                }
+                {
+                    std::lock_guard<std::mutex> guard(st.lock);
+                    st.inFlight.pop_front();
+                }
+                st.changed.notify_all();
+                window.complete(i, elapsedNs(sent), static_cast<uint64_t>(cfg.bulkPayload));
+            }
+        });
+    }
+    window.run(result);
+    for (auto& st : streams)
+        st->changed.notify_all();
+    for (std::thread& t : threads)
+        t.join();
+    window.collect(result);
+    for (auto& st : streams)
+        closesocket(st->socket);
+}
+
+// ------------------------------ 输出与基线 / Output and baselines ------------------------------
+
+static std::string resultLine(const SuiteResult& r) {
+    auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000; };
+    std::ostringstream line;
+    line << std::fixed << "Result: model=" << r.model << " workload=" << r.workload << " ops=" << r.ops
+        << std::setprecision(0) << " ops_per_s=" << r.opsPerSecond()
+        << std::setprecision(2) << " mb_per_s=" << r.mbPerSecond()
+        << std::setprecision(1) << " p50_us=" << us(r.latency.percentile(50)) << " p99_us=" << us(r.latency.percentile(99))
+        << " p999_us=" << us(r.latency.percentile(99.9)) << " max_us=" << us(r.latency.max())
+        << std::setprecision(2) << " cpu_us_per_op=" << r.cpuUsPerOp()
+        << " rss_kb=" << r.rssBytes / 1024 << " errors=" << r.errors;
+    if (r.stalls)
+        line << " stalls=" << r.stalls;
+    return line.str();
+}
+
+using ResultMap = std::map<std::string, std::map<std::string, double>>;  // "model/workload" -> 指标 / metrics
+
+// 解析 "Result: key=value ..." 行；其他行（注释、表格）被忽略 / Parse "Result: key=value ..." lines; other lines (comments, tables) are ignored
+static bool parseResults(std::istream& in, ResultMap& results) {
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 7, "Result:") != 0)
+            continue;
+        std::istringstream fields(line.substr(7));
+        std::string field, model, workload;
+        std::map<std::string, double> metrics;
+        while (fields >> field) {
+            size_t eq = field.find('=');
+            if (eq == std::string::npos)
+                continue;
+            std::string key = field.substr(0, eq);
+            std::string value = field.substr(eq + 1);
+            if (key == "model")
+                model = value;
+            else if (key == "workload")
+                workload = value;
+            else
+                metrics[key] = std::atof(value.c_str());
+        }
+        if (!model.empty() && !workload.empty())
+            results[model + "/" + workload] = metrics;
+    }
+    return true;
+}
+
+// 与基线比较；吞吐量下降或延迟、CPU、内存上升超过容差的指标标为 REGRESSION，返回退化的数量
+// Compare with the baseline. A metric whose throughput fell, or whose latency, CPU or memory rose,
+// by more than the tolerance is marked REGRESSION; returns the number of regressions.
+static int compareWithBaseline(const SuiteConfig& cfg, const std::vector<SuiteResult>& results) {
+    std::ifstream in(cfg.baseline);
+    if (!in) {
+        std::cerr << "Cannot open baseline " << cfg.baseline << std::endl;
+        return -1;
+    }
+    ResultMap baseline;
+    parseResults(in, baseline);
+    ResultMap current;
+    {
+        std::stringstream lines;
+        for (const SuiteResult& r : results)
+            lines << resultLine(r) << "\n";
+        parseResults(lines, current);
+    }
+    // 指标及其方向：true 表示越大越好 / Metric and direction: true means higher is better
+    const std::pair<const char*, bool> metrics[] = {
+        { "ops_per_s", true }, { "p99_us", false }, { "cpu_us_per_op", false }, { "rss_kb", false } };
+    int regressions = 0;
+    std::cout << "\nCompared with baseline " << cfg.baseline << " (tolerance " << std::setprecision(0) << cfg.tolerance * 100 << "%)" << std::endl;
+    std::cout << std::left << std::setw(22) << "model/workload" << std::setw(16) << "metric" << std::right
+        << std::setw(14) << "baseline" << std::setw(14) << "current" << std::setw(10) << "change" << std::endl;
+    for (const auto& [key, now] : current) {
+        auto base = baseline.find(key);
+        if (base == baseline.end()) {
+            std::cout << std::left << std::setw(22) << key << std::right << "  (not in baseline)" << std::endl;
+            continue;
+        }
+        for (const auto& [metric, higherIsBetter] : metrics) {
+            auto b = base->second.find(metric);
+            auto c = now.find(metric);
+            if (b == base->second.end() || c == now.end() || b->second <= 0)
+                continue;
+            double change = (c->second - b->second) / b->second;
+            bool regressed = higherIsBetter ? change < -cfg.tolerance : change > cfg.tolerance;
+            regressions += regressed ? 1 : 0;
+            std::cout << std::left << std::setw(22) << key << std::setw(16) << metric << std::right << std::fixed
+                << std::setprecision(1) << std::setw(14) << b->second << std::setw(14) << c->second
+                << std::setw(9) << std::showpos << change * 100 << "%" << std::noshowpos
+                << (regressed ? "  REGRESSION" : "") << std::endl;
+        }
+    }
+    return regressions;
+}
+
+static bool saveResults(const SuiteConfig& cfg, const std::vector<SuiteResult>& results) {
+    std::ofstream out(cfg.save);
+    if (!out) {
+        std::cerr << "Cannot write " << cfg.save << std::endl;
+        return false;
+    }
+    out << "# Suite baseline: " << cfg.seconds << " s per run after " << cfg.warmup << " s warm-up, "
+        << std::thread::hardware_concurrency() << " CPUs, " << cfg.threads << " server threads\n";
+    out << "# payload=" << cfg.payload << " connections=" << cfg.connections << " idle=" << cfg.idle << " active=" << cfg.active
+        << " churn_threads=" << cfg.churnThreads << " bulk_payload=" << cfg.bulkPayload << " bulk_connections=" << cfg.bulkConnections
+        << " bulk_window=" << cfg.bulkWindow << "\n";
+    for (const SuiteResult& r : results)
+        out << resultLine(r) << "\n";
+    return true;
+}
+
+// ------------------------------ 主流程 / Driver ------------------------------
+
+static bool runOne(const SuiteConfig& cfg, const ServerModel& model, const std::string& workload, SuiteResult& result) {
+    const std::string outputPath = "suite_server.out";
+    ChildProcess server;
+    if (!server.start(model.args, outputPath)) {
+        std::cerr << "Failed to start " << model.args[0] << std::endl;
+        return false;
+    }
+    bool listening = waitForPort("127.0.0.1", cfg.port, 5000);
+    if (listening) {
+        result.model = model.name;
+        result.workload = workload;
+        if (workload == "churn")
+            runChurn(cfg, model, server, result);
+        else if (workload == "idle")
+            runIdle(cfg, model, server, result);
+        else if (workload == "pingpong")
+            runPingPong(cfg, model, server, result);
+        else
+            runBulk(cfg, model, server, result);
+    }
+    else {
+        std::cerr << model.name << " did not start listening on port " << cfg.port << std::endl;
+    }
+    server.terminate();
+    std::remove(outputPath.c_str());
+    return listening;
+}
+
+static void usage() {
+    std::cerr << "Usage: Suite [--server03 PATH] [--server03co PATH] [--server04 PATH] [--models A,B,...] [--workloads A,B,...] [--seconds S] [--warmup S]\n"
+        "             [--threads N] [--port N] [--payload BYTES] [--connections N] [--idle N] [--active N] [--churn-threads N]\n"
+        "             [--bulk-payload BYTES] [--bulk-connections N] [--bulk-window N] [--save FILE] [--baseline FILE] [--tolerance F]\n"
+        "Models: 03-iocp 03-epoll 03-uring 03co-iocp 03co-epoll 03co-uring 04-thread 04-pool   Workloads: churn idle pingpong bulk" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    SuiteConfig cfg;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--server03") cfg.server03 = value;
+        else if (arg == "--server03co") cfg.server03co = value;
+        else if (arg == "--server04") cfg.server04 = value;
+        else if (arg == "--models") cfg.models = splitList(value);
+        else if (arg == "--workloads") cfg.workloads = splitList(value);
+        else if (arg == "--seconds") cfg.seconds = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--warmup") cfg.warmup = std::max(0, std::atoi(value.c_str()));
+        else if (arg == "--threads") cfg.threads = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--port") cfg.port = std::atoi(value.c_str());
+        else if (arg == "--payload") cfg.payload = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--connections") cfg.connections = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--idle") cfg.idle = std::max(0, std::atoi(value.c_str()));
+        else if (arg == "--active") cfg.active = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--churn-threads") cfg.churnThreads = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--bulk-payload") cfg.bulkPayload = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--bulk-connections") cfg.bulkConnections = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--bulk-window") cfg.bulkWindow = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--save") cfg.save = value;
+        else if (arg == "--baseline") cfg.baseline = value;
+        else if (arg == "--tolerance") cfg.tolerance = std::max(0.0, std::atof(value.c_str()));
+        else {
+            usage();
+            return 1;
+        }
+    }
+    for (const std::string& w : cfg.workloads) {
+        if (w != "churn" && w != "idle" && w != "pingpong" && w != "bulk") {
+            std::cerr << "Unknown workload " << w << std::endl;
+            usage();
+            return 1;
+        }
+    }
+
+#ifndef _WIN32
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        std::cerr << "WSAStartup failed." << std::endl;
+        return 1;
+    }
+
+    std::cout << "Benchmark suite: " << cfg.seconds << " s per run after " << cfg.warmup << " s warm-up, "
+        << cfg.threads << " server threads" << std::endl;
+    std::cout << std::left << std::setw(11) << "model" << std::setw(10) << "workload" << std::right << std::setw(12) << "ops/s"
+        << std::setw(10) << "MB/s" << std::setw(10) << "p50 us" << std::setw(10) << "p99 us" << std::setw(11) << "p99.9 us"
+        << std::setw(12) << "cpu us/op" << std::setw(10) << "rss MB" << std::setw(8) << "errors" << std::endl;
+    std::vector<SuiteResult> results;
+    for (const std::string& name : cfg.models) {
+        ServerModel model;
+        if (!makeModel(cfg, name, model)) {
+            std::cerr << "Unknown model " << name << std::endl;
+            continue;
+        }
+        for (const std::string& workload : cfg.workloads) {
+            SuiteResult r;
+            if (!runOne(cfg, model, workload, r))
+                continue;
+            std::cout << std::left << std::setw(11) << r.model << std::setw(10) << r.workload << std::right << std::fixed
+                << std::setprecision(0) << std::setw(12) << r.opsPerSecond() << std::setprecision(1) << std::setw(10) << r.mbPerSecond()
+                << std::setw(10) << r.latency.percentile(50) / 1000.0 << std::setw(10) << r.latency.percentile(99) / 1000.0
+                << std::setw(11) << r.latency.percentile(99.9) / 1000.0 << std::setprecision(2) << std::setw(12) << r.cpuUsPerOp()
+                << std::setprecision(1) << std::setw(10) << r.rssBytes / 1048576.0 << std::setw(8) << r.errors << std::endl;
+            if (r.stalls)
+                std::cerr << r.model << " " << r.workload << ": " << r.stalls << " replies did not arrive within "
+                    << REPLY_TIMEOUT_MS / 1000 << " s; the run failed" << std::endl;
+            results.push_back(std::move(r));
+        }
+    }
+    std::cout << std::endl;
+    for (const SuiteResult& r : results)
+        std::cout << resultLine(r) << std::endl;
+
+    int rc = 0;
+    for (const SuiteResult& r : results)
+        if (r.stalls)
+            rc = 1;
+    if (!cfg.save.empty() && !saveResults(cfg, results))
+        rc = 1;
+    if (!cfg.baseline.empty()) {
+        int regressions = compareWithBaseline(cfg, results);
+        if (regressions < 0)
+            rc = 1;
+        else if (regressions > 0)
+            rc = 2;
+    }
+    WSACleanup();
+    return rc;
+}
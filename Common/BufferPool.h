@@ -0,0 +1,60 @@
+// BufferPool.h
+// 按大小分级的共享接收缓冲区池，每一级是一个 ObjectPool
+// Size-classed shared receive buffer pool; every class is an ObjectPool
+//
+// 接收缓冲区只在数据到达时才取用，回显发送完后立即归还，因此空闲连接不占用缓冲区。
+// Receive buffers are taken only when data has arrived and go back as soon as the echo is
+// sent, so an idle connection holds none.
+
+#pragma once
+
+#include "ObjectPool.h"
+
+// 缓冲区规格：256 B, 1 KB, 4 KB, 16 KB, 64 KB / Buffer classes: 256 B, 1 KB, 4 KB, 16 KB, 64 KB
+constexpr int BUFFER_CLASS_COUNT = 5;
+constexpr int DEFAULT_BUFFER_CLASS = 1;
+
+template <size_t N>
+struct BufferBlock {
+    char data[N];
+};
+
+class BufferPool {
+public:
+    static size_t classSize(int cls) { return size_t{ 256 } << (2 * cls); }
+
+    char* acquire(int cls) {
+        switch (cls) {
+        case 0: return pool256.create()->data;
+        case 1: return pool1k.create()->data;
+        case 2: return pool4k.create()->data;
+        case 3: return pool16k.create()->data;
+        default: return pool64k.create()->data;
+        }
+    }
+
+    void release(char* buf, int cls) {
+        switch (cls) {
+        case 0: pool256.destroy(reinterpret_cast<BufferBlock<256>*>(buf)); break;
+        case 1: pool1k.destroy(reinterpret_cast<BufferBlock<1024>*>(buf)); break;
+        case 2: pool4k.destroy(reinterpret_cast<BufferBlock<4096>*>(buf)); break;
+        case 3: pool16k.destroy(reinterpret_cast<BufferBlock<16384>*>(buf)); break;
+        default: pool64k.destroy(reinterpret_cast<BufferBlock<65536>*>(buf)); break;
+        }
+    }
+
+    // 从堆划出的缓冲区总字节数 / Total bytes of buffers carved from the heap
+    uint64_t highWaterBytes() const {
+        return pool256.stats().highWater * 256 + pool1k.stats().highWater * 1024
+            + pool4k.stats().highWater * 4096 + pool16k.stats().highWater * 16384
+            + pool64k.stats().highWater * 65536;
+    }
+
+private:
+    // slab 大小约 64 KB / Slabs of about 64 KB
+    ObjectPool<BufferBlock<256>, 256> pool256;
+    ObjectPool<BufferBlock<1024>, 64> pool1k;
+    ObjectPool<BufferBlock<4096>, 16> pool4k;
+    ObjectPool<BufferBlock<16384>, 4> pool16k;
+    ObjectPool<BufferBlock<65536>, 2> pool64k;
+};
@@ -0,0 +1,450 @@
+// FileCache.h
+// 静态文件服务：以 mmap 映射文件内容、按字节数限定大小的 LRU 缓存，响应头在加载时生成
+// Static file serving: an LRU cache of memory-mapped file contents, bounded in bytes, with the
+// response headers rendered when a file is loaded
+//
+// 文件第一次被请求时打开、映射，并生成它的响应头（Content-Type、Last-Modified、ETag）；之后的请求只查一次
+// 哈希表，没有 open、stat 与 read。不超过 inlineLimit 的正文从映射复制进响应，与头部和同一批流水线响应
+// 一起发出；更大的正文作为文件片段交给连接，由 sendfile / TransmitFile 直接从页缓存发送，不经过用户态
+// （引擎不支持时从映射发送）。
+// The first request for a file opens and maps it and renders its response headers (Content-Type,
+// Last-Modified, ETag); later requests cost one hash lookup and no open, stat or read. A body of
+// up to inlineLimit bytes is copied from the mapping into the response and goes out together
+// with the head and the other pipelined responses. A larger body is handed to the connection as
+// a file slice and sent straight from the page cache by sendfile / TransmitFile without passing
+// through user space (or from the mapping when the engine cannot send files).
+//
+// 缓存按映射的字节数限定大小，超出时淘汰最久未用的文件。正在发送的文件由 shared_ptr 保持打开，
+// 被淘汰后等发送完才解除映射；比整个缓存还大的文件不缓存，每次请求都重新打开。
+// The cache is bounded by the bytes mapped and evicts the least recently used files beyond that.
+// A file being sent is kept open by its shared_ptr and unmapped only after the send, even if it
+// was evicted meanwhile. A file larger than the whole cache is not cached and is reopened for
+// every request.
+//
+// 失效按修改时间检查：命中的文件距上次检查超过 checkMs 时 stat 一次，大小、修改时间或 inode 变了就重新加载，
+// 文件不在了就移出缓存，因此文件更新后最多 checkMs 毫秒就会生效。原地截短一个已映射的文件会使读取映射的
+// 线程收到 SIGBUS，更新文件应先写新文件再 rename。
+// Invalidation checks the modification time: a hit on a file last checked more than checkMs ago
+// stats it once and reloads it if its size, modification time or inode changed, or drops it if
+// it is gone, so an update takes effect within checkMs. Truncating a mapped file in place raises
+// SIGBUS in a thread reading the mapping; update files by writing a new one and renaming it.
+//
+// 容量为 0 时不缓存也不映射，每次请求 open、fstat、read 再关闭，作为比较的基准。
+// With a capacity of 0 nothing is cached or mapped: every request opens, fstats, reads and closes
+// the file, as a baseline for comparison.
+
+#pragma once
+
+#include "Platform.h"
+#include "Http.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// 默认的缓存容量与复制进响应的正文上限（字节） / Default cache capacity and largest body copied into the response (bytes)
+constexpr uint64_t DEFAULT_FILE_CACHE_BYTES = 64ull << 20;
+constexpr uint64_t DEFAULT_INLINE_LIMIT = 16 * 1024;
+// 默认的修改时间检查间隔（毫秒） / Default interval between modification time checks (ms)
+constexpr int64_t DEFAULT_FILE_CHECK_MS = 1000;
+
+// 文件的身份，任何一项变化都表示内容可能变了 / A file's identity; a change in any field means the content may have changed
+struct FileStamp {
+    uint64_t size{ 0 };
+    int64_t mtimeNs{ 0 };
+    uint64_t inode{ 0 };
+
+    bool operator==(const FileStamp& o) const { return size == o.size && mtimeNs == o.mtimeNs && inode == o.inode; }
+    bool operator!=(const FileStamp& o) const { return !(*this == o); }
+};
+
+// 按扩展名猜测 Content-Type / Guess the Content-Type from the extension
+inline std::string_view contentTypeFor(std::string_view path) {
+    static const std::pair<std::string_view, std::string_view> types[] = {
+        { ".html", "text/html; charset=utf-8" }, { ".htm", "text/html; charset=utf-8" },
+        { ".css", "text/css; charset=utf-8" }, { ".js", "text/javascript; charset=utf-8" },
+        { ".json", "application/json" }, { ".txt", "text/plain; charset=utf-8" },
+        { ".svg", "image/svg+xml" }, { ".png", "image/png" }, { ".jpg", "image/jpeg" },
+        { ".jpeg", "image/jpeg" }, { ".gif", "image/gif" }, { ".ico", "image/x-icon" },
+        { ".webp", "image/webp" }, { ".woff2", "font/woff2" }, { ".wasm", "application/wasm" },
+        { ".pdf", "application/pdf" }
+    };
+    size_t dot = path.rfind('.');
+    if (dot != std::string_view::npos && path.find('/', dot) == std::string_view::npos) {
+        std::string_view ext = path.substr(dot);
+        for (const auto& type : types) {
+            if (equalsIgnoreCase(ext, type.first))
+                return type.second;
+        }
+    }
+    return "application/octet-stream";
+}
+
+// 一个打开并映射的文件，连同它的响应头 / An open, mapped file together with its response headers
+class StaticFile {
+public:
+    StaticFile(const StaticFile&) = delete;
+    StaticFile& operator=(const StaticFile&) = delete;
+
+    ~StaticFile() {
+#ifdef _WIN32
+        if (view)
+            UnmapViewOfFile(view);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_FILE_HANDLE)
+            CloseHandle(file);
+#else
+        if (view)
+            munmap(const_cast<char*>(view), static_cast<size_t>(stamp.size));
+        if (file != INVALID_FILE_HANDLE)
+            ::close(file);
+#endif
+    }
+
+    // 打开并映射一个普通文件；不存在、不是普通文件或映射失败时返回空指针
+    // Open and map a regular file; nullptr if it does not exist, is not a regular file or cannot be mapped.
+    static std::shared_ptr<StaticFile> open(const std::string& path) {
+        FileStamp stamp;
+        FileHandle file = openRegular(path, stamp);
+        if (file == INVALID_FILE_HANDLE)
+            return nullptr;
+        std::shared_ptr<StaticFile> f(new StaticFile(file, stamp, contentTypeFor(path)));
+        if (stamp.size > 0 && !f->map())
+            return nullptr;
+        return f;
+    }
+
+    // 以只读方式打开普通文件并取得它的身份 / Open a regular file read-only and get its identity
+    static FileHandle openRegular(const std::string& path, FileStamp& stamp) {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return INVALID_FILE_HANDLE;
+        BY_HANDLE_FILE_INFORMATION info{};
+        if (!GetFileInformationByHandle(file, &info) || (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+            CloseHandle(file);
+            return INVALID_FILE_HANDLE;
+        }
+        stamp.size = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+        stamp.mtimeNs = fileTimeToUnixNs(info.ftLastWriteTime);
+        stamp.inode = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+        return file;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+            return INVALID_FILE_HANDLE;
+        struct stat st {};
+        if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+            ::close(fd);
+            return INVALID_FILE_HANDLE;
+        }
+        stamp = stampOf(st);
+        return fd;
+#endif
+    }
+
+    // 按路径取得身份，不打开文件；不是普通文件时返回 false / Get a path's identity without opening it; false unless it is a regular file
+    static bool statRegular(const std::string& path, FileStamp& stamp) {
+#ifdef _WIN32
+        WIN32_FILE_ATTRIBUTE_DATA info{};
+        if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &info) || (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            return false;
+        // 按路径取不到文件索引，比较时沿用已知的值 / The file index is not available by path; the known value is kept for the comparison
+        stamp.size = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+        stamp.mtimeNs = fileTimeToUnixNs(info.ftLastWriteTime);
+        return true;
+#else
+        struct stat st {};
+        if (::stat(path.c_str(), &st) == -1 || !S_ISREG(st.st_mode))
+            return false;
+        stamp = stampOf(st);
+        return true;
+#endif
+    }
+
+    uint64_t size() const { return stamp.size; }
+    const FileStamp& identity() const { return stamp; }
+    FileHandle handle() const { return file; }
+    // 映射的内容，空文件为空 / The mapped content; empty for an empty file
+    std::string_view data() const { return std::string_view(view, view ? static_cast<size_t>(stamp.size) : 0); }
+    // 200 响应的状态行与固定头部 / Status line and fixed headers of the 200 response
+    const HttpHeaderBlock& headers() const { return block; }
+
+private:
+    FileHandle file;
+#ifdef _WIN32
+    HANDLE mapping{ nullptr };
+#endif
+    const char* view{ nullptr };
+    FileStamp stamp;
+    HttpHeaderBlock block;
+
+    StaticFile(FileHandle file, const FileStamp& stamp, std::string_view contentType)
+        : file(file), stamp(stamp), block(200, contentType, validators(stamp)) {}
+
+    bool map() {
+#ifdef _WIN32
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping)
+            return false;
+        view = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        return view != nullptr;
+#else
+        void* p = mmap(nullptr, static_cast<size_t>(stamp.size), PROT_READ, MAP_SHARED, file, 0);
+        if (p == MAP_FAILED)
+            return false;
+        view = static_cast<const char*>(p);
+        return true;
+#endif
+    }
+
+    // Last-Modified 与 ETag 头部行 / The Last-Modified and ETag header lines
+    static std::string validators(const FileStamp& stamp) {
+        char text[160];
+        size_t n = formatHttpDate(text, sizeof(text), "Last-Modified", static_cast<time_t>(stamp.mtimeNs / 1000000000));
+        int m = std::snprintf(text + n, sizeof(text) - n, "ETag: \"%llx-%llx\"\r\n",
+            static_cast<unsigned long long>(stamp.mtimeNs), static_cast<unsigned long long>(stamp.size));
+        return std::string(text, n + (m > 0 ? static_cast<size_t>(m) : 0));
+    }
+
+#ifdef _WIN32
+    // FILETIME 以 1601 年起的 100 ns 为单位 / FILETIME counts 100 ns units since 1601
+    static int64_t fileTimeToUnixNs(const FILETIME& t) {
+        uint64_t ticks = (static_cast<uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime;
+        return (static_cast<int64_t>(ticks) - 116444736000000000ll) * 100;
+    }
+#else
+    static FileStamp stampOf(const struct stat& st) {
+        FileStamp stamp;
+        stamp.size = static_cast<uint64_t>(st.st_size);
+        stamp.mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+        stamp.inode = static_cast<uint64_t>(st.st_ino);
+        return stamp;
+    }
+#endif
+};
+
+// 一次查找的结果 / Outcome of one lookup
+enum class FileLookup {
+    Hit,        // 缓存中的文件 / A cached file
+    Miss,       // 刚加载的文件 / A file loaded just now
+    NotFound    // 路径非法或文件不存在 / An invalid path or a missing file
+};
+
+// 缓存的计数 / Cache counters
+struct FileCacheStats {
+    uint64_t files{ 0 };        // 缓存中的文件数 / Files cached
+    uint64_t bytes{ 0 };        // 缓存中映射的字节数 / Bytes mapped by the cache
+    uint64_t evictions{ 0 };    // 因容量淘汰的文件数 / Files evicted for capacity
+    uint64_t reloads{ 0 };      // 修改时间检查发现变化的次数 / Changes found by the modification time checks
+};
+
+// 把 root 下的文件作为静态资源提供；可被任意多个线程同时使用
+// Serves the files under root as static assets; may be used from any number of threads at once.
+class FileCache {
+public:
+    FileCache(std::string root, uint64_t capacity = DEFAULT_FILE_CACHE_BYTES, int64_t checkMs = DEFAULT_FILE_CHECK_MS,
+        uint64_t inlineLimit = DEFAULT_INLINE_LIMIT)
+        : root(std::move(root)), capacity(capacity), checkMs(checkMs), inlineLimit(inlineLimit) {
+        while (this->root.size() > 1 && (this->root.back() == '/' || this->root.back() == '\\'))
+            this->root.pop_back();
+    }
+
+    // 回复对 relPath（URL 路径去掉挂载前缀后的部分）的 GET / HEAD 请求
+    // Answer a GET / HEAD request for relPath (the URL path without the mount prefix).
+    FileLookup serve(std::string_view relPath, HttpResponse& response) {
+        std::string path;
+        if (!resolve(relPath, path)) {
+            response.sendStatus(404);
+            return FileLookup::NotFound;
+        }
+        if (capacity == 0)
+            return readAndServe(path, response);
+        FileLookup outcome = FileLookup::Hit;
+        std::shared_ptr<const StaticFile> file = find(path, outcome);
+        if (!file) {
+            response.sendStatus(404);
+            return FileLookup::NotFound;
+        }
+        if (!response.sendHead(file->headers(), file->size()))
+            return outcome;
+        if (file->size() > inlineLimit && response.bodyFile(file, 0, file->size()))
+            return outcome;
+        response.body(file->data());
+        return outcome;
+    }
+
+    FileCacheStats stats() const {
+        std::lock_guard<std::mutex> guard(lock);
+        FileCacheStats s = counters;
+        s.files = index.size();
+        s.bytes = cachedBytes;
+        return s;
+    }
+
+private:
+    struct Entry {
+        std::string path;
+        std::shared_ptr<const StaticFile> file;
+        int64_t checkedMs;      // 上次检查修改时间的时刻 / When the modification time was last checked
+    };
+
+    std::string root;
+    const uint64_t capacity;
+    const int64_t checkMs;
+    const uint64_t inlineLimit;
+    const std::chrono::steady_clock::time_point started{ std::chrono::steady_clock::now() };
+
+    mutable std::mutex lock;                    // 保护下面的字段 / Guards the fields below
+    std::list<Entry> lru;                       // 最近使用的在前 / Most recently used first
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index; // 键指向条目中的 path / Keys view the entries' paths
+    uint64_t cachedBytes{ 0 };
+    FileCacheStats counters;
+
+    int64_t elapsedMs() const {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+    }
+
+    // URL 路径映射到 root 下的文件；拒绝 ".." 段、反斜杠、冒号与 NUL，以 '/' 结尾的路径取 index.html
+    // Map a URL path to a file under root. ".." segments, backslashes, colons and NUL are refused;
+    // a path ending in '/' means its index.html.
+    bool resolve(std::string_view relPath, std::string& path) const {
+        while (!relPath.empty() && relPath.front() == '/')
+            relPath.remove_prefix(1);
+        if (relPath.find_first_of(std::string_view("\\:\0", 3)) != std::string_view::npos)
+            return false;
+        for (size_t start = 0; start <= relPath.size();) {
+            size_t end = relPath.find('/', start);
+            if (end == std::string_view::npos)
+                end = relPath.size();
+            if (relPath.substr(start, end - start) == "..")
+                return false;
+            start = end + 1;
+        }
+        path.reserve(root.size() + relPath.size() + 12);
+        path.assign(root).append("/").append(relPath);
+        if (relPath.empty() || relPath.back() == '/')
+            path.append("index.html");
+        return true;
+    }
+
+    // 查找缓存，未命中时加载；到了检查时间的命中先核对修改时间 / Look up the cache and load on a miss; a hit due for a check verifies the modification time first
+    std::shared_ptr<const StaticFile> find(const std::string& path, FileLookup& outcome) {
+        std::shared_ptr<const StaticFile> file;
+        bool check = false;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto it = index.find(path);
+            if (it != index.end()) {
+                Entry& entry = *it->second;
+                lru.splice(lru.begin(), lru, it->second);
+                file = entry.file;
+                int64_t now = elapsedMs();
+                // 同一时刻只有一个线程去检查，其余的继续使用当前的内容 / Only one thread checks at a time; the others keep using the current content
+                if (now - entry.checkedMs >= checkMs) {
+                    entry.checkedMs = now;
+                    check = true;
+                }
+            }
+        }
+        if (file && !check) {
+            outcome = FileLookup::Hit;
+            return file;
+        }
+        if (file) {
+            FileStamp stamp = file->identity();
+            if (StaticFile::statRegular(path, stamp) && stamp == file->identity()) {
+                outcome = FileLookup::Hit;
+                return file;
+            }
+            std::lock_guard<std::mutex> guard(lock);
+            ++counters.reloads;
+            auto it = index.find(path);
+            if (it != index.end() && it->second->file == file)
+                erase(it->second);
+        }
+        outcome = FileLookup::Miss;
+        std::shared_ptr<const StaticFile> loaded = StaticFile::open(path);
+        if (loaded)
+            insert(path, loaded);
+        return loaded;
+    }
+
+    // 加入缓存并按容量淘汰；比整个缓存还大的文件不加入 / Add to the cache and evict down to the capacity; a file larger than the whole cache is not added
+    void insert(const std::string& path, const std::shared_ptr<const StaticFile>& file) {
+        if (file->size() > capacity)
+            return;
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = index.find(path);
+        if (it != index.end())
+            erase(it->second);
+        lru.push_front(Entry{ path, file, elapsedMs() });
+        index.emplace(lru.front().path, lru.begin());
+        cachedBytes += file->size();
+        while (cachedBytes > capacity) {
+            erase(std::prev(lru.end()));
+            ++counters.evictions;
+        }
+    }
+
+    // 调用者持有 lock / lock held by the caller
+    void erase(std::list<Entry>::iterator entry) {
+        cachedBytes -= entry->file->size();
+        index.erase(entry->path);
+        lru.erase(entry);
+    }
+
+    // 不缓存：每次 open、fstat、read、close，正文读进响应 / No cache: open, fstat, read and close every time, reading the body into the response
+    FileLookup readAndServe(const std::string& path, HttpResponse& response) {
+        FileStamp stamp;
+        FileHandle file = StaticFile::openRegular(path, stamp);
+        if (file == INVALID_FILE_HANDLE) {
+            response.sendStatus(404);
+            return FileLookup::NotFound;
+        }
+        HttpHeaderBlock headers(200, contentTypeFor(path));
+        if (response.sendHead(headers, stamp.size)) {
+            char* body = response.bodyBuffer(static_cast<size_t>(stamp.size));
+            uint64_t done = 0;
+            while (done < stamp.size) {
+                uint64_t want = std::min<uint64_t>(stamp.size - done, 1u << 30);
+#ifdef _WIN32
+                DWORD n = 0;
+                if (!ReadFile(file, body + done, static_cast<DWORD>(want), &n, nullptr) || n == 0)
+                    break;
+#else
+                ssize_t n = ::read(file, body + done, static_cast<size_t>(want));
+                if (n <= 0)
+                    break;
+#endif
+                done += static_cast<uint64_t>(n);
+            }
+            // 文件在读取期间变短：长度已经发出，只能在这个响应之后关闭连接
+            // The file shrank while being read: the length is already out, so the connection closes after this response.
+            if (done < stamp.size) {
+                std::fill(body + done, body + stamp.size, '\0');
+                response.close();
+            }
+        }
+#ifdef _WIN32
+        CloseHandle(file);
+#else
+        ::close(file);
+#endif
+        return FileLookup::Miss;
+    }
+};
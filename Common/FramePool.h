@@ -0,0 +1,110 @@
+// FramePool.h
+// 协程帧的每线程分配器：按 64 字节分级的空闲链表，稳态下既不加锁也不调用堆分配器
+// Per-thread allocator for coroutine frames: free lists in 64-byte size classes, so the steady
+// state neither locks nor calls the heap allocator
+//
+// 协程的 promise_type 用 allocate / deallocate 重载 operator new / delete。帧在哪个线程上释放，
+// 就回到哪个线程的链表（协程可能在另一个工作线程上结束），每级最多缓存 MAX_CACHED 个，多出的还给堆。
+// 超过最大级别的帧直接向堆申请。线程退出时归还它缓存的全部帧。
+// A promise_type overloads operator new / delete with allocate / deallocate. A frame goes back
+// to the list of whichever thread frees it (a coroutine may finish on another worker); each
+// class caches at most MAX_CACHED frames and the rest go back to the heap. Frames beyond the
+// largest class come straight from the heap. A thread returns everything it cached on exit.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+// 分配统计 / Allocation statistics
+struct FramePoolStats {
+    uint64_t allocations{ 0 };  // 全部分配 / All allocations
+    uint64_t heap{ 0 };         // 其中向堆申请的 / Those that went to the heap
+};
+
+class FramePool {
+public:
+    static constexpr size_t GRANULE = 64;       // 级差 / Size class step
+    static constexpr size_t CLASSES = 64;       // 最大 4 KiB / Up to 4 KiB
+    static constexpr size_t MAX_CACHED = 1024;  // 每线程每级最多缓存的帧 / Frames cached per thread and class
+
+    static void* allocate(size_t size) {
+        counters().allocations.fetch_add(1, std::memory_order_relaxed);
+        size_t cls = classOf(size);
+        if (cls < CLASSES) {
+            ThreadCache& cache = localCache();
+            if (FreeFrame* frame = cache.heads[cls]) {
+                cache.heads[cls] = frame->next;
+                --cache.counts[cls];
+                return frame;
+            }
+            size = cls * GRANULE;
+        }
+        counters().heap.fetch_add(1, std::memory_order_relaxed);
+        return ::operator new(size);
+    }
+
+    static void deallocate(void* p, size_t size) noexcept {
+        size_t cls = classOf(size);
+        if (cls < CLASSES) {
+            ThreadCache& cache = localCache();
+            if (cache.counts[cls] < MAX_CACHED) {
+                auto* frame = static_cast<FreeFrame*>(p);
+                frame->next = cache.heads[cls];
+                cache.heads[cls] = frame;
+                ++cache.counts[cls];
+                return;
+            }
+        }
+        ::operator delete(p);
+    }
+
+    static FramePoolStats stats() {
+        FramePoolStats s;
+        s.allocations = counters().allocations.load(std::memory_order_relaxed);
+        s.heap = counters().heap.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    struct FreeFrame {
+        FreeFrame* next;
+    };
+
+    struct ThreadCache {
+        FreeFrame* heads[CLASSES]{};
+        size_t counts[CLASSES]{};
+
+        ~ThreadCache() {
+            for (FreeFrame*& head : heads) {
+                while (head) {
+                    FreeFrame* next = head->next;
+                    ::operator delete(head);
+                    head = next;
+                }
+            }
+        }
+    };
+
+    struct Counters {
+        std::atomic<uint64_t> allocations{ 0 };
+        std::atomic<uint64_t> heap{ 0 };
+    };
+
+    // 向上取整到级；0 级不用 / Round up to a class; class 0 is unused
+    static size_t classOf(size_t size) {
+        return (size + GRANULE - 1) / GRANULE;
+    }
+
+    static ThreadCache& localCache() {
+        static thread_local ThreadCache cache;
+        return cache;
+    }
+
+    static Counters& counters() {
+        static Counters c;
+        return c;
+    }
+};
@@ -0,0 +1,189 @@
+// Framing.h
+// 消息分帧：4 字节长度前缀的二进制帧，或以换行分隔的文本帧
+// Message framing: binary frames with a 4-byte length prefix, or newline-delimited text frames
+//
+// TCP 是字节流，一次 recv 可能包含多个帧，也可能只有半个帧。FrameDecoder 直接在接收缓冲区上
+// 解析完整的帧并逐个回调，不复制；只有跨越 recv 边界的帧才把已到达的部分复制到 carry 中，
+// 等剩余部分到达后从 carry 回调。一次 recv 中流水线式到达的多个请求在同一次 feed 中全部处理。
+// TCP is a byte stream: one recv may hold several frames or only half of one. FrameDecoder parses
+// complete frames in place in the receive buffer and hands them out one by one without copying.
+// Only a frame that spans a recv boundary has its bytes so far copied into the carry buffer,
+// and it is handed out from there once the rest arrives. Pipelined requests that arrive in one
+// recv are all handled in the same feed call.
+//
+// 帧格式 / Wire formats:
+//   length  [uint32 大端序载荷长度 / big-endian payload length][载荷 / payload]
+//   line    [载荷 / payload]'\n'（载荷中不含 '\n' / the payload contains no '\n'）
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class FrameMode {
+    Raw,     // 不分帧：每次 recv 的数据即一条消息 / No framing: whatever one recv returns is one message
+    Length,  // 长度前缀 / Length prefix
+    Line     // 换行分隔 / Newline-delimited
+};
+
+constexpr size_t FRAME_HEADER_SIZE = 4;
+constexpr size_t DEFAULT_MAX_FRAME = 1 << 20;
+
+// 解析 raw|length|line，失败返回 false / Parse raw|length|line; returns false on failure
+inline bool parseFrameMode(const std::string& name, FrameMode& mode) {
+    if (name == "raw")
+        mode = FrameMode::Raw;
+    else if (name == "length")
+        mode = FrameMode::Length;
+    else if (name == "line")
+        mode = FrameMode::Line;
+    else
+        return false;
+    return true;
+}
+
+// 按 mode 把 prefix + payload 编码成一个帧追加到 out / Append prefix + payload to out as one frame in the given mode
+inline void appendFrame(std::string& out, FrameMode mode, std::string_view prefix, std::string_view payload) {
+    size_t length = prefix.size() + payload.size();
+    if (mode == FrameMode::Length) {
+        char header[FRAME_HEADER_SIZE] = { static_cast<char>(length >> 24), static_cast<char>(length >> 16),
+            static_cast<char>(length >> 8), static_cast<char>(length) };
+        out.append(header, FRAME_HEADER_SIZE);
+    }
+    out.append(prefix.data(), prefix.size());
+    out.append(payload.data(), payload.size());
+    if (mode == FrameMode::Line)
+        out.push_back('\n');
+}
+
+class FrameDecoder {
+public:
+    explicit FrameDecoder(FrameMode m = FrameMode::Raw, size_t maxFrameSize = DEFAULT_MAX_FRAME)
+        : mode(m), maxFrame(maxFrameSize) {}
+
+    // 解析新到达的 len 字节，对每个完整的帧调用 onFrame(payload, wire)：payload 为载荷，
+    // wire 为包括长度前缀或换行符在内的整个帧。若帧完全位于 data 中，它们直接指向 data；
+    // 从 carry 补全的帧指向解码器内部，保持有效直到下一次 feed。帧超过上限时返回 false，连接应当关闭。
+    // Parse len newly arrived bytes and call onFrame(payload, wire) for every complete frame:
+    // payload is the frame's payload, wire the whole frame including its length prefix or newline.
+    // When the frame lies entirely within data they point straight into it; a frame completed
+    // from the carry points into the decoder and stays valid until the next feed. Returns false
+    // if a frame exceeds the limit, after which the connection should be closed.
+    template <typename OnFrame>
+    bool feed(const char* data, size_t len, OnFrame&& onFrame) {
+        if (mode == FrameMode::Raw) {
+            if (len > 0)
+                onFrame(std::string_view(data, len), std::string_view(data, len));
+            return true;
+        }
+        const char* p = data;
+        const char* end = data + len;
+        // 先补全上次留下的半个帧 / First complete the partial frame left over from last time
+        if (!carry.empty()) {
+            if (!completeCarry(p, end, onFrame))
+                return false;
+            if (!carry.empty())
+                return true;  // 仍未补全，数据已全部进入 carry / Still incomplete; all data went into the carry
+        }
+        // 在缓冲区上原地解析完整的帧 / Parse complete frames in place in the buffer
+        while (p < end) {
+            size_t wireSize = 0;
+            size_t payloadOffset = 0;
+            if (!measure(p, static_cast<size_t>(end - p), wireSize, payloadOffset))
+                return false;
+            if (wireSize == 0)
+                break;  // 剩下的是半个帧 / What remains is a partial frame
+            onFrame(payload(p, wireSize, payloadOffset), std::string_view(p, wireSize));
+            p += wireSize;
+        }
+        // 半个帧复制到 carry / The partial frame is copied into the carry
+        carry.assign(p, end);
+        return true;
+    }
+
+    // carry 中等待补全的字节数 / Bytes held in the carry waiting for the rest of their frame
+    size_t buffered() const { return carry.size(); }
+
+private:
+    FrameMode mode;
+    size_t maxFrame;
+    std::vector<char> carry;
+    std::vector<char> completed;  // 最近一个从 carry 补全的帧 / The frame most recently completed from the carry
+
+    // 计算从 p 开始的帧的总长度（不完整时为 0）及载荷偏移；帧过大时返回 false
+    // Work out the total size of the frame starting at p (0 if incomplete) and its payload offset;
+    // returns false if the frame is too large.
+    bool measure(const char* p, size_t available, size_t& wireSize, size_t& payloadOffset) const {
+        wireSize = 0;
+        if (mode == FrameMode::Length) {
+            payloadOffset = FRAME_HEADER_SIZE;
+            if (available < FRAME_HEADER_SIZE)
+                return true;
+            const auto* b = reinterpret_cast<const unsigned char*>(p);
+            size_t length = (size_t{ b[0] } << 24) | (size_t{ b[1] } << 16) | (size_t{ b[2] } << 8) | b[3];
+            if (length > maxFrame)
+                return false;
+            if (available >= FRAME_HEADER_SIZE + length)
+                wireSize = FRAME_HEADER_SIZE + length;
+            return true;
+        }
+        payloadOffset = 0;
+        const void* newline = std::memchr(p, '\n', available);
+        if (newline)
+            wireSize = static_cast<size_t>(static_cast<const char*>(newline) - p) + 1;
+        return wireSize != 0 ? wireSize - 1 <= maxFrame : available <= maxFrame;
+    }
+
+    std::string_view payload(const char* p, size_t wireSize, size_t payloadOffset) const {
+        size_t trailer = mode == FrameMode::Line ? 1 : 0;
+        return std::string_view(p + payloadOffset, wireSize - payloadOffset - trailer);
+    }
+
+    // 只向 carry 复制补全该帧所需的字节；补全后移入 completed 再回调，carry 可以继续接收下一个半帧
+    // Copy into the carry only the bytes its frame still needs; once complete, move it to completed
+    // and hand it out, leaving the carry free for the next partial frame.
+    template <typename OnFrame>
+    bool completeCarry(const char*& p, const char* end, OnFrame& onFrame) {
+        size_t wireSize = 0;
+        size_t payloadOffset = 0;
+        if (mode == FrameMode::Length) {
+            // 先凑齐长度前缀 / Assemble the length prefix first
+            size_t headerMissing = carry.size() < FRAME_HEADER_SIZE ? FRAME_HEADER_SIZE - carry.size() : 0;
+            size_t take = std::min(headerMissing, static_cast<size_t>(end - p));
+            carry.insert(carry.end(), p, p + take);
+            p += take;
+            if (carry.size() < FRAME_HEADER_SIZE)
+                return true;
+            if (!measure(carry.data(), FRAME_HEADER_SIZE, wireSize, payloadOffset))
+                return false;
+            const auto* b = reinterpret_cast<const unsigned char*>(carry.data());
+            size_t need = FRAME_HEADER_SIZE + ((size_t{ b[0] } << 24) | (size_t{ b[1] } << 16) | (size_t{ b[2] } << 8) | b[3]);
+            take = std::min(need - carry.size(), static_cast<size_t>(end - p));
+            carry.insert(carry.end(), p, p + take);
+            p += take;
+            if (carry.size() < need)
+                return true;
+            wireSize = need;
+        }
+        else {
+            const void* newline = std::memchr(p, '\n', static_cast<size_t>(end - p));
+            const char* stop = newline ? static_cast<const char*>(newline) + 1 : end;
+            carry.insert(carry.end(), p, stop);
+            p = stop;
+            if (!newline)
+                return carry.size() <= maxFrame;
+            wireSize = carry.size();
+            if (wireSize - 1 > maxFrame)
+                return false;
+        }
+        completed.swap(carry);
+        carry.clear();
+        onFrame(payload(completed.data(), wireSize, payloadOffset), std::string_view(completed.data(), wireSize));
+        return true;
+    }
+};
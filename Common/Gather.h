@@ -0,0 +1,151 @@
+// Gather.h
+// 聚集发送：把回复描述为一串缓冲区段，用一次 WSASend / sendmsg 发出，不拼接字符串
+// Gather sends: describe a reply as a list of buffer segments and send it with one WSASend /
+// sendmsg instead of concatenating strings
+//
+// 段只引用数据（静态前缀、接收缓冲区中的载荷），不复制；长度前缀之类的几个字节写入 GatherList
+// 自己的 scratch 存储。所有容器在 clear 后保留容量，因此连接稳定后每条消息不再分配内存。
+// Segments only reference their data (a static prefix, a payload in the receive buffer) and copy
+// nothing; the few bytes of a length prefix go into the list's own scratch storage. Every
+// container keeps its capacity across clear, so once a connection has warmed up no message
+// allocates.
+
+#pragma once
+
+#include "Platform.h"
+#include "Framing.h"
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
+class GatherList {
+public:
+    // 每次系统调用最多发送的段数（Linux 的 IOV_MAX 为 1024）/ Segments per system call at most (IOV_MAX is 1024 on Linux)
+    static constexpr size_t MAX_SEGMENTS_PER_CALL = 64;
+
+    void clear() {
+        segments.clear();
+        scratch.clear();
+        total = 0;
+        sent = 0;
+    }
+
+    bool empty() const { return total == 0; }
+    size_t size() const { return total; }
+    size_t remaining() const { return total - sent; }
+
+    // 引用 data，发送完成前它必须保持有效 / Reference data, which must stay valid until it has been sent
+    void add(std::string_view data) {
+        if (data.empty())
+            return;
+        segments.push_back(Segment{ data.data(), 0, data.size() });
+        total += data.size();
+    }
+
+    // 把几个字节复制到 scratch 中再引用 / Copy a few bytes into scratch and reference them there
+    void addCopy(const char* data, size_t len) {
+        if (len == 0)
+            return;
+        segments.push_back(Segment{ nullptr, scratch.size(), len });
+        scratch.insert(scratch.end(), data, data + len);
+        total += len;
+    }
+
+    // 阻塞套接字：发送全部剩余数据，处理部分发送；失败返回 false
+    // Blocking socket: send everything that remains, handling partial sends; returns false on failure.
+    bool sendAll(SOCKET s) {
+        while (sent < total) {
+            if (sendSome(s) == SOCKET_ERROR)
+                return false;
+        }
+        return true;
+    }
+
+    // 用一次系统调用发送尽可能多的剩余数据，返回发出的字节数；非阻塞套接字暂时不可写时返回 0
+    // Send as much of the rest as one system call takes and return the bytes sent; returns 0 when
+    // a non-blocking socket is not writable yet.
+    int sendSome(SOCKET s) {
+        WSABUF buffers[MAX_SEGMENTS_PER_CALL];
+        DWORD count = 0;
+        size_t skip = sent;
+        for (const Segment& seg : segments) {
+            if (skip >= seg.len) {
+                skip -= seg.len;
+                continue;
+            }
+            const char* base = seg.data ? seg.data : scratch.data() + seg.offset;
+            buffers[count].buf = const_cast<char*>(base + skip);
+            buffers[count].len = static_cast<ULONG>(seg.len - skip);
+            skip = 0;
+            if (++count == MAX_SEGMENTS_PER_CALL)
+                break;
+        }
+#ifdef _WIN32
+        DWORD bytes = 0;
+        if (WSASend(s, buffers, count, &bytes, 0, nullptr, nullptr) == SOCKET_ERROR)
+            return WSAGetLastError() == WSAEWOULDBLOCK ? 0 : SOCKET_ERROR;
+#else
+        iovec iov[MAX_SEGMENTS_PER_CALL];
+        for (DWORD i = 0; i < count; ++i)
+            iov[i] = iovec{ buffers[i].buf, buffers[i].len };
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t bytes = ::sendmsg(s, &msg, MSG_NOSIGNAL);
+        if (bytes < 0)
+            return errno == EWOULDBLOCK || errno == EAGAIN || errno == EINTR ? 0 : SOCKET_ERROR;
+#endif
+        sent += static_cast<size_t>(bytes);
+        return static_cast<int>(bytes);
+    }
+
+    // 把尚未发出的部分复制到 out，用于非阻塞发送没有一次发完时 / Copy the unsent part into out, for when a non-blocking send did not finish
+    void appendRemaining(std::string& out) const {
+        size_t skip = sent;
+        for (const Segment& seg : segments) {
+            if (skip >= seg.len) {
+                skip -= seg.len;
+                continue;
+            }
+            const char* base = seg.data ? seg.data : scratch.data() + seg.offset;
+            out.append(base + skip, seg.len - skip);
+            skip = 0;
+        }
+    }
+
+private:
+    // data 为空时段位于 scratch 的 offset 处（scratch 扩容会移动，因此不保存指针）
+    // With a null data the segment lies at offset in scratch (scratch may move as it grows, so no pointer is kept).
+    struct Segment {
+        const char* data;
+        size_t offset;
+        size_t len;
+    };
+
+    std::vector<Segment> segments;
+    std::vector<char> scratch;
+    size_t total{ 0 };
+    size_t sent{ 0 };
+};
+
+// 按 mode 把 prefix + payload 描述为一个帧：长度前缀复制到 scratch，prefix 与 payload 只被引用
+// Describe prefix + payload as one frame in the given mode: the length prefix is copied into
+// scratch, prefix and payload are only referenced.
+inline void appendFrame(GatherList& out, FrameMode mode, std::string_view prefix, std::string_view payload) {
+    if (mode == FrameMode::Length) {
+        size_t length = prefix.size() + payload.size();
+        char header[FRAME_HEADER_SIZE] = { static_cast<char>(length >> 24), static_cast<char>(length >> 16),
+            static_cast<char>(length >> 8), static_cast<char>(length) };
+        out.addCopy(header, FRAME_HEADER_SIZE);
+    }
+    out.add(prefix);
+    out.add(payload);
+    if (mode == FrameMode::Line)
+        out.add("\n");
+}
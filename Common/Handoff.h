@@ -0,0 +1,212 @@
+// Handoff.h
+// 热重启：正在运行的进程经 Unix 域套接字把监听套接字交给新启动的进程 (SCM_RIGHTS)
+// Hot restart: the running process hands its listening sockets to a newly started one over a
+// Unix domain socket (SCM_RIGHTS)
+//
+// 新进程启动时先连接 PATH：有旧进程在那里等待时，收到它的监听套接字并直接在上面接受连接，
+// 初始化成功后回复一个字节确认；没有旧进程时自己创建监听套接字。之后新进程接管 PATH，等待下一次重启。
+// 旧进程收到确认后才停止接受，新进程启动失败时旧进程照常服务。监听套接字在交接期间从未关闭，
+// 内核中排队的连接由先 accept 的一方取走，没有连接会被拒绝。
+// At startup the new process connects to PATH. If an old process is waiting there, the new one
+// receives its listening sockets and accepts on them directly, confirming with one byte once it
+// has initialized; with no old process it creates its own listeners. Either way it then takes
+// over PATH and waits for the next restart. The old process stops accepting only after the
+// confirmation, so a new process that fails to start leaves it serving as before. The listening
+// sockets are never closed during the handoff: connections queued in the kernel go to whichever
+// process accepts first, and none is refused.
+//
+// Windows 不能经 Unix 域套接字传递套接字，这里的函数在 Windows 上报告错误并返回失败。
+// Windows cannot pass sockets over a Unix domain socket; there these functions report an error and fail.
+
+#pragma once
+
+#include "Platform.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/un.h>
+#endif
+
+// 一次交接最多传递的监听套接字数（每个分片一个） / Most listening sockets passed in one handoff (one per shard)
+constexpr size_t MAX_HANDOFF_SOCKETS = 64;
+// 等待对方发送套接字或确认的最长时间（毫秒） / Longest wait for the other side's sockets or confirmation (ms)
+constexpr int HANDOFF_TIMEOUT_MS = 10000;
+
+class HandoffChannel {
+public:
+    explicit HandoffChannel(std::string path) : path(std::move(path)) {}
+    HandoffChannel(const HandoffChannel&) = delete;
+    HandoffChannel& operator=(const HandoffChannel&) = delete;
+    ~HandoffChannel() {
+        closeFd(peer);
+        closeFd(listener);
+    }
+
+    // 向旧进程索取监听套接字。没有旧进程时返回 true 且 sockets 为空；出错返回 false
+    // Ask the old process for its listening sockets. Returns true with sockets empty when there is
+    // no old process, false on error.
+    bool takeOver(std::vector<SOCKET>& sockets) {
+#ifdef _WIN32
+        (void)sockets;
+        return unsupported();
+#else
+        sockaddr_un addr{};
+        if (!address(addr))
+            return false;
+        peer = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (peer == -1) {
+            std::cerr << "Failed to create the handoff socket. Error: " << errno << std::endl;
+            return false;
+        }
+        if (::connect(peer, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+            int err = errno;
+            closeFd(peer);
+            // 没有这个路径，或是上一个进程退出后留下的 / No such path, or one left behind by a process that has exited
+            if (err == ENOENT || err == ECONNREFUSED)
+                return true;
+            std::cerr << "Failed to connect to " << path << ". Error: " << err << std::endl;
+            return false;
+        }
+        if (!waitReadable(peer)) {
+            std::cerr << "The previous process did not send its listening sockets." << std::endl;
+            closeFd(peer);
+            return false;
+        }
+        char byte = 0;
+        iovec iov{ &byte, 1 };
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * MAX_HANDOFF_SOCKETS)];
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        ssize_t n = ::recvmsg(peer, &msg, MSG_CMSG_CLOEXEC);
+        cmsghdr* cmsg = n == 1 ? CMSG_FIRSTHDR(&msg) : nullptr;
+        if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS || (msg.msg_flags & MSG_CTRUNC)) {
+            std::cerr << "Failed to receive the listening sockets from the previous process." << std::endl;
+            closeFd(peer);
+            return false;
+        }
+        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        sockets.resize(count);
+        std::memcpy(sockets.data(), CMSG_DATA(cmsg), count * sizeof(int));
+        return true;
+#endif
+    }
+
+    // 告诉旧进程接管成功，它可以停止接受。没有旧进程时什么也不做
+    // Tell the old process the takeover succeeded so it may stop accepting; nothing to do without one.
+    void confirm() {
+#ifndef _WIN32
+        if (peer == -1)
+            return;
+        char byte = 1;
+        if (::send(peer, &byte, 1, MSG_NOSIGNAL) != 1)
+            std::cerr << "The previous process went away before the takeover was confirmed." << std::endl;
+        closeFd(peer);
+#endif
+    }
+
+    // 接管 PATH，等待下一个进程 / Take over PATH and wait for the next process
+    bool listen() {
+#ifdef _WIN32
+        return unsupported();
+#else
+        sockaddr_un addr{};
+        if (!address(addr))
+            return false;
+        // 旧进程仍在原来的文件上监听，删除路径只是让下一个进程找到我们 / The old process still listens on the old file; unlinking only makes the next process find us
+        ::unlink(path.c_str());
+        listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listener == -1 || ::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1
+            || ::listen(listener, 1) == -1) {
+            std::cerr << "Failed to listen on " << path << ". Error: " << errno << std::endl;
+            closeFd(listener);
+            return false;
+        }
+        return true;
+#endif
+    }
+
+    // 等待新进程最多 timeoutMs 毫秒；它连接后把 sockets 交给它并等它确认。确认后返回 true，
+    // 之后不再监听 PATH（路径已属于新进程）。超时或交接失败返回 false，可以再次调用
+    // Wait up to timeoutMs for a new process. Once it connects, hand it sockets and wait for its
+    // confirmation. Returns true once confirmed, after which PATH (now the new process's) is no
+    // longer listened on. Returns false on timeout or a failed handoff; it may be called again.
+    bool handOff(const std::vector<SOCKET>& sockets, int timeoutMs) {
+#ifdef _WIN32
+        (void)sockets;
+        (void)timeoutMs;
+        return false;
+#else
+        if (listener == -1 || sockets.empty() || sockets.size() > MAX_HANDOFF_SOCKETS)
+            return false;
+        pollfd p{ listener, POLLIN, 0 };
+        if (::poll(&p, 1, timeoutMs) <= 0)
+            return false;
+        int next = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (next == -1)
+            return false;
+        char byte = 0;
+        iovec iov{ &byte, 1 };
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * MAX_HANDOFF_SOCKETS)]{};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * sockets.size());
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * sockets.size());
+        std::memcpy(CMSG_DATA(cmsg), sockets.data(), sizeof(int) * sockets.size());
+        bool confirmed = ::sendmsg(next, &msg, MSG_NOSIGNAL) == 1 && waitReadable(next)
+            && ::recv(next, &byte, 1, 0) == 1;
+        closeFd(next);
+        if (!confirmed) {
+            std::cerr << "The new process did not confirm the takeover; still serving." << std::endl;
+            return false;
+        }
+        closeFd(listener);
+        return true;
+#endif
+    }
+
+private:
+    std::string path;
+    int listener{ -1 };    // 等待下一个进程的套接字 / Socket the next process connects to
+    int peer{ -1 };        // 与旧进程的连接，确认之前保持打开 / Connection to the old process, open until confirmed
+
+    static void closeFd(int& fd) {
+#ifndef _WIN32
+        if (fd != -1)
+            ::close(fd);
+#endif
+        fd = -1;
+    }
+
+#ifdef _WIN32
+    static bool unsupported() {
+        std::cerr << "--handoff passes sockets over a Unix domain socket (SCM_RIGHTS), which Windows does not provide." << std::endl;
+        return false;
+    }
+#else
+    bool address(sockaddr_un& addr) const {
+        if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+            std::cerr << "Invalid handoff path: " << path << std::endl;
+            return false;
+        }
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        return true;
+    }
+
+    static bool waitReadable(int fd) {
+        pollfd p{ fd, POLLIN, 0 };
+        return ::poll(&p, 1, HANDOFF_TIMEOUT_MS) > 0;
+    }
+#endif
+};
@@ -0,0 +1,151 @@
+// Histogram.h
+// HDR (High Dynamic Range) 直方图：在很宽的取值范围内以固定的有效数字记录延迟
+// HDR (High Dynamic Range) histogram: records latencies over a very wide range with a fixed
+// number of significant digits
+//
+// 取值按 2 的幂分成若干桶，每个桶再线性分成 subBucketCount 个子桶，因此任何值的相对误差
+// 都不超过 10^-significantDigits，而计数数组的大小只与范围的对数成正比。记录是 O(1) 的：
+// 一次前导零计数和一次自增。每个线程使用自己的直方图，结束时用 add 合并。
+// Values are split into power-of-two buckets, each divided linearly into subBucketCount
+// sub-buckets, so the relative error of any value stays below 10^-significantDigits while the
+// counts array grows only with the logarithm of the range. Recording is O(1): one leading-zero
+// count and one increment. Each thread uses its own histogram and they are merged with add.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+class Histogram {
+public:
+    // 可记录 1 到 highestTrackable 之间的值，超出的值按 highestTrackable 记录
+    // Tracks values from 1 to highestTrackable; larger values are recorded as highestTrackable.
+    explicit Histogram(uint64_t highestTrackable = 3600ull * 1000 * 1000 * 1000, int significantDigits = 3)
+        : highest(std::max<uint64_t>(highestTrackable, 2)) {
+        significantDigits = std::clamp(significantDigits, 1, 5);
+        uint64_t largestSingleUnit = 2 * static_cast<uint64_t>(std::pow(10, significantDigits));
+        int subBucketCountMagnitude = 0;
+        while ((uint64_t{ 1 } << subBucketCountMagnitude) < largestSingleUnit)
+            ++subBucketCountMagnitude;
+        subBucketHalfCountMagnitude = subBucketCountMagnitude - 1;
+        subBucketCount = uint64_t{ 1 } << subBucketCountMagnitude;
+        subBucketHalfCount = subBucketCount / 2;
+        subBucketMask = subBucketCount - 1;
+        bucketCount = 1;
+        for (uint64_t smallestUntrackable = subBucketCount; smallestUntrackable <= highest; smallestUntrackable <<= 1)
+            ++bucketCount;
+        counts.assign(static_cast<size_t>((bucketCount + 1) * subBucketHalfCount), 0);
+    }
+
+    void record(uint64_t value) {
+        value = std::min(value, highest);
+        ++counts[countsIndex(value)];
+        ++total;
+        minValue = std::min(minValue, value);
+        maxValue = std::max(maxValue, value);
+        sum += value;
+    }
+
+    // 合并另一个参数相同的直方图 / Merge another histogram created with the same parameters
+    void add(const Histogram& other) {
+        for (size_t i = 0; i < counts.size() && i < other.counts.size(); ++i)
+            counts[i] += other.counts[i];
+        total += other.total;
+        minValue = std::min(minValue, other.minValue);
+        maxValue = std::max(maxValue, other.maxValue);
+        sum += other.sum;
+    }
+
+    void reset() {
+        std::fill(counts.begin(), counts.end(), 0);
+        total = 0;
+        minValue = UINT64_MAX;
+        maxValue = 0;
+        sum = 0;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t min() const { return total ? minValue : 0; }
+    uint64_t max() const { return maxValue; }
+    double mean() const { return total ? static_cast<double>(sum) / total : 0; }
+
+    // 不小于 percent% 的记录的最小值（取其等价区间的上界），percent 为 0 到 100
+    // The smallest value that percent% of the records are at or below (upper end of its equivalent range); percent is 0 to 100.
+    uint64_t percentile(double percent) const {
+        if (total == 0)
+            return 0;
+        if (percent >= 100)
+            return maxValue;
+        uint64_t target = static_cast<uint64_t>(std::ceil(percent / 100 * static_cast<double>(total)));
+        target = std::max<uint64_t>(target, 1);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            seen += counts[i];
+            if (seen >= target)
+                return std::min(highestEquivalent(valueFromIndex(i)), maxValue);
+        }
+        return maxValue;
+    }
+
+private:
+    uint64_t highest;
+    int subBucketHalfCountMagnitude{ 0 };
+    uint64_t subBucketCount{ 0 };
+    uint64_t subBucketHalfCount{ 0 };
+    uint64_t subBucketMask{ 0 };
+    int bucketCount{ 0 };
+    std::vector<uint64_t> counts;
+    uint64_t total{ 0 };
+    uint64_t minValue{ UINT64_MAX };
+    uint64_t maxValue{ 0 };
+    uint64_t sum{ 0 };
+
+    static int leadingZeros(uint64_t value) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return 63 - static_cast<int>(index);
+#else
+        return __builtin_clzll(value);
+#endif
+    }
+
+    int bucketIndex(uint64_t value) const {
+        // value | subBucketMask 保证非零，且小于 subBucketCount 的值都落在桶 0
+        // value | subBucketMask is non-zero and puts everything below subBucketCount in bucket 0.
+        return 64 - subBucketHalfCountMagnitude - 1 - leadingZeros(value | subBucketMask);
+    }
+
+    size_t countsIndex(uint64_t value) const {
+        int bucket = bucketIndex(value);
+        uint64_t subBucket = value >> bucket;
+        return static_cast<size_t>((static_cast<uint64_t>(bucket + 1) << subBucketHalfCountMagnitude) + subBucket - subBucketHalfCount);
+    }
+
+    uint64_t valueFromIndex(size_t index) const {
+        int bucket = static_cast<int>(index >> subBucketHalfCountMagnitude) - 1;
+        uint64_t subBucket = (index & (subBucketHalfCount - 1)) + subBucketHalfCount;
+        if (bucket < 0) {
+            subBucket -= subBucketHalfCount;
+            bucket = 0;
+        }
+        return subBucket << bucket;
+    }
+
+    // value 所在等价区间的上界 / Upper end of the equivalent range that value falls in
+    uint64_t highestEquivalent(uint64_t value) const {
+        int bucket = bucketIndex(value);
+        uint64_t subBucket = value >> bucket;
+        if (subBucket >= subBucketCount)
+            ++bucket;
+        uint64_t range = uint64_t{ 1 } << bucket;
+        uint64_t lowest = (value >> bucket) << bucket;
+        return lowest + range - 1;
+    }
+};
@@ -0,0 +1,614 @@
+// Http.h
+// HTTP/1.1 服务端的最小实现：增量请求解析、预先构造的响应头块、分块响应与路由表
+// Minimal HTTP/1.1 server side: incremental request parsing, pre-built response header blocks,
+// chunked responses and a route table
+//
+// HttpRequestParser 与 FrameDecoder（见 Framing.h）的做法相同：完整的请求直接在接收缓冲区上解析并回调，
+// 请求中的各字段都是指向缓冲区的 string_view，不复制；只有跨越接收边界的请求才复制到 carry 中，
+// 等剩余部分到达后从 carry 回调。一次接收中流水线式到达的多个请求在同一次 feed 中按顺序全部处理。
+// 头部结束位置的查找从上次停下的地方继续，逐字节到达的请求头总共只扫描一遍。
+// HttpRequestParser works like FrameDecoder (see Framing.h): complete requests are parsed in
+// place in the receive buffer and handed out with every field a string_view into it, without
+// copying. Only a request that spans a receive boundary is copied into the carry and handed out
+// from there once the rest arrives. Pipelined requests that arrive in one receive are all
+// handled, in order, in the same feed call. The search for the end of the head resumes where it
+// stopped, so a head that trickles in byte by byte is still scanned only once.
+//
+// 分隔符与非法字符由 HttpScan.h 的扫描函数成段查找，按 CPU 在运行时选用 AVX2、SSE4.2 或标量实现。
+// Delimiters and invalid characters are found a run at a time by the scanners of HttpScan.h,
+// with AVX2, SSE4.2 or scalar code chosen at runtime for the CPU.
+//
+// 请求体只支持 Content-Length；带 Transfer-Encoding 的请求以 501 拒绝。
+// Request bodies are supported only with Content-Length; a request with Transfer-Encoding is
+// refused with 501.
+//
+// 响应的状态行与固定头部在启动时拼好（HttpHeaderBlock），每个响应只追加 Date（每线程每秒格式化一次）、
+// Connection 与长度，再追加正文。
+// The status line and fixed headers of a response are assembled once at startup
+// (HttpHeaderBlock); each response appends only Date (formatted once a second per thread),
+// Connection and the length, then the body.
+//
+// 正文也可以是文件的一段（HttpFileSlice）：它不复制到输出中，只记下在输出中的位置，由连接另行发送
+// （见 FileCache.h）。
+// A body may also be a range of a file (HttpFileSlice). It is not copied into the output; only
+// its position in the output is recorded, and the connection sends it on its own (see FileCache.h).
+
+#pragma once
+
+#include "HttpScan.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+constexpr size_t HTTP_MAX_HEADERS = 32;
+constexpr size_t DEFAULT_MAX_HEAD = 8 * 1024;
+constexpr size_t DEFAULT_MAX_BODY = 1 << 20;
+
+// 不区分大小写比较 ASCII 字符串 / Case-insensitive comparison of ASCII strings
+inline bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        char x = a[i];
+        char y = b[i];
+        if (x >= 'A' && x <= 'Z')
+            x = static_cast<char>(x - 'A' + 'a');
+        if (y >= 'A' && y <= 'Z')
+            y = static_cast<char>(y - 'A' + 'a');
+        if (x != y)
+            return false;
+    }
+    return true;
+}
+
+// 状态码对应的原因短语 / Reason phrase for a status code
+inline const char* httpReason(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Content Too Large";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 505: return "HTTP Version Not Supported";
+    default: return "Unknown";
+    }
+}
+
+struct HttpHeader {
+    std::string_view name;
+    std::string_view value;
+};
+
+// 一个完整的请求；所有视图在回调返回之前有效 / One complete request; every view is valid until the callback returns
+struct HttpRequest {
+    std::string_view method;
+    std::string_view target;        // 原样的请求目标 / Request target as sent
+    std::string_view path;          // 不含查询串 / Without the query string
+    std::string_view query;         // '?' 之后的部分 / What follows '?'
+    int minorVersion{ 1 };          // HTTP/1.x 的 x
+    bool keepAlive{ true };         // 回复后是否保持连接 / Whether the connection stays open after the response
+    std::string_view body;
+    HttpHeader headers[HTTP_MAX_HEADERS];
+    size_t headerCount{ 0 };
+
+    // 按名字（不区分大小写）查找头部，没有时返回空 / Find a header by name (case-insensitively); empty if absent
+    std::string_view header(std::string_view name) const {
+        for (size_t i = 0; i < headerCount; ++i) {
+            if (equalsIgnoreCase(headers[i].name, name))
+                return headers[i].value;
+        }
+        return {};
+    }
+};
+
+class HttpRequestParser {
+public:
+    // scan 选择字节扫描的实现，默认是 CPU 支持的最快一种 / scan picks the byte scanning implementation, by default the fastest the CPU supports
+    explicit HttpRequestParser(size_t maxHead = DEFAULT_MAX_HEAD, size_t maxBody = DEFAULT_MAX_BODY,
+        const HttpScanOps& scan = httpScan())
+        : scan(&scan), maxHead(maxHead), maxBody(maxBody) {}
+
+    // 解析 len 字节，对每个完整的请求调用 onRequest(const HttpRequest&)。回调返回 false 时停止解析，
+    // 其后的数据丢弃（回复后要关闭连接）。请求非法时返回 false，error() 给出应当回复的状态码
+    // Parse len bytes and call onRequest(const HttpRequest&) for every complete request. When the
+    // callback returns false parsing stops and the rest is dropped (the connection closes after
+    // the response). Returns false on a malformed request; error() is the status to answer with.
+    template <typename OnRequest>
+    bool feed(const char* data, size_t len, OnRequest&& onRequest) {
+        if (errorStatus != 0)
+            return false;
+        if (carry.empty()) {
+            size_t used = 0;
+            bool ok = parseAll(data, len, used, onRequest);
+            if (ok && used < len)
+                carry.assign(data + used, len - used);
+            return ok;
+        }
+        // 新数据接在残留的请求后面；偏移都相对于请求开头，搬到 carry 中仍然有效
+        // The new data goes after the request held back; offsets are relative to the request's start, so they survive the move.
+        carry.append(data, len);
+        size_t used = 0;
+        bool ok = parseAll(carry.data(), carry.size(), used, onRequest);
+        carry.erase(0, used);
+        return ok;
+    }
+
+    // 非法请求应当回复的状态码，0 表示没有错误 / Status to answer a malformed request with; 0 if there was none
+    int error() const { return errorStatus; }
+
+    // 当前保存的半个请求的字节数 / Bytes of the partial request currently held
+    size_t buffered() const { return carry.size(); }
+
+private:
+    enum class Step { Complete, Incomplete, Error };
+
+    const HttpScanOps* scan;
+    size_t maxHead;
+    size_t maxBody;
+    std::string carry;              // 跨越接收边界的半个请求 / A request split across receives
+    size_t scanned{ 0 };            // 头部结尾不会在此偏移之前开始 / The end of the head cannot start before this offset
+    size_t headLength{ 0 };         // 已找到的头部长度，0 表示还没找到 / Length of the head once found; 0 until then
+    size_t bodyLength{ 0 };
+    int errorStatus{ 0 };
+
+    template <typename OnRequest>
+    bool parseAll(const char* p, size_t n, size_t& used, OnRequest& onRequest) {
+        // 请求放在栈上，连接本身只保存偏移与 carry / The request lives on the stack; the connection keeps only offsets and the carry
+        HttpRequest request;
+        while (used < n) {
+            if (headLength == 0)
+                used += skipEmptyLines(p + used, n - used);
+            if (used == n)
+                break;
+            size_t consumed = 0;
+            Step step = parseOne(p + used, n - used, request, consumed);
+            if (step == Step::Error)
+                return false;
+            if (step == Step::Incomplete)
+                break;
+            used += consumed;
+            if (!onRequest(static_cast<const HttpRequest&>(request))) {
+                used = n;
+                break;
+            }
+        }
+        return true;
+    }
+
+    // 请求行之前的空行（CRLF 或单独的 LF）被忽略（RFC 9112 第 2.2 节）；结尾单独的 '\r' 留到下次
+    // Empty lines (CRLF, or a bare LF) before a request line are ignored (RFC 9112 section 2.2);
+    // a '\r' at the very end is left for the next call.
+    static size_t skipEmptyLines(const char* p, size_t n) {
+        size_t i = 0;
+        while (i < n) {
+            if (p[i] == '\n')
+                ++i;
+            else if (p[i] == '\r' && i + 1 < n && p[i + 1] == '\n')
+                i += 2;
+            else
+                break;
+        }
+        return i;
+    }
+
+    Step fail(int status) {
+        errorStatus = status;
+        return Step::Error;
+    }
+
+    Step parseOne(const char* p, size_t n, HttpRequest& request, size_t& consumed) {
+        if (headLength == 0) {
+            size_t end = scan->findHeadEnd(p, n, scanned);
+            if (end == 0) {
+                // 结尾的 "\r\n\r\n" 可能跨越边界，留 3 个字节下次重新看
+                // The final "\r\n\r\n" may straddle the boundary, so the last 3 bytes are looked at again.
+                scanned = n > 3 ? n - 3 : 0;
+                return n > maxHead ? fail(431) : Step::Incomplete;
+            }
+            if (end > maxHead)
+                return fail(431);
+            headLength = end;
+            if (!parseHead(p, request))
+                return Step::Error;
+        }
+        else if (n >= headLength + bodyLength) {
+            // 头部已经验证过，数据搬进 carry 后重新解析以更新各视图 / The head was validated already; parse it again to re-point the views after the move into the carry
+            parseHead(p, request);
+        }
+        if (n < headLength + bodyLength)
+            return Step::Incomplete;
+        request.body = std::string_view(p + headLength, bodyLength);
+        consumed = headLength + bodyLength;
+        scanned = 0;
+        headLength = 0;
+        bodyLength = 0;
+        return Step::Complete;
+    }
+
+    // 解析 p 开头 headLength 字节的请求行与头部。头部以 "\r\n\r\n" 结尾，每次扫描最迟停在其中的 '\r'，
+    // 不会越过 end；扫描停下的字节决定是分隔符还是非法字符
+    // Parse the request line and headers in the first headLength bytes at p. The head ends in
+    // "\r\n\r\n", so every scan stops at one of its '\r' at the latest and never passes end; the
+    // byte a scan stops at tells a delimiter from an invalid character.
+    bool parseHead(const char* p, HttpRequest& r) {
+        const char* cur = p;
+        const char* end = p + headLength;
+        r.headerCount = 0;
+        r.body = {};
+
+        // 请求行：方法 SP 目标 SP 版本 CRLF / Request line: method SP target SP version CRLF
+        const char* stop = scan->skipToken(cur, end);
+        if (stop == cur || *stop != ' ')
+            return failed(400);
+        r.method = std::string_view(cur, static_cast<size_t>(stop - cur));
+        cur = stop + 1;
+        stop = scan->skipTarget(cur, end);
+        if (stop == cur || *stop != ' ')
+            return failed(400);
+        r.target = std::string_view(cur, static_cast<size_t>(stop - cur));
+        cur = stop + 1;
+        if (end - cur < 10 || cur[8] != '\r' || cur[9] != '\n' || std::memcmp(cur, "HTTP/", 5) != 0 || cur[6] != '.')
+            return failed(400);
+        if (cur[5] != '1' || (cur[7] != '0' && cur[7] != '1'))
+            return failed(505);
+        r.minorVersion = cur[7] - '0';
+        cur += 10;
+        size_t question = r.target.find('?');
+        r.path = r.target.substr(0, question);
+        r.query = question == std::string_view::npos ? std::string_view{} : r.target.substr(question + 1);
+
+        bool hasLength = false;
+        bool hasHost = false;
+        bool close = false;
+        bool keepAlive = false;
+        bodyLength = 0;
+        // 每行是 名字 ':' 值 CRLF，直到最后的空行 / Each line is name ':' value CRLF, up to the final empty line
+        while (cur < end - 2) {
+            // 名字后必须紧跟 ':'；以空白开头的续行 (obs-fold) 已被 RFC 9112 废弃，也在这里被拒绝
+            // The name must be followed by ':' directly; continuation lines (obs-fold), obsolete
+            // under RFC 9112, are refused here too.
+            stop = scan->skipToken(cur, end);
+            if (stop == cur || *stop != ':')
+                return failed(400);
+            std::string_view name(cur, static_cast<size_t>(stop - cur));
+            const char* valueBegin = stop + 1;
+            // 值中的控制字符或单独的 '\n' 使扫描提前停下 / A control character or a lone '\n' in the value stops the scan early
+            stop = scan->skipValue(valueBegin, end);
+            if (stop[0] != '\r' || stop[1] != '\n')
+                return failed(400);
+            std::string_view value = trim(std::string_view(valueBegin, static_cast<size_t>(stop - valueBegin)));
+            cur = stop + 2;
+            if (r.headerCount == HTTP_MAX_HEADERS)
+                return failed(431);
+            r.headers[r.headerCount++] = HttpHeader{ name, value };
+
+            if (equalsIgnoreCase(name, "content-length")) {
+                size_t length = 0;
+                if (!parseLength(value, length) || (hasLength && length != bodyLength))
+                    return failed(400);
+                if (length > maxBody)
+                    return failed(413);
+                hasLength = true;
+                bodyLength = length;
+            }
+            else if (equalsIgnoreCase(name, "transfer-encoding")) {
+                return failed(501);
+            }
+            else if (equalsIgnoreCase(name, "host")) {
+                hasHost = true;
+            }
+            else if (equalsIgnoreCase(name, "connection")) {
+                forEachToken(value, [&](std::string_view token) {
+                    if (equalsIgnoreCase(token, "close"))
+                        close = true;
+                    else if (equalsIgnoreCase(token, "keep-alive"))
+                        keepAlive = true;
+                });
+            }
+        }
+        // HTTP/1.1 必须带 Host / HTTP/1.1 requires Host
+        if (r.minorVersion == 1 && !hasHost)
+            return failed(400);
+        // 1.1 默认保持连接，1.0 默认关闭 / 1.1 keeps the connection open by default, 1.0 closes it
+        r.keepAlive = !close && (r.minorVersion == 1 || keepAlive);
+        return true;
+    }
+
+    bool failed(int status) {
+        errorStatus = status;
+        return false;
+    }
+
+    static std::string_view trim(std::string_view s) {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+            s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+            s.remove_suffix(1);
+        return s;
+    }
+
+    static bool parseLength(std::string_view s, size_t& length) {
+        if (s.empty() || s.size() > 18)
+            return false;
+        length = 0;
+        for (char c : s) {
+            if (c < '0' || c > '9')
+                return false;
+            length = length * 10 + static_cast<size_t>(c - '0');
+        }
+        return true;
+    }
+
+    // 逗号分隔的列表 / A comma-separated list
+    template <typename OnToken>
+    static void forEachToken(std::string_view list, OnToken&& onToken) {
+        while (!list.empty()) {
+            size_t comma = list.find(',');
+            onToken(trim(list.substr(0, comma)));
+            if (comma == std::string_view::npos)
+                break;
+            list.remove_prefix(comma + 1);
+        }
+    }
+};
+
+class StaticFile;  // FileCache.h
+
+// 响应中由连接直接从文件发送的一段正文 / A stretch of a response body the connection sends straight from a file
+struct HttpFileSlice {
+    size_t at{ 0 };                          // 在输出中的位置，之前的字节先发送 / Position in the output; the bytes before it go first
+    std::shared_ptr<const StaticFile> file;  // 发送完之前保持文件打开 / Keeps the file open until it is sent
+    uint64_t offset{ 0 };
+    uint64_t length{ 0 };
+};
+
+// 预先拼好的状态行与固定头部 / A status line and fixed headers assembled ahead of time
+class HttpHeaderBlock {
+public:
+    // extraHeaders 是完整的头部行，每行以 CRLF 结尾 / extraHeaders are complete header lines, each ending in CRLF
+    HttpHeaderBlock(int status, std::string_view contentType, std::string_view extraHeaders = {}) : code(status) {
+        text = "HTTP/1.1 " + std::to_string(status) + " " + httpReason(status) + "\r\nServer: IocpServer\r\n";
+        if (!contentType.empty())
+            text.append("Content-Type: ").append(contentType).append("\r\n");
+        text.append(extraHeaders);
+    }
+
+    int status() const { return code; }
+    std::string_view view() const { return text; }
+
+private:
+    int code;
+    std::string text;
+};
+
+// 格式化为 "<name>: <IMF-fixdate>\r\n"，与区域设置无关；返回长度 / Format "<name>: <IMF-fixdate>\r\n" independently of the locale; returns the length
+inline size_t formatHttpDate(char* text, size_t size, const char* name, time_t when) {
+    static const char* const days[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+    static const char* const months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+    tm utc{};
+#ifdef _WIN32
+    gmtime_s(&utc, &when);
+#else
+    gmtime_r(&when, &utc);
+#endif
+    int n = std::snprintf(text, size, "%s: %s, %02d %s %04d %02d:%02d:%02d GMT\r\n", name,
+        days[utc.tm_wday], utc.tm_mday, months[utc.tm_mon], utc.tm_year + 1900, utc.tm_hour, utc.tm_min, utc.tm_sec);
+    return n > 0 ? static_cast<size_t>(n) : 0;
+}
+
+// 当前时间的 Date 头部行，每线程缓存，每秒最多格式化一次
+// The Date header line for the current time, cached per thread and formatted at most once a second
+inline std::string_view httpDateHeader() {
+    struct Cache {
+        time_t second{ -1 };
+        char text[64]{};
+        size_t length{ 0 };
+    };
+    static thread_local Cache cache;
+    time_t now = std::time(nullptr);
+    if (now != cache.second) {
+        cache.length = formatHttpDate(cache.text, sizeof(cache.text), "Date", now);
+        cache.second = now;
+    }
+    return std::string_view(cache.text, cache.length);
+}
+
+// 错误状态的响应头块（text/plain） / Header blocks for the error statuses (text/plain)
+inline const HttpHeaderBlock& httpErrorBlock(int status) {
+    static const HttpHeaderBlock blocks[] = {
+        { 400, "text/plain" }, { 404, "text/plain" }, { 405, "text/plain" }, { 413, "text/plain" },
+        { 431, "text/plain" }, { 501, "text/plain" }, { 505, "text/plain" }, { 500, "text/plain" }
+    };
+    for (const HttpHeaderBlock& block : blocks) {
+        if (block.status() == status)
+            return block;
+    }
+    return blocks[sizeof(blocks) / sizeof(blocks[0]) - 1];
+}
+
+// 把一个请求的响应追加到 out。一个响应要么 send 一次，要么 sendHead 后给出正文，
+// 要么 beginChunked、若干 chunk、endChunked。files 非空时正文可以是文件片段，记在 files 中
+// Appends the response to one request to out. A response is either one send, or sendHead
+// followed by its body, or beginChunked, any number of chunks and endChunked. With files set, a
+// body may be a file slice, recorded in files.
+class HttpResponse {
+public:
+    HttpResponse(std::vector<char>& out, const HttpRequest& request, std::vector<HttpFileSlice>* files = nullptr)
+        : out(out), files(files), keepAlive(request.keepAlive), http10(request.minorVersion == 0), headOnly(request.method == "HEAD") {}
+
+    // 回复后关闭连接 / Close the connection after this response
+    void close() { keepAlive = false; }
+    bool keepsAlive() const { return keepAlive; }
+
+    // 带 Content-Length 的完整响应；HEAD 请求只发头部 / A complete response with Content-Length; a HEAD request gets the head only
+    void send(const HttpHeaderBlock& headers, std::string_view body, std::string_view extraHeaders = {}) {
+        if (sendHead(headers, body.size(), extraHeaders))
+            append(body);
+    }
+
+    // 只发头部，正文随后由 body / bodyBuffer / bodyFile 给出，总长必须是 length。返回 false 表示不发正文 (HEAD)
+    // Send the head only; the body follows through body / bodyBuffer / bodyFile and must total
+    // length bytes. Returns false when no body is sent (HEAD).
+    bool sendHead(const HttpHeaderBlock& headers, uint64_t length, std::string_view extraHeaders = {}) {
+        appendHead(headers, extraHeaders);
+        char line[48];
+        int n = std::snprintf(line, sizeof(line), "Content-Length: %llu\r\n\r\n", static_cast<unsigned long long>(length));
+        append(std::string_view(line, static_cast<size_t>(n)));
+        return !headOnly;
+    }
+
+    void body(std::string_view data) { append(data); }
+
+    // 在输出末尾留出 length 字节的正文，由调用者直接写入 / Reserve length bytes of body at the end of the output for the caller to fill in
+    char* bodyBuffer(size_t length) {
+        size_t at = out.size();
+        out.resize(at + length);
+        return out.data() + at;
+    }
+
+    // 正文是文件的一段，不复制；连接不能直接发送文件 (files 为空) 时返回 false，调用者改为复制
+    // The body is a range of a file, not copied. Returns false when the connection cannot send
+    // files (files is unset); the caller copies instead.
+    bool bodyFile(std::shared_ptr<const StaticFile> file, uint64_t offset, uint64_t length) {
+        if (!files)
+            return false;
+        if (length > 0)
+            files->push_back(HttpFileSlice{ out.size(), std::move(file), offset, length });
+        return true;
+    }
+
+    // 错误状态的响应，正文是原因短语 / A response with an error status; the body is the reason phrase
+    void sendStatus(int status, std::string_view extraHeaders = {}) {
+        const HttpHeaderBlock& block = httpErrorBlock(status);
+        std::string body = std::string(httpReason(block.status())) + "\n";
+        send(block, body, extraHeaders);
+    }
+
+    // 分块响应；HTTP/1.0 的客户端不认识分块编码，改为以关闭连接结束正文
+    // A chunked response. An HTTP/1.0 client does not understand chunked coding, so the body is
+    // ended by closing the connection instead.
+    void beginChunked(const HttpHeaderBlock& headers) {
+        chunked = !http10;
+        if (!chunked)
+            keepAlive = false;
+        appendHead(headers, {});
+        append(chunked ? std::string_view("Transfer-Encoding: chunked\r\n\r\n") : std::string_view("\r\n"));
+    }
+
+    void chunk(std::string_view data) {
+        if (headOnly || data.empty())
+            return;
+        if (chunked) {
+            char size[24];
+            int n = std::snprintf(size, sizeof(size), "%zx\r\n", data.size());
+            append(std::string_view(size, static_cast<size_t>(n)));
+        }
+        append(data);
+        if (chunked)
+            append("\r\n");
+    }
+
+    void endChunked() {
+        if (chunked && !headOnly)
+            append("0\r\n\r\n");
+    }
+
+private:
+    std::vector<char>& out;
+    std::vector<HttpFileSlice>* files;
+    bool keepAlive;
+    bool http10;
+    bool headOnly;
+    bool chunked{ false };
+
+    void append(std::string_view s) {
+        out.insert(out.end(), s.begin(), s.end());
+    }
+
+    void appendHead(const HttpHeaderBlock& headers, std::string_view extraHeaders) {
+        append(headers.view());
+        append(httpDateHeader());
+        append(extraHeaders);
+        if (!keepAlive)
+            append("Connection: close\r\n");
+        else if (http10)
+            append("Connection: keep-alive\r\n");
+    }
+};
+
+using HttpHandler = std::function<void(const HttpRequest&, HttpResponse&)>;
+
+// 路由表：方法与路径精确匹配，mount 的路由匹配以其前缀开头的全部路径，先加入的优先。
+// 路径存在但方法不符时回复 405，路径不存在时回复 404；
+// 没有 HEAD 路由时 HEAD 请求由 GET 的处理函数处理（HttpResponse 不发正文）
+// Route table matching method and path exactly; a mounted route matches every path starting with
+// its prefix, and earlier routes win. A known path with the wrong method gets 405 and an unknown
+// path 404. A HEAD request without a HEAD route goes to the GET handler (HttpResponse sends no
+// body).
+class HttpRouter {
+public:
+    void add(std::string method, std::string path, HttpHandler handler) {
+        routes.push_back(Route{ std::move(method), std::move(path), false, std::move(handler) });
+    }
+
+    void mount(std::string method, std::string prefix, HttpHandler handler) {
+        routes.push_back(Route{ std::move(method), std::move(prefix), true, std::move(handler) });
+    }
+
+    void dispatch(const HttpRequest& request, HttpResponse& response) const {
+        const Route* pathMatch = nullptr;
+        const Route* getRoute = nullptr;
+        for (const Route& route : routes) {
+            if (!route.matches(request.path))
+                continue;
+            if (route.method == request.method) {
+                route.handler(request, response);
+                return;
+            }
+            pathMatch = &route;
+            if (route.method == "GET" && !getRoute)
+                getRoute = &route;
+        }
+        if (getRoute && request.method == "HEAD") {
+            getRoute->handler(request, response);
+            return;
+        }
+        if (!pathMatch) {
+            response.sendStatus(404);
+            return;
+        }
+        std::string allow = "Allow: ";
+        for (const Route& route : routes) {
+            if (route.matches(request.path))
+                allow.append(route.method).append(", ");
+        }
+        allow.resize(allow.size() - 2);
+        allow += "\r\n";
+        response.sendStatus(405, allow);
+    }
+
+private:
+    struct Route {
+        std::string method;
+        std::string path;
+        bool prefix;
+        HttpHandler handler;
+
+        bool matches(std::string_view target) const {
+            return prefix ? target.substr(0, path.size()) == path : target == path;
+        }
+    };
+    std::vector<Route> routes;
+};
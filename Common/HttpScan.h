@@ -0,0 +1,359 @@
+// HttpScan.h
+// HTTP 请求头的字节扫描：查找 token、头部值与请求目标的结尾以及头部的结尾，按 CPU 在运行时选用
+// AVX2、SSE4.2 或标量实现
+// Byte scanning for HTTP request heads: finding the end of a token, a header value, the request
+// target and the head itself, with AVX2, SSE4.2 or scalar code chosen at runtime for the CPU
+//
+// 解析器（见 Http.h）不再逐字节判断，而是调用这里的扫描函数一次跳过一整段：方法与头部名跳过 token
+// 字符停在 ' ' 或 ':'，头部值跳到第一个控制字符（正常情况下是行尾的 '\r'），请求目标跳到第一个空格。
+// 停下的字符由解析器检查，因此非法字符与分隔符用同一次扫描发现。
+// The parser (see Http.h) no longer looks at one byte at a time; it calls these scanners to skip
+// a whole run at once. A method or header name skips token characters and stops at ' ' or ':',
+// a header value runs to the first control character (normally the '\r' ending the line), and
+// the request target runs to the first space. The parser checks the byte it stopped at, so
+// invalid characters and delimiters are found by the same scan.
+//
+// 三种实现 / Three implementations:
+//   avx2    每次 32 字节。token 字符用两张按高低半字节索引的表 (vpshufb) 分类，控制字符用无符号比较
+//           32 bytes at a time. Token characters are classified with two tables indexed by the low
+//           and high nibble (vpshufb); control characters with an unsigned compare.
+//   sse4.2  每次 16 字节。token 同上 (pshufb)，头部值与请求目标用 pcmpestri 的字符范围比较
+//           16 bytes at a time. Tokens as above (pshufb); values and targets with pcmpestri range compares.
+//   scalar  256 项的字符类表，以及 memchr；不是 x86 的平台只有这一种
+//           A 256-entry character class table, and memchr. The only one on non-x86 platforms.
+// 向量实现用函数级的 target 属性编译，不需要 -mavx2 等编译选项；httpScan() 在第一次调用时检测 CPU。
+// 所有实现对任意输入给出相同的结果。
+// The vector code is compiled with per-function target attributes, so no -mavx2 style flags are
+// needed; httpScan() detects the CPU on first use. All implementations give the same result for
+// any input.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define HTTP_SCAN_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define HTTP_SCAN_TARGET(isa)
+#else
+#define HTTP_SCAN_TARGET(isa) __attribute__((target(isa)))
+#endif
+#else
+#define HTTP_SCAN_X86 0
+#endif
+
+enum class HttpScanLevel {
+    Scalar,
+    Sse42,
+    Avx2
+};
+
+// 一套扫描函数；每个都返回第一个满足条件的位置，没有时返回 end
+// One set of scanners; each returns the first position that qualifies, or end if none does.
+struct HttpScanOps {
+    HttpScanLevel level;
+    const char* name;
+    // 第一个不是 token 字符的字节 / First byte that is not a token character
+    const char* (*skipToken)(const char* p, const char* end);
+    // 第一个控制字符（HT 除外）或 DEL，即头部值的结尾 / First control character other than HT, or DEL: the end of a header value
+    const char* (*skipValue)(const char* p, const char* end);
+    // 第一个空格、控制字符或 DEL，即请求目标的结尾 / First space, control character or DEL: the end of the request target
+    const char* (*skipTarget)(const char* p, const char* end);
+    // 从偏移 from 起查找 "\r\n\r\n"，返回它之后的偏移，没有时返回 0
+    // Search for "\r\n\r\n" starting at offset from; returns the offset just past it, or 0 if absent.
+    size_t (*findHeadEnd)(const char* p, size_t n, size_t from);
+};
+
+namespace httpscan {
+
+enum : uint8_t {
+    TOKEN = 1,          // RFC 9110 的 tchar / tchar of RFC 9110
+    VALUE_END = 2,      // 控制字符（HT 除外）与 DEL / Controls other than HT, and DEL
+    TARGET_END = 4      // 空格、控制字符与 DEL / Space, controls and DEL
+};
+
+struct CharTable {
+    uint8_t bits[256];
+};
+
+constexpr CharTable makeCharTable() {
+    CharTable t{};
+    for (int c = 0; c < 256; ++c) {
+        bool token = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+        for (char x : "!#$%&'*+-.^_`|~") {
+            if (x != '\0' && c == x)
+                token = true;
+        }
+        bool control = c < 0x20 || c == 0x7F;
+        t.bits[c] = static_cast<uint8_t>((token ? TOKEN : 0) | (control && c != '\t' ? VALUE_END : 0)
+            | (control || c == ' ' ? TARGET_END : 0));
+    }
+    return t;
+}
+
+inline constexpr CharTable CHAR_TABLE = makeCharTable();
+
+inline bool hasClass(char c, uint8_t cls) {
+    return (CHAR_TABLE.bits[static_cast<uint8_t>(c)] & cls) != 0;
+}
+
+// ------------------------------ 标量 / Scalar ------------------------------
+
+inline const char* skipTokenScalar(const char* p, const char* end) {
+    while (p < end && hasClass(*p, TOKEN))
+        ++p;
+    return p;
+}
+
+inline const char* skipValueScalar(const char* p, const char* end) {
+    while (p < end && !hasClass(*p, VALUE_END))
+        ++p;
+    return p;
+}
+
+inline const char* skipTargetScalar(const char* p, const char* end) {
+    while (p < end && !hasClass(*p, TARGET_END))
+        ++p;
+    return p;
+}
+
+// 逐个找 '\n'，再往回看三个字节 / Find each '\n' and look back three bytes
+inline size_t findHeadEndScalar(const char* p, size_t n, size_t from) {
+    size_t i = from + 3;
+    while (i < n) {
+        const void* lf = std::memchr(p + i, '\n', n - i);
+        if (!lf)
+            return 0;
+        i = static_cast<size_t>(static_cast<const char*>(lf) - p);
+        if (p[i - 1] == '\r' && p[i - 2] == '\n' && p[i - 3] == '\r')
+            return i + 1;
+        ++i;
+    }
+    return 0;
+}
+
+#if HTTP_SCAN_X86
+
+inline unsigned lowestBit(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// token 的半字节分类表：高半字节 2..7 各占一位，低半字节表给出每个高半字节下哪些低半字节是 token，
+// 两者按位与非零即为 token；高半字节 8..F（非 ASCII）全为 0
+// Nibble tables for tokens: each high nibble 2..7 owns one bit, and the low-nibble table says for
+// which high nibbles each low nibble is a token; a non-zero AND of the two means a token. High
+// nibbles 8..F (non-ASCII) are all 0.
+alignas(16) inline constexpr uint8_t TOKEN_LO[16] = {
+    0x3A, 0x3F, 0x3E, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3E, 0x3E, 0x3D, 0x15, 0x34, 0x15, 0x3D, 0x1C
+};
+alignas(16) inline constexpr uint8_t TOKEN_HI[16] = {
+    0x00, 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+// ------------------------------ SSE4.2 ------------------------------
+
+HTTP_SCAN_TARGET("sse4.2")
+inline const char* skipTokenSse42(const char* p, const char* end) {
+    const __m128i lo = _mm_load_si128(reinterpret_cast<const __m128i*>(TOKEN_LO));
+    const __m128i hi = _mm_load_si128(reinterpret_cast<const __m128i*>(TOKEN_HI));
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i cls = _mm_and_si128(_mm_shuffle_epi8(lo, _mm_and_si128(v, nibble)),
+            _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(v, 4), nibble)));
+        uint32_t stop = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(cls, _mm_setzero_si128())));
+        if (stop)
+            return p + lowestBit(stop);
+        p += 16;
+    }
+    return skipTokenScalar(p, end);
+}
+
+// pcmpestri 在 16 个字节中找第一个落在 ranges 中任一范围内的字节 / pcmpestri finds the first of 16 bytes inside any of the ranges
+HTTP_SCAN_TARGET("sse4.2")
+inline const char* skipValueSse42(const char* p, const char* end) {
+    const __m128i ranges = _mm_setr_epi8(0x00, 0x08, 0x0A, 0x1F, 0x7F, 0x7F, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int index = _mm_cmpestri(ranges, 6, v, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+        if (index != 16)
+            return p + index;
+        p += 16;
+    }
+    return skipValueScalar(p, end);
+}
+
+HTTP_SCAN_TARGET("sse4.2")
+inline const char* skipTargetSse42(const char* p, const char* end) {
+    const __m128i ranges = _mm_setr_epi8(0x00, 0x20, 0x7F, 0x7F, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int index = _mm_cmpestri(ranges, 4, v, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+        if (index != 16)
+            return p + index;
+        p += 16;
+    }
+    return skipTargetScalar(p, end);
+}
+
+// 错开 0..3 个字节的四次加载分别与 '\r' '\n' '\r' '\n' 比较，按位与后即为 "\r\n\r\n" 的起点
+// Four loads offset by 0..3 bytes compared with '\r' '\n' '\r' '\n'; their AND marks where "\r\n\r\n" starts.
+HTTP_SCAN_TARGET("sse4.2")
+inline size_t findHeadEndSse42(const char* p, size_t n, size_t from) {
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    size_t i = from;
+    while (i + 19 <= n) {
+        const char* q = p + i;
+        __m128i m = _mm_and_si128(
+            _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(q)), cr),
+                _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(q + 1)), lf)),
+            _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(q + 2)), cr),
+                _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(q + 3)), lf)));
+        uint32_t found = static_cast<uint32_t>(_mm_movemask_epi8(m));
+        if (found)
+            return i + lowestBit(found) + 4;
+        i += 16;
+    }
+    return findHeadEndScalar(p, n, i);
+}
+
+// ------------------------------ AVX2 ------------------------------
+
+HTTP_SCAN_TARGET("avx2")
+inline const char* skipTokenAvx2(const char* p, const char* end) {
+    const __m256i lo = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(TOKEN_LO)));
+    const __m256i hi = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(TOKEN_HI)));
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i cls = _mm256_and_si256(_mm256_shuffle_epi8(lo, _mm256_and_si256(v, nibble)),
+            _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+        uint32_t stop = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(cls, _mm256_setzero_si256())));
+        if (stop)
+            return p + lowestBit(stop);
+        p += 32;
+    }
+    return skipTokenSse42(p, end);
+}
+
+// v <= limit（无符号）等价于 min(v, limit) == v / v <= limit (unsigned) is min(v, limit) == v
+HTTP_SCAN_TARGET("avx2")
+inline const char* skipValueAvx2(const char* p, const char* end) {
+    const __m256i limit = _mm256_set1_epi8(0x1F);
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i del = _mm256_set1_epi8(0x7F);
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(v, limit), v);
+        __m256i m = _mm256_or_si256(_mm256_andnot_si256(_mm256_cmpeq_epi8(v, tab), control), _mm256_cmpeq_epi8(v, del));
+        uint32_t stop = static_cast<uint32_t>(_mm256_movemask_epi8(m));
+        if (stop)
+            return p + lowestBit(stop);
+        p += 32;
+    }
+    return skipValueScalar(p, end);
+}
+
+HTTP_SCAN_TARGET("avx2")
+inline const char* skipTargetAvx2(const char* p, const char* end) {
+    const __m256i limit = _mm256_set1_epi8(0x20);
+    const __m256i del = _mm256_set1_epi8(0x7F);
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(v, limit), v), _mm256_cmpeq_epi8(v, del));
+        uint32_t stop = static_cast<uint32_t>(_mm256_movemask_epi8(m));
+        if (stop)
+            return p + lowestBit(stop);
+        p += 32;
+    }
+    return skipTargetScalar(p, end);
+}
+
+HTTP_SCAN_TARGET("avx2")
+inline size_t findHeadEndAvx2(const char* p, size_t n, size_t from) {
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    size_t i = from;
+    while (i + 35 <= n) {
+        const char* q = p + i;
+        __m256i m = _mm256_and_si256(
+            _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(q)), cr),
+                _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(q + 1)), lf)),
+            _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(q + 2)), cr),
+                _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(q + 3)), lf)));
+        uint32_t found = static_cast<uint32_t>(_mm256_movemask_epi8(m));
+        if (found)
+            return i + lowestBit(found) + 4;
+        i += 32;
+    }
+    return findHeadEndScalar(p, n, i);
+}
+
+#endif // HTTP_SCAN_X86
+
+} // namespace httpscan
+
+// CPU 支持的最高一级 / The highest level the CPU supports
+inline HttpScanLevel detectHttpScanLevel() {
+#if HTTP_SCAN_X86
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse42 = (info[2] & (1 << 20)) != 0;
+    bool osAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osAvx) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    bool sse42 = __builtin_cpu_supports("sse4.2");
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (avx2)
+        return HttpScanLevel::Avx2;
+    if (sse42)
+        return HttpScanLevel::Sse42;
+#endif
+    return HttpScanLevel::Scalar;
+}
+
+// 指定一级的扫描函数；CPU 不支持的级别退回到它支持的最高一级
+// The scanners of the given level; a level the CPU lacks falls back to the highest one it has.
+inline const HttpScanOps& httpScanOps(HttpScanLevel level) {
+    using namespace httpscan;
+    static const HttpScanOps scalar{ HttpScanLevel::Scalar, "scalar", skipTokenScalar, skipValueScalar, skipTargetScalar, findHeadEndScalar };
+#if HTTP_SCAN_X86
+    static const HttpScanOps sse42{ HttpScanLevel::Sse42, "sse4.2", skipTokenSse42, skipValueSse42, skipTargetSse42, findHeadEndSse42 };
+    static const HttpScanOps avx2{ HttpScanLevel::Avx2, "avx2", skipTokenAvx2, skipValueAvx2, skipTargetAvx2, findHeadEndAvx2 };
+    static const HttpScanLevel best = detectHttpScanLevel();
+    if (level > best)
+        level = best;
+    if (level == HttpScanLevel::Avx2)
+        return avx2;
+    if (level == HttpScanLevel::Sse42)
+        return sse42;
+#endif
+    (void)level;
+    return scalar;
+}
+
+// CPU 支持的最快实现 / The fastest implementation the CPU supports
+inline const HttpScanOps& httpScan() {
+    static const HttpScanOps& ops = httpScanOps(detectHttpScanLevel());
+    return ops;
+}
@@ -0,0 +1,335 @@
+// Logger.h
+// 异步日志：每个线程写自己的无锁环形缓冲区，后台线程批量写出
+// Asynchronous logger: every thread writes to its own lock-free ring, a background thread writes them out in batches
+//
+// 热路径上的一条日志只是在本线程的单生产者/单消费者环形缓冲区中格式化一条定长记录，
+// 既不加锁，也不调用 write/flush。后台线程每隔几毫秒取走所有线程的记录，按时间排序后
+// 一次写出并只刷新一次。环形缓冲区满时丢弃新记录并计数，日志永远不会让工作线程等待。
+// On the hot path a log call only formats one fixed-size record into the calling thread's
+// single-producer/single-consumer ring: no lock, no write, no flush. Every few milliseconds the
+// drain thread takes the records of all threads, sorts them by time, writes them in one go and
+// flushes once. A full ring drops the new record and counts it, so logging never makes a worker wait.
+//
+// 缓冲区起初只有 RING_INITIAL_CAPACITY 条记录（一页），满时由所属线程加倍，直到 RING_CAPACITY；
+// 每线程一个连接的服务器有上万个线程，大多数只写很少的日志，不应各占满额缓冲区。加倍时短暂持有 ringsLock，每线程最多六次。
+// A ring starts with RING_INITIAL_CAPACITY records (one page) and its owning thread doubles it when
+// full, up to RING_CAPACITY. A thread-per-connection server runs tens of thousands of threads, most
+// of which log little, and should not pay for a full ring in each. Growing briefly takes ringsLock,
+// at most six times per thread.
+//
+// 级别 / Levels:
+//   运行时由 setLevel 过滤；编译时定义 LOG_COMPILED_LEVEL（如 -DLOG_COMPILED_LEVEL=1）后，
+//   低于它的 LOG_xxx 调用展开为空，参数也不会被求值。
+//   Filtered at run time by setLevel. Defining LOG_COMPILED_LEVEL (e.g. -DLOG_COMPILED_LEVEL=1)
+//   expands LOG_xxx calls below it to nothing, so their arguments are not even evaluated.
+// 采样 / Sampling:
+//   LOG_xxx_EVERY(n, ...) 在每个线程上每 n 次调用只记录一次，用于可能刷屏的调用点。
+//   LOG_xxx_EVERY(n, ...) records one call in n per thread, for call sites that could flood the log.
+//
+// Debug/Info 写到标准输出，Warn/Error 写到标准错误。超过 LOG_TEXT_CAPACITY 的消息被截断。
+// Debug/Info go to stdout, Warn/Error to stderr. Messages longer than LOG_TEXT_CAPACITY are truncated.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+
+#ifndef LOG_COMPILED_LEVEL
+#define LOG_COMPILED_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LOG_PRINTF_FORMAT(fmt, args) __attribute__((format(printf, fmt, args)))
+#else
+#define LOG_PRINTF_FORMAT(fmt, args)
+#endif
+
+enum class LogLevel : uint8_t {
+    Debug = LOG_LEVEL_DEBUG,
+    Info = LOG_LEVEL_INFO,
+    Warn = LOG_LEVEL_WARN,
+    Error = LOG_LEVEL_ERROR,
+    Off
+};
+
+// 解析 debug|info|warn|error|off，失败返回 false / Parse debug|info|warn|error|off; returns false on failure
+inline bool parseLogLevel(const std::string& name, LogLevel& level) {
+    static const char* const names[] = { "debug", "info", "warn", "error", "off" };
+    for (int i = 0; i <= static_cast<int>(LogLevel::Off); ++i) {
+        if (name == names[i]) {
+            level = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+constexpr size_t LOG_RECORD_SIZE = 256;
+constexpr size_t LOG_TEXT_CAPACITY = LOG_RECORD_SIZE - 16;
+
+class Logger {
+public:
+    static Logger& instance() {
+        static Logger logger;
+        return logger;
+    }
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    // 进程退出时写出剩余的记录 / Write out whatever is left when the process exits
+    ~Logger() {
+        {
+            std::lock_guard<std::mutex> guard(drainLock);
+            stopping = true;
+        }
+        wake.notify_one();
+        drainThread.join();
+        for (ThreadRing* ring : rings)
+            delete ring;
+    }
+
+    void setLevel(LogLevel level) { minLevel.store(static_cast<uint8_t>(level), std::memory_order_relaxed); }
+    LogLevel level() const { return static_cast<LogLevel>(minLevel.load(std::memory_order_relaxed)); }
+    bool enabled(LogLevel level) const {
+        return static_cast<uint8_t>(level) >= minLevel.load(std::memory_order_relaxed);
+    }
+
+    // 格式化一条记录放入本线程的环形缓冲区；满时丢弃 / Format one record into this thread's ring; dropped when full
+    void write(LogLevel level, const char* format, ...) LOG_PRINTF_FORMAT(3, 4) {
+        ThreadRing& ring = localRing();
+        uint32_t head = ring.head.load(std::memory_order_relaxed);
+        if (head - ring.tail.load(std::memory_order_acquire) == ring.capacity && !grow(ring, head)) {
+            ring.dropped.store(ring.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        Record& r = ring.records[head & (ring.capacity - 1)];
+        r.timeNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+        r.level = level;
+        va_list args;
+        va_start(args, format);
+        int n = std::vsnprintf(r.text, LOG_TEXT_CAPACITY, format, args);
+        va_end(args);
+        r.length = static_cast<uint16_t>(std::min<size_t>(n < 0 ? 0 : static_cast<size_t>(n), LOG_TEXT_CAPACITY - 1));
+        ring.head.store(head + 1, std::memory_order_release);
+    }
+
+    // 等待后台线程写出此前记录的全部日志 / Wait until the drain thread has written everything logged so far
+    void flush() {
+        std::unique_lock<std::mutex> guard(drainLock);
+        uint64_t ticket = ++flushRequested;
+        wake.notify_one();
+        drained.wait(guard, [&] { return flushCompleted >= ticket || stopping; });
+    }
+
+    // 因缓冲区满而丢弃的记录数 / Records dropped because a ring was full
+    uint64_t dropped() const {
+        std::lock_guard<std::mutex> guard(ringsLock);
+        uint64_t total = droppedTotal;
+        for (const ThreadRing* ring : rings)
+            total += ring->dropped.load(std::memory_order_relaxed);
+        return total;
+    }
+
+private:
+    static constexpr uint32_t RING_INITIAL_CAPACITY = 16;   // 4 KiB；必须是 2 的幂 / 4 KiB; must be a power of two
+    static constexpr uint32_t RING_CAPACITY = 1024;         // 每线程最多的记录数，必须是 2 的幂 / Most records per thread; must be a power of two
+    static constexpr int DRAIN_INTERVAL_MS = 5;
+
+    // 一条定长记录 / One fixed-size record
+    struct Record {
+        uint64_t timeNs;
+        LogLevel level;
+        uint16_t length;
+        char text[LOG_TEXT_CAPACITY];
+    };
+    static_assert(sizeof(Record) == LOG_RECORD_SIZE, "Record must stay LOG_RECORD_SIZE bytes");
+
+    // 单生产者（所属线程）/单消费者（后台线程）环形缓冲区 / Single-producer (owning thread) / single-consumer (drain thread) ring
+    struct ThreadRing {
+        alignas(64) std::atomic<uint32_t> head{ 0 };      // 只由所属线程写入 / Written only by the owning thread
+        std::atomic<uint64_t> dropped{ 0 };               // 只由所属线程写入 / Written only by the owning thread
+        // 只由所属线程在 ringsLock 下替换，后台线程在 ringsLock 下读取 / Replaced only by the owning thread under ringsLock, read by the drain thread under ringsLock
+        uint32_t capacity{ RING_INITIAL_CAPACITY };
+        std::unique_ptr<Record[]> records{ new Record[RING_INITIAL_CAPACITY] };
+        alignas(64) std::atomic<uint32_t> tail{ 0 };      // 只由后台线程写入 / Written only by the drain thread
+        std::atomic<bool> retired{ false };               // 所属线程已退出 / The owning thread has exited
+    };
+
+    // 线程退出时标记其缓冲区，由后台线程写完后释放 / Marks the ring when its thread exits; the drain thread frees it once written out
+    struct RingOwner {
+        ThreadRing* ring{ nullptr };
+        ~RingOwner() {
+            if (ring)
+                ring->retired.store(true, std::memory_order_release);
+        }
+    };
+
+    std::atomic<uint8_t> minLevel{ static_cast<uint8_t>(LogLevel::Debug) };
+
+    mutable std::mutex ringsLock;                 // 保护 rings 与 droppedTotal / Guards rings and droppedTotal
+    std::vector<ThreadRing*> rings;
+    uint64_t droppedTotal{ 0 };                   // 已释放缓冲区的丢弃数 / Drops of rings already freed
+
+    std::mutex drainLock;                         // 保护以下成员 / Guards the members below
+    std::condition_variable wake;
+    std::condition_variable drained;
+    uint64_t flushRequested{ 0 };
+    uint64_t flushCompleted{ 0 };
+    bool stopping{ false };
+
+    std::thread drainThread;
+
+    Logger() : drainThread(&Logger::drainLoop, this) {}
+
+    ThreadRing& localRing() {
+        static thread_local RingOwner owner;
+        if (!owner.ring) {
+            owner.ring = new ThreadRing();
+            std::lock_guard<std::mutex> guard(ringsLock);
+            rings.push_back(owner.ring);
+        }
+        return *owner.ring;
+    }
+
+    // 把满了的缓冲区加倍，搬移未写出的记录；已达 RING_CAPACITY 时返回 false。持有 ringsLock 时后台线程不会读取
+    // Double a full ring and move the records not yet written out; false once it is at RING_CAPACITY.
+    // The drain thread does not read a ring while ringsLock is held.
+    bool grow(ThreadRing& ring, uint32_t head) {
+        if (ring.capacity == RING_CAPACITY)
+            return false;
+        std::lock_guard<std::mutex> guard(ringsLock);
+        uint32_t capacity = ring.capacity * 2;
+        std::unique_ptr<Record[]> records(new Record[capacity]);
+        for (uint32_t i = ring.tail.load(std::memory_order_relaxed); i != head; ++i)
+            records[i & (capacity - 1)] = ring.records[i & (ring.capacity - 1)];
+        ring.records = std::move(records);
+        ring.capacity = capacity;
+        return true;
+    }
+
+    void drainLoop() {
+        std::vector<Record> batch;
+        std::string out;
+        std::string err;
+        while (true) {
+            uint64_t ticket;
+            bool last;
+            {
+                std::unique_lock<std::mutex> guard(drainLock);
+                wake.wait_for(guard, std::chrono::milliseconds(DRAIN_INTERVAL_MS),
+                    [this] { return stopping || flushRequested > flushCompleted; });
+                ticket = flushRequested;
+                last = stopping;
+            }
+            drainOnce(batch, out, err);
+            {
+                std::lock_guard<std::mutex> guard(drainLock);
+                flushCompleted = ticket;
+            }
+            drained.notify_all();
+            if (last)
+                return;
+        }
+    }
+
+    // 取走所有缓冲区的记录，按时间排序后写出；已退出线程的空缓冲区被释放
+    // Take the records of every ring, sort them by time and write them; empty rings of exited threads are freed.
+    void drainOnce(std::vector<Record>& batch, std::string& out, std::string& err) {
+        batch.clear();
+        {
+            std::lock_guard<std::mutex> guard(ringsLock);
+            for (size_t i = 0; i < rings.size();) {
+                ThreadRing* ring = rings[i];
+                bool retired = ring->retired.load(std::memory_order_acquire);
+                uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+                uint32_t head = ring->head.load(std::memory_order_acquire);
+                for (; tail != head; ++tail)
+                    batch.push_back(ring->records[tail & (ring->capacity - 1)]);
+                ring->tail.store(tail, std::memory_order_release);
+                if (retired) {
+                    droppedTotal += ring->dropped.load(std::memory_order_relaxed);
+                    delete ring;
+                    rings[i] = rings.back();
+                    rings.pop_back();
+                    continue;
+                }
+                ++i;
+            }
+        }
+        if (batch.empty())
+            return;
+        std::stable_sort(batch.begin(), batch.end(),
+            [](const Record& a, const Record& b) { return a.timeNs < b.timeNs; });
+        out.clear();
+        err.clear();
+        for (const Record& r : batch) {
+            std::string& target = r.level >= LogLevel::Warn ? err : out;
+            target.append(r.text, r.length);
+            target.push_back('\n');
+        }
+        if (!out.empty()) {
+            std::fwrite(out.data(), 1, out.size(), stdout);
+            std::fflush(stdout);
+        }
+        if (!err.empty()) {
+            std::fwrite(err.data(), 1, err.size(), stderr);
+            std::fflush(stderr);
+        }
+    }
+};
+
+#define LOG_AT(level, ...)                                          \
+    do {                                                            \
+        if (Logger::instance().enabled(level))                      \
+            Logger::instance().write(level, __VA_ARGS__);           \
+    } while (0)
+
+#define LOG_AT_EVERY(level, n, ...)                                 \
+    do {                                                            \
+        static thread_local uint32_t logSampleCount_ = 0;           \
+        if (Logger::instance().enabled(level) && logSampleCount_++ % (n) == 0) \
+            Logger::instance().write(level, __VA_ARGS__);           \
+    } while (0)
+
+#if LOG_COMPILED_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) LOG_AT(LogLevel::Debug, __VA_ARGS__)
+#define LOG_DEBUG_EVERY(n, ...) LOG_AT_EVERY(LogLevel::Debug, n, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#define LOG_DEBUG_EVERY(n, ...) ((void)0)
+#endif
+
+#if LOG_COMPILED_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) LOG_AT(LogLevel::Info, __VA_ARGS__)
+#define LOG_INFO_EVERY(n, ...) LOG_AT_EVERY(LogLevel::Info, n, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#define LOG_INFO_EVERY(n, ...) ((void)0)
+#endif
+
+#if LOG_COMPILED_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) LOG_AT(LogLevel::Warn, __VA_ARGS__)
+#define LOG_WARN_EVERY(n, ...) LOG_AT_EVERY(LogLevel::Warn, n, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#define LOG_WARN_EVERY(n, ...) ((void)0)
+#endif
+
+#define LOG_ERROR(...) LOG_AT(LogLevel::Error, __VA_ARGS__)
@@ -0,0 +1,279 @@
+// Metrics.h
+// 运行时指标：每线程按缓存行对齐的计数槽，无锁汇总，以 Prometheus 文本格式在本地管理端口上输出
+// Runtime metrics: cache-line aligned per-thread counter slots, summed without locks and served
+// in the Prometheus text format on a local admin port
+//
+// 每个线程第一次记录时分配自己的槽并用一次 CAS 挂到全局链表上，之后只写自己的槽：一次普通的
+// 读和一次普通的写（relaxed），没有 lock 前缀指令，也不会与其他线程争用缓存行。抓取时沿链表
+// 读取所有槽并相加，不加锁，也不会让工作线程等待。
+// A thread allocates its slot on first use and links it onto a global list with one CAS; from
+// then on it only writes its own slot, with a plain relaxed load and store: no locked
+// instruction and no cache line shared with another thread. A scrape walks the list and sums
+// the slots without taking a lock, so it never makes a worker wait.
+//
+// 计量值（在途操作数等）由增减两部分组成，可能在一个线程上增加、在另一个线程上减少；
+// 单个槽可以为负，所有槽的和才是当前值。
+// A gauge (operations in flight, ...) may be raised on one thread and lowered on another; a
+// single slot can go negative and only the sum over all slots is the current value.
+//
+// 用法 / Usage: 调用者用自己的枚举给指标编号，启动时用 define 描述每一个，热路径上调用 add / observe。
+// The caller numbers its metrics with its own enum, describes each with define at startup and
+// calls add / observe on the hot path.
+
+#pragma once
+
+#include "Platform.h"
+#include "ObjectPool.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class MetricType {
+    Counter,    // 只增不减 / Only ever increases
+    Gauge,      // 当前值，可增可减 / Current value, goes up and down
+    Histogram   // 按上界分桶计数，另有总和 / Counts per upper bound, plus a sum
+};
+
+// 指标描述。同名的多个指标（不同标签）输出在同一组 HELP/TYPE 之下，必须连续编号
+// Metric description. Several metrics sharing a name (with different labels) are printed under
+// one HELP/TYPE pair and must be numbered consecutively.
+struct MetricInfo {
+    const char* name{ nullptr };
+    const char* labels{ nullptr };          // 例如 op="recv"，可为空 / e.g. op="recv", may be null
+    MetricType type{ MetricType::Counter };
+    const char* help{ "" };
+    std::vector<int64_t> bounds;            // 直方图各桶的上界（递增）/ Histogram bucket upper bounds (increasing)
+};
+
+class Metrics {
+public:
+    // 每个槽可容纳的值的个数；直方图占 bounds.size() + 2 个（各桶、+Inf 桶、总和）
+    // Values per slot; a histogram takes bounds.size() + 2 (its buckets, the +Inf bucket and the sum).
+    static constexpr size_t MAX_VALUES = 128;
+
+    static Metrics& instance() {
+        static Metrics metrics;
+        return metrics;
+    }
+
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    ~Metrics() {
+        for (Slot* s = slots.load(); s;) {
+            Slot* next = s->next;
+            delete s;
+            s = next;
+        }
+    }
+
+    // 描述编号为 id 的指标；直方图从 id 开始占用多个值，返回下一个可用的编号。应在工作线程启动前调用
+    // Describe metric id; a histogram takes several values from id on. Returns the next free id.
+    // Call this before the worker threads start.
+    size_t define(size_t id, MetricInfo info) {
+        size_t width = info.type == MetricType::Histogram ? info.bounds.size() + 2 : 1;
+        if (id + width > MAX_VALUES)
+            return id;
+        if (infos.size() < id + width)
+            infos.resize(id + width);
+        infos[id] = std::move(info);
+        return id + width;
+    }
+
+    // 计数或计量加 delta / Add delta to a counter or gauge
+    template <typename Id>
+    static void add(Id id, int64_t delta = 1) {
+        bump(localSlot().values[static_cast<size_t>(id)], delta);
+    }
+
+    // 记录直方图 id 的一个观测值 / Record one observation of histogram id
+    template <typename Id>
+    void observe(Id id, int64_t value) {
+        size_t base = static_cast<size_t>(id);
+        const std::vector<int64_t>& bounds = infos[base].bounds;
+        size_t bucket = 0;
+        while (bucket < bounds.size() && value > bounds[bucket])
+            ++bucket;
+        Slot& slot = localSlot();
+        bump(slot.values[base + bucket], 1);
+        bump(slot.values[base + bounds.size() + 1], value);
+    }
+
+    // 所有线程上的和 / Sum over all threads
+    template <typename Id>
+    int64_t value(Id id) const {
+        return sum(static_cast<size_t>(id));
+    }
+
+    // 以 Prometheus 文本格式 (0.0.4) 输出全部指标 / Render every metric in the Prometheus text format (0.0.4)
+    std::string render() const {
+        std::string out;
+        const char* lastName = nullptr;
+        for (size_t id = 0; id < infos.size(); ++id) {
+            const MetricInfo& info = infos[id];
+            if (!info.name)
+                continue;
+            if (!lastName || std::strcmp(lastName, info.name) != 0) {
+                static const char* const typeNames[] = { "counter", "gauge", "histogram" };
+                out += "# HELP " + std::string(info.name) + " " + info.help + "\n";
+                out += "# TYPE " + std::string(info.name) + " " + typeNames[static_cast<int>(info.type)] + "\n";
+                lastName = info.name;
+            }
+            if (info.type != MetricType::Histogram) {
+                appendSample(out, info.name, "", info.labels, nullptr, sum(id));
+                continue;
+            }
+            // 桶是累积的：le 桶包含所有不大于它的观测 / Buckets are cumulative: bucket le counts every observation at or below it
+            int64_t cumulative = 0;
+            for (size_t b = 0; b <= info.bounds.size(); ++b) {
+                cumulative += sum(id + b);
+                std::string le = b < info.bounds.size() ? std::to_string(info.bounds[b]) : "+Inf";
+                appendSample(out, info.name, "_bucket", info.labels, le.c_str(), cumulative);
+            }
+            appendSample(out, info.name, "_sum", info.labels, nullptr, sum(id + info.bounds.size() + 1));
+            appendSample(out, info.name, "_count", info.labels, nullptr, cumulative);
+        }
+        return out;
+    }
+
+private:
+    // 一个线程的槽，独占若干缓存行 / One thread's slot, occupying cache lines of its own
+    struct alignas(CACHE_LINE_SIZE) Slot {
+        std::atomic<int64_t> values[MAX_VALUES]{};
+        Slot* next{ nullptr };
+    };
+
+    std::atomic<Slot*> slots{ nullptr };    // 无锁链表，只增不减 / Lock-free list that only grows
+    std::vector<MetricInfo> infos;
+
+    Metrics() = default;
+
+    // 只有所属线程写入，因此读后写即可，不需要原子的读-改-写
+    // Only the owning thread writes, so a load followed by a store is enough; no atomic read-modify-write.
+    static void bump(std::atomic<int64_t>& v, int64_t delta) {
+        v.store(v.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    // 槽在线程退出后保留，已记录的计数不会丢失 / Slots outlive their threads so nothing counted is lost
+    static Slot& localSlot() {
+        static thread_local Slot* slot = nullptr;
+        if (!slot) {
+            slot = new Slot();
+            Metrics& m = instance();
+            slot->next = m.slots.load(std::memory_order_relaxed);
+            while (!m.slots.compare_exchange_weak(slot->next, slot, std::memory_order_release, std::memory_order_relaxed)) {}
+        }
+        return *slot;
+    }
+
+    int64_t sum(size_t index) const {
+        int64_t total = 0;
+        for (const Slot* s = slots.load(std::memory_order_acquire); s; s = s->next)
+            total += s->values[index].load(std::memory_order_relaxed);
+        return total;
+    }
+
+    static void appendSample(std::string& out, const char* name, const char* suffix, const char* labels, const char* le, int64_t value) {
+        out += name;
+        out += suffix;
+        if (labels || le) {
+            out += "{";
+            if (labels)
+                out += labels;
+            if (le) {
+                out += labels ? ",le=\"" : "le=\"";
+                out += le;
+                out += "\"";
+            }
+            out += "}";
+        }
+        out += " " + std::to_string(value) + "\n";
+    }
+};
+
+// 管理端口：在 127.0.0.1 上用一个独立的阻塞线程回答抓取请求，对任何请求都返回全部指标。
+// 它不经过完成引擎，抓取不会占用工作线程。
+// Admin port: a separate blocking thread on 127.0.0.1 answers scrapes, returning every metric
+// for any request. It does not go through the completion engine, so a scrape takes no worker time.
+class MetricsEndpoint {
+public:
+    MetricsEndpoint() = default;
+    MetricsEndpoint(const MetricsEndpoint&) = delete;
+    MetricsEndpoint& operator=(const MetricsEndpoint&) = delete;
+    ~MetricsEndpoint() { stop(); }
+
+    bool start(int port) {
+        listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (listenSocket == INVALID_SOCKET) {
+            std::cerr << "Failed to create admin socket. Error: " << WSAGetLastError() << std::endl;
+            return false;
+        }
+#ifndef _WIN32
+        int reuse = 1;
+        setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<unsigned short>(port));
+        InetPtonA(AF_INET, "127.0.0.1", &addr.sin_addr);
+        if (bind(listenSocket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR
+            || listen(listenSocket, 16) == SOCKET_ERROR) {
+            std::cerr << "Admin port " << port << " bind/listen failed. Error: " << WSAGetLastError() << std::endl;
+            closesocket(listenSocket);
+            listenSocket = INVALID_SOCKET;
+            return false;
+        }
+        thread = std::thread(&MetricsEndpoint::serve, this);
+        return true;
+    }
+
+    void stop() {
+        stopping = true;
+        if (thread.joinable())
+            thread.join();
+        if (listenSocket != INVALID_SOCKET) {
+            closesocket(listenSocket);
+            listenSocket = INVALID_SOCKET;
+        }
+    }
+
+private:
+    SOCKET listenSocket{ INVALID_SOCKET };
+    std::atomic<bool> stopping{ false };
+    std::thread thread;
+
+    void serve() {
+        while (!stopping) {
+            // 有限等待，以便及时发现 stop / Wait with a timeout so stop is noticed promptly
+            WSAPOLLFD poll{};
+            poll.fd = listenSocket;
+            poll.events = POLLIN;
+            if (WSAPoll(&poll, 1, 200) <= 0)
+                continue;
+            SOCKET client = accept(listenSocket, nullptr, nullptr);
+            if (client == INVALID_SOCKET)
+                continue;
+            // 读取请求头（内容被忽略），最多等 1 秒 / Read the request head (its content is ignored), waiting at most 1 s
+            char request[1024];
+            WSAPOLLFD readable{};
+            readable.fd = client;
+            readable.events = POLLIN;
+            if (WSAPoll(&readable, 1, 1000) > 0)
+                recv(client, request, sizeof(request), 0);
+            std::string body = Metrics::instance().render();
+            std::string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+                + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+            for (size_t sent = 0; sent < response.size();) {
+                int n = send(client, response.data() + sent, static_cast<int>(response.size() - sent), 0);
+                if (n <= 0)
+                    break;
+                sent += static_cast<size_t>(n);
+            }
+            closesocket(client);
+        }
+    }
+};
@@ -0,0 +1,252 @@
+// ObjectPool.h
+// 固定大小对象的分层空闲链表池：每线程缓存 + 共享链表 + 按 slab 向堆申请
+// Free-list pool for fixed-size objects: per-thread caches, a shared list, and slabs from the heap
+//
+// 每个线程从自己的空闲链表取、还对象，稳态下既不加锁也不调用堆分配器。
+// 本线程链表过长时把一批对象交给共享链表；为空时先从共享链表取一批，仍不够才向堆申请一个新的 slab。
+// 每个槽位按缓存行对齐，两个对象不会共享缓存行。
+// Each thread takes and returns objects on its own free list, so the steady state neither
+// locks nor calls the heap allocator. A list that grows too long hands a batch to the shared
+// list; an empty one first takes a batch from there and only then carves a new slab from the
+// heap. Slots are cache-line aligned so no two objects share a line.
+//
+// slab 分配在申请线程所在 NUMA 节点的内存上，共享链表每个节点一条：线程只从本节点的链表补充，
+// 交回的对象按其 slab 所在的节点回到对应的链表，因此固定在 CPU 上的线程拿到的总是本节点的内存。
+// 代价是每个节点各自保留自己的峰值容量。
+// Slabs are allocated from the memory of the requesting thread's NUMA node, and there is one
+// shared list per node: a thread refills only from its own node's list, and spilled objects go
+// back to the list of the node their slab lives on, so a thread pinned to a CPU always gets
+// memory of its own node. The price is that every node keeps its own peak capacity.
+// 只有一个节点时 slab 照旧用 operator new 申请，不必为每个 slab 单独映射页。
+// With a single node slabs come from operator new as before, rather than mapping pages for each.
+//
+// 统计 / Statistics:
+//   hits      从空闲链表取得的对象 / objects served from a free list
+//   misses    需要新 slab 的分配 / allocations that had to carve a new slab
+//   highWater 已从堆划出的槽位数（池的峰值容量）/ slots carved from the heap (peak capacity of the pool)
+//   inUse     当前未归还的对象 / objects not yet returned
+
+#pragma once
+
+#include "Topology.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+// 池的统计快照 / Snapshot of pool statistics
+struct PoolStats {
+    uint64_t hits{ 0 };
+    uint64_t misses{ 0 };
+    uint64_t highWater{ 0 };
+    int64_t inUse{ 0 };
+};
+
+template <typename T, size_t SlabObjects = 64>
+class ObjectPool {
+public:
+    ObjectPool() : id(nextPoolId().fetch_add(1) + 1), sharedHeads(static_cast<size_t>(CpuTopology::instance().nodeCount()), nullptr) {}
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    // 池销毁时所有对象都应已归还 / Every object must have been returned when the pool is destroyed
+    ~ObjectPool() {
+        for (ThreadCache* c : caches)
+            delete c;
+        for (const Slab& slab : slabs) {
+            if (sharedHeads.size() > 1)
+                freeNodeLocal(slab.base, SLAB_BYTES);
+            else
+                ::operator delete(slab.base, std::align_val_t{ CACHE_LINE_SIZE });
+        }
+    }
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        ThreadCache& cache = localCache();
+        Slot* slot = cache.head;
+        if (slot) {
+            bump(cache.hits);
+        }
+        else if ((slot = refill(cache)) != nullptr) {
+            bump(cache.hits);
+        }
+        else {
+            bump(cache.misses);
+            slot = carveSlab(cache);
+        }
+        cache.head = slot->next;
+        --cache.count;
+        bump(cache.created);
+        return new (slot->storage) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T* object) {
+        if (!object)
+            return;
+        object->~T();
+        ThreadCache& cache = localCache();
+        auto* slot = reinterpret_cast<Slot*>(object);
+        slot->next = cache.head;
+        cache.head = slot;
+        ++cache.count;
+        bump(cache.destroyed);
+        if (cache.count > 2 * SlabObjects)
+            spill(cache);
+    }
+
+    // 汇总各线程的计数；并发读取时是近似值 / Sum the per-thread counters; approximate while threads are running
+    PoolStats stats() const {
+        PoolStats s;
+        std::lock_guard<std::mutex> guard(sharedLock);
+        for (const ThreadCache* c : caches) {
+            s.hits += c->hits.load(std::memory_order_relaxed);
+            s.misses += c->misses.load(std::memory_order_relaxed);
+            s.inUse += static_cast<int64_t>(c->created.load(std::memory_order_relaxed))
+                - static_cast<int64_t>(c->destroyed.load(std::memory_order_relaxed));
+        }
+        s.highWater = slabs.size() * SlabObjects;
+        return s;
+    }
+
+private:
+    // 槽位：空闲时存放链表指针，使用时存放对象 / Slot: holds the list link when free, the object when in use
+    union alignas(CACHE_LINE_SIZE) Slot {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    // 每线程缓存；计数器只由所属线程写入 / Per-thread cache; counters are written only by the owning thread
+    struct alignas(CACHE_LINE_SIZE) ThreadCache {
+        Slot* head{ nullptr };
+        size_t count{ 0 };
+        size_t node{ 0 };                       // 线程创建缓存时所在的节点 / Node the thread ran on when the cache was created
+        std::thread::id owner;
+        std::atomic<uint64_t> hits{ 0 };
+        std::atomic<uint64_t> misses{ 0 };
+        std::atomic<uint64_t> created{ 0 };
+        std::atomic<uint64_t> destroyed{ 0 };
+    };
+
+    // 线程当前使用的池及其缓存 / The pool this thread last used and its cache
+    struct TlsEntry {
+        uint64_t poolId{ 0 };
+        ThreadCache* cache{ nullptr };
+    };
+
+    // 一个 slab 及其所在的节点 / A slab and the node it lives on
+    struct Slab {
+        char* base;
+        size_t node;
+    };
+
+    static constexpr size_t SLAB_BYTES = sizeof(Slot) * SlabObjects;
+
+    const uint64_t id;                          // 区分先后复用同一地址的池 / Tells apart pools reusing an address
+    mutable std::mutex sharedLock;              // 保护以下成员 / Guards the members below
+    std::vector<Slot*> sharedHeads;             // 每个节点一条共享链表 / One shared list per node
+    std::vector<Slab> slabs;                    // 按地址排序 / Sorted by address
+    std::vector<ThreadCache*> caches;
+
+    static std::atomic<uint64_t>& nextPoolId() {
+        static std::atomic<uint64_t> counter{ 0 };
+        return counter;
+    }
+
+    // 单写者计数，无需原子读改写 / Single-writer counter: no atomic read-modify-write needed
+    static void bump(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // 缓存与池同寿命；已退出线程缓存中的对象不再复用，因此假定工作线程长期存在
+    // Caches live as long as the pool; objects left in an exited thread's cache are not reused,
+    // so worker threads are assumed to be long-lived.
+    ThreadCache& localCache() {
+        static thread_local TlsEntry tls;
+        if (tls.poolId != id) {
+            std::lock_guard<std::mutex> guard(sharedLock);
+            ThreadCache* cache = nullptr;
+            for (ThreadCache* c : caches)
+                if (c->owner == std::this_thread::get_id())
+                    cache = c;
+            if (!cache) {
+                cache = new ThreadCache();
+                cache->owner = std::this_thread::get_id();
+                cache->node = std::min(static_cast<size_t>(currentNode()), sharedHeads.size() - 1);
+                caches.push_back(cache);
+            }
+            tls.poolId = id;
+            tls.cache = cache;
+        }
+        return *tls.cache;
+    }
+
+    // 从本节点的共享链表取一批 / Take a batch from this node's shared list
+    Slot* refill(ThreadCache& cache) {
+        std::lock_guard<std::mutex> guard(sharedLock);
+        Slot*& sharedHead = sharedHeads[cache.node];
+        for (size_t i = 0; i < SlabObjects && sharedHead; ++i) {
+            Slot* slot = sharedHead;
+            sharedHead = slot->next;
+            slot->next = cache.head;
+            cache.head = slot;
+            ++cache.count;
+        }
+        return cache.head;
+    }
+
+    // 把一批对象交给各自 slab 所在节点的共享链表 / Hand a batch to the shared lists of the nodes their slabs live on
+    void spill(ThreadCache& cache) {
+        std::lock_guard<std::mutex> guard(sharedLock);
+        for (size_t i = 0; i < SlabObjects; ++i) {
+            Slot* slot = cache.head;
+            cache.head = slot->next;
+            --cache.count;
+            Slot*& sharedHead = sharedHeads[homeNode(slot)];
+            slot->next = sharedHead;
+            sharedHead = slot;
+        }
+    }
+
+    // 槽位所在 slab 的节点（调用者持有 sharedLock） / Node of the slab holding a slot (sharedLock held)
+    size_t homeNode(const Slot* slot) const {
+        if (sharedHeads.size() == 1)
+            return 0;
+        auto* address = reinterpret_cast<const char*>(slot);
+        auto it = std::upper_bound(slabs.begin(), slabs.end(), address,
+            [](const char* a, const Slab& slab) { return a < slab.base; });
+        return it == slabs.begin() ? 0 : std::prev(it)->node;
+    }
+
+    // 在本节点上申请一个 slab，全部槽位放入本线程链表 / Allocate a slab on this node and put all its slots on this thread's list
+    Slot* carveSlab(ThreadCache& cache) {
+        Slot* slab;
+        if (sharedHeads.size() > 1) {
+            slab = static_cast<Slot*>(allocateNodeLocal(SLAB_BYTES, static_cast<int>(cache.node)));
+            if (!slab)
+                throw std::bad_alloc();
+        }
+        else {
+            slab = static_cast<Slot*>(::operator new(SLAB_BYTES, std::align_val_t{ CACHE_LINE_SIZE }));
+        }
+        {
+            std::lock_guard<std::mutex> guard(sharedLock);
+            Slab entry{ reinterpret_cast<char*>(slab), cache.node };
+            slabs.insert(std::upper_bound(slabs.begin(), slabs.end(), entry.base,
+                [](const char* a, const Slab& s) { return a < s.base; }), entry);
+        }
+        for (size_t i = SlabObjects; i-- > 0;) {
+            slab[i].next = cache.head;
+            cache.head = &slab[i];
+            ++cache.count;
+        }
+        return cache.head;
+    }
+};
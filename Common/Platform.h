@@ -0,0 +1,120 @@
+// Platform.h
+// 跨平台套接字适配层：在 Linux 上提供与 Winsock 同名的类型与函数
+// Cross-platform socket shim: provides Winsock-named types and functions on Linux
+//
+// 各阶段的代码按 Winsock 的写法编写（SOCKET、closesocket、WSAGetLastError ...），
+// 在 Windows 上直接使用系统头文件，在 Linux 上由本文件映射到 POSIX 接口。
+// Stage code is written against the Winsock API; on Windows the system headers are used
+// directly, on Linux this file maps the same names onto POSIX calls.
+
+#pragma once
+
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <mswsock.h>
+#include <windows.h>
+
+#pragma comment(lib, "Ws2_32.lib")
+
+// Winsock 没有 SIGPIPE，该标志在 Windows 上为空 / Winsock raises no SIGPIPE, so the flag is empty on Windows
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#else
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <cerrno>
+#include <cstdint>
+
+// Winsock 基本类型 / Basic Winsock types
+using SOCKET = int;
+using DWORD = std::uint32_t;
+using ULONG = unsigned long;
+using ULONG_PTR = std::uintptr_t;
+using BOOL = int;
+
+constexpr SOCKET INVALID_SOCKET = -1;
+constexpr int SOCKET_ERROR = -1;
+constexpr DWORD INFINITE = 0xFFFFFFFF;
+constexpr int SD_RECEIVE = SHUT_RD;
+constexpr int SD_SEND = SHUT_WR;
+constexpr int SD_BOTH = SHUT_RDWR;
+constexpr int WSAEWOULDBLOCK = EWOULDBLOCK;
+
+// 与 Winsock 布局一致的缓冲区描述 / Buffer descriptor with the Winsock field layout
+struct WSABUF {
+    ULONG len;
+    char* buf;
+};
+
+// WSAStartup / WSACleanup 在 Linux 上无需任何操作 / No-ops on Linux
+struct WSADATA {};
+inline unsigned short MAKEWORD(int low, int high) {
+    return static_cast<unsigned short>((low & 0xFF) | ((high & 0xFF) << 8));
+}
+inline int WSAStartup(unsigned short, WSADATA*) { return 0; }
+inline int WSACleanup() { return 0; }
+
+inline int closesocket(SOCKET s) { return ::close(s); }
+inline int WSAGetLastError() { return errno; }
+inline DWORD GetLastError() { return static_cast<DWORD>(errno); }
+inline int InetPtonA(int family, const char* src, void* dst) { return ::inet_pton(family, src, dst); }
+
+using WSAPOLLFD = pollfd;
+inline int WSAPoll(WSAPOLLFD* fds, ULONG count, int timeoutMs) { return ::poll(fds, count, timeoutMs); }
+
+#endif
+
+// 打开的文件，供 TransmitFile / sendfile 使用 / An open file, as used by TransmitFile / sendfile
+#ifdef _WIN32
+using FileHandle = HANDLE;
+#define INVALID_FILE_HANDLE INVALID_HANDLE_VALUE
+#else
+using FileHandle = int;
+constexpr FileHandle INVALID_FILE_HANDLE = -1;
+#endif
+
+// 将套接字设置为非阻塞模式 / Put a socket into non-blocking mode
+inline bool setNonBlocking(SOCKET s) {
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(s, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(s, F_GETFL, 0);
+    return flags != -1 && fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+// 关闭 Nagle 算法，小消息往返测试必须 / Disable Nagle; required for small-message round trips
+inline void setNoDelay(SOCKET s) {
+    int one = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+}
+
+// 接收时在网卡队列上忙轮询最多 us 微秒 (SO_BUSY_POLL)，只在 Linux 与支持它的网卡驱动上有效；
+// 超过 net.core.busy_read 的值需要 CAP_NET_ADMIN。Windows 上返回 false
+// Busy-poll the NIC queue for up to us microseconds on receive (SO_BUSY_POLL). Only Linux and NIC
+// drivers supporting it honor it, and values above net.core.busy_read need CAP_NET_ADMIN.
+// Returns false on Windows.
+inline bool setBusyPoll(SOCKET s, int us) {
+#ifdef _WIN32
+    (void)s;
+    (void)us;
+    return false;
+#else
+    return setsockopt(s, SOL_SOCKET, SO_BUSY_POLL, &us, sizeof(us)) == 0;
+#endif
+}
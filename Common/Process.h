@@ -0,0 +1,252 @@
+// Process.h
+// 基准测试用的子进程封装：启动服务器可执行文件，结束时终止并回收
+// Child process wrapper for benchmarks: start a server executable, terminate and reap it when done
+
+#pragma once
+
+#include "Platform.h"
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <psapi.h>
+#include <tlhelp32.h>
+#pragma comment(lib, "Psapi.lib")
+#else
+#include <csignal>
+#include <sys/wait.h>
+#endif
+
+class ChildProcess {
+public:
+    ChildProcess() = default;
+    ChildProcess(const ChildProcess&) = delete;
+    ChildProcess& operator=(const ChildProcess&) = delete;
+    ~ChildProcess() { terminate(); }
+
+    // 启动进程，args[0] 为可执行文件路径；outputPath 非空时把标准输出重定向到该文件
+    // Start the process; args[0] is the executable path. A non-empty outputPath receives its stdout.
+    bool start(const std::vector<std::string>& args, const std::string& outputPath = "") {
+#ifdef _WIN32
+        std::string commandLine;
+        for (const auto& a : args)
+            commandLine += "\"" + a + "\" ";
+        STARTUPINFOA si{};
+        si.cb = sizeof(si);
+        HANDLE output = INVALID_HANDLE_VALUE;
+        if (!outputPath.empty()) {
+            SECURITY_ATTRIBUTES sa{ sizeof(sa), nullptr, TRUE };
+            output = CreateFileA(outputPath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, &sa,
+                CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            si.dwFlags = STARTF_USESTDHANDLES;
+            si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+            si.hStdOutput = output;
+            si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+        }
+        PROCESS_INFORMATION pi{};
+        // 独立的进程组，以便之后发送 CTRL_BREAK 让它正常退出 / Own process group so CTRL_BREAK can stop it cleanly later
+        BOOL created = CreateProcessA(nullptr, &commandLine[0], nullptr, nullptr, output != INVALID_HANDLE_VALUE,
+            CREATE_NEW_PROCESS_GROUP, nullptr, nullptr, &si, &pi);
+        if (output != INVALID_HANDLE_VALUE)
+            CloseHandle(output);
+        if (!created)
+            return false;
+        CloseHandle(pi.hThread);
+        hProcess = pi.hProcess;
+        processId = pi.dwProcessId;
+        return true;
+#else
+        std::vector<char*> argv;
+        for (const auto& a : args)
+            argv.push_back(const_cast<char*>(a.c_str()));
+        argv.push_back(nullptr);
+        pid_t child = fork();
+        if (child == -1)
+            return false;
+        if (child == 0) {
+            if (!outputPath.empty()) {
+                int fd = ::open(outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                if (fd != -1) {
+                    dup2(fd, STDOUT_FILENO);
+                    ::close(fd);
+                }
+            }
+            // 不把父进程的套接字留给子进程：多线程的父进程 fork 时其他线程的客户端连接也会被继承，
+            // 客户端关闭后服务器仍看不到 EOF
+            // Keep the parent's sockets out of the child: fork in a multithreaded parent also copies
+            // other threads' client connections, and the server would not see EOF after they close.
+            ::close_range(3, ~0U, 0);
+            execv(argv[0], argv.data());
+            _exit(127);
+        }
+        processId = child;
+        return true;
+#endif
+    }
+
+    // 请求进程正常退出（Ctrl+Break / SIGTERM）并等待；超时后强制结束
+    // Ask the process to exit cleanly (Ctrl+Break / SIGTERM) and wait; kill it after a timeout.
+    void terminate() {
+#ifdef _WIN32
+        if (hProcess) {
+            GenerateConsoleCtrlEvent(CTRL_BREAK_EVENT, processId);
+            if (WaitForSingleObject(hProcess, 5000) != WAIT_OBJECT_0)
+                TerminateProcess(hProcess, 0);
+            WaitForSingleObject(hProcess, INFINITE);
+            CloseHandle(hProcess);
+            hProcess = nullptr;
+        }
+#else
+        if (processId > 0) {
+            kill(processId, SIGTERM);
+            int status = 0;
+            for (int i = 0; i < 500; ++i) {
+                if (waitpid(processId, &status, WNOHANG) == processId) {
+                    processId = 0;
+                    return;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            kill(processId, SIGKILL);
+            waitpid(processId, &status, 0);
+        }
+#endif
+        processId = 0;
+    }
+
+    // 等待进程自行退出，最多 timeoutMs 毫秒；已退出时返回 true
+    // Wait up to timeoutMs for the process to exit on its own; returns true once it has.
+    bool waitExit(int timeoutMs) {
+#ifdef _WIN32
+        if (!hProcess)
+            return true;
+        if (WaitForSingleObject(hProcess, static_cast<DWORD>(timeoutMs)) != WAIT_OBJECT_0)
+            return false;
+        CloseHandle(hProcess);
+        hProcess = nullptr;
+#else
+        if (processId <= 0)
+            return true;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        int status = 0;
+        while (waitpid(processId, &status, WNOHANG) != processId) {
+            if (std::chrono::steady_clock::now() >= deadline)
+                return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+#endif
+        processId = 0;
+        return true;
+    }
+
+    long pid() const { return static_cast<long>(processId); }
+
+    // 进程当前的常驻内存（工作集）字节数，失败时返回 0 / Current resident memory (working set) in bytes, 0 on failure
+    size_t residentBytes() const {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters{};
+        if (!hProcess || !GetProcessMemoryInfo(hProcess, &counters, sizeof(counters)))
+            return 0;
+        return counters.WorkingSetSize;
+#else
+        return statusField("VmRSS: %zu kB") * 1024;
+#endif
+    }
+
+    // 进程至今消耗的 CPU 时间（用户态 + 内核态，秒），失败时返回 0
+    // CPU time the process has used so far (user + kernel, seconds), 0 on failure
+    double cpuSeconds() const {
+#ifdef _WIN32
+        FILETIME created, exited, kernel, user;
+        if (!hProcess || !GetProcessTimes(hProcess, &created, &exited, &kernel, &user))
+            return 0;
+        auto ticks = [](const FILETIME& t) { return (static_cast<uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime; };
+        return static_cast<double>(ticks(kernel) + ticks(user)) / 1e7;  // 100 ns 为单位 / In 100 ns units
+#else
+        if (processId <= 0)
+            return 0;
+        std::string path = "/proc/" + std::to_string(processId) + "/stat";
+        FILE* f = std::fopen(path.c_str(), "r");
+        if (!f)
+            return 0;
+        char line[1024];
+        bool ok = std::fgets(line, sizeof(line), f) != nullptr;
+        std::fclose(f);
+        // 进程名可能含空格，从最后一个 ')' 之后数字段：utime、stime 是第 14、15 个字段
+        // The command name may contain spaces, so count fields after the last ')': utime and stime are fields 14 and 15.
+        const char* rest = ok ? std::strrchr(line, ')') : nullptr;
+        unsigned long long utime = 0, stime = 0;
+        if (!rest || std::sscanf(rest + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) != 2)
+            return 0;
+        return static_cast<double>(utime + stime) / static_cast<double>(sysconf(_SC_CLK_TCK));
+#endif
+    }
+
+    // 进程当前的线程数，失败时返回 0 / Current number of threads in the process, 0 on failure
+    size_t threadCount() const {
+#ifdef _WIN32
+        HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+        if (snapshot == INVALID_HANDLE_VALUE)
+            return 0;
+        size_t count = 0;
+        THREADENTRY32 entry{};
+        entry.dwSize = sizeof(entry);
+        for (BOOL ok = Thread32First(snapshot, &entry); ok; ok = Thread32Next(snapshot, &entry))
+            if (entry.th32OwnerProcessID == processId)
+                ++count;
+        CloseHandle(snapshot);
+        return count;
+#else
+        return statusField("Threads: %zu");
+#endif
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE hProcess{ nullptr };
+    DWORD processId{ 0 };
+#else
+    pid_t processId{ 0 };
+
+    // 从 /proc/<pid>/status 读取一个数值字段，format 为该行的 sscanf 格式 / Read one numeric field of /proc/<pid>/status; format is the sscanf pattern of its line
+    size_t statusField(const char* format) const {
+        if (processId <= 0)
+            return 0;
+        std::string path = "/proc/" + std::to_string(processId) + "/status";
+        FILE* f = std::fopen(path.c_str(), "r");
+        if (!f)
+            return 0;
+        char line[256];
+        size_t value = 0;
+        while (std::fgets(line, sizeof(line), f)) {
+            if (std::sscanf(line, format, &value) == 1)
+                break;
+        }
+        std::fclose(f);
+        return value;
+    }
+#endif
+};
+
+// 反复尝试连接，直到服务器开始监听或超时 / Retry connecting until the server listens or the timeout expires
+inline bool waitForPort(const char* ip, int port, int timeoutMs) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (std::chrono::steady_clock::now() < deadline) {
+        SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<unsigned short>(port));
+        InetPtonA(AF_INET, ip, &addr.sin_addr);
+        bool ok = connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != SOCKET_ERROR;
+        closesocket(s);
+        if (ok)
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    return false;
+}
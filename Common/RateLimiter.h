@@ -0,0 +1,280 @@
+// RateLimiter.h
+// 按客户端地址的令牌桶限速表：无锁、分组、容量固定
+// Token buckets keyed by client address: lock-free, split into sets, fixed capacity
+//
+// 表由 64 字节的组构成，每组 4 个槽，地址的哈希决定它所在的组，查找只读一条缓存行。
+// 组之间不共享任何状态，就是表的分片；槽的键与状态各是一个 64 位原子量，
+// 状态把上次补充的时间（毫秒）与令牌数打包在一起，用一次 CAS 更新。
+// 组满时替换其中已经补满的桶（替换它不丢失任何信息），没有就替换最久未补充的桶，
+// 因此内存固定为 16 字节 × 容量，而正在被限速的客户端的桶会留在表中。
+// The table consists of 64-byte sets of 4 slots; an address's hash picks its set, so a lookup
+// reads one cache line. The sets share no state and are the table's shards. A slot's key and
+// state are one 64-bit atomic each; the state packs the time of the last refill (ms) and the
+// token count and is updated with one CAS. When a set is full the bucket that has refilled
+// completely is replaced (replacing it loses nothing), otherwise the one refilled longest ago,
+// so memory stays at 16 bytes per entry while the buckets of clients being limited stay put.
+//
+// 替换时先换键再重置状态，其间另一个线程可能用被替换客户端的余额检查新客户端一次；
+// 两个线程同时为同一地址占用两个槽时，之后的查找总是落在前一个槽上。两者都只让限速短暂地不精确。
+// A replacement swaps the key first and resets the state after it, so in between another thread
+// may check the new client once against the old client's balance. Two threads claiming two slots
+// for one address at the same time leave later lookups on the first of them. Either only makes
+// the limit briefly inexact.
+
+#pragma once
+
+#include "Platform.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+// 超过限速时的处理 / What happens above the limit
+enum class LimitAction {
+    Delay,   // 推迟下一次读取，让 TCP 流控把压力推回客户端 / Postpone the next read so TCP flow control pushes back on the client
+    Drop,    // 关闭连接 / Close the connection
+    Busy     // 回复忙碌后关闭连接 / Reply busy, then close the connection
+};
+
+// 解析 delay|drop|busy，失败返回 false / Parse delay|drop|busy; returns false on failure
+inline bool parseLimitAction(const std::string& name, LimitAction& action) {
+    if (name == "delay")
+        action = LimitAction::Delay;
+    else if (name == "drop")
+        action = LimitAction::Drop;
+    else if (name == "busy")
+        action = LimitAction::Busy;
+    else
+        return false;
+    return true;
+}
+
+// 每秒补充 rate 个令牌，最多存 burst 个；rate 为 0 表示不限速
+// rate tokens are added per second and at most burst are kept; a rate of 0 means no limit.
+struct RateLimit {
+    uint32_t rate{ 0 };
+    uint32_t burst{ 0 };
+};
+
+// 解析 RATE[:BURST]，BURST 默认等于 RATE（一秒的量） / Parse RATE[:BURST]; BURST defaults to RATE (one second's worth)
+inline bool parseRateLimit(const std::string& text, RateLimit& limit) {
+    char* end = nullptr;
+    unsigned long long rate = std::strtoull(text.c_str(), &end, 10);
+    unsigned long long burst = rate;
+    if (end == text.c_str())
+        return false;
+    if (*end == ':') {
+        const char* from = end + 1;
+        burst = std::strtoull(from, &end, 10);
+        if (end == from)
+            return false;
+    }
+    if (*end != '\0' || rate == 0 || burst == 0 || rate > INT32_MAX || burst > INT32_MAX)
+        return false;
+    limit.rate = static_cast<uint32_t>(rate);
+    limit.burst = static_cast<uint32_t>(burst);
+    return true;
+}
+
+// 地址的键：IPv4（含映射到 IPv6 的）为地址本身，IPv6 为 128 位的哈希；0 表示不认识的地址族
+// The key of an address: an IPv4 address (mapped into IPv6 or not) is itself, an IPv6 address a
+// hash of its 128 bits; 0 for an unknown family.
+inline uint64_t addressKey(const sockaddr_in& addr) {
+    return (uint64_t{ 1 } << 32) | ntohl(addr.sin_addr.s_addr);
+}
+
+inline uint64_t addressKey(const sockaddr* addr) {
+    if (addr->sa_family == AF_INET)
+        return addressKey(*reinterpret_cast<const sockaddr_in*>(addr));
+    if (addr->sa_family == AF_INET6) {
+        const auto* bytes = reinterpret_cast<const sockaddr_in6*>(addr)->sin6_addr.s6_addr;
+        static const unsigned char mapped[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff };
+        if (std::memcmp(bytes, mapped, sizeof(mapped)) == 0)
+            return (uint64_t{ 1 } << 32) | (uint32_t{ bytes[12] } << 24) | (uint32_t{ bytes[13] } << 16)
+                | (uint32_t{ bytes[14] } << 8) | bytes[15];
+        uint64_t h = 0xcbf29ce484222325ULL;
+        for (int i = 0; i < 16; ++i)
+            h = (h ^ bytes[i]) * 0x100000001b3ULL;
+        return h | (uint64_t{ 1 } << 63);
+    }
+    return 0;
+}
+
+// 已连接套接字对端的键，失败时为 0 / The key of a connected socket's peer; 0 on failure
+inline uint64_t peerKey(SOCKET s) {
+    sockaddr_storage addr{};
+    socklen_t len = sizeof(addr);
+    if (getpeername(s, reinterpret_cast<sockaddr*>(&addr), &len) != 0)
+        return 0;
+    return addressKey(reinterpret_cast<const sockaddr*>(&addr));
+}
+
+class RateLimiter {
+public:
+    static constexpr size_t WAYS = 4;   // 每组的槽数 / Slots per set
+    static constexpr uint32_t REFUSED = UINT32_MAX;   // take 拒绝欠下更多令牌 / take refuses to run up more debt
+
+    // entries 向上取整为 4 的 2 的幂倍 / entries is rounded up to four times a power of two
+    RateLimiter(size_t entries, RateLimit limit) : rate(limit.rate), burst(static_cast<int32_t>(limit.burst)) {
+        size_t count = 1;
+        while (count * WAYS < entries)
+            count <<= 1;
+        sets = std::make_unique<Set[]>(count);
+        mask = count - 1;
+    }
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    size_t capacity() const { return (mask + 1) * WAYS; }
+
+    // 从 key 的桶中取 cost 个令牌。取到返回 0，否则返回还需等待的毫秒数；超过 burst 的 cost 按 burst 计，否则永远取不到。
+    // debt 为 true 时令牌不足也扣除 cost，余额可以为负，但最多欠一个 burst，返回余额回到非负还需的毫秒数；
+    // 已经欠着、再扣就超过一个 burst 时不扣除，返回 REFUSED。因此等待最多 burst / rate 秒，
+    // 超过这个量的请求由调用者拒绝，而不是越排越久。key 为 0 时总是放行。nowMs 来自单调时钟，只用到它的低 32 位。
+    // Take cost tokens from key's bucket. Returns 0 when they were taken, else the ms to wait until
+    // they would be; a cost above burst counts as burst, which could never be taken otherwise. With
+    // debt the cost is taken even when the tokens fall short and the balance may go negative, but by
+    // one burst at most; the return value is then the ms until it is non-negative again. When the
+    // bucket is already in debt and the cost would take it past one burst, nothing is taken and
+    // REFUSED is returned. Waits are therefore bounded by burst / rate seconds, and the caller
+    // refuses what goes beyond that instead of queueing it ever longer. A key of 0 is always
+    // admitted. nowMs comes from a monotonic clock, and only its low 32 bits are used.
+    uint32_t take(uint64_t key, uint32_t cost, int64_t nowMs, bool debt = false) {
+        if (key == 0)
+            return 0;
+        uint32_t now = static_cast<uint32_t>(nowMs);
+        int64_t need = debt ? cost : std::min<uint32_t>(cost, static_cast<uint32_t>(burst));
+        Slot& slot = find(key, now);
+        uint64_t old = slot.state.load(std::memory_order_relaxed);
+        while (true) {
+            uint32_t stamp = static_cast<uint32_t>(old >> 32);
+            int32_t tokens = refill(static_cast<int32_t>(static_cast<uint32_t>(old)), stamp, now);
+            uint32_t wait = 0;
+            if (tokens >= need)
+                tokens -= static_cast<int32_t>(need);
+            else if (debt) {
+                if (tokens < 0 && tokens - need < -static_cast<int64_t>(burst))
+                    return REFUSED;
+                tokens = static_cast<int32_t>(std::max<int64_t>(tokens - need, -static_cast<int64_t>(burst)));
+                wait = waitFor(-tokens);
+            }
+            else
+                return waitFor(static_cast<int32_t>(need - tokens));
+            if (slot.state.compare_exchange_weak(old, pack(stamp, tokens), std::memory_order_relaxed))
+                return wait;
+        }
+    }
+
+    // 单调时钟的毫秒数，供没有自己时钟的调用者使用 / Monotonic ms for callers without a clock of their own
+    static int64_t clockMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> key{ 0 };     // 0 表示空槽 / 0 marks an empty slot
+        std::atomic<uint64_t> state{ 0 };   // 高 32 位为补充时间，低 32 位为令牌数（有符号） / Refill time in the high 32 bits, signed tokens in the low 32
+    };
+    struct alignas(64) Set {
+        Slot slots[WAYS];
+    };
+
+    // 各线程的时钟最多相差这么多（分片的循环时钟只在每轮更新） / How far apart threads' clocks may be (a shard's loop clock updates once per turn)
+    static constexpr uint32_t CLOCK_SKEW_MS = 60 * 1000;
+
+    const uint32_t rate;
+    const int32_t burst;
+    std::unique_ptr<Set[]> sets;
+    size_t mask{ 0 };
+
+    static uint64_t pack(uint32_t stamp, int32_t tokens) {
+        return (uint64_t{ stamp } << 32) | static_cast<uint32_t>(tokens);
+    }
+
+    static uint64_t mix(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    // 补满 deficit 个令牌所需的毫秒数 / Milliseconds until deficit tokens have been added
+    uint32_t waitFor(int32_t deficit) const {
+        uint64_t ms = (static_cast<uint64_t>(deficit) * 1000 + rate - 1) / rate;
+        return static_cast<uint32_t>(std::max<uint64_t>(1, std::min<uint64_t>(ms, REFUSED - 1)));
+    }
+
+    // 按经过的时间补充令牌。只按补进的整数个令牌推进 stamp（向上取整到毫秒，速率高于每毫秒一个令牌时
+    // 舍去不足一个令牌的零头），其余时间留到下次。
+    // 经过的时间按无符号差计算，2^32 毫秒（约 49.7 天）以内都读得正确；只有差值在 2^32 之下 CLOCK_SKEW_MS 以内时
+    // 才当作另一个线程的时钟稍快。超过 49.7 天未用的桶按除以 2^32 毫秒的余数计，最坏时比补满晚一个 2 × burst / rate 秒
+    // Add tokens for the time elapsed. stamp advances by the time of the whole tokens added, rounded
+    // up to a millisecond (dropping the fraction of a token when the rate exceeds one per ms); the
+    // rest of the time carries over.
+    // The elapsed time is the unsigned difference, so it reads correctly up to 2^32 ms (about 49.7
+    // days); only a difference within CLOCK_SKEW_MS of 2^32 counts as another thread's clock having
+    // run ahead. A bucket unused for longer than 49.7 days is read modulo 2^32 ms, and at worst
+    // reaches full 2 * burst / rate seconds late.
+    int32_t refill(int32_t tokens, uint32_t& stamp, uint32_t now) const {
+        uint32_t elapsed = now - stamp;
+        if (elapsed == 0 || elapsed > UINT32_MAX - CLOCK_SKEW_MS)
+            return tokens;   // 另一个线程的时钟稍快 / Another thread's clock ran slightly ahead
+        uint64_t missing = static_cast<uint64_t>(static_cast<int64_t>(burst) - tokens);
+        if (static_cast<uint64_t>(elapsed) * rate >= missing * 1000) {
+            stamp = now;
+            return burst;
+        }
+        uint64_t added = static_cast<uint64_t>(elapsed) * rate / 1000;
+        stamp += static_cast<uint32_t>((added * 1000 + rate - 1) / rate);
+        return tokens + static_cast<int32_t>(added);
+    }
+
+    // key 的槽；不在表中时占用第一个空槽，组满则替换补满的或最久未补充的桶。
+    // 槽只会从空变为有键，不会变回空，所以空槽之后不会再有已占用的槽。
+    // key's slot. When it is not in the table the first empty slot is claimed, or if the set is
+    // full the bucket that has refilled completely or else the one refilled longest ago is
+    // replaced. Slots only ever go from empty to keyed, never back, so no keyed slot follows an
+    // empty one.
+    Slot& find(uint64_t key, uint32_t now) {
+        Set& set = sets[mix(key) & mask];
+        while (true) {
+            Slot* victim = nullptr;
+            uint64_t victimKey = 0;
+            uint32_t victimAge = 0;
+            for (Slot& slot : set.slots) {
+                uint64_t k = slot.key.load(std::memory_order_acquire);
+                if (k == key)
+                    return slot;
+                if (k == 0) {
+                    victim = &slot;
+                    victimKey = 0;
+                    break;
+                }
+                uint64_t state = slot.state.load(std::memory_order_relaxed);
+                uint32_t stamp = static_cast<uint32_t>(state >> 32);
+                uint32_t age = now - stamp;
+                if (refill(static_cast<int32_t>(static_cast<uint32_t>(state)), stamp, now) == burst)
+                    age = UINT32_MAX;   // 已补满，替换它等于新建 / Full again; replacing it is as good as new
+                if (!victim || age > victimAge) {
+                    victim = &slot;
+                    victimKey = k;
+                    victimAge = age;
+                }
+            }
+            if (victim->key.compare_exchange_strong(victimKey, key, std::memory_order_acq_rel)) {
+                victim->state.store(pack(now, burst), std::memory_order_relaxed);
+                return *victim;
+            }
+            // 另一个线程先改了这个槽，重新查找 / Another thread changed the slot first; look again
+        }
+    }
+};
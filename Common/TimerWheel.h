@@ -0,0 +1,137 @@
+// TimerWheel.h
+// 分层时间轮：以 tick 为单位的定时器，布防、取消与到期都是 O(1)
+// Hierarchical timing wheel: timers counted in ticks, with O(1) arm, cancel and expiry
+//
+// 共 4 层，每层 256 个槽。到期时间距现在不足 256 个 tick 的定时器放在第 0 层，按到期 tick
+// 直接定位槽；更远的按距离放到更高层。第 0 层每转一圈，把第 1 层的下一个槽重新分配到
+// 第 0 层（第 1 层转一圈时对第 2 层同样处理，依此类推），因此每个 tick 只处理一个第 0 层的槽，
+// 加上偶尔一次较高层的分配，与定时器总数无关。4 层共覆盖 2^32 个 tick。
+// There are 4 levels of 256 slots. A timer due in fewer than 256 ticks sits on level 0, in the
+// slot of its expiry tick; later timers go to higher levels by distance. Whenever level 0 wraps,
+// the next slot of level 1 is redistributed downwards (and likewise level 2 when level 1 wraps,
+// and so on), so a tick handles one level-0 slot plus the occasional cascade, independent of how
+// many timers exist. The 4 levels span 2^32 ticks.
+//
+// 定时器节点嵌入在所有者中（侵入式双向链表），布防与取消不分配内存。
+// 时间轮本身不加锁，由调用者串行化。
+// Timer nodes are embedded in their owners (an intrusive doubly-linked list), so arming and
+// cancelling never allocate. The wheel itself takes no lock; callers serialize access.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 定时器节点 / Timer node
+struct TimerNode {
+    TimerNode* prev{ nullptr };
+    TimerNode* next{ nullptr };     // 非空表示已布防 / Non-null while armed
+    uint64_t expires{ 0 };          // 到期 tick / Expiry tick
+    void* context{ nullptr };       // 所有者 / Owner
+
+    bool armed() const { return next != nullptr; }
+};
+
+class TimerWheel {
+public:
+    static constexpr unsigned SLOT_BITS = 8;
+    static constexpr unsigned SLOTS = 1u << SLOT_BITS;
+    static constexpr unsigned LEVELS = 4;
+    static constexpr uint64_t MAX_DELAY = (uint64_t{ 1 } << (SLOT_BITS * LEVELS)) - 1;
+
+    explicit TimerWheel(uint64_t startTick = 0) : current(startTick) {
+        for (auto& level : slots)
+            for (auto& head : level)
+                head.prev = head.next = &head;
+    }
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // 当前 tick 与已布防的定时器数 / Current tick and number of armed timers
+    uint64_t now() const { return current; }
+    size_t size() const { return count; }
+
+    // 在 expires 时到期；不晚于当前 tick 的在下一个 tick 到期。已布防的先取消
+    // Expire at tick expires; anything not after the current tick fires on the next one. An armed node is cancelled first.
+    void schedule(TimerNode* node, uint64_t expires) {
+        cancel(node);
+        if (expires <= current)
+            expires = current + 1;
+        if (expires - current > MAX_DELAY)
+            expires = current + MAX_DELAY;
+        node->expires = expires;
+        insert(node);
+        ++count;
+    }
+
+    void cancel(TimerNode* node) {
+        if (!node->armed())
+            return;
+        unlink(node);
+        --count;
+    }
+
+    // 推进到 tick to，对每个到期的定时器调用 onExpire(node)；回调时节点已取消，可以重新布防
+    // Advance to tick to and call onExpire(node) for every timer that comes due; the node is
+    // already cancelled during the callback and may be armed again.
+    template <typename OnExpire>
+    size_t advance(uint64_t to, OnExpire&& onExpire) {
+        size_t fired = 0;
+        while (current < to) {
+            ++current;
+            // 低层转完一圈时把上一层的下一个槽分配下来 / When a lower level wraps, redistribute the next slot of the level above
+            for (unsigned level = 1; level < LEVELS; ++level) {
+                if ((current & ((uint64_t{ 1 } << (SLOT_BITS * level)) - 1)) != 0)
+                    break;
+                cascade(level, slotIndex(current, level));
+            }
+            TimerNode& head = slots[0][slotIndex(current, 0)];
+            while (head.next != &head) {
+                TimerNode* node = head.next;
+                unlink(node);
+                --count;
+                ++fired;
+                onExpire(node);
+            }
+        }
+        return fired;
+    }
+
+private:
+    TimerNode slots[LEVELS][SLOTS];     // 每个槽是一个带哨兵的环形链表 / Each slot is a circular list with a sentinel
+    uint64_t current;
+    size_t count{ 0 };
+
+    static unsigned slotIndex(uint64_t tick, unsigned level) {
+        return static_cast<unsigned>((tick >> (SLOT_BITS * level)) & (SLOTS - 1));
+    }
+
+    // 按距离选层，按到期 tick 选槽 / Choose the level by distance and the slot by expiry tick
+    void insert(TimerNode* node) {
+        uint64_t delta = node->expires - current;
+        unsigned level = 0;
+        while (level + 1 < LEVELS && delta >= (uint64_t{ 1 } << (SLOT_BITS * (level + 1))))
+            ++level;
+        TimerNode& head = slots[level][slotIndex(node->expires, level)];
+        node->prev = head.prev;
+        node->next = &head;
+        head.prev->next = node;
+        head.prev = node;
+    }
+
+    static void unlink(TimerNode* node) {
+        node->prev->next = node->next;
+        node->next->prev = node->prev;
+        node->prev = node->next = nullptr;
+    }
+
+    void cascade(unsigned level, unsigned index) {
+        TimerNode& head = slots[level][index];
+        while (head.next != &head) {
+            TimerNode* node = head.next;
+            unlink(node);
+            insert(node);
+        }
+    }
+};
@@ -0,0 +1,224 @@
+// Topology.h
+// CPU 与 NUMA 拓扑：逻辑 CPU 所属的节点、把线程绑定到 CPU、套接字的接收 CPU 与节点本地内存
+// CPU and NUMA topology: the node of each logical CPU, pinning threads to CPUs, the receiving
+// CPU of a socket, and node-local memory
+//
+// 双路服务器上线程若被调度到另一个节点，它访问的连接状态与缓冲区就要跨节点互连读取。
+// 这里的函数让服务器把工作线程固定在指定的 CPU 上、把连接交给接收其数据包的 CPU 上的线程，
+// 并从该线程所在节点的内存中分配对象（见 ObjectPool.h）。单节点的机器上节点总是 0。
+// On a dual-socket server a thread scheduled onto the other node reads the connection state and
+// buffers it touches across the interconnect. These functions let a server pin its workers to
+// given CPUs, hand each connection to the worker on the CPU that receives its packets, and
+// allocate objects from the memory of that worker's node (see ObjectPool.h). On a single-node
+// machine the node is always 0.
+//
+// Linux 从 /sys/devices/system/node 读取拓扑，Windows 使用 GetNumaProcessorNodeEx；
+// Windows 的 CPU 编号为 处理器组 * 64 + 组内编号。
+// Linux reads the topology from /sys/devices/system/node and Windows uses
+// GetNumaProcessorNodeEx; on Windows a CPU number is processor group * 64 + number in the group.
+
+#pragma once
+
+#include "Platform.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <mstcpip.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <fstream>
+#endif
+
+// 解析 "0-3,8,10-11" 形式的 CPU 列表；格式错误时返回 false
+// Parse a CPU list such as "0-3,8,10-11"; returns false when it is malformed.
+inline bool parseCpuList(const std::string& text, std::vector<int>& cpus) {
+    cpus.clear();
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find(',', pos);
+        if (end == std::string::npos)
+            end = text.size();
+        std::string item = text.substr(pos, end - pos);
+        size_t dash = item.find('-');
+        char* tail = nullptr;
+        long first = std::strtol(item.c_str(), &tail, 10);
+        long last = first;
+        if (tail == item.c_str() || first < 0)
+            return false;
+        if (dash != std::string::npos) {
+            const char* from = item.c_str() + dash + 1;
+            last = std::strtol(from, &tail, 10);
+            if (tail == from || last < first)
+                return false;
+        }
+        if (*tail != '\0')
+            return false;
+        for (long cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(static_cast<int>(cpu));
+        pos = end + 1;
+    }
+    return !cpus.empty();
+}
+
+// 机器的 CPU 与节点，启动时读取一次 / The machine's CPUs and nodes, read once at startup
+class CpuTopology {
+public:
+    static const CpuTopology& instance() {
+        static const CpuTopology topology;
+        return topology;
+    }
+
+    int cpuCount() const { return static_cast<int>(nodeOfCpu.size()); }
+    int nodeCount() const { return nodes; }
+    // CPU 所属的节点，未知的 CPU 属于节点 0 / The node of a CPU; unknown CPUs belong to node 0
+    int nodeOf(int cpu) const {
+        return cpu >= 0 && cpu < cpuCount() ? nodeOfCpu[static_cast<size_t>(cpu)] : 0;
+    }
+
+private:
+    std::vector<int> nodeOfCpu;
+    int nodes{ 1 };
+
+    CpuTopology() {
+#ifdef _WIN32
+        WORD groups = GetActiveProcessorGroupCount();
+        nodeOfCpu.assign(static_cast<size_t>(groups) * 64, 0);
+        for (WORD g = 0; g < groups; ++g) {
+            for (BYTE n = 0; n < 64 && n < GetActiveProcessorCount(g); ++n) {
+                PROCESSOR_NUMBER processor{ g, n, 0 };
+                USHORT node = 0;
+                if (GetNumaProcessorNodeEx(&processor, &node))
+                    nodeOfCpu[static_cast<size_t>(g) * 64 + n] = node;
+            }
+        }
+        ULONG highest = 0;
+        if (GetNumaHighestNodeNumber(&highest))
+            nodes = static_cast<int>(highest) + 1;
+#else
+        nodeOfCpu.assign(static_cast<size_t>(std::max(1L, sysconf(_SC_NPROCESSORS_CONF))), 0);
+        // 节点编号可能不连续，逐个尝试直到连续缺失若干个 / Node numbers may have gaps; probe until several in a row are missing
+        for (int node = 0, missing = 0; missing < 8; ++node) {
+            std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            std::string list;
+            if (!std::getline(in, list)) {
+                ++missing;
+                continue;
+            }
+            missing = 0;
+            nodes = node + 1;
+            std::vector<int> cpus;
+            if (!parseCpuList(list, cpus))
+                continue;
+            for (int cpu : cpus) {
+                if (cpu >= cpuCount())
+                    nodeOfCpu.resize(static_cast<size_t>(cpu) + 1, 0);
+                nodeOfCpu[static_cast<size_t>(cpu)] = node;
+            }
+        }
+#endif
+    }
+};
+
+// 当前线程正在运行的 CPU，未知时为 -1 / The CPU the calling thread runs on; -1 if unknown
+inline int currentCpu() {
+#ifdef _WIN32
+    PROCESSOR_NUMBER processor;
+    GetCurrentProcessorNumberEx(&processor);
+    return processor.Group * 64 + processor.Number;
+#else
+    return sched_getcpu();
+#endif
+}
+
+// 当前线程所在的节点 / The node the calling thread runs on
+inline int currentNode() {
+    return CpuTopology::instance().nodeOf(currentCpu());
+}
+
+// 把当前线程固定在一个 CPU 上 / Pin the calling thread to one CPU
+inline bool pinThread(int cpu) {
+#ifdef _WIN32
+    GROUP_AFFINITY affinity{};
+    affinity.Group = static_cast<WORD>(cpu / 64);
+    affinity.Mask = KAFFINITY{ 1 } << (cpu % 64);
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#endif
+}
+
+// 最近处理该套接字数据包的 CPU（Linux 的 SO_INCOMING_CPU，Windows 的 RSS 处理器），未知时为 -1
+// The CPU that last processed the socket's packets (SO_INCOMING_CPU on Linux, the RSS processor
+// on Windows); -1 if unknown.
+inline int incomingCpu(SOCKET s) {
+#ifdef _WIN32
+    SOCKET_PROCESSOR_AFFINITY affinity{};
+    DWORD bytes = 0;
+    if (WSAIoctl(s, SIO_QUERY_RSS_PROCESSOR_INFO, nullptr, 0, &affinity, sizeof(affinity), &bytes, nullptr, nullptr) != 0)
+        return -1;
+    return affinity.Processor.Group * 64 + affinity.Processor.Number;
+#else
+    int cpu = -1;
+    socklen_t len = sizeof(cpu);
+    if (getsockopt(s, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) != 0)
+        return -1;
+    return cpu;
+#endif
+}
+
+// 让 SO_REUSEPORT 组把在 cpu 上收到 SYN 的连接交给这个监听套接字（Linux 6.2 起），Windows 上返回 false
+// Have the SO_REUSEPORT group give this listener the connections whose SYN arrived on cpu (Linux
+// 6.2 and later); returns false on Windows.
+inline bool setIncomingCpu(SOCKET listener, int cpu) {
+#ifdef _WIN32
+    (void)listener;
+    (void)cpu;
+    return false;
+#else
+    return setsockopt(listener, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) == 0;
+#endif
+}
+
+// 在节点 node 上分配 bytes 字节（按页取整、已清零），用 freeNodeLocal 释放
+// Allocate bytes (rounded to pages, zeroed) on node; free with freeNodeLocal.
+inline void* allocateNodeLocal(size_t bytes, int node) {
+#ifdef _WIN32
+    return VirtualAllocExNuma(GetCurrentProcess(), nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE,
+        static_cast<DWORD>(node));
+#else
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        return nullptr;
+    // 多节点时优先使用该节点的页，不论之后由哪个线程首先写入；内存不足时仍可退回其他节点
+    // With several nodes prefer that node's pages whichever thread writes them first; other nodes
+    // are still used when it runs out.
+    if (CpuTopology::instance().nodeCount() > 1) {
+        constexpr unsigned long MPOL_PREFERRED_MODE = 1;
+        unsigned long mask[16]{};
+        if (node >= 0 && node < static_cast<int>(sizeof(mask) * 8)) {
+            mask[node / 64] = 1UL << (node % 64);
+            syscall(SYS_mbind, p, bytes, MPOL_PREFERRED_MODE, mask, sizeof(mask) * 8 + 1, 0);
+        }
+    }
+    return p;
+#endif
+}
+
+inline void freeNodeLocal(void* p, size_t bytes) {
+#ifdef _WIN32
+    (void)bytes;
+    VirtualFree(p, 0, MEM_RELEASE);
+#else
+    munmap(p, bytes);
+#endif
+}